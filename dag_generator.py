@@ -13,11 +13,25 @@ Usage:
     python dag_generator.py --campaign ALL --jobs 50 --output full_production.dag
     python dag_generator.py --list-campaigns
 
+Job sizing from measured throughput (cost profiles written by shower_normal /
+shower_phi --calibrate K):
+    python dag_generator.py --campaign JJP_DPS1 \
+        --cost-profile pool_jpsi_g:normal=cost_jpsi_normal.json \
+        --cost-profile pool_jpsi_g:phi=cost_jpsi_phi.json \
+        --target-walltime 24 --lhe-events-per-file 50000 --target-events 100000
+
+Shared shower banks (each pool and shower mode showered once, campaign jobs
+mix event ranges of the banks):
+    python dag_generator.py --campaign ALL --jobs 50 --shared-banks \
+        --bank-events 1000 --bank-shard-events 20000
+
 Author: MC Production Team
 Date: 2024
 """
 
 import argparse
+import json
+import math
 import os
 import sys
 from datetime import datetime
@@ -201,6 +215,125 @@ CAMPAIGNS: Dict[str, Campaign] = {
     ),
 }
 
+# =============================================================================
+# Job Sizing
+# =============================================================================
+
+class JobPlan:
+    """Events per processing job and job count for one campaign"""
+    def __init__(self, events_per_job, n_jobs, est_seconds, est_accepted):
+        self.events_per_job = events_per_job
+        self.n_jobs = n_jobs
+        self.est_seconds = est_seconds
+        self.est_accepted = est_accepted
+
+class CostModel:
+    """Per-job cost estimate from shower cost profiles (shower --calibrate)
+
+    Each source of a job showers the same number n of LHE events (the mixer
+    stops at the shortest source), so a job costs
+
+        T(n) = sum_s init_s + n * (sum_s sec_per_lhe_event_s + min_s accept_s * post)
+
+    where post is the per-event cost of the steps after the shower (mixing,
+    GEN-SIM ... ntuple), measured separately. n is chosen so that T(n) hits the
+    target wall time.
+    """
+    def __init__(self, profiles, target_seconds, lhe_events_per_file,
+                 post_seconds_per_event=0.0, target_events=None):
+        self.profiles = profiles
+        self.target_seconds = target_seconds
+        self.lhe_events_per_file = lhe_events_per_file
+        self.post_seconds_per_event = post_seconds_per_event
+        self.target_events = target_events
+
+    @staticmethod
+    def parse_profiles(specs):
+        """Load POOL:MODE=FILE (or POOL=FILE, mode taken from the profile) specs"""
+        profiles = {}
+        for spec in specs:
+            if "=" not in spec:
+                raise ValueError(f"--cost-profile expects POOL:MODE=FILE, got: {spec}")
+            key, path = spec.split("=", 1)
+            with open(path) as f:
+                profile = json.load(f)
+            pool, _, mode = key.partition(":")
+            mode = mode or profile.get("mode")
+            if pool not in LHE_POOLS:
+                raise ValueError(f"Unknown pool in --cost-profile: {pool}")
+            if mode not in ("normal", "phi"):
+                raise ValueError(f"Unknown shower mode for {pool} in --cost-profile: {mode}")
+            profiles[(pool, mode)] = profile
+        return profiles
+
+    def profile(self, pool_name, mode):
+        if (pool_name, mode) not in self.profiles:
+            raise KeyError(f"No cost profile for {pool_name}:{mode}; "
+                           f"calibrate with shower_{mode} --calibrate K and pass --cost-profile")
+        return self.profiles[(pool_name, mode)]
+
+    def plan(self, campaign, default_jobs):
+        profiles = [self.profile(p, m) for p, m in zip(campaign.inputs, campaign.modes)]
+
+        init_sec = sum(p["init_sec"] for p in profiles)
+        accept = min(p["accept_fraction"] for p in profiles)
+        sec_per_event = (sum(p["sec_per_lhe_event"] for p in profiles)
+                         + accept * self.post_seconds_per_event)
+
+        n = int((self.target_seconds - init_sec) / sec_per_event) if sec_per_event > 0 else 0
+        if n < 1:
+            print(f"  [WARNING] {campaign.name}: target wall time below the cost of one event, using 1")
+            n = 1
+        n = min(n, self.lhe_events_per_file)
+
+        accepted = n * accept
+        if self.target_events and accepted > 0:
+            n_jobs = int(math.ceil(self.target_events / accepted))
+        else:
+            n_jobs = default_jobs
+
+        return JobPlan(n, n_jobs, init_sec + n * sec_per_event, accepted)
+
+class BankPlan:
+    """Shared shower banks (--shared-banks)
+
+    Every (pool, mode) pair used by the campaigns is showered once into a bank
+    of shards, one whole LHE file per shard, written to EOS_BASE/banks/<pool>_<mode>
+    (run_chain.sh --bank-dir). Processing jobs then only mix: each source of a
+    job takes events_per_job bank events, BANK:pool:first:count, with disjoint
+    ranges within a campaign. Campaigns share the banks from event 0, so the
+    shower cost scales with the pools, not the campaigns; with
+    disjoint_campaigns every campaign gets its own ranges instead (no event
+    reused between campaigns, at the cost of larger banks).
+
+    The shard size (accepted events per LHE file) is given or estimated from
+    the cost profiles, accept_fraction * lhe_events_per_file, less a 10% margin.
+    """
+    SHARD_MARGIN = 0.9
+
+    def __init__(self, events_per_job, shard_events=None, disjoint_campaigns=False,
+                 cost_model=None, target_events=None):
+        self.events_per_job = events_per_job
+        self.shard_events = shard_events
+        self.disjoint_campaigns = disjoint_campaigns
+        self.cost_model = cost_model
+        self.target_events = target_events
+
+    def events_per_shard(self, pool_name, mode):
+        if self.shard_events:
+            return self.shard_events
+        if not self.cost_model:
+            raise KeyError(f"Bank {pool_name}_{mode}: pass --bank-shard-events or cost profiles "
+                           f"with --lhe-events-per-file to size the shards")
+        profile = self.cost_model.profile(pool_name, mode)
+        n = int(profile["accept_fraction"] * self.cost_model.lhe_events_per_file * self.SHARD_MARGIN)
+        return max(1, n)
+
+    def n_jobs(self, default_jobs):
+        if self.target_events:
+            return int(math.ceil(self.target_events / self.events_per_job))
+        return default_jobs
+
 # =============================================================================
 # DAG Generator Class
 # =============================================================================
@@ -208,9 +341,14 @@ CAMPAIGNS: Dict[str, Campaign] = {
 class DAGGenerator:
     """Generate HTCondor DAGMan files for MC production"""
     
-    def __init__(self, output_dir: str, eos_output: str = EOS_BASE):
+    def __init__(self, output_dir: str, eos_output: str = EOS_BASE,
+                 cost_model: Optional[CostModel] = None, chain_args: str = "",
+                 banks: Optional[BankPlan] = None):
         self.output_dir = output_dir
         self.eos_output = eos_output
+        self.cost_model = cost_model
+        self.banks = banks
+        self.chain_args = chain_args  # extra run_chain.sh options for every processing job
         self.dag_lines: List[str] = []
         self.sub_files: Dict[str, str] = {}
         self.job_counter = 0
@@ -263,7 +401,8 @@ class DAGGenerator:
             f'inputs="{inputs_str}" '
             f'modes="{modes_str}" '
             f'analysis="{campaign.analysis_type}" '
-            f'n_sources="{campaign.n_sources}"'
+            f'n_sources="{campaign.n_sources}" '
+            f'extra_args="{self.chain_args}"'
         )
         self.dag_lines.append(f"RETRY {job_name} 2")
         
@@ -284,6 +423,20 @@ class DAGGenerator:
         
         processing_jobs = []
         
+        # Event-sliced jobs sized from cost profiles; otherwise one LHE file per source
+        plan = None
+        slices_per_file = 1
+        if self.cost_model:
+            plan = self.cost_model.plan(campaign, n_jobs)
+            n_jobs = plan.n_jobs
+            slices_per_file = max(1, self.cost_model.lhe_events_per_file // plan.events_per_job)
+            self.dag_lines.append(f"# Sizing: {plan.events_per_job} LHE events/source/job, "
+                                  f"~{plan.est_accepted:.0f} accepted, "
+                                  f"est. {plan.est_seconds / 3600:.1f} h, {n_jobs} jobs")
+            print(f"  [INFO] {campaign.name}: {plan.events_per_job} LHE events/source/job, "
+                  f"~{plan.est_accepted:.0f} accepted events/job, "
+                  f"est. {plan.est_seconds / 3600:.1f} h/job, {n_jobs} jobs")
+        
         # Collect unique pools needed
         unique_pools = list(set(campaign.inputs))
         pool_lhe_jobs: Dict[str, List[str]] = {}
@@ -294,7 +447,7 @@ class DAGGenerator:
             
             # Count how many times this pool is used
             usage_count = campaign.inputs.count(pool_name)
-            jobs_per_pool = n_jobs * usage_count
+            jobs_per_pool = int(math.ceil(n_jobs * usage_count / slices_per_file))
             
             if use_existing_lhe and pool.eos_path:
                 pool_lhe_jobs[pool_name] = []  # No jobs needed
@@ -315,7 +468,19 @@ class DAGGenerator:
                 usage_idx = pool_usage_counter[pool_name]
                 pool_usage_counter[pool_name] += 1
                 
-                if pool.eos_path:
+                if plan:
+                    # Slice g of the pool: file g // slices_per_file, events from skip
+                    g = job_id * campaign.inputs.count(pool_name) + usage_idx
+                    file_idx = g // slices_per_file
+                    skip = (g % slices_per_file) * plan.events_per_job
+                    if pool.eos_path:
+                        lhe_files.append(f"EOS:{pool_name}:{file_idx}:{usage_idx}:{skip}:{plan.events_per_job}")
+                    else:
+                        lhe_files.append(f"GEN:{pool_name}:{file_idx}:{skip}:{plan.events_per_job}")
+                        lhe_job_name = pool_lhe_jobs[pool_name][file_idx]
+                        if lhe_job_name not in parent_jobs:
+                            parent_jobs.append(lhe_job_name)
+                elif pool.eos_path:
                     # Use existing LHE from EOS (will be resolved at runtime)
                     lhe_files.append(f"EOS:{pool_name}:{job_id}:{usage_idx}")
                 else:
@@ -330,6 +495,113 @@ class DAGGenerator:
             
         return processing_jobs
     
+    def add_bank_jobs(self, bank_events: Dict[Tuple[str, str], int]) -> Dict[Tuple[str, str], List[str]]:
+        """Add the shard jobs of the shared shower banks to DAG
+
+        Shards of the banks of one pool shower distinct LHE files: the banks of
+        a pool take consecutive file ranges.
+        """
+        self.dag_lines.append(f"\n# ============================================")
+        self.dag_lines.append(f"# Shared Shower Banks")
+        self.dag_lines.append(f"# ============================================")
+        
+        bank_shards = {}
+        pool_files: Dict[str, List[Tuple[str, str, int]]] = {}
+        for (pool_name, mode), n_events in bank_events.items():
+            n_shards = int(math.ceil(n_events / self.banks.events_per_shard(pool_name, mode)))
+            pool_files.setdefault(pool_name, []).extend((pool_name, mode, k) for k in range(n_shards))
+            self.dag_lines.append(f"# Bank {pool_name}_{mode}: {n_events} events, {n_shards} shards")
+            print(f"  [INFO] Bank {pool_name}_{mode}: {n_events} events in {n_shards} shards")
+        
+        for pool_name, shards in pool_files.items():
+            pool = LHE_POOLS[pool_name]
+            lhe_jobs = self.add_lhe_generation_jobs(pool, len(shards))
+            
+            for file_idx, (_, mode, k) in enumerate(shards):
+                bank = f"{pool_name}_{mode}"
+                job_name = f"BANK_{bank}_{k}"
+                bank_shards.setdefault((pool_name, mode), []).append(job_name)
+                if pool.eos_path:
+                    inputs = f"EOS:{pool_name}:{file_idx}:0"
+                else:
+                    inputs = f"GEN:{pool_name}:{file_idx}"
+                
+                self.dag_lines.append(f"JOB {job_name} processing/templates/bank.sub")
+                self.dag_lines.append(
+                    f'VARS {job_name} bank="{bank}" '
+                    f'job_id="{k}" '
+                    f'inputs="{inputs}" '
+                    f'modes="{mode}" '
+                    f'bank_dir="{self.eos_output}/banks/{bank}" '
+                    f'extra_args="{self.chain_args}"'
+                )
+                self.dag_lines.append(f"RETRY {job_name} 2")
+                if lhe_jobs:
+                    self.dag_lines.append(f"PARENT {lhe_jobs[file_idx]} CHILD {job_name}")
+                    
+        return bank_shards
+    
+    def generate_banked_campaign_dag(self, campaign: Campaign, n_jobs: int,
+                                     offsets: Dict[Tuple[str, str], int],
+                                     bank_shards: Dict[Tuple[str, str], List[str]]) -> List[str]:
+        """Generate mixing-only processing jobs drawing from the shared banks"""
+        self.dag_lines.append(f"\n# ============================================")
+        self.dag_lines.append(f"# Campaign: {campaign.name}")
+        self.dag_lines.append(f"# Description: {campaign.description}")
+        self.dag_lines.append(f"# Sources: shared shower banks, {self.banks.events_per_job} events/source/job")
+        self.dag_lines.append(f"# ============================================")
+        
+        sources = list(zip(campaign.inputs, campaign.modes))
+        processing_jobs = []
+        for job_id in range(n_jobs):
+            # Range g of the bank: the sources of all jobs take consecutive ranges
+            bank_usage = {key: 0 for key in sources}
+            bank_inputs = []
+            for key in sources:
+                g = job_id * sources.count(key) + bank_usage[key]
+                bank_usage[key] += 1
+                first = offsets.get(key, 0) + g * self.banks.events_per_job
+                bank_inputs.append(f"BANK:{key[0]}:{first}:{self.banks.events_per_job}")
+            processing_jobs.append(self.add_processing_job(campaign, job_id, bank_inputs, []))
+        
+        # Every job waits for the complete banks of its sources (shard order)
+        parents = []
+        for key in dict.fromkeys(sources):
+            parents.extend(bank_shards[key])
+        self.dag_lines.append(f"PARENT {' '.join(parents)} CHILD {' '.join(processing_jobs)}")
+        
+        return processing_jobs
+    
+    def generate_shared_bank_dags(self, campaigns: List[Campaign], n_jobs: int) -> List[str]:
+        """Generate the bank stage and the mixing-only campaign stages"""
+        n_jobs = self.banks.n_jobs(n_jobs)
+        
+        # Events each campaign takes from each bank; ranges start at 0 in every
+        # campaign unless they are made disjoint
+        bank_events: Dict[Tuple[str, str], int] = {}
+        campaign_offsets = []
+        for campaign in campaigns:
+            sources = list(zip(campaign.inputs, campaign.modes))
+            offsets = {}
+            for key in dict.fromkeys(sources):
+                demand = sources.count(key) * n_jobs * self.banks.events_per_job
+                if self.banks.disjoint_campaigns:
+                    offsets[key] = bank_events.get(key, 0)
+                    bank_events[key] = offsets[key] + demand
+                else:
+                    offsets[key] = 0
+                    bank_events[key] = max(bank_events.get(key, 0), demand)
+            campaign_offsets.append(offsets)
+        
+        bank_shards = self.add_bank_jobs(bank_events)
+        
+        all_jobs = []
+        for campaign, offsets in zip(campaigns, campaign_offsets):
+            print(f"  [INFO] {campaign.name}: {n_jobs} mixing jobs, "
+                  f"{self.banks.events_per_job} bank events/source/job")
+            all_jobs.extend(self.generate_banked_campaign_dag(campaign, n_jobs, offsets, bank_shards))
+        return all_jobs
+    
     def generate_full_dag(self, campaigns: List[str], n_jobs: int) -> str:
         """Generate complete DAG file content"""
         self.dag_lines = []
@@ -339,7 +611,14 @@ class DAGGenerator:
         self.dag_lines.append("# Full MC Production DAG")
         self.dag_lines.append(f"# Generated: {datetime.now().isoformat()}")
         self.dag_lines.append(f"# Campaigns: {', '.join(campaigns)}")
-        self.dag_lines.append(f"# Jobs per campaign: {n_jobs}")
+        if self.banks:
+            self.dag_lines.append(f"# Jobs per campaign: {self.banks.n_jobs(n_jobs)} mixing jobs "
+                                  f"on shared shower banks")
+        elif self.cost_model:
+            self.dag_lines.append(f"# Jobs per campaign: sized from cost profiles "
+                                  f"({self.cost_model.target_seconds / 3600:.1f} h target)")
+        else:
+            self.dag_lines.append(f"# Jobs per campaign: {n_jobs}")
         self.dag_lines.append("# " + "=" * 70)
         self.dag_lines.append("")
         
@@ -350,13 +629,18 @@ class DAGGenerator:
         
         # Generate each campaign
         all_jobs = []
+        known = []
         for campaign_name in campaigns:
             if campaign_name not in CAMPAIGNS:
                 print(f"[WARNING] Unknown campaign: {campaign_name}, skipping")
                 continue
-            campaign = CAMPAIGNS[campaign_name]
-            jobs = self.generate_campaign_dag(campaign, n_jobs)
-            all_jobs.extend(jobs)
+            known.append(CAMPAIGNS[campaign_name])
+        if self.banks:
+            all_jobs = self.generate_shared_bank_dags(known, n_jobs)
+        else:
+            for campaign in known:
+                jobs = self.generate_campaign_dag(campaign, n_jobs)
+                all_jobs.extend(jobs)
             
         # Final summary node
         if all_jobs:
@@ -457,6 +741,16 @@ Examples:
   
   # Generate DAG for all campaigns
   python dag_generator.py --campaign ALL --jobs 20 --output full_mc.dag
+  
+  # Size jobs for 24 h from calibrated shower cost profiles, 100k mixed events
+  python dag_generator.py --campaign JJP_DPS1 \\
+      --cost-profile pool_jpsi_g:normal=cost_normal.json \\
+      --cost-profile pool_jpsi_g:phi=cost_phi.json \\
+      --target-walltime 24 --lhe-events-per-file 50000 --target-events 100000
+  
+  # Shower every pool/mode once into shared banks; campaign jobs only mix
+  python dag_generator.py --campaign ALL --jobs 50 --shared-banks \
+      --bank-events 1000 --bank-shard-events 20000
         """
     )
     
@@ -474,6 +768,34 @@ Examples:
                         help="List available LHE pools")
     parser.add_argument("--dry-run", action="store_true",
                         help="Print DAG content without writing files")
+    parser.add_argument("--cost-profile", action="append", default=[], metavar="POOL:MODE=FILE",
+                        help="Shower cost profile (shower_* --calibrate) for a pool/mode; repeatable")
+    parser.add_argument("--target-walltime", type=float,
+                        help="Target wall time per processing job in hours (requires --cost-profile)")
+    parser.add_argument("--target-events", type=int,
+                        help="Mixed events per campaign; sets the job count (default: --jobs)")
+    parser.add_argument("--lhe-events-per-file", type=int,
+                        help="Events per LHE pool file, used to slice files into jobs")
+    parser.add_argument("--post-shower-sec-per-event", type=float, default=0.0,
+                        help="Measured cost of mix + GEN-SIM ... ntuple per accepted event (default: 0)")
+    parser.add_argument("--reject-memo-dir", metavar="DIR",
+                        help="Shared directory (e.g. on EOS) for the shower reject memos; "
+                             "jobs skip LHE events that failed every retry in earlier jobs")
+    parser.add_argument("--adaptive-retry", action="store_true",
+                        help="Shower jobs learn their hadronization retry budget (run_chain.sh --adaptive-retry)")
+    parser.add_argument("--lhe-ledger", metavar="DIR",
+                        help="Shared ledger directory (e.g. on EOS) leasing unused LHE event ranges to "
+                             "jobs, so pool files are never showered twice per mode (see lhe_ledger.cc)")
+    parser.add_argument("--ledger-chunk", type=int,
+                        help="Lease granularity in events for new ledgers (default: 1000)")
+    parser.add_argument("--shared-banks", action="store_true",
+                        help="Shower each pool/mode once into a shared bank; campaign jobs mix bank events")
+    parser.add_argument("--bank-events", type=int, default=1000,
+                        help="Bank events per source per mixing job (default: 1000)")
+    parser.add_argument("--bank-shard-events", type=int,
+                        help="Accepted events per bank shard (one LHE file); default: from --cost-profile")
+    parser.add_argument("--disjoint-campaigns", action="store_true",
+                        help="Give every campaign its own bank events instead of sharing them")
     
     args = parser.parse_args()
     
@@ -503,13 +825,67 @@ Examples:
         print("Use --list-campaigns to see available options")
         sys.exit(1)
         
+    # Optional job sizing from measured shower throughput; shared banks only
+    # need the profiles (and LHE file size) to size their shards
+    cost_model = None
+    if args.shared_banks and args.cost_profile and not args.target_walltime:
+        if not args.lhe_events_per_file:
+            print("[ERROR] Bank shard sizing from --cost-profile needs --lhe-events-per-file")
+            sys.exit(1)
+        try:
+            profiles = CostModel.parse_profiles(args.cost_profile)
+        except (OSError, ValueError, KeyError) as e:
+            print(f"[ERROR] {e}")
+            sys.exit(1)
+        cost_model = CostModel(profiles, 0.0, args.lhe_events_per_file)
+    elif args.cost_profile or args.target_walltime:
+        if not (args.cost_profile and args.target_walltime and args.lhe_events_per_file):
+            print("[ERROR] Job sizing needs --cost-profile, --target-walltime and --lhe-events-per-file")
+            sys.exit(1)
+        try:
+            profiles = CostModel.parse_profiles(args.cost_profile)
+        except (OSError, ValueError, KeyError) as e:
+            print(f"[ERROR] {e}")
+            sys.exit(1)
+        cost_model = CostModel(profiles, args.target_walltime * 3600.0, args.lhe_events_per_file,
+                               args.post_shower_sec_per_event, args.target_events)
+        
+    banks = None
+    if args.shared_banks:
+        if args.bank_events < 1:
+            print("[ERROR] --bank-events must be positive")
+            sys.exit(1)
+        banks = BankPlan(args.bank_events, args.bank_shard_events, args.disjoint_campaigns,
+                         cost_model, args.target_events)
+        
     print(f"\n[INFO] Generating DAG for campaigns: {', '.join(campaigns)}")
-    print(f"[INFO] Jobs per campaign: {args.jobs}")
+    if banks:
+        print(f"[INFO] Shared shower banks, {args.bank_events} events/source/job"
+              + (", disjoint per campaign" if args.disjoint_campaigns else ""))
+    elif cost_model:
+        print(f"[INFO] Jobs sized for {args.target_walltime} h wall time")
+    else:
+        print(f"[INFO] Jobs per campaign: {args.jobs}")
     print(f"[INFO] Output file: {args.output}")
     
     # Generate DAG
-    generator = DAGGenerator(args.output_dir)
-    dag_content = generator.generate_full_dag(campaigns, args.jobs)
+    chain_opts = []
+    if args.reject_memo_dir:
+        chain_opts.append(f"--reject-memo-dir {args.reject_memo_dir}")
+    if args.adaptive_retry:
+        chain_opts.append("--adaptive-retry")
+    if args.lhe_ledger:
+        chain_opts.append(f"--lhe-ledger {args.lhe_ledger}")
+        if args.ledger_chunk:
+            chain_opts.append(f"--ledger-chunk {args.ledger_chunk}")
+    chain_args = " ".join(chain_opts)
+    generator = DAGGenerator(args.output_dir, cost_model=cost_model, chain_args=chain_args,
+                             banks=banks)
+    try:
+        dag_content = generator.generate_full_dag(campaigns, args.jobs)
+    except KeyError as e:
+        print(f"[ERROR] {e.args[0]}")
+        sys.exit(1)
     
     if args.dry_run:
         print("\n" + "=" * 70)
@@ -0,0 +1,554 @@
+// ==============================================================================
+// async_input.h - Batched asynchronous reads for the mixer inputs
+// ==============================================================================
+// The mixer takes one event from every source in turn. With plain ASCII
+// inputs on cold scratch disks each read waited for the disk, one source at a
+// time. Here all inputs share one ReadQueue that keeps several large reads
+// (kReadChunkBytes) in flight per file, so the disk queue stays full while
+// the parsers run:
+//
+//   ReadQueue      : fixed set of read slots in one buffer arena, used from
+//                    one thread. Reads go through io_uring (READ_FIXED into
+//                    the arena registered as kernel buffers; READV when the
+//                    registration is refused, e.g. by RLIMIT_MEMLOCK) or,
+//                    where io_uring is unavailable (old kernel or headers,
+//                    seccomp in containers, kernel.io_uring_disabled),
+//                    through a pool of pread threads.
+//   PrefetchReader : std::streambuf on a plain file, served from the slots it
+//                    holds in the queue; the parser reads straight out of the
+//                    slot buffers. The read-ahead spans all its slots while
+//                    reads are sequential and drops to one chunk after a seek
+//                    outside of it, growing back as reads stay sequential, so
+//                    offset reads (--require) do not drag whole windows along.
+//
+// No library is needed: the ring is set up with the raw system calls.
+// ==============================================================================
+
+#ifndef ASYNC_INPUT_H
+#define ASYNC_INPUT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define ASYNC_INPUT_URING 1
+#else
+#define ASYNC_INPUT_URING 0
+#endif
+
+enum ReadBackend { kReadSync = 0, kReadUring = 1, kReadThreads = 2 };
+
+const size_t kReadChunkBytes = 1 << 20;
+const int kDefaultReadAhead = 4;     // chunks in flight per input, besides the one parsed
+const int kMaxReadThreads = 8;
+
+// --input-io names: uring (falls back to threads), threads, off
+inline bool parseReadBackend(const std::string& name, ReadBackend& backend) {
+    if (name == "uring") backend = kReadUring;
+    else if (name == "threads") backend = kReadThreads;
+    else if (name == "off") backend = kReadSync;
+    else return false;
+    return true;
+}
+
+// One read in flight: length bytes of fd at offset into data
+struct ReadSlot {
+    char* data = nullptr;     // in the arena (registered buffer index)
+    unsigned index = 0;
+    int fd = -1;
+    uint64_t offset = 0;
+    size_t length = 0;
+    size_t bytes = 0;         // read so far; less than length only at the end of the file
+    bool done = true;
+    bool ok = true;
+    struct iovec iov;         // READV without registered buffers
+};
+
+// ------------------------------------------------------------------------------
+// Read queue
+// ------------------------------------------------------------------------------
+
+class ReadQueue {
+public:
+    ~ReadQueue() { stop(); }
+
+    // Slots of kReadChunkBytes for nReaders readers of readAhead chunks each;
+    // io_uring if asked for and available, otherwise up to nThreads pread threads
+    bool start(int nReaders, int readAhead, ReadBackend backend, int nThreads) {
+        stop();
+        if (backend == kReadSync || nReaders <= 0 || readAhead <= 0) return false;
+        m_slotsPerReader = readAhead + 1;
+        size_t nSlots = (size_t)nReaders * m_slotsPerReader;
+        m_arenaBytes = nSlots * kReadChunkBytes;
+        void* arena = mmap(nullptr, m_arenaBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED) return false;
+        m_arena = (char*)arena;
+        m_slots.resize(nSlots);
+        for (size_t i = 0; i < nSlots; ++i) {
+            m_slots[i].data = m_arena + i * kReadChunkBytes;
+            m_slots[i].index = i;
+            m_free.push_back(&m_slots[i]);
+        }
+
+        m_backend = backend;
+        if (m_backend == kReadUring && !startUring()) m_backend = kReadThreads;
+        if (m_backend == kReadThreads) {
+            m_stopping = false;
+            for (int i = 0; i < std::max(nThreads, 1); ++i) m_threads.emplace_back(&ReadQueue::run, this);
+        }
+        return true;
+    }
+
+    bool running() const { return m_backend != kReadSync; }
+    ReadBackend backend() const { return m_backend; }
+    int slotsPerReader() const { return m_slotsPerReader; }
+
+    std::string describe() const {
+        if (m_backend == kReadUring) return m_fixed ? "io_uring, registered buffers" : "io_uring";
+        if (m_backend == kReadThreads) return "pread threads (" + std::to_string(m_threads.size()) + ")";
+        return "synchronous";
+    }
+
+    // Slots for one reader (fewer if the queue is short) and their return
+    std::vector<ReadSlot*> acquire() {
+        size_t n = std::min(m_free.size(), (size_t)m_slotsPerReader);
+        std::vector<ReadSlot*> slots(m_free.end() - n, m_free.end());
+        m_free.resize(m_free.size() - n);
+        return slots;
+    }
+
+    void release(std::vector<ReadSlot*>& slots) {
+        for (ReadSlot* slot : slots) {
+            wait(slot);
+            m_free.push_back(slot);
+        }
+        slots.clear();
+    }
+
+    // Queues a read; with io_uring it is only handed to the kernel by flush()
+    // or wait(), so a reader's whole window goes in one system call
+    void submit(ReadSlot* slot, int fd, uint64_t offset, size_t length) {
+        slot->fd = fd;
+        slot->offset = offset;
+        slot->length = length;
+        slot->bytes = 0;
+        slot->ok = true;
+        slot->done = false;
+        if (m_backend == kReadUring) {
+            queueRead(slot);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(slot);
+        m_wake.notify_one();
+    }
+
+    void flush() {
+        if (m_backend == kReadUring && m_pending > 0) enter(0);
+    }
+
+    void wait(ReadSlot* slot) {
+        if (m_backend == kReadUring) {
+            while (!slot->done) {
+                if (!enter(1)) {
+                    slot->ok = false;
+                    slot->done = true;
+                }
+            }
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [slot] { return slot->done; });
+    }
+
+    void stop() {
+        for (auto& slot : m_slots) wait(&slot);
+        if (!m_threads.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wake.notify_all();
+            for (auto& t : m_threads) t.join();
+            m_threads.clear();
+        }
+        stopUring();
+        if (m_arena) munmap(m_arena, m_arenaBytes);
+        m_arena = nullptr;
+        m_slots.clear();
+        m_free.clear();
+        m_backend = kReadSync;
+    }
+
+private:
+    // Thread backend: complete reads with pread
+    void run() {
+        while (true) {
+            ReadSlot* slot;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+                if (m_jobs.empty()) return;
+                slot = m_jobs.front();
+                m_jobs.pop_front();
+            }
+            size_t bytes = 0;
+            bool ok = true;
+            while (bytes < slot->length) {
+                ssize_t n = pread(slot->fd, slot->data + bytes, slot->length - bytes, (off_t)(slot->offset + bytes));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    ok = n == 0;
+                    break;
+                }
+                bytes += n;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                slot->bytes = bytes;
+                slot->ok = ok;
+                slot->done = true;
+            }
+            m_done.notify_all();
+        }
+    }
+
+#if ASYNC_INPUT_URING
+    bool startUring() {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = (int)syscall(__NR_io_uring_setup, (unsigned)m_slots.size(), &params);
+        if (fd < 0) return false;
+        m_ringFd = fd;
+
+        m_sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool single = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+        single = params.features & IORING_FEAT_SINGLE_MMAP;
+#endif
+        if (single) m_sqRingBytes = m_cqRingBytes = std::max(m_sqRingBytes, m_cqRingBytes);
+        m_sqRing = mmap(nullptr, m_sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        m_cqRing = single ? m_sqRing
+                 : mmap(nullptr, m_cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        m_sqesBytes = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = mmap(nullptr, m_sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (m_sqRing == MAP_FAILED || m_cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+            if (m_sqRing == MAP_FAILED) m_sqRing = nullptr;
+            if (m_cqRing == MAP_FAILED) m_cqRing = nullptr;
+            if (sqes != MAP_FAILED) munmap(sqes, m_sqesBytes);
+            stopUring();
+            return false;
+        }
+        char* sq = (char*)m_sqRing;
+        char* cq = (char*)m_cqRing;
+        m_sqTail = (unsigned*)(sq + params.sq_off.tail);
+        m_sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+        m_sqArray = (unsigned*)(sq + params.sq_off.array);
+        m_sqes = (struct io_uring_sqe*)sqes;
+        m_cqHead = (unsigned*)(cq + params.cq_off.head);
+        m_cqTail = (unsigned*)(cq + params.cq_off.tail);
+        m_cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+        m_cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+        // One registered buffer per slot: the kernel maps them once instead of per read
+        std::vector<struct iovec> buffers(m_slots.size());
+        for (size_t i = 0; i < m_slots.size(); ++i) buffers[i] = {m_slots[i].data, kReadChunkBytes};
+        m_fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers.data(), (unsigned)buffers.size()) == 0;
+        return true;
+    }
+
+    void stopUring() {
+        if (m_sqes) munmap(m_sqes, m_sqesBytes);
+        if (m_cqRing && m_cqRing != m_sqRing) munmap(m_cqRing, m_cqRingBytes);
+        if (m_sqRing) munmap(m_sqRing, m_sqRingBytes);
+        if (m_ringFd >= 0) ::close(m_ringFd);
+        m_sqes = nullptr;
+        m_sqRing = m_cqRing = nullptr;
+        m_ringFd = -1;
+        m_fixed = false;
+        m_pending = 0;
+    }
+
+    // Adds the (rest of the) slot's read to the submission ring; one entry per
+    // slot at most, so the ring (one entry per slot) never overflows
+    void queueRead(ReadSlot* slot) {
+        unsigned tail = *m_sqTail;   // only this thread moves the tail
+        unsigned index = tail & *m_sqMask;
+        struct io_uring_sqe& sqe = m_sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.fd = slot->fd;
+        sqe.off = slot->offset + slot->bytes;
+        sqe.user_data = (uint64_t)(uintptr_t)slot;
+        if (m_fixed) {
+            sqe.opcode = IORING_OP_READ_FIXED;
+            sqe.addr = (uint64_t)(uintptr_t)(slot->data + slot->bytes);
+            sqe.len = slot->length - slot->bytes;
+            sqe.buf_index = slot->index;
+        } else {
+            slot->iov = {slot->data + slot->bytes, slot->length - slot->bytes};
+            sqe.opcode = IORING_OP_READV;
+            sqe.addr = (uint64_t)(uintptr_t)&slot->iov;
+            sqe.len = 1;
+        }
+        m_sqArray[index] = index;
+        __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++m_pending;
+    }
+
+    // Submits the queued reads, waits for minComplete completions and reaps
+    // all that are there; short reads are queued again for the rest
+    bool enter(unsigned minComplete) {
+        while (true) {
+            int n = (int)syscall(__NR_io_uring_enter, m_ringFd, m_pending, minComplete,
+                                 minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (n >= 0) {
+                m_pending -= std::min((unsigned)n, m_pending);
+                break;
+            }
+            if (errno != EINTR) return false;
+        }
+        unsigned head = *m_cqHead;
+        unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const struct io_uring_cqe& cqe = m_cqes[head & *m_cqMask];
+            ReadSlot* slot = (ReadSlot*)(uintptr_t)cqe.user_data;
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                queueRead(slot);
+            } else if (cqe.res < 0) {
+                slot->ok = false;
+                slot->done = true;
+            } else {
+                slot->bytes += cqe.res;
+                if (cqe.res > 0 && slot->bytes < slot->length) queueRead(slot);
+                else slot->done = true;
+            }
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        return true;
+    }
+#else
+    bool startUring() { return false; }
+    void stopUring() {}
+    void queueRead(ReadSlot*) {}
+    bool enter(unsigned) { return false; }
+#endif
+
+    ReadBackend m_backend = kReadSync;
+    int m_slotsPerReader = 0;
+    char* m_arena = nullptr;
+    size_t m_arenaBytes = 0;
+    std::vector<ReadSlot> m_slots;
+    std::vector<ReadSlot*> m_free;
+
+    // Thread backend
+    std::vector<std::thread> m_threads;
+    std::deque<ReadSlot*> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_wake, m_done;
+    bool m_stopping = false;
+
+    // io_uring backend
+    int m_ringFd = -1;
+    bool m_fixed = false;         // buffers registered
+    unsigned m_pending = 0;       // queued, not yet submitted
+    void* m_sqRing = nullptr;
+    void* m_cqRing = nullptr;
+    size_t m_sqRingBytes = 0, m_cqRingBytes = 0, m_sqesBytes = 0;
+#if ASYNC_INPUT_URING
+    unsigned *m_sqTail = nullptr, *m_sqMask = nullptr, *m_sqArray = nullptr;
+    unsigned *m_cqHead = nullptr, *m_cqTail = nullptr, *m_cqMask = nullptr;
+    struct io_uring_sqe* m_sqes = nullptr;
+    struct io_uring_cqe* m_cqes = nullptr;
+#else
+    void* m_sqes = nullptr;
+#endif
+};
+
+// ------------------------------------------------------------------------------
+// Reader
+// ------------------------------------------------------------------------------
+
+class PrefetchReader : public std::streambuf {
+public:
+    ~PrefetchReader() { close(); }
+
+    // Takes the reader's slots from the queue and starts reading; false if the
+    // file cannot be opened or the queue has no slots left
+    bool open(const std::string& path, ReadQueue& queue) {
+        close();
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (m_fd < 0 || fstat(m_fd, &st) != 0) {
+            close();
+            return false;
+        }
+        m_queue = &queue;
+        m_free = queue.acquire();
+        if (m_free.empty()) {
+            close();
+            return false;
+        }
+        m_nSlots = m_free.size();
+        posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        m_size = (uint64_t)st.st_size;
+        m_failed = false;
+        m_chunkStart = 0;
+        m_nextOffset = 0;
+        m_window = maxWindow();
+        fill();
+        return true;
+    }
+
+    bool isOpen() const { return m_fd >= 0; }
+    bool failed() const { return m_failed; }
+
+    void close() {
+        if (m_queue) {
+            drain();
+            release();
+            m_queue->release(m_free);
+        }
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+        m_queue = nullptr;
+        setg(nullptr, nullptr, nullptr);
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        if (m_fd < 0 || m_failed) return traits_type::eof();
+        // Sequential read: widen the read-ahead again
+        m_window = std::min(2 * m_window, maxWindow());
+        if (!advance()) return traits_type::eof();
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        uint64_t here = m_chunkStart + (gptr() - eback());
+        if (dir == std::ios_base::beg) return seekpos(pos_type(off), which);
+        if (dir == std::ios_base::cur) return off == 0 ? pos_type(off_type(here)) : seekpos(pos_type(off_type(here) + off), which);
+        return seekpos(pos_type(off_type(m_size) + off), which);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        off_type target = off_type(pos);
+        if (m_fd < 0 || !(which & std::ios_base::in) || target < 0 || (uint64_t)target > m_size)
+            return pos_type(off_type(-1));
+        m_failed = false;
+
+        // Still in the current chunk
+        if (m_current && (uint64_t)target >= m_chunkStart && (uint64_t)target < m_chunkStart + (egptr() - eback())) {
+            setg(eback(), eback() + (target - m_chunkStart), egptr());
+            return pos;
+        }
+
+        // Keep the read-ahead if target is in it, otherwise restart there with one chunk
+        while (!m_ahead.empty() && m_ahead.front()->offset + m_ahead.front()->length <= (uint64_t)target) {
+            m_queue->wait(m_ahead.front());
+            m_free.push_back(m_ahead.front());
+            m_ahead.pop_front();
+        }
+        if (m_ahead.empty() || m_ahead.front()->offset > (uint64_t)target) {
+            drain();
+            m_nextOffset = target;
+            m_window = 1;
+        }
+        release();
+        if ((uint64_t)target == m_size) {
+            m_chunkStart = m_size;
+            return pos;
+        }
+        if (!advance()) return pos_type(off_type(-1));
+        setg(eback(), eback() + (target - m_chunkStart), egptr());
+        return pos;
+    }
+
+private:
+    size_t maxWindow() const { return std::max(m_nSlots, (size_t)2) - 1; }
+
+    // Queues chunks up to the read-ahead window, handed to the kernel at once
+    void fill() {
+        bool queued = false;
+        while (m_ahead.size() < m_window && !m_free.empty() && m_nextOffset < m_size) {
+            ReadSlot* slot = m_free.back();
+            m_free.pop_back();
+            size_t length = (size_t)std::min<uint64_t>(kReadChunkBytes, m_size - m_nextOffset);
+            m_queue->submit(slot, m_fd, m_nextOffset, length);
+            m_nextOffset += length;
+            m_ahead.push_back(slot);
+            queued = true;
+        }
+        if (queued) m_queue->flush();
+    }
+
+    // Makes the next chunk current
+    bool advance() {
+        release();
+        fill();
+        if (m_ahead.empty()) {
+            m_chunkStart = m_size;
+            return false;
+        }
+        m_current = m_ahead.front();
+        m_ahead.pop_front();
+        m_queue->wait(m_current);
+        fill();
+        if (!m_current->ok || m_current->bytes == 0) {
+            m_failed = true;    // read error or file truncated under us
+            return false;
+        }
+        m_chunkStart = m_current->offset;
+        char* begin = m_current->data;
+        setg(begin, begin, begin + m_current->bytes);
+        return true;
+    }
+
+    void release() {
+        if (m_current) m_free.push_back(m_current);
+        m_current = nullptr;
+        setg(nullptr, nullptr, nullptr);
+    }
+
+    // Waits for and discards the read-ahead
+    void drain() {
+        for (ReadSlot* slot : m_ahead) {
+            m_queue->wait(slot);
+            m_free.push_back(slot);
+        }
+        m_ahead.clear();
+    }
+
+    int m_fd = -1;
+    bool m_failed = false;
+    uint64_t m_size = 0;
+    uint64_t m_chunkStart = 0;    // file offset of the get area
+    uint64_t m_nextOffset = 0;    // next chunk to queue
+    size_t m_nSlots = 0;
+    size_t m_window = 1;          // chunks to keep in flight
+    ReadQueue* m_queue = nullptr;
+    ReadSlot* m_current = nullptr;
+    std::deque<ReadSlot*> m_ahead;     // queued, in file order
+    std::vector<ReadSlot*> m_free;
+};
+
+#endif // ASYNC_INPUT_H
@@ -0,0 +1,171 @@
+// ==============================================================================
+// bank_slice.cc - Cut an event range out of a shared shower bank
+// ==============================================================================
+// A shower bank is the set of binary shower outputs (shard_<k>.hepb) of one
+// LHE pool and shower mode, built once and shared by all campaigns (see
+// dag_generator.py --shared-banks). Each shard's summary sidecar (.evsum) is
+// its index: event count and byte offset of every event. The shards, in the
+// order given, form one bank with global event indices 0 .. N-1.
+//
+// bank_slice copies the events [first, first + count) of the bank into one
+// .hepb file with its own sidecar, which the mixer reads like a shower output.
+// Frames are copied without decoding; the event number of every frame is set
+// to its global bank index, so mixer provenance identifies bank events.
+//
+// No external dependencies:
+//   g++ -std=c++17 -O2 bank_slice.cc -o bank_slice
+//
+// Usage:
+//   ./bank_slice output.hepb --first N --count M shard_0.hepb [shard_1.hepb ...]
+//   ./bank_slice --list shard_0.hepb [shard_1.hepb ...]
+// ==============================================================================
+
+#include "event_summary.h"
+#include "hepmc_binary.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void printUsage(const char* progName) {
+    cerr << "\n=== Shower Bank Slice ===" << endl;
+    cerr << "Usage: " << progName << " output.hepb --first N --count M shard.hepb [shard.hepb ...]" << endl;
+    cerr << "       " << progName << " --list shard.hepb [shard.hepb ...]" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --first N  : Global index of the first bank event (default: 0)" << endl;
+    cerr << "  --count M  : Number of events, -1 for all up to the end of the bank (default: -1)" << endl;
+    cerr << "  --list     : Print the events per shard and the bank size" << endl;
+    cerr << "\nExit codes: 0 = full range copied, 3 = bank shorter than the range (partial copy)" << endl;
+}
+
+// Copies one frame at the current position of in, renumbered; returns the bytes written
+long copyFrame(FILE* in, FILE* out, int64_t eventNumber, vector<char>& buffer) {
+    uint32_t payloadBytes;
+    int64_t oldNumber;
+    if (!readBinaryFrameHeader(in, payloadBytes, oldNumber)) return -1;
+    buffer.resize(payloadBytes);
+    if (payloadBytes > 0 && fread(buffer.data(), 1, payloadBytes, in) != payloadBytes) return -1;
+    uint32_t frame[2] = {kBinaryFrameMagic, payloadBytes};
+    bool ok = fwrite(frame, sizeof(frame), 1, out) == 1
+           && fwrite(&eventNumber, sizeof(eventNumber), 1, out) == 1
+           && (payloadBytes == 0 || fwrite(buffer.data(), 1, payloadBytes, out) == payloadBytes);
+    return ok ? (long)(sizeof(frame) + sizeof(eventNumber) + payloadBytes) : -1;
+}
+
+int main(int argc, char* argv[]) {
+    string outputFile;
+    vector<string> shards;
+    long first = 0;
+    long count = -1;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--first" && i + 1 < argc) {
+            first = atol(argv[++i]);
+        } else if (arg == "--count" && i + 1 < argc) {
+            count = atol(argv[++i]);
+        } else if (arg == "--list") {
+            list = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 1;
+        } else if (outputFile.empty() && !list) {
+            outputFile = arg;
+        } else {
+            shards.push_back(arg);
+        }
+    }
+
+    if (shards.empty() || first < 0 || (!list && outputFile.empty())) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Bank index: events per shard from the sidecars
+    vector<size_t> shardEvents;
+    size_t bankEvents = 0;
+    string mode;
+    for (const auto& shard : shards) {
+        SummaryFile index;
+        if (!index.open(summaryPathFor(shard))) {
+            cerr << "Error: Cannot read the bank index " << summaryPathFor(shard) << endl;
+            return 1;
+        }
+        if (mode.empty()) mode = index.mode();
+        shardEvents.push_back(index.size());
+        bankEvents += index.size();
+    }
+
+    if (list) {
+        for (size_t s = 0; s < shards.size(); ++s) cout << shards[s] << " " << shardEvents[s] << endl;
+        cout << "Bank events: " << bankEvents << endl;
+        return 0;
+    }
+
+    size_t end = count < 0 ? bankEvents : min(bankEvents, (size_t)(first + count));
+    FILE* out = fopen(outputFile.c_str(), "wb");
+    SummaryWriter outIndex;
+    if (!out || !writeBinaryFileHeader(out) || !outIndex.open(summaryPathFor(outputFile), mode)) {
+        cerr << "Error: Cannot open output file: " << outputFile << " / " << summaryPathFor(outputFile) << endl;
+        return 1;
+    }
+
+    vector<char> buffer;
+    uint64_t outOffset = 16;   // file header
+    uint32_t nCopied = 0;
+    size_t shardFirst = 0;     // global index of the shard's first event
+    for (size_t s = 0; s < shards.size() && shardFirst < end; shardFirst += shardEvents[s], ++s) {
+        size_t from = max(shardFirst, (size_t)first), to = min(shardFirst + shardEvents[s], end);
+        if (from >= to) continue;
+
+        SummaryFile index;
+        FILE* in = fopen(shards[s].c_str(), "rb");
+        if (!in || !readBinaryFileHeader(in) || !index.open(summaryPathFor(shards[s]))) {
+            cerr << "Error: Cannot read bank shard " << shards[s] << endl;
+            if (in) fclose(in);
+            fclose(out);
+            return 1;
+        }
+        if (fseeko(in, (off_t)index[from - shardFirst].hepmcOffset, SEEK_SET) != 0) {
+            cerr << "Error: Cannot seek in bank shard " << shards[s] << endl;
+            fclose(in);
+            fclose(out);
+            return 1;
+        }
+        for (size_t g = from; g < to; ++g) {
+            long bytes = copyFrame(in, out, (int64_t)g, buffer);
+            if (bytes < 0) {
+                cerr << "Error: Corrupt event " << g - shardFirst << " in bank shard " << shards[s] << endl;
+                fclose(in);
+                fclose(out);
+                return 1;
+            }
+            EventSummary record = index[g - shardFirst];
+            record.hepmcOffset = outOffset;
+            record.eventIndex = nCopied++;
+            outIndex.write(record);
+            outOffset += bytes;
+        }
+        fclose(in);
+    }
+
+    outIndex.close();
+    if (fclose(out) != 0) {
+        cerr << "Error: Cannot write output file: " << outputFile << endl;
+        return 1;
+    }
+
+    size_t requested = count < 0 ? (bankEvents > (size_t)first ? bankEvents - first : 0) : (size_t)count;
+    cout << "Copied bank events " << first << " .. " << first + nCopied << " (" << nCopied << " of "
+         << requested << " requested, bank size " << bankEvents << ") to " << outputFile << endl;
+    if (nCopied < requested) {
+        cerr << "Warning: bank has only " << bankEvents << " events; range ends at " << first + requested << endl;
+        return 3;
+    }
+    return 0;
+}
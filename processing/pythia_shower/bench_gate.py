@@ -0,0 +1,357 @@
+#!/usr/bin/env python3
+"""
+Benchmark Regression Gate
+=========================
+
+Runs the shower/mixer benchmarks (bench_kernels, bench_shower.sh,
+bench_mixer.sh) several times, stores their JSON results as baselines and
+compares later runs against them.
+
+A metric regresses when its median moves in the bad direction by more than
+
+    max(--rel-tol, --noise-k * robust relative spread)
+
+where the spread is 1.4826 * MAD / median of the baseline and current samples
+(whichever is noisier), and by more than a small absolute floor per metric.
+Deterministic metrics (allocations/event) therefore fall back to --rel-tol,
+noisy ones (events/s on a busy machine) get a wider band.
+
+With --reference-bins DIR the baseline is not read from disk but measured in
+the same session with the binaries in DIR (e.g. the -O2 reference build kept
+by `make pgo`), and the speed-up of the current binaries is reported.
+
+Usage:
+    python3 bench_gate.py --update                 # record baselines
+    python3 bench_gate.py                          # compare, exit 1 on regression
+    python3 bench_gate.py --suite kernels --repeat 5
+    python3 bench_gate.py --suite-args mixer="--events 50 --format binary"
+    python3 bench_gate.py --suite shower,mixer --reference-bins pgo_reference
+
+Exit codes: 0 = no regression, 1 = regression, 2 = benchmark/baseline error.
+"""
+
+import argparse
+import json
+import os
+import shlex
+import socket
+import subprocess
+import sys
+import tempfile
+from datetime import datetime
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_BASELINE_DIR = os.path.join(SCRIPT_DIR, "bench_baselines")
+
+# Benchmark commands; the JSON output path is appended as "--json FILE"
+SUITES = {
+    "kernels": ["./bench_kernels", "--min-time", "0.5"],
+    "shower":  ["./bench_shower.sh", "--events", "200", "--mode", "both"],
+    "mixer":   ["./bench_mixer.sh", "--events", "100", "--particles", "5000", "--max-sources", "3"],
+}
+
+HIGHER_IS_BETTER = {"events_per_sec", "written_per_sec", "input_mb_per_sec"}
+LOWER_IS_BETTER = {"ns_per_event", "allocs_per_event", "bytes_per_event",
+                   "peak_rss_mb", "avg_retries"}
+
+# Changes smaller than this are never reported, whatever the relative change
+ABS_FLOOR = {
+    "ns_per_event": 1.0,
+    "allocs_per_event": 0.5,
+    "bytes_per_event": 64.0,
+    "peak_rss_mb": 5.0,
+    "avg_retries": 0.05,
+}
+
+
+def median(values):
+    s = sorted(values)
+    n = len(s)
+    if n == 0:
+        return 0.0
+    return s[n // 2] if n % 2 else 0.5 * (s[n // 2 - 1] + s[n // 2])
+
+
+def mad(values):
+    m = median(values)
+    return median([abs(v - m) for v in values])
+
+
+def relative_spread(values):
+    m = median(values)
+    if m == 0:
+        return 0.0
+    return 1.4826 * mad(values) / abs(m)
+
+
+# =============================================================================
+# Running benchmarks
+# =============================================================================
+
+def flatten_results(data):
+    """Map 'case/metric' -> value for one benchmark JSON document"""
+    metrics = {}
+    if "peak_rss_mb" in data:
+        metrics["process/peak_rss_mb"] = float(data["peak_rss_mb"])
+    for result in data.get("results", []):
+        for key, value in result.items():
+            if key in HIGHER_IS_BETTER or key in LOWER_IS_BETTER:
+                metrics[f"{result['name']}/{key}"] = float(value)
+    return metrics
+
+
+def reference_command(command, bin_dir):
+    """The same benchmark command running the binaries in bin_dir"""
+    if command[0].endswith(".sh"):
+        return command + ["--bin-dir", os.path.abspath(bin_dir)]
+    binary = os.path.join(os.path.abspath(bin_dir), os.path.basename(command[0]))
+    if not os.access(binary, os.X_OK):
+        raise RuntimeError(f"{binary} not found (reference build)")
+    return [binary] + command[1:]
+
+
+def run_suite(name, extra_args, repeat, verbose, bin_dir=None):
+    """Run one suite `repeat` times, return ('case/metric' -> [samples], command)"""
+    command = SUITES[name] + extra_args
+    if bin_dir:
+        command = reference_command(command, bin_dir)
+    samples = {}
+
+    for i in range(repeat):
+        fd, json_file = tempfile.mkstemp(prefix=f"bench_{name}_", suffix=".json")
+        os.close(fd)
+        try:
+            print(f"[INFO] {name}: run {i + 1}/{repeat}: {' '.join(command)}")
+            result = subprocess.run(command + ["--json", json_file], cwd=SCRIPT_DIR,
+                                    stdout=None if verbose else subprocess.PIPE,
+                                    stderr=subprocess.STDOUT, universal_newlines=True)
+            if result.returncode != 0:
+                if not verbose and result.stdout:
+                    print(result.stdout)
+                raise RuntimeError(f"{name} benchmark failed (exit code {result.returncode})")
+            with open(json_file) as f:
+                data = json.load(f)
+        finally:
+            os.remove(json_file)
+
+        for key, value in flatten_results(data).items():
+            samples.setdefault(key, []).append(value)
+
+    return samples, command
+
+
+# =============================================================================
+# Baselines
+# =============================================================================
+
+def baseline_path(baseline_dir, name):
+    return os.path.join(baseline_dir, f"{name}.json")
+
+
+def save_baseline(baseline_dir, name, samples, command):
+    os.makedirs(baseline_dir, exist_ok=True)
+    doc = {
+        "suite": name,
+        "command": command,
+        "host": socket.gethostname(),
+        "date": datetime.now().isoformat(timespec="seconds"),
+        "metrics": {key: {"median": median(values), "mad": mad(values), "samples": values}
+                    for key, values in sorted(samples.items())},
+    }
+    path = baseline_path(baseline_dir, name)
+    with open(path, "w") as f:
+        json.dump(doc, f, indent=2)
+        f.write("\n")
+    print(f"[OK] Baseline written: {path}")
+
+
+def load_baseline(baseline_dir, name):
+    path = baseline_path(baseline_dir, name)
+    if not os.path.exists(path):
+        return None
+    with open(path) as f:
+        return json.load(f)
+
+
+# =============================================================================
+# Comparison
+# =============================================================================
+
+def compare(name, baseline, samples, rel_tol, noise_k):
+    """Print a comparison table, return the number of regressions"""
+    if baseline.get("host") != socket.gethostname():
+        print(f"[WARNING] Baseline for {name} was recorded on {baseline.get('host')}, "
+              f"comparing on {socket.gethostname()}")
+
+    print(f"\n{name}:")
+    print(f"  {'metric':52} {'baseline':>12} {'current':>12} {'change':>9} {'allowed':>9}  status")
+    print("  " + "-" * 106)
+
+    n_regressions = 0
+    for key in sorted(set(baseline["metrics"]) | set(samples)):
+        if key not in samples:
+            print(f"  {key:52} {'':>12} {'':>12} {'':>9} {'':>9}  missing")
+            continue
+        if key not in baseline["metrics"]:
+            print(f"  {key:52} {'':>12} {median(samples[key]):12.4g} {'':>9} {'':>9}  new")
+            continue
+
+        metric = key.rsplit("/", 1)[1]
+        base_values = baseline["metrics"][key]["samples"]
+        base = median(base_values)
+        cur = median(samples[key])
+
+        noise = max(relative_spread(base_values), relative_spread(samples[key]))
+        allowed = max(rel_tol, noise_k * noise)
+
+        # Positive 'worse' means the metric moved in the bad direction
+        delta = cur - base
+        worse = -delta if metric in HIGHER_IS_BETTER else delta
+        rel_worse = worse / abs(base) if base != 0 else (float("inf") if worse > 0 else 0.0)
+        change = delta / abs(base) if base != 0 else 0.0
+
+        if worse > ABS_FLOOR.get(metric, 0.0) and rel_worse > allowed:
+            status = "REGRESSION"
+            n_regressions += 1
+        elif -worse > ABS_FLOOR.get(metric, 0.0) and -rel_worse > allowed:
+            status = "improved"
+        else:
+            status = "ok"
+
+        print(f"  {key:52} {base:12.4g} {cur:12.4g} {100 * change:+8.1f}% {100 * allowed:8.1f}%  {status}")
+
+    return n_regressions
+
+
+def print_speedups(name, reference, samples):
+    """Throughput of the current binaries relative to the reference build"""
+    ratios = []
+    for key in sorted(samples):
+        metric = key.rsplit("/", 1)[1]
+        if metric != "events_per_sec" or key not in reference:
+            continue
+        base = median(reference[key])
+        if base <= 0:
+            continue
+        ratio = median(samples[key]) / base
+        ratios.append(ratio)
+        print(f"  speed-up {key.rsplit('/', 1)[0]:43} {ratio:6.3f}x")
+    if ratios:
+        geomean = 1.0
+        for ratio in ratios:
+            geomean *= ratio
+        geomean **= 1.0 / len(ratios)
+        print(f"  speed-up {name + ' (geometric mean)':43} {geomean:6.3f}x")
+
+
+def parse_suite_args(values):
+    suite_args = {}
+    for value in values:
+        if "=" not in value:
+            raise ValueError(f"--suite-args expects SUITE=\"ARGS\", got: {value}")
+        name, args = value.split("=", 1)
+        if name not in SUITES:
+            raise ValueError(f"Unknown suite in --suite-args: {name}")
+        suite_args[name] = shlex.split(args)
+    return suite_args
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Benchmark regression gate for the shower/mixer programs",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  # Record baselines for all suites (5 runs each)
+  python3 bench_gate.py --update --repeat 5
+
+  # Compare the kernels only, 10%% minimum tolerance
+  python3 bench_gate.py --suite kernels --rel-tol 0.10
+        """
+    )
+    parser.add_argument("--suite", "-s", type=str, default="all",
+                        help="Comma-separated suites: kernels, shower, mixer, or all (default: all)")
+    parser.add_argument("--repeat", "-r", type=int, default=3,
+                        help="Runs per suite (default: 3)")
+    parser.add_argument("--update", action="store_true",
+                        help="Store the runs as the new baselines instead of comparing")
+    parser.add_argument("--baseline-dir", type=str, default=DEFAULT_BASELINE_DIR,
+                        help="Directory holding <suite>.json baselines (default: bench_baselines/)")
+    parser.add_argument("--rel-tol", type=float, default=0.05,
+                        help="Minimum relative tolerance (default: 0.05)")
+    parser.add_argument("--noise-k", type=float, default=3.0,
+                        help="Tolerance in units of the robust relative spread (default: 3.0)")
+    parser.add_argument("--suite-args", action="append", default=[], metavar='SUITE="ARGS"',
+                        help="Extra arguments for one suite, e.g. kernels=\"--events 500\"")
+    parser.add_argument("--reference-bins", type=str, default=None, metavar="DIR",
+                        help="Measure the baseline now with the binaries in DIR and report speed-ups")
+    parser.add_argument("--verbose", "-v", action="store_true",
+                        help="Show the benchmark output")
+
+    args = parser.parse_args()
+
+    suites = list(SUITES) if args.suite == "all" else args.suite.split(",")
+    for name in suites:
+        if name not in SUITES:
+            print(f"[ERROR] Unknown suite: {name}")
+            sys.exit(2)
+    if args.repeat < 1:
+        print("[ERROR] --repeat must be at least 1")
+        sys.exit(2)
+
+    try:
+        suite_args = parse_suite_args(args.suite_args)
+    except ValueError as e:
+        print(f"[ERROR] {e}")
+        sys.exit(2)
+
+    if args.update and args.reference_bins:
+        print("[ERROR] --update and --reference-bins are exclusive")
+        sys.exit(2)
+
+    n_regressions = 0
+    for name in suites:
+        baseline = None
+        if args.reference_bins:
+            try:
+                reference, command = run_suite(name, suite_args.get(name, []), args.repeat,
+                                               args.verbose, args.reference_bins)
+            except (RuntimeError, OSError, ValueError) as e:
+                print(f"[ERROR] {e}")
+                sys.exit(2)
+            baseline = {"host": socket.gethostname(), "command": command,
+                        "metrics": {key: {"samples": values} for key, values in reference.items()}}
+        elif not args.update:
+            baseline = load_baseline(args.baseline_dir, name)
+            if baseline is None:
+                print(f"[ERROR] No baseline for {name} in {args.baseline_dir}; run with --update first")
+                sys.exit(2)
+            # Compare like with like: reuse the recorded command unless overridden
+            if name not in suite_args:
+                suite_args[name] = baseline["command"][len(SUITES[name]):]
+
+        try:
+            samples, command = run_suite(name, suite_args.get(name, []), args.repeat, args.verbose)
+        except (RuntimeError, OSError, ValueError) as e:
+            print(f"[ERROR] {e}")
+            sys.exit(2)
+
+        if args.update:
+            save_baseline(args.baseline_dir, name, samples, command)
+        else:
+            n_regressions += compare(name, baseline, samples, args.rel_tol, args.noise_k)
+            if args.reference_bins:
+                print_speedups(name, reference, samples)
+
+    if args.update:
+        return
+
+    print("")
+    if n_regressions:
+        print(f"[ERROR] {n_regressions} metric(s) regressed")
+        sys.exit(1)
+    print("[OK] No regressions")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,666 @@
+// ==============================================================================
+// bench_kernels.cc - Microbenchmarks for the shower/mixer hot kernels
+// ==============================================================================
+// Measures ns/event and heap allocations/event for the functions that sit in
+// the inner loops of the production programs:
+//   - hasPhiMeson, hasValidJpsiMuons, hasValidUpsilonMuons, countParticles
+//     (run after every hadronization retry in shower_normal/shower_phi)
+//   - fillEventSummary (once per written event, summary sidecar)
+//   - the same muon cuts as a compiled --select expression (selection_expr.h)
+//   - the retry-loop state restore (event + parton systems copy-back)
+//   - convertToHepMC2, mergeEvents, countParticles (event_mixer_multisource)
+//   - the flat event path that replaced them (flat_event.h): hepmc3ToBinary,
+//     pythiaToFlat, mergeFlatEvents + flatToHepMC2, countParticles on flat events
+//   - HepMC3 text of the mixer's --hepmc3 output: flat writer (flat_output.h)
+//     against binaryToHepMC3 + WriterAscii
+//   - batch pT/eta/phi and acceptance kernels (kinematics_simd.h) against the
+//     per-particle libm versions, on all particles of the HepMC sample
+//
+// The event sample is either synthetic (gg -> gg with ISR/FSR/MPI, or
+// gg -> J/psi g, generated in-process with the production tune) or recorded
+// (an LHE file showered with the same settings and/or a HepMC3 file written
+// by the shower programs).
+//
+// Compilation (in CMSSW environment):
+//   g++ -std=c++17 -O2 bench_kernels.cc -o bench_kernels \
+//       $(pythia8-config --cxxflags --libs) \
+//       -I$HEPMC3/include -I$HEPMC2/include \
+//       -L$HEPMC3/lib64 -L$HEPMC2/lib -lHepMC3 -lHepMC
+//
+// With --json FILE the results (and the peak RSS of the run) are also written
+// as JSON for bench_gate.py.
+//
+// Usage:
+//   ./bench_kernels [--events N] [--min-time SEC] [--process gg|jpsi]
+//                   [--lhe input.lhe] [--hepmc input.hepmc] [--seed N]
+//                   [--json results.json]
+// ==============================================================================
+
+#include "Pythia8/Pythia.h"
+#include "Pythia8Plugins/HepMC3.h"
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/ReaderAscii.h"
+#include "HepMC3/WriterAscii.h"
+
+#include "HepMC/GenEvent.h"
+
+#include "shower_selection.h"
+#include "hepmc_convert.h"
+#include "hepmc3_binary.h"
+#include "flat_pythia.h"
+#include "flat_output.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+using namespace Pythia8;
+using namespace std;
+
+// ------------------------------------------------------------------------------
+// Allocation counting
+// ------------------------------------------------------------------------------
+// Global operator new/delete replacements; the counters are only read around
+// the timed loops, so plain integers are enough (the benchmark is single
+// threaded).
+
+static size_t g_allocCount = 0;
+static size_t g_allocBytes = 0;
+
+void* operator new(size_t size) {
+    ++g_allocCount;
+    g_allocBytes += size;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    ++g_allocCount;
+    g_allocBytes += size;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ------------------------------------------------------------------------------
+// Benchmark harness
+// ------------------------------------------------------------------------------
+
+struct BenchResult {
+    string name;
+    long events = 0;
+    double nsPerEvent = 0.0;
+    double allocsPerEvent = 0.0;
+    double bytesPerEvent = 0.0;
+};
+
+// Keeps results observable so the optimizer cannot drop the kernel calls
+static volatile long g_sink = 0;
+
+// Discards written text, counting the bytes (text writer benches)
+class NullBuffer : public streambuf {
+public:
+    long bytes = 0;
+
+protected:
+    int_type overflow(int_type c) override { ++bytes; return traits_type::not_eof(c); }
+    streamsize xsputn(const char*, streamsize n) override { bytes += n; return n; }
+};
+
+// Run body(i) over all items, repeating full passes until minSeconds elapsed.
+// One untimed warm-up pass fills caches and lazily allocated buffers.
+template <class Body>
+BenchResult runBench(const string& name, size_t nItems, double minSeconds, Body&& body) {
+    BenchResult result;
+    result.name = name;
+    if (nItems == 0) return result;
+
+    for (size_t i = 0; i < nItems; ++i) body(i);
+
+    size_t allocCount0 = g_allocCount;
+    size_t allocBytes0 = g_allocBytes;
+    auto t0 = chrono::steady_clock::now();
+    double elapsed = 0.0;
+    long calls = 0;
+
+    do {
+        for (size_t i = 0; i < nItems; ++i) body(i);
+        calls += nItems;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    } while (elapsed < minSeconds);
+
+    result.events = calls;
+    result.nsPerEvent = 1e9 * elapsed / calls;
+    result.allocsPerEvent = double(g_allocCount - allocCount0) / calls;
+    result.bytesPerEvent = double(g_allocBytes - allocBytes0) / calls;
+    return result;
+}
+
+void printResults(const vector<BenchResult>& results) {
+    cout << "\n" << left << setw(34) << "Kernel"
+         << right << setw(12) << "calls"
+         << setw(14) << "ns/event"
+         << setw(14) << "allocs/event"
+         << setw(14) << "bytes/event" << endl;
+    cout << string(88, '-') << endl;
+    for (const auto& r : results) {
+        cout << left << setw(34) << r.name
+             << right << setw(12) << r.events
+             << setw(14) << fixed << setprecision(1) << r.nsPerEvent
+             << setw(14) << setprecision(2) << r.allocsPerEvent
+             << setw(14) << setprecision(0) << r.bytesPerEvent << endl;
+    }
+    cout << string(88, '-') << endl;
+}
+
+// Machine-readable results for bench_gate.py
+bool writeJson(const string& file, const vector<BenchResult>& results, const string& sample) {
+    ofstream out(file);
+    if (!out.is_open()) return false;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    out << "{\n  \"benchmark\": \"kernels\",\n"
+        << "  \"sample\": \"" << sample << "\",\n"
+        << "  \"peak_rss_mb\": " << usage.ru_maxrss / 1024.0 << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"events\": " << r.events
+            << ", \"ns_per_event\": " << setprecision(6) << r.nsPerEvent
+            << ", \"events_per_sec\": " << (r.nsPerEvent > 0 ? 1e9 / r.nsPerEvent : 0.0)
+            << ", \"allocs_per_event\": " << r.allocsPerEvent
+            << ", \"bytes_per_event\": " << r.bytesPerEvent << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return out.good();
+}
+
+// ------------------------------------------------------------------------------
+// Event samples
+// ------------------------------------------------------------------------------
+
+struct PartonState {
+    Event event;
+    PartonSystems partonSystems;
+};
+
+// Production settings of shower_normal (tune, colour reconnection, decays)
+void configurePythia(Pythia& pythia, const string& process, const string& lheFile, int seed) {
+    if (!lheFile.empty()) {
+        pythia.readString("Beams:frameType = 4");
+        pythia.readString("Beams:LHEF = " + lheFile);
+    } else if (process == "jpsi") {
+        pythia.readString("Charmonium:gg2ccbar(3S1)[3S1(1)]g = on");
+        pythia.readString("PhaseSpace:pTHatMin = 6.");
+    } else {
+        pythia.readString("HardQCD:gg2gg = on");
+        pythia.readString("PhaseSpace:pTHatMin = 4.");
+    }
+    pythia.readString("Beams:eCM = 13600.");
+
+    pythia.readString("PartonLevel:ISR = on");
+    pythia.readString("PartonLevel:FSR = on");
+    pythia.readString("PartonLevel:MPI = on");
+    pythia.readString("HadronLevel:all = off");
+
+    pythia.readString("ColourReconnection:reconnect = on");
+    pythia.readString("ColourReconnection:mode = 1");
+    pythia.readString("ColourReconnection:allowDoubleJunRem = off");
+    pythia.readString("ColourReconnection:m0 = 0.3");
+    pythia.readString("ColourReconnection:allowJunctions = on");
+    pythia.readString("ColourReconnection:junctionCorrection = 1.20");
+    pythia.readString("ColourReconnection:timeDilationMode = 2");
+    pythia.readString("ColourReconnection:timeDilationPar = 0.18");
+
+    pythia.readString("Tune:pp = 14");
+    pythia.readString("Tune:ee = 7");
+    pythia.readString("MultipartonInteractions:pT0Ref = 2.4024");
+    pythia.readString("MultipartonInteractions:ecmPow = 0.25208");
+    pythia.readString("MultipartonInteractions:expPow = 1.6");
+
+    pythia.readString("443:onMode = off");
+    pythia.readString("443:onIfMatch = 13 -13");
+    pythia.readString("333:onMode = off");
+    pythia.readString("333:onIfMatch = 321 -321");
+    pythia.readString("553:onMode = off");
+    pythia.readString("553:onIfMatch = 13 -13");
+
+    pythia.readString("Random:setSeed = on");
+    pythia.readString("Random:seed = " + to_string(seed));
+    pythia.readString("Next:numberCount = 0");
+    pythia.readString("Print:quiet = on");
+}
+
+// Read up to maxEvents recorded HepMC3 events
+vector<unique_ptr<HepMC3::GenEvent>> readHepMC3(const string& file, int maxEvents) {
+    vector<unique_ptr<HepMC3::GenEvent>> events;
+    HepMC3::ReaderAscii reader(file);
+    while (maxEvents <= 0 || (int)events.size() < maxEvents) {
+        auto evt = make_unique<HepMC3::GenEvent>();
+        if (!reader.read_event(*evt) || reader.failed()) break;
+        events.push_back(std::move(evt));
+    }
+    return events;
+}
+
+void printUsage(const char* progName) {
+    cerr << "\n=== Shower/Mixer Kernel Benchmarks ===" << endl;
+    cerr << "Usage: " << progName << " [options]" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --events N      : Number of events in the sample (default: 200)" << endl;
+    cerr << "  --min-time SEC  : Minimum timed duration per kernel (default: 1.0)" << endl;
+    cerr << "  --process P     : Synthetic process: gg (gg->gg + MPI) or jpsi (default: gg)" << endl;
+    cerr << "  --lhe FILE      : Shower a recorded LHE file instead of synthetic events" << endl;
+    cerr << "  --hepmc FILE    : Use recorded HepMC3 events for the mixer kernels" << endl;
+    cerr << "  --seed N        : Pythia random seed (default: 12345)" << endl;
+    cerr << "  --json FILE     : Also write the results as JSON" << endl;
+}
+
+// One J/psi with two recoil copies before its mu+ mu- decay: every event view
+// must count it once, in N*name selection terms and in the summary sidecar
+void checkCopyCounting(Pythia8::ParticleData& particleData) {
+    const double mJpsi = 3.0969;
+    BinaryEvent flat;
+    int prod = -1;
+    for (int copy = 0; copy < 3; ++copy) {
+        int p = flat.addParticle(443, 2, prod, 10.0, 0.0, 0.0, sqrt(100.0 + mJpsi * mJpsi), mJpsi);
+        prod = flat.addVertex();
+        flat.endVertex[p] = prod;
+    }
+    const double mMu = 0.10566;
+    flat.addParticle(13, 1, prod, 5.0, 2.0, 1.0, sqrt(30.0 + mMu * mMu), mMu);
+    flat.addParticle(-13, 1, prod, 5.0, -2.0, -1.0, sqrt(30.0 + mMu * mMu), mMu);
+    FlatLinks links;
+    links.build(flat);
+
+    Pythia8::Event event;
+    event.init("copy check", &particleData);
+    flatToPythia(flat, links, event);
+    HepMC3::GenEvent evt3;
+    binaryToHepMC3(flat, evt3);
+
+    SelectionProgram twoJpsi, oneJpsi;
+    SelectionState state;
+    string error;
+    twoJpsi.compile("2*jpsi(443)", error);
+    oneJpsi.compile("jpsi(443)->mu+mu- pT>2.5 |eta|<2.4", error);
+
+    EventSummary summaries[3];
+    fillEventSummary(event, 2.5, 2.4, summaries[0]);
+    fillEventSummary(flat, links, 2.5, 2.4, summaries[1]);
+    fillEventSummary(evt3, 2.5, 2.4, summaries[2]);
+    bool twoMatched[3] = {twoJpsi.match(PythiaEventView{event}, state),
+                          twoJpsi.match(FlatEventView{flat, links}, state),
+                          twoJpsi.match(HepMC3EventView(evt3), state)};
+    bool oneMatched[3] = {oneJpsi.match(PythiaEventView{event}, state),
+                          oneJpsi.match(FlatEventView{flat, links}, state),
+                          oneJpsi.match(HepMC3EventView(evt3), state)};
+
+    const char* names[3] = {"Pythia", "flat", "HepMC3"};
+    for (int v = 0; v < 3; ++v) {
+        if (twoMatched[v] || !oneMatched[v] || summaries[v].nJpsi != 1 || summaries[v].nJpsiAccepted != 1) {
+            cerr << "Warning: " << names[v] << " view counts a J/psi with copies as " << (int)summaries[v].nJpsi
+                 << " (2*jpsi " << (twoMatched[v] ? "matches" : "does not match") << ")" << endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int nEvents = 200;
+    double minTime = 1.0;
+    string process = "gg";
+    string lheFile;
+    string hepmcFile;
+    string jsonFile;
+    int seed = 12345;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--events" && i + 1 < argc) {
+            nEvents = atoi(argv[++i]);
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            minTime = atof(argv[++i]);
+        } else if (arg == "--process" && i + 1 < argc) {
+            process = argv[++i];
+        } else if (arg == "--lhe" && i + 1 < argc) {
+            lheFile = argv[++i];
+        } else if (arg == "--hepmc" && i + 1 < argc) {
+            hepmcFile = argv[++i];
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonFile = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (process != "gg" && process != "jpsi") {
+        cerr << "Error: Unknown process: " << process << endl;
+        return 1;
+    }
+
+    cout << "\n=== Shower/Mixer Kernel Benchmarks ===" << endl;
+    cout << "Sample:       " << (lheFile.empty() ? "synthetic " + process : "recorded " + lheFile) << endl;
+    cout << "Mixer input:  " << (hepmcFile.empty() ? "from sample" : hepmcFile) << endl;
+    cout << "Events:       " << nEvents << endl;
+    cout << "Min time:     " << minTime << " s per kernel" << endl;
+    cout << "======================================\n" << endl;
+
+    // Build the event sample
+    Pythia pythia;
+    configurePythia(pythia, process, lheFile, seed);
+    if (!pythia.init()) {
+        cerr << "Pythia initialization failed!" << endl;
+        return 1;
+    }
+
+    HepMC3::Pythia8ToHepMC3 toHepMC;
+    vector<PartonState> partonStates;
+    vector<Event> hadronEvents;
+    vector<unique_ptr<HepMC3::GenEvent>> hepmc3Events;
+    long nParticles = 0;
+    int iAbort = 0;
+
+    while ((int)hadronEvents.size() < nEvents) {
+        if (!pythia.next()) {
+            if (pythia.info.atEndOfFile()) break;
+            if (++iAbort < 10) continue;
+            cerr << "Event generation aborted prematurely!" << endl;
+            break;
+        }
+
+        partonStates.push_back({pythia.event, pythia.partonSystems});
+        if (!pythia.forceHadronLevel()) {
+            partonStates.pop_back();
+            continue;
+        }
+
+        hadronEvents.push_back(pythia.event);
+        nParticles += pythia.event.size();
+
+        if (hepmcFile.empty()) {
+            auto evt = make_unique<HepMC3::GenEvent>();
+            toHepMC.fill_next_event(pythia, evt.get());
+            hepmc3Events.push_back(std::move(evt));
+        }
+    }
+
+    if (!hepmcFile.empty()) {
+        hepmc3Events = readHepMC3(hepmcFile, nEvents);
+    }
+
+    if (hadronEvents.empty()) {
+        cerr << "Error: No events in sample" << endl;
+        return 1;
+    }
+
+    long nParticles3 = 0;
+    for (const auto& evt : hepmc3Events) nParticles3 += evt->particles().size();
+
+    cout << "Sample ready: " << hadronEvents.size() << " Pythia events ("
+         << nParticles / (long)hadronEvents.size() << " entries/event), "
+         << hepmc3Events.size() << " HepMC3 events ("
+         << (hepmc3Events.empty() ? 0 : nParticles3 / (long)hepmc3Events.size())
+         << " particles/event)" << endl;
+
+    // HepMC2 copies for the mixer-side countParticles
+    vector<unique_ptr<HepMC::GenEvent>> hepmc2Events;
+    for (size_t i = 0; i < hepmc3Events.size(); ++i) {
+        hepmc2Events.emplace_back(convertToHepMC2(*hepmc3Events[i], i));
+    }
+
+    // Flat copies for the mixer's flat path
+    vector<BinaryEvent> flatEvents(hepmc3Events.size());
+    for (size_t i = 0; i < hepmc3Events.size(); ++i) hepmc3ToBinary(*hepmc3Events[i], flatEvents[i]);
+
+    // Run the kernels
+    vector<BenchResult> results;
+    size_t nHad = hadronEvents.size();
+    size_t nHepMC = hepmc3Events.size();
+
+    results.push_back(runBench("hasPhiMeson", nHad, minTime, [&](size_t i) {
+        g_sink += hasPhiMeson(hadronEvents[i], 0.0);
+    }));
+
+    results.push_back(runBench("hasValidJpsiMuons", nHad, minTime, [&](size_t i) {
+        g_sink += hasValidJpsiMuons(hadronEvents[i], 2.5, 2.4);
+    }));
+
+    results.push_back(runBench("hasValidUpsilonMuons", nHad, minTime, [&](size_t i) {
+        g_sink += hasValidUpsilonMuons(hadronEvents[i], 2.5, 2.4);
+    }));
+
+    // The compiled selection must agree with the hand-written checks it replaces
+    SelectionProgram selection;
+    SelectionState selectionState;
+    string selectError;
+    selection.compile("onium(443|553|100553|200553)->mu+mu- pT>2.5 |eta|<2.4", selectError);
+    size_t nDisagree = 0;
+    for (size_t i = 0; i < nHad; ++i) {
+        bool handWritten = hasValidJpsiMuons(hadronEvents[i], 2.5, 2.4) ||
+                           hasValidUpsilonMuons(hadronEvents[i], 2.5, 2.4);
+        if (handWritten != selection.match(PythiaEventView{hadronEvents[i]}, selectionState)) nDisagree++;
+    }
+    if (nDisagree > 0) {
+        cerr << "Warning: compiled selection disagrees with hasValid*Muons on "
+             << nDisagree << " events" << endl;
+    }
+    checkCopyCounting(pythia.particleData);
+    
+    results.push_back(runBench("hasValid{Jpsi,Upsilon}Muons", nHad, minTime, [&](size_t i) {
+        g_sink += hasValidJpsiMuons(hadronEvents[i], 2.5, 2.4) ||
+                  hasValidUpsilonMuons(hadronEvents[i], 2.5, 2.4);
+    }));
+    
+    results.push_back(runBench("compiled selection (same cuts)", nHad, minTime, [&](size_t i) {
+        g_sink += selection.match(PythiaEventView{hadronEvents[i]}, selectionState);
+    }));
+    
+    results.push_back(runBench("countParticles (Pythia)", nHad, minTime, [&](size_t i) {
+        int nJpsi, nUpsilon, nPhi, nMuon;
+        countParticles(hadronEvents[i], nJpsi, nUpsilon, nPhi, nMuon);
+        g_sink += nJpsi + nUpsilon + nPhi + nMuon;
+    }));
+
+    results.push_back(runBench("fillEventSummary", nHad, minTime, [&](size_t i) {
+        EventSummary summary;
+        fillEventSummary(hadronEvents[i], 2.5, 2.4, summary);
+        g_sink += summary.flags;
+    }));
+
+    results.push_back(runBench("retry state restore", partonStates.size(), minTime, [&](size_t i) {
+        pythia.event = partonStates[i].event;
+        pythia.partonSystems = partonStates[i].partonSystems;
+        g_sink += pythia.event.size();
+    }));
+
+    results.push_back(runBench("convertToHepMC2", nHepMC, minTime, [&](size_t i) {
+        HepMC::GenEvent* evt2 = convertToHepMC2(*hepmc3Events[i], i);
+        g_sink += evt2->particles_size();
+        delete evt2;
+    }));
+
+    for (size_t nSources : {size_t(2), size_t(3)}) {
+        if (nHepMC < nSources) continue;
+        vector<HepMC3::GenEvent*> sources(nSources);
+        results.push_back(runBench("mergeEvents (" + to_string(nSources) + " sources)", nHepMC, minTime,
+                                   [&](size_t i) {
+            for (size_t s = 0; s < nSources; ++s) sources[s] = hepmc3Events[(i + s) % nHepMC].get();
+            HepMC::GenEvent* merged = mergeEvents(sources, i);
+            g_sink += merged->particles_size();
+            delete merged;
+        }));
+    }
+
+    // The flat path must write the same particles as the graph-to-graph merge
+    size_t nMismatch = 0;
+    BinaryEvent merged;
+    FlatMergeLayout layout;
+    for (size_t i = 0; i + 1 < nHepMC; ++i) {
+        vector<HepMC3::GenEvent*> graphSources = {hepmc3Events[i].get(), hepmc3Events[i + 1].get()};
+        mergeFlatEvents({&flatEvents[i], &flatEvents[i + 1]}, i, merged, layout);
+        HepMC::GenEvent* reference = mergeEvents(graphSources, i);
+        HepMC::GenEvent* flat = flatToHepMC2(merged, i, &layout);
+        if (reference->particles_size() != flat->particles_size() ||
+            reference->vertices_size() != flat->vertices_size()) nMismatch++;
+        delete reference;
+        delete flat;
+    }
+    if (nMismatch > 0) {
+        cerr << "Warning: flat merge differs from mergeEvents on " << nMismatch << " events" << endl;
+    }
+
+    results.push_back(runBench("hepmc3ToBinary", nHepMC, minTime, [&](size_t i) {
+        hepmc3ToBinary(*hepmc3Events[i], merged);
+        g_sink += merged.nParticles();
+    }));
+
+    results.push_back(runBench("pythiaToFlat", nHad, minTime, [&](size_t i) {
+        pythiaToFlat(hadronEvents[i], merged);
+        g_sink += merged.nParticles();
+    }));
+
+    results.push_back(runBench("flatToHepMC2", nHepMC, minTime, [&](size_t i) {
+        HepMC::GenEvent* evt2 = flatToHepMC2(flatEvents[i], i);
+        g_sink += evt2->particles_size();
+        delete evt2;
+    }));
+
+    for (size_t nSources : {size_t(2), size_t(3)}) {
+        if (nHepMC < nSources) continue;
+        vector<const BinaryEvent*> sources(nSources);
+        results.push_back(runBench("mergeFlatEvents (" + to_string(nSources) + " sources)", nHepMC, minTime,
+                                   [&](size_t i) {
+            for (size_t s = 0; s < nSources; ++s) sources[s] = &flatEvents[(i + s) % nHepMC];
+            mergeFlatEvents(sources, i, merged, layout);
+            g_sink += merged.nParticles();
+        }));
+        results.push_back(runBench("mergeFlatEvents + flatToHepMC2 (" + to_string(nSources) + " sources)",
+                                   nHepMC, minTime, [&](size_t i) {
+            for (size_t s = 0; s < nSources; ++s) sources[s] = &flatEvents[(i + s) % nHepMC];
+            mergeFlatEvents(sources, i, merged, layout);
+            HepMC::GenEvent* evt2 = flatToHepMC2(merged, i, &layout);
+            g_sink += evt2->particles_size();
+            delete evt2;
+        }));
+    }
+
+    // HepMC3 text of merged events (mixer --hepmc3)
+    {
+        NullBuffer nullBuffer;
+        ostream nullStream(&nullBuffer);
+        HepMC3::WriterAscii asciiWriter(nullStream);
+        HepMC3::GenEvent evt3;
+        results.push_back(runBench("HepMC3 text (binaryToHepMC3 + WriterAscii)", nHepMC, minTime, [&](size_t i) {
+            binaryToHepMC3(flatEvents[i], evt3);
+            asciiWriter.write_event(evt3);
+        }));
+        FlatHepMC3Writer flatWriter(nullStream);
+        FlatLinks textLinks;
+        results.push_back(runBench("HepMC3 text (flat writer)", nHepMC, minTime, [&](size_t i) {
+            textLinks.build(flatEvents[i]);
+            flatWriter.write(flatEvents[i], textLinks);
+        }));
+        g_sink += nullBuffer.bytes;
+    }
+
+    // Batch kinematics: all particles of each event, against libm
+    cout << "Kinematics kernels: " << kinematicsIsa() << endl;
+    vector<double> pt, eta, phi;
+    vector<uint8_t> pass;
+    double maxEtaDiff = 0.0, maxPhiDiff = 0.0;
+    for (const auto& evt : flatEvents) {
+        flatKinematics(evt, pt, eta, phi);
+        for (size_t k = 0; k < evt.nParticles(); ++k) {
+            maxEtaDiff = max(maxEtaDiff, fabs(eta[k] - scalarEta(evt.px[k], evt.py[k], evt.pz[k])));
+            maxPhiDiff = max(maxPhiDiff, fabs(phi[k] - atan2(evt.py[k], evt.px[k])));
+        }
+    }
+    if (maxEtaDiff > 1e-12 || maxPhiDiff > 1e-12) {
+        cerr << "Warning: batch kinematics differ from libm (eta " << maxEtaDiff
+             << ", phi " << maxPhiDiff << ")" << endl;
+    }
+
+    results.push_back(runBench("pT/eta/phi per particle (libm)", flatEvents.size(), minTime, [&](size_t i) {
+        const BinaryEvent& evt = flatEvents[i];
+        double sum = 0.0;
+        for (size_t k = 0; k < evt.nParticles(); ++k) {
+            sum += scalarPt(evt.px[k], evt.py[k]) + scalarEta(evt.px[k], evt.py[k], evt.pz[k])
+                 + atan2(evt.py[k], evt.px[k]);
+        }
+        g_sink += sum > 0.0;
+    }));
+
+    results.push_back(runBench("batchKinematics", flatEvents.size(), minTime, [&](size_t i) {
+        flatKinematics(flatEvents[i], pt, eta, phi);
+        g_sink += pt.size();
+    }));
+
+    const AcceptanceCut muonAcceptance(2.5, 2.4);
+    results.push_back(runBench("acceptance per particle (pT, eta)", flatEvents.size(), minTime, [&](size_t i) {
+        const BinaryEvent& evt = flatEvents[i];
+        size_t n = 0;
+        for (size_t k = 0; k < evt.nParticles(); ++k) {
+            n += scalarPt(evt.px[k], evt.py[k]) > 2.5 && fabs(scalarEta(evt.px[k], evt.py[k], evt.pz[k])) < 2.4;
+        }
+        g_sink += n;
+    }));
+
+    results.push_back(runBench("batchAcceptance", flatEvents.size(), minTime, [&](size_t i) {
+        const BinaryEvent& evt = flatEvents[i];
+        pass.resize(evt.nParticles());
+        batchAcceptance(evt.px.data(), evt.py.data(), evt.pz.data(), evt.nParticles(), muonAcceptance, pass.data());
+        g_sink += pass.empty() ? 0 : pass[0];
+    }));
+
+    // The compiled selection on flat events (vectorized pid scan, momentum-space cuts)
+    vector<FlatLinks> flatLinks(flatEvents.size());
+    for (size_t i = 0; i < flatEvents.size(); ++i) flatLinks[i].build(flatEvents[i]);
+    results.push_back(runBench("compiled selection (flat)", flatEvents.size(), minTime, [&](size_t i) {
+        g_sink += selection.match(FlatEventView{flatEvents[i], flatLinks[i]}, selectionState);
+    }));
+
+    results.push_back(runBench("countParticles (flat)", flatEvents.size(), minTime, [&](size_t i) {
+        int nJpsi, nUpsilon, nPhi;
+        countParticles(flatEvents[i], nJpsi, nUpsilon, nPhi);
+        g_sink += nJpsi + nUpsilon + nPhi;
+    }));
+
+    results.push_back(runBench("countParticles (HepMC2)", hepmc2Events.size(), minTime, [&](size_t i) {
+        int nJpsi, nUpsilon, nPhi;
+        countParticles(hepmc2Events[i].get(), nJpsi, nUpsilon, nPhi);
+        g_sink += nJpsi + nUpsilon + nPhi;
+    }));
+
+    printResults(results);
+
+    if (!jsonFile.empty()) {
+        string sample = lheFile.empty() ? "synthetic " + process : "recorded " + lheFile;
+        if (!writeJson(jsonFile, results, sample)) {
+            cerr << "Error: Cannot write JSON output: " << jsonFile << endl;
+            return 1;
+        }
+        cout << "Results written to: " << jsonFile << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+#!/bin/bash
+# ==============================================================================
+# bench_mixer.sh - Throughput and scaling benchmark of event_mixer_multisource
+# ==============================================================================
+# Generates one synthetic HepMC3 bank per source with synth_hepmc (distinct
+# seeds, so sources are statistically independent) and runs the mixer with
+# 1, 2, ... up to --max-sources inputs. Reports wall time, events/s, input
+# MB/s and peak RSS for each source count. Runs fully offline. --bin-dir runs
+# the mixer of another build (e.g. the reference build kept by make pgo);
+# --input-io compares the read-ahead backends of plain ASCII inputs.
+#
+# Usage:
+#   ./bench_mixer.sh [--events N] [--particles N] [--max-sources S]
+#                    [--format ascii|binary] [--seed N] [--workdir DIR] [--keep]
+#                    [--json FILE] [--compress zstd|lz4|none] [--bin-dir DIR]
+#                    [--input-io uring|threads|off]
+# ==============================================================================
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+
+EVENTS=200
+PARTICLES=5000
+MAX_SOURCES=3
+FORMAT="ascii"
+SEED=12345
+WORKDIR=""
+KEEP="false"
+JSON_FILE=""
+REQUIRE=""
+COMPRESS="none"
+BIN_DIR=""
+INPUT_IO="uring"
+
+usage() {
+    cat << EOF
+Usage: $0 [options]
+
+Options:
+  --events N          Events per source bank (default: 200)
+  --particles N       Final-state hadrons per source event (default: 5000)
+  --max-sources S     Largest number of sources to mix (default: 3)
+  --format F          Input bank format: ascii (.hepmc) or binary (.hepb) (default: ascii)
+  --seed N            Base random seed; source i uses seed+i (default: 12345)
+  --workdir DIR       Directory for the bank/output files (default: temporary)
+  --keep              Keep the generated files
+  --json FILE         Also write the results as JSON (for bench_gate.py)
+  --require SPEC      Time requirement-driven pairing (mixer --require), e.g. jpsi=1,phi=1
+  --compress C        Block-compress the mixer output: zstd, lz4 or none (default: none)
+  --bin-dir DIR       Directory of the mixer binary (default: this directory)
+  --input-io B        Mixer read-ahead backend: uring, threads or off (default: uring)
+  -h, --help          Show this help
+EOF
+    exit 1
+}
+
+while [[ $# -gt 0 ]]; do
+    case $1 in
+        --events) EVENTS="$2"; shift 2 ;;
+        --particles) PARTICLES="$2"; shift 2 ;;
+        --max-sources) MAX_SOURCES="$2"; shift 2 ;;
+        --format) FORMAT="$2"; shift 2 ;;
+        --seed) SEED="$2"; shift 2 ;;
+        --workdir) WORKDIR="$2"; shift 2 ;;
+        --keep) KEEP="true"; shift ;;
+        --json) JSON_FILE="$2"; shift 2 ;;
+        --require) REQUIRE="$2"; shift 2 ;;
+        --compress) COMPRESS="$2"; shift 2 ;;
+        --bin-dir) BIN_DIR="$2"; shift 2 ;;
+        --input-io) INPUT_IO="$2"; shift 2 ;;
+        -h|--help) usage ;;
+        *) echo "[ERROR] Unknown option: $1"; usage ;;
+    esac
+done
+
+case "${FORMAT}" in
+    ascii) EXT="hepmc" ;;
+    binary) EXT="hepb" ;;
+    *) echo "[ERROR] Unknown format: ${FORMAT}"; exit 1 ;;
+esac
+
+case "${COMPRESS}" in
+    zstd) OUT_SUFFIX=".zst" ;;
+    lz4) OUT_SUFFIX=".lz4" ;;
+    none) OUT_SUFFIX="" ;;
+    *) echo "[ERROR] Unknown compression: ${COMPRESS}"; exit 1 ;;
+esac
+
+BIN_DIR="${BIN_DIR:-${SCRIPT_DIR}}"
+if [[ ! -x "${SCRIPT_DIR}/synth_hepmc" ]]; then
+    echo "[ERROR] synth_hepmc not built; run 'make synth_hepmc' first"
+    exit 1
+fi
+if [[ ! -x "${BIN_DIR}/event_mixer_multisource" ]]; then
+    echo "[ERROR] event_mixer_multisource not found in ${BIN_DIR}; run 'make mixer' first"
+    exit 1
+fi
+
+if [[ -z "${WORKDIR}" ]]; then
+    WORKDIR=$(mktemp -d --suffix=_bench_mixer)
+fi
+mkdir -p "${WORKDIR}"
+
+cleanup() {
+    if [[ "${KEEP}" != "true" ]]; then
+        rm -f "${WORKDIR}"/bench_src*."${EXT}" "${WORKDIR}"/bench_mixed_*.hepmc* "${WORKDIR}"/bench_*.log
+        rmdir "${WORKDIR}" 2>/dev/null || true
+    fi
+}
+trap cleanup EXIT
+
+# Source 1 carries the phi (as in production), the others are onium-only
+SOURCES=()
+for ((i = 1; i <= MAX_SOURCES; ++i)); do
+    bank="${WORKDIR}/bench_src${i}.${EXT}"
+    phi_fraction=0.0
+    [[ ${i} -eq 1 ]] && phi_fraction=1.0
+    "${SCRIPT_DIR}/synth_hepmc" "${bank}" --events "${EVENTS}" --particles "${PARTICLES}" \
+        --onia 443,553 --phi-fraction "${phi_fraction}" --seed $((SEED + i)) > /dev/null
+    SOURCES+=("${bank}")
+done
+
+MIX_ARGS=(--input-io "${INPUT_IO}")
+if [[ -n "${REQUIRE}" ]]; then
+    MIX_ARGS+=(--require "${REQUIRE}")
+fi
+
+# GNU time gives peak RSS; fall back to wall time only
+TIME_CMD=""
+if [[ -x /usr/bin/time ]] && /usr/bin/time -f "%M" true > /dev/null 2>&1; then
+    TIME_CMD="/usr/bin/time"
+fi
+
+echo ""
+echo "=============================================="
+echo "Event Mixer Benchmark"
+echo "=============================================="
+echo "Events/source:    ${EVENTS}"
+echo "Particles/event:  ${PARTICLES} per source"
+echo "Input format:     ${FORMAT}"
+echo "Max sources:      ${MAX_SOURCES}"
+echo "Pairing:          ${REQUIRE:-sequential}"
+echo "Output codec:     ${COMPRESS}"
+echo "Input I/O:        ${INPUT_IO}"
+echo "Binaries:         ${BIN_DIR}"
+echo "=============================================="
+
+printf "\n%-8s %10s %10s %12s %12s %12s\n" "sources" "wall[s]" "merged" "events/s" "input MB/s" "peak RSS[MB]"
+printf "%s\n" "--------------------------------------------------------------------"
+
+JSON_RECORDS=()
+for ((n = 1; n <= MAX_SOURCES; ++n)); do
+    inputs=("${SOURCES[@]:0:n}")
+    output="${WORKDIR}/bench_mixed_${n}.hepmc${OUT_SUFFIX}"
+    log_file="${WORKDIR}/bench_mix${n}.log"
+    rss_file="${WORKDIR}/bench_rss${n}.log"
+
+    input_bytes=$(stat -c %s "${inputs[@]}" | awk '{ s += $1 } END { print s }')
+
+    t0=$(date +%s.%N)
+    if [[ -n "${TIME_CMD}" ]]; then
+        ${TIME_CMD} -f "%M" -o "${rss_file}" \
+            "${BIN_DIR}/event_mixer_multisource" "${output}" "${inputs[@]}" "${MIX_ARGS[@]}" > "${log_file}" 2>&1
+        peak_kb=$(tail -n 1 "${rss_file}")
+    else
+        "${BIN_DIR}/event_mixer_multisource" "${output}" "${inputs[@]}" "${MIX_ARGS[@]}" > "${log_file}" 2>&1
+        peak_kb=""
+    fi
+    t1=$(date +%s.%N)
+
+    n_merged=$(grep -m1 "Total events merged" "${log_file}" | awk -F: '{print $2}' | awk '{print $1}')
+
+    awk -v s="${n}" -v t0="${t0}" -v t1="${t1}" -v w="${n_merged:-0}" -v b="${input_bytes}" -v r="${peak_kb}" \
+        'BEGIN { dt = t1 - t0; if (dt <= 0) dt = 1e-9;
+                 rss = (r == "") ? "n/a" : sprintf("%.1f", r / 1024);
+                 printf "%-8d %10.2f %10d %12.2f %12.1f %12s\n", s, dt, w, w / dt, b / 1e6 / dt, rss }'
+
+    JSON_RECORDS+=("$(awk -v s="${n}" -v t0="${t0}" -v t1="${t1}" -v w="${n_merged:-0}" -v b="${input_bytes}" -v r="${peak_kb}" \
+        'BEGIN { dt = t1 - t0; if (dt <= 0) dt = 1e-9;
+                 printf "{\"name\": \"mixer_%dsrc\", \"wall_sec\": %.4f, \"events\": %d, \"events_per_sec\": %.4f, \"input_mb_per_sec\": %.4f", s, dt, w, w / dt, b / 1e6 / dt;
+                 if (r != "") printf ", \"peak_rss_mb\": %.2f", r / 1024;
+                 printf "}" }')")
+
+    rm -f "${output}" "${rss_file}"
+done
+
+printf "%s\n" "--------------------------------------------------------------------"
+if [[ -n "${JSON_FILE}" ]]; then
+    {
+        echo "{"
+        echo "  \"benchmark\": \"mixer\","
+        echo "  \"sample\": \"${FORMAT}, ${EVENTS} events x ${PARTICLES} particles, seed ${SEED}, output ${COMPRESS}, input ${INPUT_IO}\","
+        echo "  \"results\": ["
+        for ((i = 0; i < ${#JSON_RECORDS[@]}; ++i)); do
+            sep=","
+            [[ $((i + 1)) -eq ${#JSON_RECORDS[@]} ]] && sep=""
+            echo "    ${JSON_RECORDS[$i]}${sep}"
+        done
+        echo "  ]"
+        echo "}"
+    } > "${JSON_FILE}"
+    echo "Results written to: ${JSON_FILE}"
+fi
+if [[ -z "${TIME_CMD}" ]]; then
+    echo "Note: /usr/bin/time not available, peak RSS not measured"
+fi
+if [[ "${KEEP}" == "true" ]]; then
+    echo "Files kept in: ${WORKDIR}"
+fi
@@ -0,0 +1,198 @@
+#!/bin/bash
+# ==============================================================================
+# bench_shower.sh - End-to-end throughput benchmark of the shower programs
+# ==============================================================================
+# Generates a reproducible synthetic LHE sample with synth_lhe and runs
+# shower_normal and/or shower_phi on it with the production arguments used by
+# run_chain.sh. Reports wall time, LHE events/s, accepted events/s, the
+# average number of hadronization retries and peak RSS. Runs fully offline.
+# With --workers N the showers fork N workers after initialization
+# (shower_workers.h) and the private memory per worker is reported as well.
+# --bin-dir runs the shower binaries of another build (e.g. the reference
+# build kept by make pgo) on the same sample.
+#
+# Usage:
+#   ./bench_shower.sh [--process P] [--events N] [--mode normal|phi|both]
+#                     [--extra-gluons K] [--seed N] [--workdir DIR] [--keep]
+#                     [--workers N] [--json FILE] [--bin-dir DIR]
+# ==============================================================================
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+
+PROCESS="jpsi_g"
+EVENTS=500
+MODE="both"
+EXTRA_GLUONS=0
+SEED=12345
+WORKDIR=""
+KEEP="false"
+JSON_FILE=""
+WORKERS=1
+BIN_DIR=""
+
+usage() {
+    cat << EOF
+Usage: $0 [options]
+
+Options:
+  --process P         Synthetic LHE process (jpsi_g|upsilon_g|2jpsi_g|jpsi_upsilon_g|gg, default: jpsi_g)
+  --events N          Number of LHE events (default: 500)
+  --mode M            Shower mode: normal, phi or both (default: both)
+  --extra-gluons K    Additional final-state gluons in the LHE sample (default: 0)
+  --seed N            Random seed for the LHE sample (default: 12345)
+  --workdir DIR       Directory for the LHE/HepMC files (default: temporary)
+  --keep              Keep the generated files
+  --workers N         Shower workers sharing one initialization (default: 1)
+  --json FILE         Also write the results as JSON (for bench_gate.py)
+  --bin-dir DIR       Directory of the shower binaries (default: this directory)
+  -h, --help          Show this help
+EOF
+    exit 1
+}
+
+while [[ $# -gt 0 ]]; do
+    case $1 in
+        --process) PROCESS="$2"; shift 2 ;;
+        --events) EVENTS="$2"; shift 2 ;;
+        --mode) MODE="$2"; shift 2 ;;
+        --extra-gluons) EXTRA_GLUONS="$2"; shift 2 ;;
+        --seed) SEED="$2"; shift 2 ;;
+        --workdir) WORKDIR="$2"; shift 2 ;;
+        --keep) KEEP="true"; shift ;;
+        --workers) WORKERS="$2"; shift 2 ;;
+        --json) JSON_FILE="$2"; shift 2 ;;
+        --bin-dir) BIN_DIR="$2"; shift 2 ;;
+        -h|--help) usage ;;
+        *) echo "[ERROR] Unknown option: $1"; usage ;;
+    esac
+done
+
+case "${MODE}" in
+    normal) MODES=("normal") ;;
+    phi) MODES=("phi") ;;
+    both) MODES=("normal" "phi") ;;
+    *) echo "[ERROR] Unknown mode: ${MODE}"; exit 1 ;;
+esac
+
+BIN_DIR="${BIN_DIR:-${SCRIPT_DIR}}"
+if [[ ! -x "${SCRIPT_DIR}/synth_lhe" ]]; then
+    echo "[ERROR] synth_lhe not built; run 'make synth_lhe' first"
+    exit 1
+fi
+for prog in "${MODES[@]/#/shower_}"; do
+    if [[ ! -x "${BIN_DIR}/${prog}" ]]; then
+        echo "[ERROR] ${prog} not found in ${BIN_DIR}; run 'make ${prog}' first"
+        exit 1
+    fi
+done
+
+if [[ -z "${WORKDIR}" ]]; then
+    WORKDIR=$(mktemp -d --suffix=_bench_shower)
+fi
+mkdir -p "${WORKDIR}"
+
+cleanup() {
+    if [[ "${KEEP}" != "true" ]]; then
+        rm -f "${WORKDIR}"/bench_*.lhe "${WORKDIR}"/bench_*.hepmc "${WORKDIR}"/bench_*.hepmc.evsum "${WORKDIR}"/bench_*.hepmc.runstats "${WORKDIR}"/bench_*.w*.hepmc* "${WORKDIR}"/bench_*.log "${WORKDIR}"/bench_*.rss
+        rmdir "${WORKDIR}" 2>/dev/null || true
+    fi
+}
+trap cleanup EXIT
+
+LHE_FILE="${WORKDIR}/bench_${PROCESS}.lhe"
+"${SCRIPT_DIR}/synth_lhe" "${LHE_FILE}" --process "${PROCESS}" --events "${EVENTS}" \
+    --extra-gluons "${EXTRA_GLUONS}" --seed "${SEED}"
+
+# GNU time gives peak RSS; fall back to wall time only
+TIME_CMD=""
+if [[ -x /usr/bin/time ]] && /usr/bin/time -f "%M" true > /dev/null 2>&1; then
+    TIME_CMD="/usr/bin/time -f %M -o"
+fi
+
+echo ""
+echo "=============================================="
+echo "Shower Throughput Benchmark"
+echo "=============================================="
+echo "Process:      ${PROCESS} (+${EXTRA_GLUONS} gluons)"
+echo "LHE events:   ${EVENTS}"
+echo "Modes:        ${MODES[*]}"
+echo "Workers:      ${WORKERS}"
+echo "Binaries:     ${BIN_DIR}"
+echo "=============================================="
+
+printf "\n%-8s %10s %10s %12s %14s %12s %12s\n" "mode" "wall[s]" "written" "LHE ev/s" "written ev/s" "avg retries" "peak RSS[MB]"
+printf "%s\n" "---------------------------------------------------------------------------------"
+
+JSON_RECORDS=()
+
+for mode in "${MODES[@]}"; do
+    hepmc_output="${WORKDIR}/bench_${mode}.hepmc"
+    log_file="${WORKDIR}/bench_${mode}.log"
+    rss_file="${WORKDIR}/bench_${mode}.rss"
+    time_prefix=()
+    [[ -n "${TIME_CMD}" ]] && time_prefix=(${TIME_CMD} "${rss_file}")
+    worker_args=()
+    [[ "${WORKERS}" -gt 1 ]] && worker_args=(--workers "${WORKERS}")
+
+    # Same arguments as run_chain.sh; the output goes to the log, so a failing
+    # run is reported here with the end of its log (set -e would stop silently)
+    t0=$(date +%s.%N)
+    status=0
+    if [[ "${mode}" == "phi" ]]; then
+        "${time_prefix[@]}" "${BIN_DIR}/shower_phi" "${LHE_FILE}" "${hepmc_output}" -1 0.0 2.5 2.4 1000 "${worker_args[@]}" > "${log_file}" 2>&1 || status=$?
+    else
+        "${time_prefix[@]}" "${BIN_DIR}/shower_normal" "${LHE_FILE}" "${hepmc_output}" -1 2.5 2.4 1000 "${worker_args[@]}" > "${log_file}" 2>&1 || status=$?
+    fi
+    t1=$(date +%s.%N)
+    if [[ ${status} -ne 0 ]]; then
+        echo "[ERROR] shower_${mode} failed with exit status ${status}; last lines of ${log_file}:"
+        tail -n 20 "${log_file}" | sed 's/^/    /'
+        exit "${status}"
+    fi
+    peak_kb=""
+    [[ -n "${TIME_CMD}" ]] && peak_kb=$(tail -n 1 "${rss_file}")
+
+    n_lhe=$(grep -m1 "Total LHE events processed" "${log_file}" | awk -F: '{print $2}' | awk '{print $1}')
+    n_written=$(grep -m1 "Events written" "${log_file}" | awk -F: '{print $2}' | awk '{print $1}')
+    avg_retry=$(grep -m1 "Average retries per event" "${log_file}" | awk -F: '{print $2}' | awk '{print $1}')
+    # "per additional worker: <private> (independent process: <rss>)"
+    worker_mb=$(grep -m1 "per additional worker" "${log_file}" | awk -F: '{print $2}' | awk '{print $1}')
+
+    awk -v m="${mode}" -v t0="${t0}" -v t1="${t1}" -v n="${n_lhe:-0}" -v w="${n_written:-0}" -v r="${avg_retry:-0}" -v k="${peak_kb}" \
+        'BEGIN { dt = t1 - t0; if (dt <= 0) dt = 1e-9;
+                 rss = (k == "") ? "n/a" : sprintf("%.1f", k / 1024);
+                 printf "%-8s %10.2f %10d %12.2f %14.2f %12.1f %12s\n", m, dt, w, n / dt, w / dt, r, rss }'
+    if [[ -n "${worker_mb}" ]]; then
+        echo "         $(grep -m1 "per additional worker" "${log_file}" | sed 's/^ *//') [MB]"
+    fi
+
+    JSON_RECORDS+=("$(awk -v m="${mode}" -v t0="${t0}" -v t1="${t1}" -v n="${n_lhe:-0}" -v w="${n_written:-0}" -v r="${avg_retry:-0}" -v k="${peak_kb}" -v pw="${worker_mb}" \
+        'BEGIN { dt = t1 - t0; if (dt <= 0) dt = 1e-9;
+                 printf "{\"name\": \"shower_%s\", \"wall_sec\": %.4f, \"events\": %d, \"events_per_sec\": %.4f, \"written_per_sec\": %.4f, \"avg_retries\": %.4f", m, dt, n, n / dt, w / dt, r;
+                 if (k != "") printf ", \"peak_rss_mb\": %.2f", k / 1024;
+                 if (pw != "") printf ", \"worker_private_mb\": %.2f", pw;
+                 printf "}" }')")
+done
+
+printf "%s\n" "---------------------------------------------------------------------------------"
+if [[ -n "${JSON_FILE}" ]]; then
+    {
+        echo "{"
+        echo "  \"benchmark\": \"shower\","
+        echo "  \"sample\": \"${PROCESS} +${EXTRA_GLUONS}g, ${EVENTS} events, seed ${SEED}\","
+        echo "  \"results\": ["
+        for ((i = 0; i < ${#JSON_RECORDS[@]}; ++i)); do
+            sep=","
+            [[ $((i + 1)) -eq ${#JSON_RECORDS[@]} ]] && sep=""
+            echo "    ${JSON_RECORDS[$i]}${sep}"
+        done
+        echo "  ]"
+        echo "}"
+    } > "${JSON_FILE}"
+    echo "Results written to: ${JSON_FILE}"
+fi
+if [[ "${KEEP}" == "true" ]]; then
+    echo "Files kept in: ${WORKDIR}"
+fi
@@ -0,0 +1,634 @@
+// ==============================================================================
+// block_compress.h - Block-compressed intermediate HepMC files (.zst / .lz4)
+// ==============================================================================
+// The ASCII event files (shower_*.hepmc, mixed.hepmc) are written as a chain
+// of independently compressed blocks of kBlockRawBytes uncompressed bytes:
+//
+//   block : skippable frame  uint32 magic 0x184D2A5E, uint32 frameBytes = 16,
+//                            uint32 tag "HBLK", uint32 codec,
+//                            uint32 rawBytes, uint32 packedBytes
+//           codec frame      one complete zstd or LZ4 frame (packedBytes)
+//
+// Both zstd and LZ4 skip skippable frames, so the files decompress with the
+// stock command line tools (zstd -d, lz4 -d). The block headers let a reader
+// index the file without decoding anything: blocks are decompressed ahead on
+// a pool of threads and a seek to an uncompressed offset only decodes the
+// block it lands in. Offsets seen by the programs (tellp/tellg, the summary
+// sidecar) are always uncompressed byte offsets.
+//
+// Writers compress full blocks on a pool of threads and write them in order;
+// at most twice as many blocks as threads are in flight. With 0 threads
+// everything runs on the calling thread. Plain (uncompressed) outputs go
+// through the same path with one thread doing the writes, so the producer
+// only fills buffers.
+//
+//   EventOutputStream : std::ostream on a plain or compressed file, by name;
+//                       both are written asynchronously
+//   EventInputStream  : std::istream on a plain or compressed file, by name;
+//                       plain files are read ahead through a ReadQueue when
+//                       one is given (async_input.h)
+//
+// The codec is chosen by the file extension: .zst (zstd) or .lz4 (LZ4 frame).
+// ==============================================================================
+
+#ifndef BLOCK_COMPRESS_H
+#define BLOCK_COMPRESS_H
+
+#include "async_input.h"
+
+#include <zstd.h>
+#include <lz4frame.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+enum BlockCodec : uint32_t { kCodecNone = 0, kCodecZstd = 1, kCodecLz4 = 2 };
+
+const uint32_t kBlockSkippableMagic = 0x184D2A5E;  // zstd/LZ4 skippable frame
+const uint32_t kBlockTag = 0x4B4C4248;             // "HBLK"
+const size_t kBlockRawBytes = 1 << 20;
+const int kBlockZstdLevel = 3;
+const int kDefaultCompressionThreads = 2;
+
+// Codec for a file name: .zst, .lz4, otherwise none
+inline BlockCodec blockCodecFor(const std::string& path) {
+    auto endsWith = [&](const char* ext, size_t n) {
+        return path.size() > n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (endsWith(".zst", 4)) return kCodecZstd;
+    if (endsWith(".lz4", 4)) return kCodecLz4;
+    return kCodecNone;
+}
+
+inline const char* blockCodecName(BlockCodec codec) {
+    switch (codec) {
+        case kCodecZstd: return "zstd";
+        case kCodecLz4:  return "lz4";
+        default:         return "none";
+    }
+}
+
+struct BlockHeader {
+    uint32_t magic = kBlockSkippableMagic;
+    uint32_t frameBytes = 16;
+    uint32_t tag = kBlockTag;
+    uint32_t codec = kCodecNone;
+    uint32_t rawBytes = 0;
+    uint32_t packedBytes = 0;
+};
+
+// Per-thread codec contexts, created on first use
+class BlockCodecContext {
+public:
+    ~BlockCodecContext() {
+        if (m_zstdC) ZSTD_freeCCtx(m_zstdC);
+        if (m_zstdD) ZSTD_freeDCtx(m_zstdD);
+        if (m_lz4D) LZ4F_freeDecompressionContext(m_lz4D);
+    }
+
+    bool compress(BlockCodec codec, const char* src, size_t n, std::vector<char>& dst) {
+        if (codec == kCodecZstd) {
+            if (!m_zstdC) m_zstdC = ZSTD_createCCtx();
+            dst.resize(ZSTD_compressBound(n));
+            size_t packed = ZSTD_compressCCtx(m_zstdC, dst.data(), dst.size(), src, n, kBlockZstdLevel);
+            if (ZSTD_isError(packed)) return false;
+            dst.resize(packed);
+            return true;
+        }
+        if (codec == kCodecLz4) {
+            LZ4F_preferences_t prefs = LZ4F_preferences_t();
+            prefs.frameInfo.contentSize = n;
+            dst.resize(LZ4F_compressFrameBound(n, &prefs));
+            size_t packed = LZ4F_compressFrame(dst.data(), dst.size(), src, n, &prefs);
+            if (LZ4F_isError(packed)) return false;
+            dst.resize(packed);
+            return true;
+        }
+        return false;
+    }
+
+    bool decompress(BlockCodec codec, const char* src, size_t n, char* dst, size_t rawBytes) {
+        if (codec == kCodecZstd) {
+            if (!m_zstdD) m_zstdD = ZSTD_createDCtx();
+            return ZSTD_decompressDCtx(m_zstdD, dst, rawBytes, src, n) == rawBytes;
+        }
+        if (codec == kCodecLz4) {
+            if (!m_lz4D && LZ4F_isError(LZ4F_createDecompressionContext(&m_lz4D, LZ4F_VERSION))) return false;
+            size_t dstBytes = rawBytes, srcBytes = n;
+            size_t hint = LZ4F_decompress(m_lz4D, dst, &dstBytes, src, &srcBytes, nullptr);
+            if (hint != 0) {
+                LZ4F_resetDecompressionContext(m_lz4D);   // error or truncated frame
+                return false;
+            }
+            return dstBytes == rawBytes && srcBytes == n;
+        }
+        return false;
+    }
+
+private:
+    ZSTD_CCtx* m_zstdC = nullptr;
+    ZSTD_DCtx* m_zstdD = nullptr;
+    LZ4F_dctx* m_lz4D = nullptr;
+};
+
+// One block in flight: raw (uncompressed) and packed bytes
+struct BlockJob {
+    BlockHeader header;
+    std::vector<char> raw, packed;
+    size_t block = 0;          // index in the file (reader)
+    uint64_t fileOffset = 0;   // of the codec frame (reader)
+    bool done = false;
+    bool ok = true;
+};
+
+// Fixed pool of threads running one work function over submitted jobs
+class BlockPool {
+public:
+    typedef std::function<bool(BlockJob&, BlockCodecContext&)> Work;
+
+    ~BlockPool() { stop(); }
+
+    void start(int nThreads, Work work) {
+        stop();
+        m_work = work;
+        m_stopping = false;
+        for (int i = 0; i < nThreads; ++i) m_threads.emplace_back(&BlockPool::run, this);
+    }
+
+    void submit(BlockJob* job) {
+        job->done = false;
+        if (m_threads.empty()) {
+            job->ok = m_work(*job, m_inlineContext);
+            job->done = true;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(job);
+        }
+        m_wake.notify_one();
+    }
+
+    // Blocks until the job has been processed
+    void wait(BlockJob* job) {
+        if (m_threads.empty()) return;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [job] { return job->done; });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& t : m_threads) t.join();
+        m_threads.clear();
+    }
+
+    size_t nThreads() const { return m_threads.size(); }
+
+private:
+    void run() {
+        BlockCodecContext context;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) return;
+            BlockJob* job = m_queue.front();
+            m_queue.pop_front();
+            lock.unlock();
+            bool ok = m_work(*job, context);
+            lock.lock();
+            job->ok = ok;
+            job->done = true;
+            m_finished.notify_all();
+        }
+    }
+
+    Work m_work;
+    std::vector<std::thread> m_threads;
+    std::deque<BlockJob*> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_wake, m_finished;
+    bool m_stopping = false;
+    BlockCodecContext m_inlineContext;   // for 0 threads
+};
+
+// ------------------------------------------------------------------------------
+// Writing
+// ------------------------------------------------------------------------------
+
+class BlockWriter : public std::streambuf {
+public:
+    ~BlockWriter() { close(); }
+
+    bool open(const std::string& path, BlockCodec codec, int nThreads = kDefaultCompressionThreads) {
+        close();
+        m_file = fopen(path.c_str(), "wb");
+        if (!m_file) return false;
+        m_codec = codec;
+        m_failed = false;
+        m_rawWritten = m_packedWritten = 0;
+        if (codec == kCodecNone) {
+            // One writer thread keeps the blocks in order
+            FILE* file = m_file;
+            m_maxInFlight = 2;
+            m_pool.start(1, [file](BlockJob& job, BlockCodecContext&) {
+                return fwrite(job.raw.data(), 1, job.header.rawBytes, file) == job.header.rawBytes;
+            });
+        } else {
+            m_maxInFlight = 2 * std::max(nThreads, 1);
+            m_pool.start(nThreads, [](BlockJob& job, BlockCodecContext& context) {
+                if (!context.compress((BlockCodec)job.header.codec, job.raw.data(), job.header.rawBytes, job.packed))
+                    return false;
+                job.header.packedBytes = (uint32_t)job.packed.size();
+                return true;
+            });
+        }
+        startBlock();
+        return true;
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    // Compresses and writes everything buffered; false if any block failed
+    bool close() {
+        if (!m_file) return !m_failed;
+        submitBlock();
+        while (!m_inFlight.empty()) writeOldest();
+        m_pool.stop();
+        if (fclose(m_file) != 0) m_failed = true;
+        m_file = nullptr;
+        m_current.reset();
+        m_spare.clear();
+        setp(nullptr, nullptr);
+        return !m_failed;
+    }
+
+    uint64_t rawBytes() const { return m_rawWritten + (pptr() - pbase()); }
+    uint64_t packedBytes() const { return m_packedWritten; }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!m_file || m_failed) return traits_type::eof();
+        submitBlock();
+        startBlock();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return m_failed ? traits_type::eof() : traits_type::not_eof(c);
+    }
+
+    // Blocks stay full-size: a flush of the stream does not cut a block
+    int sync() override { return m_failed ? -1 : 0; }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out)) return pos_type(off_type(-1));
+        return pos_type(off_type(rawBytes()));
+    }
+
+private:
+    void startBlock() {
+        if (m_spare.empty()) {
+            m_current.reset(new BlockJob());
+            m_current->raw.resize(kBlockRawBytes);
+        } else {
+            m_current = std::move(m_spare.back());
+            m_spare.pop_back();
+        }
+        m_current->header = BlockHeader();
+        m_current->header.codec = m_codec;
+        setp(m_current->raw.data(), m_current->raw.data() + kBlockRawBytes);
+    }
+
+    void submitBlock() {
+        size_t n = pptr() - pbase();
+        if (n == 0) return;
+        m_current->header.rawBytes = (uint32_t)n;
+        m_rawWritten += n;
+        setp(nullptr, nullptr);
+        m_pool.submit(m_current.get());
+        m_inFlight.push_back(std::move(m_current));
+        while (m_inFlight.size() > m_maxInFlight) writeOldest();
+    }
+
+    void writeOldest() {
+        std::unique_ptr<BlockJob> job = std::move(m_inFlight.front());
+        m_inFlight.pop_front();
+        m_pool.wait(job.get());
+        if (m_codec == kCodecNone) {
+            if (!job->ok) m_failed = true;
+            m_packedWritten += job->header.rawBytes;
+        } else {
+            if (!job->ok
+                || fwrite(&job->header, sizeof(BlockHeader), 1, m_file) != 1
+                || fwrite(job->packed.data(), 1, job->packed.size(), m_file) != job->packed.size()) {
+                m_failed = true;
+            }
+            m_packedWritten += sizeof(BlockHeader) + job->packed.size();
+        }
+        m_spare.push_back(std::move(job));
+    }
+
+    FILE* m_file = nullptr;
+    BlockCodec m_codec = kCodecNone;
+    bool m_failed = false;
+    uint64_t m_rawWritten = 0, m_packedWritten = 0;
+    size_t m_maxInFlight = 2;
+    BlockPool m_pool;
+    std::unique_ptr<BlockJob> m_current;                 // being filled
+    std::deque<std::unique_ptr<BlockJob>> m_inFlight;    // in file order
+    std::vector<std::unique_ptr<BlockJob>> m_spare;      // recycled buffers
+};
+
+// ------------------------------------------------------------------------------
+// Reading
+// ------------------------------------------------------------------------------
+
+class BlockReader : public std::streambuf {
+public:
+    ~BlockReader() { close(); }
+
+    // Indexes the block headers; fails on files not written by BlockWriter
+    bool open(const std::string& path, int nThreads = kDefaultCompressionThreads) {
+        close();
+        m_file = fopen(path.c_str(), "rb");
+        if (!m_file) return false;
+        m_failed = false;
+
+        BlockHeader header;
+        uint64_t offset = 0, rawOffset = 0;
+        while (fread(&header, sizeof(BlockHeader), 1, m_file) == 1) {
+            if (header.magic != kBlockSkippableMagic || header.frameBytes != 16 || header.tag != kBlockTag) {
+                close();
+                return false;
+            }
+            offset += sizeof(BlockHeader);
+            m_index.push_back({header, offset, rawOffset});
+            offset += header.packedBytes;
+            rawOffset += header.rawBytes;
+            if (fseeko(m_file, (off_t)offset, SEEK_SET) != 0) break;
+        }
+        m_rawSize = rawOffset;
+
+        int fd = fileno(m_file);
+        m_maxAhead = 2 * std::max(nThreads, 1);
+        m_pool.start(nThreads, [fd](BlockJob& job, BlockCodecContext& context) {
+            const BlockHeader& h = job.header;
+            job.packed.resize(h.packedBytes);
+            job.raw.resize(h.rawBytes);
+            return pread(fd, job.packed.data(), h.packedBytes, (off_t)job.fileOffset) == (ssize_t)h.packedBytes
+                && context.decompress((BlockCodec)h.codec, job.packed.data(), h.packedBytes,
+                                      job.raw.data(), h.rawBytes);
+        });
+        m_nextBlock = 0;
+        m_blockStart = 0;
+        return true;
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+    bool failed() const { return m_failed; }
+    uint64_t rawSize() const { return m_rawSize; }
+
+    void close() {
+        drain();
+        m_pool.stop();
+        if (m_file) fclose(m_file);
+        m_file = nullptr;
+        m_index.clear();
+        m_current.reset();
+        m_spare.clear();
+        setg(nullptr, nullptr, nullptr);
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        if (!m_file || m_failed) return traits_type::eof();
+        if (!advance()) return traits_type::eof();
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        uint64_t here = m_blockStart + (gptr() - eback());
+        if (dir == std::ios_base::beg) return seekpos(pos_type(off), which);
+        if (dir == std::ios_base::cur) return off == 0 ? pos_type(off_type(here)) : seekpos(pos_type(off_type(here) + off), which);
+        return seekpos(pos_type(off_type(m_rawSize) + off), which);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        off_type target = off_type(pos);
+        if (!m_file || !(which & std::ios_base::in) || target < 0 || (uint64_t)target > m_rawSize)
+            return pos_type(off_type(-1));
+        m_failed = false;
+
+        // Still in the current block
+        if (m_current && (uint64_t)target >= m_blockStart && (uint64_t)target < m_blockStart + (egptr() - eback())) {
+            setg(eback(), eback() + (target - m_blockStart), egptr());
+            return pos;
+        }
+
+        // Block containing target (the end of the file when target == m_rawSize)
+        size_t block = std::upper_bound(m_index.begin(), m_index.end(), (uint64_t)target,
+                                        [](uint64_t t, const IndexEntry& e) { return t < e.rawOffset; })
+                     - m_index.begin();
+        block = block > 0 ? block - 1 : 0;
+        if ((uint64_t)target == m_rawSize) block = m_index.size();
+
+        // Keep the read-ahead if the block is already in it, otherwise restart there
+        while (!m_ahead.empty() && m_ahead.front()->block < block) {
+            m_pool.wait(m_ahead.front().get());
+            m_spare.push_back(std::move(m_ahead.front()));
+            m_ahead.pop_front();
+        }
+        if (m_ahead.empty() || m_ahead.front()->block != block) {
+            drain();
+            m_nextBlock = block;
+        }
+        release();
+        if (block == m_index.size()) {
+            m_blockStart = m_rawSize;
+            return pos;
+        }
+        if (!advance()) return pos_type(off_type(-1));
+        setg(eback(), eback() + (target - m_blockStart), egptr());
+        return pos;
+    }
+
+private:
+    struct IndexEntry {
+        BlockHeader header;
+        uint64_t fileOffset;   // of the codec frame
+        uint64_t rawOffset;    // uncompressed offset of the first byte
+    };
+
+    // Queues blocks up to the read-ahead depth
+    void fill() {
+        while (m_ahead.size() < m_maxAhead && m_nextBlock < m_index.size()) {
+            std::unique_ptr<BlockJob> job;
+            if (m_spare.empty()) {
+                job.reset(new BlockJob());
+            } else {
+                job = std::move(m_spare.back());
+                m_spare.pop_back();
+            }
+            const IndexEntry& entry = m_index[m_nextBlock];
+            job->header = entry.header;
+            job->fileOffset = entry.fileOffset;
+            job->block = m_nextBlock++;
+            m_pool.submit(job.get());
+            m_ahead.push_back(std::move(job));
+        }
+    }
+
+    // Makes the next block current
+    bool advance() {
+        release();
+        fill();
+        if (m_ahead.empty()) {
+            m_blockStart = m_rawSize;
+            return false;
+        }
+        m_current = std::move(m_ahead.front());
+        m_ahead.pop_front();
+        m_pool.wait(m_current.get());
+        fill();
+        if (!m_current->ok) {
+            m_failed = true;
+            return false;
+        }
+        m_blockStart = m_index[m_current->block].rawOffset;
+        char* begin = m_current->raw.data();
+        setg(begin, begin, begin + m_current->header.rawBytes);
+        return true;
+    }
+
+    void release() {
+        if (m_current) m_spare.push_back(std::move(m_current));
+        setg(nullptr, nullptr, nullptr);
+    }
+
+    // Waits for and discards the read-ahead
+    void drain() {
+        for (auto& job : m_ahead) {
+            m_pool.wait(job.get());
+            m_spare.push_back(std::move(job));
+        }
+        m_ahead.clear();
+    }
+
+    FILE* m_file = nullptr;
+    bool m_failed = false;
+    std::vector<IndexEntry> m_index;
+    uint64_t m_rawSize = 0;
+    uint64_t m_blockStart = 0;    // uncompressed offset of the get area
+    size_t m_nextBlock = 0;       // next block to queue
+    size_t m_maxAhead = 2;
+    BlockPool m_pool;
+    std::unique_ptr<BlockJob> m_current;
+    std::deque<std::unique_ptr<BlockJob>> m_ahead;     // queued, in block order
+    std::vector<std::unique_ptr<BlockJob>> m_spare;
+};
+
+// ------------------------------------------------------------------------------
+// Streams
+// ------------------------------------------------------------------------------
+
+// Output stream on a plain file or, for .zst/.lz4 names, a block-compressed
+// one; either way the writes happen on the BlockWriter threads
+class EventOutputStream : public std::ostream {
+public:
+    EventOutputStream() : std::ostream(nullptr) {}
+    ~EventOutputStream() { close(); }
+
+    bool open(const std::string& path, int nThreads = kDefaultCompressionThreads) {
+        close();
+        m_codec = blockCodecFor(path);
+        if (!m_blocks.open(path, m_codec, nThreads)) return false;
+        rdbuf(&m_blocks);
+        clear();
+        return true;
+    }
+
+    bool is_open() const { return rdbuf() != nullptr; }
+    BlockCodec codec() const { return m_codec; }
+
+    // Uncompressed and on-disk sizes (equal for plain files), also after close()
+    uint64_t rawBytes() const { return m_blocks.rawBytes(); }
+    uint64_t packedBytes() const { return m_blocks.packedBytes(); }
+
+    bool close() {
+        if (!rdbuf()) return true;
+        bool ok = m_blocks.close();
+        rdbuf(nullptr);
+        return ok;
+    }
+
+private:
+    BlockCodec m_codec = kCodecNone;
+    BlockWriter m_blocks;
+};
+
+// Input stream on a plain file or, for .zst/.lz4 names, a block-compressed one;
+// seekg/tellg use uncompressed offsets. Plain files are read through readQueue
+// if it is running (and has slots left), otherwise with a std::filebuf
+class EventInputStream : public std::istream {
+public:
+    EventInputStream() : std::istream(nullptr) {}
+    ~EventInputStream() { close(); }
+
+    bool open(const std::string& path, int nThreads = kDefaultCompressionThreads, ReadQueue* readQueue = nullptr) {
+        close();
+        m_codec = blockCodecFor(path);
+        std::streambuf* buffer = nullptr;
+        if (m_codec != kCodecNone) {
+            if (m_blocks.open(path, nThreads)) buffer = &m_blocks;
+        } else if (readQueue && readQueue->running() && m_prefetch.open(path, *readQueue)) {
+            buffer = &m_prefetch;
+        } else if (m_file.open(path, std::ios::in)) {
+            buffer = &m_file;
+        }
+        if (!buffer) return false;
+        rdbuf(buffer);
+        clear();
+        return true;
+    }
+
+    bool is_open() const { return rdbuf() != nullptr; }
+    BlockCodec codec() const { return m_codec; }
+    bool prefetched() const { return rdbuf() == &m_prefetch; }
+
+    void close() {
+        if (!rdbuf()) return;
+        if (rdbuf() == &m_blocks) m_blocks.close();
+        else if (rdbuf() == &m_prefetch) m_prefetch.close();
+        else m_file.close();
+        rdbuf(nullptr);
+    }
+
+private:
+    BlockCodec m_codec = kCodecNone;
+    std::filebuf m_file;
+    PrefetchReader m_prefetch;
+    BlockReader m_blocks;
+};
+
+#endif // BLOCK_COMPRESS_H
@@ -0,0 +1,171 @@
+// ==============================================================================
+// detector_response.h - Parametric muon/track efficiency and resolution
+// ==============================================================================
+// Table-driven detector response for fast_sim. A table file has one row per
+// line ('#' starts a comment):
+//
+//   <object> <quantity> <|eta| min> <|eta| max> <pT min> <pT max> <value>
+//
+//   object   : muon | track (any other charged particle)
+//   quantity : eff (probability to reconstruct), pt (relative pT resolution),
+//              eta (absolute eta resolution), phi (absolute phi resolution)
+//
+// The first row whose |eta| and pT ranges contain the particle is used. A
+// particle matched by no eff row is outside the acceptance and is never
+// reconstructed; without a resolution row the quantity is not smeared.
+// See fastsim_tables.txt for the default table.
+//
+// Random numbers come from a small counter-based generator seeded per event,
+// so results do not depend on the number of threads.
+// ==============================================================================
+
+#ifndef DETECTOR_RESPONSE_H
+#define DETECTOR_RESPONSE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// splitmix64; cheap to seed, good enough for smearing
+struct FastRng {
+    uint64_t state;
+
+    explicit FastRng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    double gauss() {
+        double u1 = uniform(), u2 = uniform();
+        if (u1 < 1e-300) u1 = 1e-300;
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+    }
+};
+
+// Independent stream for every event, whatever thread processes it
+inline FastRng eventRng(uint64_t seed, uint64_t eventIndex) {
+    FastRng mix(seed ^ (eventIndex * 0xD1B54A32D192ED03ULL));
+    return FastRng(mix.next());
+}
+
+class DetectorResponse {
+public:
+    enum Object { kMuon = 0, kTrack, kNumObjects };
+    enum Quantity { kEff = 0, kPt, kEta, kPhi, kNumQuantities };
+
+    struct Row {
+        double etaMin, etaMax, ptMin, ptMax, value;
+    };
+
+    bool load(const std::string& file, std::string& error) {
+        std::ifstream in(file);
+        if (!in.is_open()) {
+            error = "cannot open " + file;
+            return false;
+        }
+        for (auto& object : m_rows) {
+            for (auto& rows : object) rows.clear();
+        }
+        std::string line;
+        int lineNo = 0;
+        while (std::getline(in, line)) {
+            ++lineNo;
+            size_t hash = line.find('#');
+            if (hash != std::string::npos) line.erase(hash);
+            std::istringstream fields(line);
+            std::string object, quantity;
+            Row row;
+            if (!(fields >> object)) continue;
+            if (!(fields >> quantity >> row.etaMin >> row.etaMax >> row.ptMin >> row.ptMax >> row.value)) {
+                error = file + ":" + std::to_string(lineNo) + ": expected 7 fields";
+                return false;
+            }
+            int o = objectIndex(object), q = quantityIndex(quantity);
+            if (o < 0 || q < 0) {
+                error = file + ":" + std::to_string(lineNo) + ": unknown " + (o < 0 ? object : quantity);
+                return false;
+            }
+            m_rows[o][q].push_back(row);
+        }
+        return true;
+    }
+
+    static Object objectFor(int pid) {
+        return (pid == 13 || pid == -13) ? kMuon : kTrack;
+    }
+
+    // Value of the first matching row, or fallback
+    double lookup(Object o, Quantity q, double pt, double absEta, double fallback) const {
+        for (const Row& r : m_rows[o][q]) {
+            if (absEta >= r.etaMin && absEta < r.etaMax && pt >= r.ptMin && pt < r.ptMax) return r.value;
+        }
+        return fallback;
+    }
+
+    // Smears a true momentum p = (px, py, pz, e) into out; false if the
+    // particle is not reconstructed. The true mass is kept.
+    bool smear(Object o, const double* p, FastRng& rng, double* out) const {
+        double pt = std::hypot(p[0], p[1]);
+        if (pt <= 0.0) return false;
+        return smear(o, p, pt, std::asinh(p[2] / pt), std::atan2(p[1], p[0]), rng, out);
+    }
+
+    // Same with the true pT, eta and phi of p already known (batchKinematics)
+    bool smear(Object o, const double* p, double pt, double eta, double phi, FastRng& rng, double* out) const {
+        if (pt <= 0.0) return false;
+        double eff = lookup(o, kEff, pt, std::fabs(eta), 0.0);
+        if (eff < 1.0 && rng.uniform() >= eff) return false;
+
+        double ptRes = lookup(o, kPt, pt, std::fabs(eta), 0.0);
+        double etaRes = lookup(o, kEta, pt, std::fabs(eta), 0.0);
+        double phiRes = lookup(o, kPhi, pt, std::fabs(eta), 0.0);
+        double ptReco = pt * (1.0 + ptRes * rng.gauss());
+        if (ptReco <= 0.0) return false;
+        double etaReco = eta + etaRes * rng.gauss();
+        double phiReco = phi + phiRes * rng.gauss();
+
+        double m2 = std::max(0.0, p[3] * p[3] - p[0] * p[0] - p[1] * p[1] - p[2] * p[2]);
+        out[0] = ptReco * std::cos(phiReco);
+        out[1] = ptReco * std::sin(phiReco);
+        out[2] = ptReco * std::sinh(etaReco);
+        out[3] = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2] + m2);
+        return true;
+    }
+
+    size_t size() const {
+        size_t n = 0;
+        for (const auto& object : m_rows) {
+            for (const auto& rows : object) n += rows.size();
+        }
+        return n;
+    }
+
+private:
+    static int objectIndex(const std::string& s) {
+        if (s == "muon") return kMuon;
+        if (s == "track") return kTrack;
+        return -1;
+    }
+
+    static int quantityIndex(const std::string& s) {
+        if (s == "eff") return kEff;
+        if (s == "pt") return kPt;
+        if (s == "eta") return kEta;
+        if (s == "phi") return kPhi;
+        return -1;
+    }
+
+    std::vector<Row> m_rows[kNumObjects][kNumQuantities];
+};
+
+#endif // DETECTOR_RESPONSE_H
@@ -8,18 +8,40 @@
 // Key features:
 // - Handles variable number of input sources (1 to N)
 // - Preserves particle barcodes with offsets to avoid conflicts
-// - Properly merges event weights
+// - Merges full weight vectors (nominal and variations, see combineWeights)
+// - Records which input events went into every output event, with their
+//   weights, in a side table (<output>.mixprov, mix_provenance.h) and as a
+//   mix_source_events attribute in the HepMC3 output
 // - Uses phi-source event count as reference (typically has fewer events)
+// - Reads HepMC3 ASCII or the compact binary format (.hepb, see hepmc_binary.h)
+// - Reads and writes block-compressed ASCII (.zst/.lz4, see block_compress.h),
+//   decompressing ahead and compressing on a pool of threads
+// - Reads plain ASCII inputs ahead through one queue shared by all sources
+//   (io_uring, or pread threads where it is unavailable; async_input.h), so
+//   the disks serve every source while the events are parsed
+// - Works on flat events (flat_event.h): sources are read into reused arrays,
+//   merged by concatenation and converted to HepMC2 once for writing
+// - With --require, pairs events by their per-event summaries instead of by
+//   index (event_pairing.h) and reads only the chosen events by offset
+// - With --hepmc3/--binary, writes the same merged events also as HepMC3
+//   ASCII (straight from the flat event, flat_output.h) and .hepb in the same
+//   pass; all outputs are written asynchronously (block_compress.h)
+// - Writes a run statistics record for the fleet-wide report (--stats,
+//   run_stats.h)
 //
 // Compilation (in CMSSW environment):
 //   g++ -std=c++17 -O2 event_mixer_multisource.cc -o event_mixer_multisource \
 //       -I$HEPMC3/include -I$HEPMC2/include \
 //       -L$HEPMC3/lib64 -L$HEPMC2/lib \
 //       -Wl,-rpath,$HEPMC3/lib64 -Wl,-rpath,$HEPMC2/lib \
-//       -lHepMC3 -lHepMC
+//       -lHepMC3 -lHepMC -lzstd -llz4 -pthread
 //
 // Usage:
 //   ./event_mixer_multisource output.hepmc input1.hepmc [input2.hepmc ...] [--nevents N]
+//                             [--require SPEC | --analysis JJP|JUP] [--select EXPR]
+//                             [--compress-threads N] [--read-ahead N] [--input-io uring|threads|off]
+//                             [--hepmc3 FILE] [--binary FILE.hepb]
+//                             [--provenance FILE|none] [--stats FILE|none]
 // ==============================================================================
 
 #include "HepMC3/GenEvent.h"
@@ -33,157 +55,55 @@
 #include "HepMC/GenVertex.h"
 #include "HepMC/IO_GenEvent.h"
 
+#include "block_compress.h"
+#include "hepmc_convert.h"
+#include "hepmc3_binary.h"
+#include "flat_event.h"
+#include "flat_output.h"
+#include "event_summary.h"
+#include "event_pairing.h"
+#include "mix_provenance.h"
+#include "run_stats.h"
+
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <memory>
 #include <map>
 #include <algorithm>
+#include <chrono>
 
 using namespace std;
 
-// Convert HepMC3 event to HepMC2 event
-HepMC::GenEvent* convertToHepMC2(const HepMC3::GenEvent& evt3, int eventNumber, int barcodeOffset = 0) {
-    HepMC::GenEvent* evt2 = new HepMC::GenEvent();
-    evt2->set_event_number(eventNumber);
-    evt2->set_signal_process_id(0);
-    
-    // Set weight
-    if (evt3.weights().size() > 0) {
-        evt2->weights().push_back(evt3.weights()[0]);
-    } else {
-        evt2->weights().push_back(1.0);
-    }
-    
-    // Particle mapping
-    map<int, HepMC::GenParticle*> particleMap;
-    
-    // Create all particles
-    for (const auto& p3 : evt3.particles()) {
-        HepMC::FourVector mom(p3->momentum().px(), 
-                              p3->momentum().py(),
-                              p3->momentum().pz(),
-                              p3->momentum().e());
-        HepMC::GenParticle* p2 = new HepMC::GenParticle(mom, p3->pid(), p3->status());
-        p2->suggest_barcode(p3->id() + barcodeOffset);
-        particleMap[p3->id()] = p2;
-    }
-    
-    // Create vertices and connect particles
-    for (const auto& v3 : evt3.vertices()) {
-        HepMC::FourVector pos(v3->position().x(),
-                              v3->position().y(),
-                              v3->position().z(),
-                              v3->position().t());
-        HepMC::GenVertex* v2 = new HepMC::GenVertex(pos);
-        v2->suggest_barcode(v3->id() - barcodeOffset);
-        
-        for (const auto& p3_in : v3->particles_in()) {
-            if (particleMap.count(p3_in->id())) {
-                v2->add_particle_in(particleMap[p3_in->id()]);
-            }
-        }
-        
-        for (const auto& p3_out : v3->particles_out()) {
-            if (particleMap.count(p3_out->id())) {
-                v2->add_particle_out(particleMap[p3_out->id()]);
-            }
-        }
-        
-        evt2->add_vertex(v2);
-    }
-    
-    return evt2;
-}
-
-// Merge multiple HepMC3 events into one HepMC2 event
-HepMC::GenEvent* mergeEvents(const vector<HepMC3::GenEvent*>& events, int eventNumber) {
-    HepMC::GenEvent* merged = new HepMC::GenEvent();
-    merged->set_event_number(eventNumber);
-    merged->set_signal_process_id(0);
-    
-    // Combine weights (product of all event weights)
-    double combinedWeight = 1.0;
-    for (const auto& evt : events) {
-        if (evt && evt->weights().size() > 0) {
-            combinedWeight *= evt->weights()[0];
-        }
-    }
-    merged->weights().push_back(combinedWeight);
-    
-    // Barcode offset for each source
-    const int barcodeStep = 100000;
-    
-    for (size_t srcIdx = 0; srcIdx < events.size(); ++srcIdx) {
-        if (!events[srcIdx]) continue;
-        
-        const HepMC3::GenEvent& evt = *events[srcIdx];
-        int offset = srcIdx * barcodeStep;
-        
-        // Particle mapping for this source
-        map<int, HepMC::GenParticle*> particleMap;
-        
-        // Create particles
-        for (const auto& p3 : evt.particles()) {
-            HepMC::FourVector mom(p3->momentum().px(), 
-                                  p3->momentum().py(),
-                                  p3->momentum().pz(),
-                                  p3->momentum().e());
-            HepMC::GenParticle* p2 = new HepMC::GenParticle(mom, p3->pid(), p3->status());
-            p2->suggest_barcode(p3->id() + offset);
-            particleMap[p3->id()] = p2;
-        }
-        
-        // Create vertices
-        for (const auto& v3 : evt.vertices()) {
-            HepMC::FourVector pos(v3->position().x(),
-                                  v3->position().y(),
-                                  v3->position().z(),
-                                  v3->position().t());
-            HepMC::GenVertex* v2 = new HepMC::GenVertex(pos);
-            v2->suggest_barcode(v3->id() - offset);
-            
-            for (const auto& p3_in : v3->particles_in()) {
-                if (particleMap.count(p3_in->id())) {
-                    v2->add_particle_in(particleMap[p3_in->id()]);
-                }
-            }
-            
-            for (const auto& p3_out : v3->particles_out()) {
-                if (particleMap.count(p3_out->id())) {
-                    v2->add_particle_out(particleMap[p3_out->id()]);
-                }
-            }
-            
-            merged->add_vertex(v2);
-        }
-    }
-    
-    return merged;
-}
-
-// Count specific particles in event
-void countParticles(const HepMC::GenEvent* evt, int& nJpsi, int& nUpsilon, int& nPhi) {
-    nJpsi = 0;
-    nUpsilon = 0;
-    nPhi = 0;
-    
-    for (auto p = evt->particles_begin(); p != evt->particles_end(); ++p) {
-        int pid = abs((*p)->pdg_id());
-        if (pid == 443) nJpsi++;
-        else if (pid == 553 || pid == 100553 || pid == 200553) nUpsilon++;
-        else if (pid == 333) nPhi++;
-    }
-}
+// Muon acceptance used when summarizing inputs without a sidecar
+// (matches the shower arguments in run_chain.sh)
+const double kMuonMinPt = 2.5;
+const double kMuonMaxEta = 2.4;
 
 void printUsage(const char* progName) {
     cerr << "\n=== Multi-Source HepMC Event Mixer ===" << endl;
     cerr << "Usage: " << progName << " output.hepmc input1.hepmc [input2.hepmc ...] [--nevents N]" << endl;
     cerr << "\nArguments:" << endl;
-    cerr << "  output.hepmc  : Output merged HepMC file" << endl;
-    cerr << "  input1.hepmc  : First input HepMC file" << endl;
+    cerr << "  output.hepmc  : Output merged HepMC file (.zst/.lz4 block-compressed)" << endl;
+    cerr << "  input1.hepmc  : First input HepMC3 file (.hepb binary, .zst/.lz4 compressed)" << endl;
     cerr << "  inputN.hepmc  : Additional input files (optional)" << endl;
     cerr << "  --nevents N   : Maximum events to process (default: all)" << endl;
+    cerr << "  --require SPEC: Pair events so every output satisfies SPEC, e.g." << endl;
+    cerr << "                  jpsi=2,phi=1 or jpsi=1,upsilon=1,phi=1[,phi-pt=X]" << endl;
+    cerr << "                  (J/psi/Upsilon counted with both muons in acceptance)" << endl;
+    cerr << "  --analysis T  : Shortcut for the campaign requirement of JJP or JUP" << endl;
+    cerr << "  --select EXPR : Write only combined events matching EXPR, counted over all" << endl;
+    cerr << "                  sources (selection language, see selection_expr.h)" << endl;
+    cerr << "  --compress-threads N: Threads per compressed file (default: 2)" << endl;
+    cerr << "  --read-ahead N: 1 MB chunks read ahead per plain ASCII input, 0 for" << endl;
+    cerr << "                  synchronous reads (default: " << kDefaultReadAhead << ")" << endl;
+    cerr << "  --input-io B  : Read-ahead backend: uring (falls back to threads when" << endl;
+    cerr << "                  io_uring is unavailable), threads, off (default: uring)" << endl;
+    cerr << "  --hepmc3 FILE : Also write the merged events as HepMC3 ASCII (.zst/.lz4 allowed)" << endl;
+    cerr << "  --binary FILE : Also write the merged events in the binary format (.hepb)" << endl;
+    cerr << "  --provenance FILE: Weight/provenance side table, 'none' to disable" << endl;
+    cerr << "                  (default: output.hepmc.mixprov)" << endl;
+    cerr << "  --stats FILE  : Run statistics record, 'none' to disable (default: output.hepmc.runstats)" << endl;
     cerr << "\nExamples:" << endl;
     cerr << "  # Single source (passthrough with HepMC2 conversion):" << endl;
     cerr << "  " << progName << " output.hepmc phi.hepmc" << endl;
@@ -191,9 +111,100 @@ void printUsage(const char* progName) {
     cerr << "  " << progName << " output.hepmc normal.hepmc phi.hepmc" << endl;
     cerr << "\n  # TPS (three sources):" << endl;
     cerr << "  " << progName << " output.hepmc src1.hepmc src2.hepmc src3.hepmc" << endl;
+    cerr << "\n  # DPS pairing only combinations with two accepted J/psi and a phi:" << endl;
+    cerr << "  " << progName << " output.hepmc normal.hepmc phi.hepmc --analysis JJP" << endl;
+    cerr << "\nPer-event summaries are read from <input>.evsum when present (written by" << endl;
+    cerr << "the shower programs), otherwise gathered in a first pass over the input." << endl;
+}
+
+// One input source with sequential and offset-based reads into a flat event;
+// the format is chosen by file extension. Binary records are read as they
+// are, ASCII events go through a reused HepMC3 event. ASCII offsets are byte
+// positions of event blocks (as stored in the summary sidecar, uncompressed
+// positions for .zst/.lz4), binary offsets are frame positions.
+class EventSource {
+public:
+    bool open(const string& file, int compressThreads = kDefaultCompressionThreads, ReadQueue* readQueue = nullptr) {
+        m_binary = isBinaryEventFile(file);
+        if (m_binary) {
+            m_binaryReader = new ReaderBinary(file);
+            m_reader.reset(m_binaryReader);
+        } else {
+            if (!m_stream.open(file, compressThreads, readQueue)) return false;
+            m_reader.reset(new HepMC3::ReaderAscii(m_stream));
+        }
+        return !m_reader->failed();
+    }
+
+    bool isBinary() const { return m_binary; }
+
+    // Offset of the next event returned by next()
+    uint64_t tell() {
+        if (m_binary) return m_binaryReader->tell();
+        return (uint64_t)m_stream.tellg();
+    }
+
+    bool next(BinaryEvent& evt) {
+        if (m_binary) return m_binaryReader->read_binary(evt);
+        if (!m_reader->read_event(m_event) || m_reader->failed()) return false;
+        hepmc3ToBinary(m_event, evt);
+        return true;
+    }
+
+    bool readAt(uint64_t offset, BinaryEvent& evt) {
+        if (m_binary) {
+            if (!m_binaryReader->seek(offset)) return false;
+        } else {
+            m_stream.clear();
+            m_stream.seekg(offset);
+            if (!m_stream) return false;
+            m_event.clear();
+        }
+        return next(evt);
+    }
+
+private:
+    bool m_binary = false;
+    EventInputStream m_stream;
+    unique_ptr<HepMC3::Reader> m_reader;
+    ReaderBinary* m_binaryReader = nullptr;   // m_reader for .hepb
+    HepMC3::GenEvent m_event;
+};
+
+// Per-event summaries of one source: from the sidecar if there is one,
+// otherwise from a first pass over the events (offsets recorded on the way)
+bool loadSummaries(const string& file, vector<EventSummary>& summaries, bool& fromSidecar,
+                   ReadQueue* readQueue = nullptr) {
+    summaries.clear();
+    fromSidecar = false;
+
+    SummaryFile sidecar;
+    if (sidecar.open(summaryPathFor(file))) {
+        summaries.assign(sidecar.records(), sidecar.records() + sidecar.size());
+        fromSidecar = true;
+        return true;
+    }
+
+    EventSource source;
+    if (!source.open(file, kDefaultCompressionThreads, readQueue)) return false;
+    BinaryEvent evt;
+    FlatLinks links;
+    while (true) {
+        uint64_t offset = source.tell();
+        if (!source.next(evt)) break;
+        links.build(evt);
+        EventSummary summary;
+        fillEventSummary(evt, links, kMuonMinPt, kMuonMaxEta, summary);
+        summary.hepmcOffset = offset;
+        summary.eventIndex = summaries.size();
+        summary.lheIndex = 0;
+        summaries.push_back(summary);
+    }
+    return true;
 }
 
 int main(int argc, char* argv[]) {
+    auto tStart = chrono::steady_clock::now();
     if (argc < 3) {
         printUsage(argv[0]);
         return 1;
@@ -203,11 +214,53 @@ int main(int argc, char* argv[]) {
     string outputFile = argv[1];
     vector<string> inputFiles;
     int nEvents = -1;
+    PairingRequirement requirement;
+    string selectExpr;
+    int compressThreads = kDefaultCompressionThreads;
+    int readAhead = kDefaultReadAhead;
+    ReadBackend readBackend = kReadUring;
+    string hepmc3File;
+    string binaryFile;
+    string provenanceFile;
+    string statsFile;
     
     for (int i = 2; i < argc; ++i) {
         string arg = argv[i];
         if (arg == "--nevents" && i + 1 < argc) {
             nEvents = atoi(argv[++i]);
+        } else if (arg == "--require" && i + 1 < argc) {
+            if (!parseRequirement(argv[++i], requirement)) {
+                cerr << "Error: Invalid requirement: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--analysis" && i + 1 < argc) {
+            if (!requirementForAnalysis(argv[++i], requirement)) {
+                cerr << "Error: Unknown analysis: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--select" && i + 1 < argc) {
+            selectExpr = argv[++i];
+        } else if (arg == "--compress-threads" && i + 1 < argc) {
+            compressThreads = atoi(argv[++i]);
+        } else if (arg == "--read-ahead" && i + 1 < argc) {
+            readAhead = atoi(argv[++i]);
+        } else if (arg == "--input-io" && i + 1 < argc) {
+            if (!parseReadBackend(argv[++i], readBackend)) {
+                cerr << "Error: Unknown --input-io backend: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--hepmc3" && i + 1 < argc) {
+            hepmc3File = argv[++i];
+        } else if (arg == "--binary" && i + 1 < argc) {
+            binaryFile = argv[++i];
+            if (!isBinaryEventFile(binaryFile)) {
+                cerr << "Error: --binary output must end in .hepb: " << binaryFile << endl;
+                return 1;
+            }
+        } else if (arg == "--provenance" && i + 1 < argc) {
+            provenanceFile = argv[++i];
+        } else if (arg == "--stats" && i + 1 < argc) {
+            statsFile = argv[++i];
         } else if (arg[0] != '-') {
             inputFiles.push_back(arg);
         }
@@ -220,71 +273,197 @@ int main(int argc, char* argv[]) {
     
     int nSources = inputFiles.size();
     
+    // Provenance side table next to the output unless disabled
+    if (provenanceFile.empty()) provenanceFile = provenancePathFor(outputFile);
+    else if (provenanceFile == "none") provenanceFile.clear();
+    if (statsFile.empty()) statsFile = runStatsPathFor(outputFile);
+    else if (statsFile == "none") statsFile.clear();
+    
+    SelectionProgram selection;
+    SelectionState selectionState;
+    if (!selectExpr.empty()) {
+        string error;
+        if (!selection.compile(selectExpr, error)) {
+            cerr << "Error: Invalid --select expression: " << error << endl;
+            return 1;
+        }
+        selection.reset(selectionState);
+    }
+    
+    // Read-ahead for the plain ASCII inputs, one queue for all of them; one
+    // reader more for the first pass of loadSummaries
+    ReadQueue readQueue;
+    int nPlainInputs = 0;
+    for (const auto& file : inputFiles) {
+        if (!isBinaryEventFile(file) && blockCodecFor(file) == kCodecNone) ++nPlainInputs;
+    }
+    if (nPlainInputs > 0) {
+        readQueue.start(nPlainInputs + 1, readAhead, readBackend, min(nPlainInputs * readAhead, kMaxReadThreads));
+    }
+    
     cout << "\n=== Multi-Source HepMC Event Mixer ===" << endl;
     cout << "Output:     " << outputFile << endl;
+    if (!hepmc3File.empty()) cout << "  HepMC3:   " << hepmc3File << endl;
+    if (!binaryFile.empty()) cout << "  Binary:   " << binaryFile << endl;
+    if (!provenanceFile.empty()) cout << "  Provenance: " << provenanceFile << endl;
     cout << "N sources:  " << nSources << endl;
     for (size_t i = 0; i < inputFiles.size(); ++i) {
         cout << "  Input " << i+1 << ": " << inputFiles[i] << endl;
     }
     cout << "N events:   " << (nEvents > 0 ? to_string(nEvents) : "all") << endl;
+    cout << "Pairing:    " << (requirement.empty() ? "sequential" : requirementString(requirement)) << endl;
+    if (!selection.empty()) cout << "Selection:  " << selection.source() << endl;
+    if (readQueue.running()) {
+        cout << "Input I/O:  " << readQueue.describe() << ", " << readAhead << " MB ahead per input";
+        if (readBackend == kReadUring && readQueue.backend() != kReadUring) cout << " (io_uring unavailable)";
+        cout << endl;
+    }
     cout << "========================================\n" << endl;
     
     // Open input files
-    vector<unique_ptr<HepMC3::ReaderAscii>> readers;
+    vector<unique_ptr<EventSource>> sources;
     for (const auto& file : inputFiles) {
-        auto reader = make_unique<HepMC3::ReaderAscii>(file);
-        if (reader->failed()) {
+        unique_ptr<EventSource> source(new EventSource());
+        if (!source->open(file, compressThreads, &readQueue)) {
             cerr << "Error: Cannot open input file: " << file << endl;
             return 1;
         }
-        readers.push_back(std::move(reader));
+        sources.push_back(std::move(source));
+    }
+    
+    // Requirement-driven pairing: choose the tuples up front from the summaries
+    bool smartPairing = !requirement.empty();
+    vector<vector<EventSummary>> summaries(nSources);
+    PairingResult pairing;
+    if (smartPairing) {
+        auto tStart = chrono::steady_clock::now();
+        PairingClasses classes(requirement);
+        vector<vector<int>> eventClasses(nSources);
+        
+        for (int i = 0; i < nSources; ++i) {
+            bool fromSidecar = false;
+            if (!loadSummaries(inputFiles[i], summaries[i], fromSidecar, &readQueue)) {
+                cerr << "Error: Cannot summarize input file: " << inputFiles[i] << endl;
+                return 1;
+            }
+            for (const auto& summary : summaries[i]) eventClasses[i].push_back(classes.classOf(summary));
+            cout << "Input " << i+1 << ": " << summaries[i].size() << " events summarized ("
+                 << (fromSidecar ? "sidecar" : "first pass") << ")" << endl;
+        }
+        
+        pairing = pairEvents(eventClasses, requirement, nEvents > 0 ? (size_t)nEvents : 0);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - tStart).count();
+        cout << "Pairing: " << pairing.tuples.size() << " combinations satisfy the requirement ("
+             << (pairing.upperBound == pairing.tuples.size()
+                 ? string("maximum")
+                 : "at most " + to_string(pairing.upperBound - pairing.tuples.size()) + " below the maximum")
+             << ", " << seconds << " s)" << endl;
     }
     
     // Open output file
-    ofstream outStream(outputFile);
-    if (!outStream.is_open()) {
+    EventOutputStream outStream;
+    if (!outStream.open(outputFile, compressThreads)) {
         cerr << "Error: Cannot open output file: " << outputFile << endl;
         return 1;
     }
     HepMC::IO_GenEvent writer(outStream);
     
+    // Optional HepMC3 and binary copies of the same merged events
+    EventOutputStream hepmc3Stream, binaryStream;
+    unique_ptr<FlatHepMC3Writer> hepmc3Writer;
+    if (!hepmc3File.empty()) {
+        if (!hepmc3Stream.open(hepmc3File, compressThreads)) {
+            cerr << "Error: Cannot open output file: " << hepmc3File << endl;
+            return 1;
+        }
+        hepmc3Writer.reset(new FlatHepMC3Writer(hepmc3Stream));
+    }
+    if (!binaryFile.empty()) {
+        if (!binaryStream.open(binaryFile, compressThreads) || !writeBinaryFileHeader(binaryStream)) {
+            cerr << "Error: Cannot open output file: " << binaryFile << endl;
+            return 1;
+        }
+    }
+    
+    ProvenanceWriter provenanceWriter;
+    if (!provenanceFile.empty() && !provenanceWriter.open(provenanceFile, inputFiles)) {
+        cerr << "Error: Cannot open provenance file: " << provenanceFile << endl;
+        return 1;
+    }
+    
+    // Flat events, reused for every combination
+    vector<BinaryEvent> events(nSources);
+    vector<const BinaryEvent*> eventPtrs(nSources);
+    for (int i = 0; i < nSources; ++i) eventPtrs[i] = &events[i];
+    BinaryEvent merged;
+    FlatMergeLayout layout;
+    FlatLinks links;
+    MixProvenance provenance;
+    provenance.sources.resize(nSources);
+    vector<uint32_t> nRead(nSources, 0);   // events read per source (sequential pairing)
+    string sourceEvents;
+    
     // Process events
     int iEvent = 0;
+    int iTuple = 0;      // combinations read (differs from iEvent with --select)
+    int nRejected = 0;
+    int nWeightsNominal = 0;   // weight vectors that could not be combined
     int totalJpsi = 0, totalUpsilon = 0, totalPhi = 0;
+    StatsHistogram eventMicros = {};   // wall time per combination
     
+    double initSeconds = chrono::duration<double>(chrono::steady_clock::now() - tStart).count();
+    auto tLoop = chrono::steady_clock::now();
     cout << "Processing events..." << endl;
     
     while (true) {
         if (nEvents > 0 && iEvent >= nEvents) break;
         
-        // Read one event from each source
-        vector<HepMC3::GenEvent*> events(nSources, nullptr);
-        bool allValid = true;
+        if (smartPairing && iTuple >= (int)pairing.tuples.size()) break;
+        auto tEvent = chrono::steady_clock::now();
         
-        for (int i = 0; i < nSources; ++i) {
-            events[i] = new HepMC3::GenEvent();
-            if (!readers[i]->read_event(*events[i]) || readers[i]->failed()) {
-                allValid = false;
-                delete events[i];
-                events[i] = nullptr;
+        // Read one event from each source (the paired ones, by offset, with
+        // --require), noting where it came from
+        bool allValid = true;
+        for (int i = 0; i < nSources && allValid; ++i) {
+            ProvenanceSource& origin = provenance.sources[i];
+            if (smartPairing) {
+                const EventSummary& summary = summaries[i][pairing.tuples[iTuple][i]];
+                origin.offset = summary.hepmcOffset;
+                origin.eventIndex = summary.eventIndex;
+                allValid = sources[i]->readAt(summary.hepmcOffset, events[i]);
+            } else {
+                origin.offset = sources[i]->tell();
+                origin.eventIndex = nRead[i]++;
+                allValid = sources[i]->next(events[i]);
             }
+            origin.eventNumber = events[i].eventNumber;
+            origin.nWeights = events[i].weights.size();
         }
         
         if (!allValid) {
-            // Clean up and exit
-            for (auto evt : events) {
-                if (evt) delete evt;
+            if (smartPairing) {
+                cerr << "Error: Cannot read paired event " << iTuple << " (stale summary sidecar?)" << endl;
+                return 1;
             }
             cout << "Reached end of at least one input file." << endl;
             break;
         }
         
-        // Merge events
-        HepMC::GenEvent* merged;
-        if (nSources == 1) {
-            merged = convertToHepMC2(*events[0], iEvent);
-        } else {
-            merged = mergeEvents(events, iEvent);
+        ++iTuple;
+        
+        // Merge events: concatenation, vertex links shifted per source
+        if (!mergeFlatEvents(eventPtrs, iEvent, merged, layout)) ++nWeightsNominal;
+        
+        // Links are shared by the selection and the HepMC3 writer
+        if (!selection.empty() || hepmc3Writer) links.build(merged);
+        
+        // Selection over the combined sources (counts add up across sources)
+        if (!selection.empty()) {
+            if (!selection.match(FlatEventView{merged, links}, selectionState)) {
+                ++nRejected;
+                eventMicros.fill(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - tEvent).count());
+                continue;
+            }
         }
         
         // Count particles
@@ -294,14 +473,29 @@ int main(int argc, char* argv[]) {
         totalUpsilon += nUpsilon;
         totalPhi += nPhi;
         
-        // Write output
-        writer.write_event(merged);
-        
-        // Cleanup
-        for (auto evt : events) {
-            if (evt) delete evt;
+        // Write output: HepMC2 for CMSSW, then the optional copies
+        HepMC::GenEvent* evt2 = flatToHepMC2(merged, iEvent, &layout);
+        writer.write_event(evt2);
+        delete evt2;
+        if (hepmc3Writer) {
+            sourceEvents.clear();
+            for (int i = 0; i < nSources; ++i) {
+                sourceEvents += (i ? "," : "") + to_string(provenance.sources[i].eventIndex);
+            }
+            hepmc3Writer->addAttribute("mix_source_events", sourceEvents);
+            hepmc3Writer->write(merged, links);
+        }
+        if (!binaryFile.empty() && !writeBinaryEvent(binaryStream, merged)) {
+            cerr << "Error: Cannot write event " << iEvent << " to " << binaryFile << endl;
+            return 1;
         }
-        delete merged;
+        if (provenanceWriter.isOpen()) {
+            provenance.eventNumber = iEvent;
+            provenance.weights.clear();
+            for (int i = 0; i < nSources; ++i) appendArray(provenance.weights, events[i].weights);
+            provenanceWriter.write(provenance);
+        }
+        eventMicros.fill(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - tEvent).count());
         
         ++iEvent;
         if (iEvent % 100 == 0) {
@@ -309,19 +503,80 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    outStream.close();
+    double loopSeconds = chrono::duration<double>(chrono::steady_clock::now() - tLoop).count();
+    if (hepmc3Writer) hepmc3Writer->close();
+    vector<pair<string, EventOutputStream*>> outputs = {{outputFile, &outStream}};
+    if (!hepmc3File.empty()) outputs.push_back({hepmc3File, &hepmc3Stream});
+    if (!binaryFile.empty()) outputs.push_back({binaryFile, &binaryStream});
+    for (auto& output : outputs) {
+        if (!output.second->close()) {
+            cerr << "Error: Failed writing output file: " << output.first << endl;
+            return 1;
+        }
+    }
+    uint64_t nProvenance = provenanceWriter.nRecords();
+    provenanceWriter.close();
     
     cout << "\n========================================" << endl;
     cout << "Mixing Summary:" << endl;
     cout << "----------------------------------------" << endl;
     cout << "Total events merged: " << iEvent << endl;
+    if (!selection.empty()) {
+        cout << "Rejected (--select): " << nRejected << endl;
+    }
+    if (smartPairing) {
+        cout << "Requirement:         " << requirementString(requirement) << endl;
+        for (int i = 0; i < nSources; ++i) {
+            cout << "  Input " << i+1 << " unused:    " << pairing.unused[i]
+                 << " / " << summaries[i].size() << endl;
+        }
+    }
+    if (nWeightsNominal > 0) {
+        cout << "Nominal weight only: " << nWeightsNominal << " (weight vectors of different length)" << endl;
+    }
     cout << "Particle counts:" << endl;
     cout << "  Total J/psi:   " << totalJpsi << endl;
     cout << "  Total Upsilon: " << totalUpsilon << endl;
     cout << "  Total phi:     " << totalPhi << endl;
     cout << "----------------------------------------" << endl;
-    cout << "Output file: " << outputFile << endl;
+    for (auto& output : outputs) {
+        cout << "Output file: " << output.first << " (" << output.second->rawBytes() / 1e6 << " MB";
+        if (output.second->codec() != kCodecNone) {
+            cout << ", " << blockCodecName(output.second->codec()) << " " << output.second->packedBytes() / 1e6 << " MB";
+        }
+        cout << ")" << endl;
+    }
+    if (!provenanceFile.empty()) {
+        cout << "Provenance:  " << provenanceFile << " (" << nProvenance << " records)" << endl;
+    }
     cout << "========================================" << endl;
     
+    // Run statistics record for the fleet-wide report (run_stats.h)
+    if (!statsFile.empty()) {
+        RunStats run;
+        initRunStats(run, "event_mixer", inputFiles[0], outputFile);
+        run.initSeconds = initSeconds;
+        run.loopSeconds = loopSeconds;
+        run.counters[kRunLheEvents] = iTuple;
+        run.counters[kRunAccepted] = iEvent;
+        run.counters[kRunFailed] = nRejected;
+        run.counters[kRunJpsi] = totalJpsi;
+        run.counters[kRunUpsilon] = totalUpsilon;
+        run.counters[kRunPhi] = totalPhi;
+        run.counters[kRunNominalWeights] = nWeightsNominal;
+        if (smartPairing) {
+            for (int i = 0; i < nSources; ++i) {
+                run.counters[kRunInputEvents] += summaries[i].size();
+                run.counters[kRunUnusedInputs] += pairing.unused[i];
+            }
+        }
+        run.eventMicros = eventMicros;
+        finishRunStats(run, tStart);
+        if (!writeRunStats(statsFile, run)) {
+            cerr << "Error: Cannot write run statistics: " << statsFile << endl;
+            return 1;
+        }
+    }
+    
     return 0;
 }
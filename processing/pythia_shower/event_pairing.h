@@ -0,0 +1,273 @@
+// ==============================================================================
+// event_pairing.h - Requirement-driven pairing of events across mixer sources
+// ==============================================================================
+// The mixer normally combines event i of every source. With a campaign
+// requirement (e.g. JJP: two J/psi -> mu mu in acceptance plus a phi) most of
+// those blind tuples fail downstream. Here every source event is reduced to a
+// small class from its EventSummary (accepted J/psi, accepted Upsilon, phi
+// above threshold, each capped at what the requirement asks for), and only
+// tuples of classes that together satisfy the requirement are formed.
+//
+// The number of classes is tiny (6 for JJP, 12 for JUP), so every class tuple
+// can be enumerated and the number of tuples is maximized by a small linear
+// program over their multiplicities (see pairEvents): exact for two sources,
+// within a reported bound of the maximum for more.
+//
+// Header-only, no external dependencies.
+// ==============================================================================
+
+#ifndef EVENT_PAIRING_H
+#define EVENT_PAIRING_H
+
+#include "event_summary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// What a combined event must contain, summed over its sources
+struct PairingRequirement {
+    int nJpsi = 0;           // J/psi with both muons in acceptance
+    int nUpsilon = 0;        // Upsilon with both muons in acceptance
+    int nPhi = 0;            // 0 or 1: leading phi above phiMinPt
+    double phiMinPt = 0.0;
+
+    bool empty() const { return nJpsi == 0 && nUpsilon == 0 && nPhi == 0; }
+};
+
+// Parses "jpsi=2,upsilon=0,phi=1,phi-pt=4.0"; returns false on an unknown key
+inline bool parseRequirement(const std::string& spec, PairingRequirement& req) {
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        if (key == "jpsi") req.nJpsi = atoi(value.c_str());
+        else if (key == "upsilon") req.nUpsilon = atoi(value.c_str());
+        else if (key == "phi") req.nPhi = std::min(1, atoi(value.c_str()));
+        else if (key == "phi-pt") req.phiMinPt = atof(value.c_str());
+        else return false;
+    }
+    return true;
+}
+
+// Campaign requirements by analysis type (see README, Campaign Physics)
+inline bool requirementForAnalysis(const std::string& analysis, PairingRequirement& req) {
+    if (analysis == "JJP") return parseRequirement("jpsi=2,phi=1", req);
+    if (analysis == "JUP") return parseRequirement("jpsi=1,upsilon=1,phi=1", req);
+    return false;
+}
+
+inline std::string requirementString(const PairingRequirement& req) {
+    std::ostringstream out;
+    out << "jpsi=" << req.nJpsi << ",upsilon=" << req.nUpsilon << ",phi=" << req.nPhi;
+    if (req.phiMinPt > 0.0) out << ",phi-pt=" << req.phiMinPt;
+    return out.str();
+}
+
+// Event classes: (jpsi, upsilon, phi) contributions, each capped at the requirement
+class PairingClasses {
+public:
+    explicit PairingClasses(const PairingRequirement& req)
+        : m_req(req), m_nJ(req.nJpsi + 1), m_nU(req.nUpsilon + 1), m_nP(req.nPhi + 1) {}
+
+    int size() const { return m_nJ * m_nU * m_nP; }
+
+    int classOf(const EventSummary& s) const {
+        int j = std::min<int>(s.nJpsiAccepted, m_req.nJpsi);
+        int u = std::min<int>(s.nUpsilonAccepted, m_req.nUpsilon);
+        int p = ((s.flags & kSumHasPhi) && s.phiPt > m_req.phiMinPt) ? m_req.nPhi : 0;
+        return (j * m_nU + u) * m_nP + p;
+    }
+
+    int jpsi(int c) const { return c / (m_nU * m_nP); }
+    int upsilon(int c) const { return (c / m_nP) % m_nU; }
+    int phi(int c) const { return c % m_nP; }
+
+private:
+    PairingRequirement m_req;
+    int m_nJ, m_nU, m_nP;
+};
+
+// Result: tuples[k][s] is the event index taken from source s for combined event k
+struct PairingResult {
+    std::vector<std::vector<uint32_t>> tuples;
+    std::vector<size_t> unused;     // per source
+    size_t upperBound = 0;          // no pairing forms more tuples (== tuples.size(): optimal)
+};
+
+// Maximizes c.x subject to A x <= b, x >= 0, for b >= 0 (the slack basis is
+// feasible, so no phase 1). Dense tableau with Bland's rule, which cannot
+// cycle on the degenerate bases that empty classes produce.
+inline std::vector<double> simplexMaximize(const std::vector<std::vector<double>>& A,
+                                           const std::vector<double>& b,
+                                           const std::vector<double>& c, double& optimum) {
+    const double eps = 1e-9;
+    const size_t m = b.size(), n = c.size(), width = n + m + 1;
+    std::vector<std::vector<double>> t(m + 1, std::vector<double>(width, 0.0));
+    std::vector<size_t> basis(m);
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) t[i][j] = A[i][j];
+        t[i][n + i] = 1.0;
+        t[i][width - 1] = b[i];
+        basis[i] = n + i;
+    }
+    for (size_t j = 0; j < n; ++j) t[m][j] = -c[j];
+
+    for (int iter = 0; iter < 100000; ++iter) {
+        size_t enter = width;
+        for (size_t j = 0; j + 1 < width; ++j) {
+            if (t[m][j] < -eps) { enter = j; break; }
+        }
+        if (enter == width) break;
+        size_t leave = m;
+        double best = 0.0;
+        for (size_t i = 0; i < m; ++i) {
+            if (t[i][enter] <= eps) continue;
+            double ratio = t[i][width - 1] / t[i][enter];
+            if (leave == m || ratio < best - eps || (ratio < best + eps && basis[i] < basis[leave])) {
+                leave = i;
+                best = ratio;
+            }
+        }
+        if (leave == m) break;      // unbounded; cannot happen with supply rows
+        double pivot = t[leave][enter];
+        for (double& v : t[leave]) v /= pivot;
+        for (size_t i = 0; i <= m; ++i) {
+            if (i == leave || std::abs(t[i][enter]) <= eps) continue;
+            double f = t[i][enter];
+            for (size_t j = 0; j < width; ++j) t[i][j] -= f * t[leave][j];
+        }
+        basis[leave] = enter;
+    }
+
+    std::vector<double> x(n, 0.0);
+    for (size_t i = 0; i < m; ++i) {
+        if (basis[i] < n) x[basis[i]] = t[i][width - 1];
+    }
+    optimum = t[m][width - 1];
+    return x;
+}
+
+// classes[s][i] is the class of event i of source s (PairingClasses::classOf).
+// Tuples are returned ordered by their source-0 event index so that source 0
+// is read sequentially.
+//
+// The number of tuples is maximized over the multiplicity of every satisfying
+// class tuple, subject to the events of each (source, class) and maxTuples: a
+// linear program with one row per (source, class). For two sources the rows
+// are the incidence matrix of a bipartite graph (plus the maxTuples row, the
+// sum of the source-0 rows), which is totally unimodular, so the LP optimum is
+// integral and the pairing is the exact maximum. For more sources the LP
+// solution is rounded down and the leftover events are filled greedily
+// (cheapest tuples first, surplus weighted by scarcity); the LP optimum bounds
+// the result from above and is reported as upperBound.
+inline PairingResult pairEvents(const std::vector<std::vector<int>>& classes,
+                                const PairingRequirement& req, size_t maxTuples = 0) {
+    PairingClasses cls(req);
+    const int nSources = classes.size();
+    const int nClasses = cls.size();
+
+    // Events of each class, in file order
+    std::vector<std::vector<std::vector<uint32_t>>> pool(nSources, std::vector<std::vector<uint32_t>>(nClasses));
+    for (int s = 0; s < nSources; ++s) {
+        for (size_t i = 0; i < classes[s].size(); ++i) pool[s][classes[s][i]].push_back(i);
+    }
+
+    // Total supply of each quantity, for the scarcity weights
+    double supplyJ = 0, supplyU = 0, supplyP = 0;
+    for (int s = 0; s < nSources; ++s) {
+        for (int c = 0; c < nClasses; ++c) {
+            supplyJ += (double)cls.jpsi(c) * pool[s][c].size();
+            supplyU += (double)cls.upsilon(c) * pool[s][c].size();
+            supplyP += (double)cls.phi(c) * pool[s][c].size();
+        }
+    }
+
+    // Enumerate all satisfying class tuples of non-empty classes with their cost
+    struct Candidate { double cost; std::vector<int> classOf; };
+    std::vector<Candidate> candidates;
+    std::vector<int> tuple(nSources, 0);
+    size_t nTuples = 1;
+    for (int s = 0; s < nSources; ++s) nTuples *= nClasses;
+    for (size_t t = 0; t < nTuples; ++t) {
+        size_t rest = t;
+        int j = 0, u = 0, p = 0;
+        bool available = true;
+        for (int s = 0; s < nSources; ++s) {
+            tuple[s] = rest % nClasses;
+            rest /= nClasses;
+            available = available && !pool[s][tuple[s]].empty();
+            j += cls.jpsi(tuple[s]);
+            u += cls.upsilon(tuple[s]);
+            p += cls.phi(tuple[s]);
+        }
+        if (!available || j < req.nJpsi || u < req.nUpsilon || p < req.nPhi) continue;
+        double cost = (j - req.nJpsi) / std::max(1.0, supplyJ)
+                    + (u - req.nUpsilon) / std::max(1.0, supplyU)
+                    + (p - req.nPhi) / std::max(1.0, supplyP);
+        candidates.push_back({cost, tuple});
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.cost < b.cost; });
+
+    // LP over the candidate multiplicities
+    const size_t nRows = (size_t)nSources * nClasses + (maxTuples > 0 ? 1 : 0);
+    std::vector<std::vector<double>> A(nRows, std::vector<double>(candidates.size(), 0.0));
+    std::vector<double> b(nRows, 0.0), objective(candidates.size(), 1.0);
+    for (int s = 0; s < nSources; ++s) {
+        for (int c = 0; c < nClasses; ++c) b[s * nClasses + c] = pool[s][c].size();
+    }
+    if (maxTuples > 0) b[nRows - 1] = maxTuples;
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        for (int s = 0; s < nSources; ++s) A[s * nClasses + candidates[k].classOf[s]][k] = 1.0;
+        if (maxTuples > 0) A[nRows - 1][k] = 1.0;
+    }
+    double lpOptimum = 0.0;
+    std::vector<double> multiplicity = candidates.empty()
+        ? std::vector<double>() : simplexMaximize(A, b, objective, lpOptimum);
+
+    PairingResult result;
+    result.upperBound = (size_t)std::floor(lpOptimum + 1e-6);
+    std::vector<std::vector<size_t>> next(nSources, std::vector<size_t>(nClasses, 0));
+    auto fill = [&](const Candidate& cand, size_t want) {
+        size_t take = want;
+        for (int s = 0; s < nSources; ++s) {
+            int c = cand.classOf[s];
+            take = std::min(take, pool[s][c].size() - next[s][c]);
+        }
+        if (maxTuples > 0) take = std::min(take, maxTuples - result.tuples.size());
+        for (size_t k = 0; k < take; ++k) {
+            std::vector<uint32_t> picked(nSources);
+            for (int s = 0; s < nSources; ++s) {
+                int c = cand.classOf[s];
+                picked[s] = pool[s][c][next[s][c]++];
+            }
+            result.tuples.push_back(picked);
+        }
+    };
+
+    // LP solution rounded down (exact for two sources), then greedy on what is left
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        fill(candidates[k], (size_t)std::floor(multiplicity[k] + 1e-6));
+    }
+    for (const auto& cand : candidates) fill(cand, SIZE_MAX);
+    result.upperBound = std::max(result.upperBound, result.tuples.size());
+
+    std::sort(result.tuples.begin(), result.tuples.end());
+
+    result.unused.assign(nSources, 0);
+    for (int s = 0; s < nSources; ++s) {
+        result.unused[s] = classes[s].size();
+        for (int c = 0; c < nClasses; ++c) result.unused[s] -= next[s][c];
+    }
+    return result;
+}
+
+#endif // EVENT_PAIRING_H
@@ -0,0 +1,293 @@
+// ==============================================================================
+// event_summary.h - Per-event summary sidecar for shower HepMC outputs
+// ==============================================================================
+// shower_normal/shower_phi write one fixed-width record per written HepMC event
+// to a sidecar file (default: <output>.evsum). Tools that only need per-event
+// facts (phi present, onium kinematics, dimuon acceptance, retries, weight)
+// mmap the sidecar instead of parsing the HepMC text; every column is a
+// constant-stride array over the mapping, and hepmcOffset points at the event
+// in the HepMC file for random access.
+//
+// File layout (little endian):
+//   header  : 64 bytes, SummaryFileHeader
+//   records : nRecords x 64 bytes, EventSummary, in HepMC event order
+//
+// nRecords is patched when the writer closes; a sidecar from a job that died
+// has nRecords = 0 and its length is taken from the file size instead.
+//
+// fillSummaryFromView fills the per-event facts from any event record view,
+// once for the shower (Pythia8), flat and HepMC3 paths.
+//
+// Header-only, no external dependencies.
+// ==============================================================================
+
+#ifndef EVENT_SUMMARY_H
+#define EVENT_SUMMARY_H
+
+#include "kinematics_simd.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char kSummaryMagic[4] = {'E', 'S', 'U', 'M'};
+const uint32_t kSummaryVersion = 1;
+
+// Flag bits of EventSummary::flags
+enum SummaryFlags : uint32_t {
+    kSumHasJpsi           = 1u << 0,
+    kSumHasUpsilon        = 1u << 1,
+    kSumHasPhi            = 1u << 2,
+    kSumJpsiMuonsAccepted = 1u << 3, // J/psi -> mu+ mu- with both muons in acceptance
+    kSumUpsMuonsAccepted  = 1u << 4, // Upsilon -> mu+ mu- with both muons in acceptance
+};
+
+struct SummaryFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved0;
+    uint64_t nRecords;
+    char mode[8];            // shower mode ("normal", "phi")
+    char reserved[32];
+};
+
+struct EventSummary {
+    uint64_t hepmcOffset;    // byte offset of the event block in the HepMC file
+    uint32_t eventIndex;     // index of the event in the HepMC file
+    uint32_t lheIndex;       // index of the LHE event in the input file
+    double weight;           // nominal event weight
+    uint32_t nRetries;       // hadronization tries used for this event
+    uint32_t flags;          // SummaryFlags
+    int32_t oniumPid;        // leading onium (0 if none)
+    float oniumPt, oniumEta, oniumPhi;
+    float phiPt, phiEta;     // leading phi (0 if none)
+    uint8_t nJpsi, nUpsilon, nPhi, nMuon; // counts, saturating at 255
+    uint8_t nJpsiAccepted;   // J/psi with both decay muons in acceptance
+    uint8_t nUpsilonAccepted;
+    uint16_t retryCorrection;// x1000, retry budget acceptance weight (0 if not recorded, retry_budget.h)
+};
+
+static_assert(sizeof(SummaryFileHeader) == 64, "SummaryFileHeader must be 64 bytes");
+static_assert(sizeof(EventSummary) == 64, "EventSummary must be 64 bytes");
+
+// Default sidecar name for a HepMC output
+inline std::string summaryPathFor(const std::string& hepmcFile) {
+    return hepmcFile + ".evsum";
+}
+
+inline uint8_t saturate8(int n) {
+    return (uint8_t)(n < 0 ? 0 : (n > 255 ? 255 : n));
+}
+
+// ------------------------------------------------------------------------------
+// Writing
+// ------------------------------------------------------------------------------
+
+class SummaryWriter {
+public:
+    ~SummaryWriter() { close(); }
+
+    bool open(const std::string& file, const std::string& mode) {
+        m_file = fopen(file.c_str(), "wb");
+        if (!m_file) return false;
+        SummaryFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kSummaryMagic, 4);
+        header.version = kSummaryVersion;
+        header.recordSize = sizeof(EventSummary);
+        strncpy(header.mode, mode.c_str(), sizeof(header.mode) - 1);
+        m_nRecords = 0;
+        return fwrite(&header, sizeof(header), 1, m_file) == 1;
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    bool write(const EventSummary& record) {
+        if (!m_file) return false;
+        ++m_nRecords;
+        return fwrite(&record, sizeof(record), 1, m_file) == 1;
+    }
+
+    // Patches the record count into the header
+    void close() {
+        if (!m_file) return;
+        if (fseek(m_file, offsetof(SummaryFileHeader, nRecords), SEEK_SET) == 0) {
+            fwrite(&m_nRecords, sizeof(m_nRecords), 1, m_file);
+        }
+        fclose(m_file);
+        m_file = nullptr;
+    }
+
+private:
+    FILE* m_file = nullptr;
+    uint64_t m_nRecords = 0;
+};
+
+// ------------------------------------------------------------------------------
+// Reading (read-only mmap)
+// ------------------------------------------------------------------------------
+
+class SummaryFile {
+public:
+    SummaryFile() {}
+    SummaryFile(const SummaryFile&) = delete;
+    SummaryFile& operator=(const SummaryFile&) = delete;
+    ~SummaryFile() { close(); }
+
+    bool open(const std::string& file) {
+        close();
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SummaryFileHeader)) {
+            ::close(fd);
+            return false;
+        }
+        m_length = st.st_size;
+        m_data = mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (m_data == MAP_FAILED) {
+            m_data = nullptr;
+            return false;
+        }
+
+        const SummaryFileHeader* h = header();
+        if (memcmp(h->magic, kSummaryMagic, 4) != 0 || h->version != kSummaryVersion ||
+            h->recordSize != sizeof(EventSummary)) {
+            close();
+            return false;
+        }
+        size_t onDisk = (m_length - sizeof(SummaryFileHeader)) / sizeof(EventSummary);
+        m_size = (h->nRecords > 0 && h->nRecords <= onDisk) ? h->nRecords : onDisk;
+        madvise(m_data, m_length, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void close() {
+        if (m_data) munmap(m_data, m_length);
+        m_data = nullptr;
+        m_length = 0;
+        m_size = 0;
+    }
+
+    bool isOpen() const { return m_data != nullptr; }
+    size_t size() const { return m_size; }
+    std::string mode() const { return std::string(header()->mode, strnlen(header()->mode, sizeof(header()->mode))); }
+
+    const SummaryFileHeader* header() const { return (const SummaryFileHeader*)m_data; }
+    const EventSummary* records() const {
+        return (const EventSummary*)((const char*)m_data + sizeof(SummaryFileHeader));
+    }
+    const EventSummary& operator[](size_t i) const { return records()[i]; }
+
+private:
+    void* m_data = nullptr;
+    size_t m_length = 0;
+    size_t m_size = 0;
+};
+
+// ------------------------------------------------------------------------------
+// Filling from an event record
+// ------------------------------------------------------------------------------
+
+// True if particle i of the view decays to mu+ mu- with both muons in acceptance
+template <class View>
+inline bool viewHasAcceptedDimuon(const View& view, int i, const AcceptanceCut& acceptance) {
+    bool muPlusValid = false, muMinusValid = false;
+    view.forEachDaughter(i, [&](int id, double px, double py, double pz) {
+        if (std::abs(id) == 13 && acceptance.pass(px, py, pz)) {
+            if (id == 13) muMinusValid = true;
+            else muPlusValid = true;
+        }
+        return false;
+    });
+    return muPlusValid && muMinusValid;
+}
+
+// Per-event facts of an event record through its view (PythiaEventView,
+// FlatEventView, HepMC3EventView; the selection_expr.h interface plus
+// isFinal(i) and isCopy(i)), so the shower, flat and HepMC3 paths share one
+// set of rules. Only the last copy of each onium/phi is counted; the
+// leading-pT candidate is recorded. Bookkeeping fields (offset, indices,
+// weight, retries) are left to the caller.
+template <class View>
+inline void fillSummaryFromView(const View& view, double minMuonPt, double maxMuonEta,
+                                EventSummary& summary) {
+    const AcceptanceCut acceptance(minMuonPt, maxMuonEta);
+    int nJpsi = 0, nUpsilon = 0, nPhi = 0, nMuon = 0;
+    int nJpsiAcc = 0, nUpsAcc = 0;
+    double bestOniumPt = -1.0, bestPhiPt = -1.0;
+
+    summary.flags = 0;
+    summary.oniumPid = 0;
+    summary.oniumPt = summary.oniumEta = summary.oniumPhi = 0.0f;
+    summary.phiPt = summary.phiEta = 0.0f;
+
+    for (int i = 0; i < view.size(); ++i) {
+        int pid = std::abs(view.id(i));
+        bool isJpsi = (pid == 443);
+        bool isUpsilon = (pid == 553 || pid == 100553 || pid == 200553);
+        if (!isJpsi && !isUpsilon && pid != 333 && pid != 13) continue;
+
+        if (pid == 13) {
+            if (view.isFinal(i)) nMuon++;
+            continue;
+        }
+
+        // Skip intermediate copies (recoil/shower copies carry a single same-id daughter)
+        if (view.isCopy(i)) continue;
+
+        double px = view.px(i), py = view.py(i), pz = view.pz(i);
+        double pt = scalarPt(px, py);
+        if (pid == 333) {
+            nPhi++;
+            if (pt > bestPhiPt) {
+                bestPhiPt = pt;
+                summary.phiPt = pt;
+                summary.phiEta = scalarEta(px, py, pz);
+            }
+            continue;
+        }
+
+        bool accepted = viewHasAcceptedDimuon(view, i, acceptance);
+        if (isJpsi) {
+            nJpsi++;
+            if (accepted) nJpsiAcc++;
+        } else {
+            nUpsilon++;
+            if (accepted) nUpsAcc++;
+        }
+        if (pt > bestOniumPt) {
+            bestOniumPt = pt;
+            summary.oniumPid = view.id(i);
+            summary.oniumPt = pt;
+            summary.oniumEta = scalarEta(px, py, pz);
+            summary.oniumPhi = std::atan2(py, px);
+        }
+    }
+
+    if (nJpsi > 0) summary.flags |= kSumHasJpsi;
+    if (nUpsilon > 0) summary.flags |= kSumHasUpsilon;
+    if (nPhi > 0) summary.flags |= kSumHasPhi;
+    if (nJpsiAcc > 0) summary.flags |= kSumJpsiMuonsAccepted;
+    if (nUpsAcc > 0) summary.flags |= kSumUpsMuonsAccepted;
+
+    summary.nJpsi = saturate8(nJpsi);
+    summary.nUpsilon = saturate8(nUpsilon);
+    summary.nPhi = saturate8(nPhi);
+    summary.nMuon = saturate8(nMuon);
+    summary.nJpsiAccepted = saturate8(nJpsiAcc);
+    summary.nUpsilonAccepted = saturate8(nUpsAcc);
+}
+
+#endif // EVENT_SUMMARY_H
@@ -0,0 +1,364 @@
+// ==============================================================================
+// fast_sim.cc - Parametric detector response on mixed events
+// ==============================================================================
+// Local stand-in for GEN-SIM ... MiniAOD + ntuple in optimization studies:
+// takes the mixed event file (or shower outputs, like gen_ntuple), finds the
+// onium -> mu mu and phi -> K K candidates, smears their daughters with the
+// efficiency/resolution tables of detector_response.h and writes the
+// candidates whose daughters are both reconstructed, with the momenta and
+// invariant mass rebuilt from the smeared daughters. The ntuple layout is
+// the one of gen_ntuple (gen_candidates.h), so the same macros read both.
+//
+// Events are streamed in batches: the main thread only splits the input into
+// raw event blocks, the worker threads parse, find and smear, and the main
+// thread fills the tree in input order. Random numbers are seeded per event,
+// so the output does not depend on --threads. The true pT/eta/phi of all
+// daughters of a batch are computed in one vectorized pass
+// (kinematics_simd.h) before smearing.
+//
+// Compilation (in CMSSW environment):
+//   g++ -std=c++17 -O2 -pthread fast_sim.cc -o fast_sim \
+//       -I$HEPMC3/include -I$HEPMC2/include $(root-config --cflags) \
+//       -L$HEPMC3/lib64 -L$HEPMC2/lib \
+//       -Wl,-rpath,$HEPMC3/lib64 -Wl,-rpath,$HEPMC2/lib \
+//       -lHepMC3 -lHepMC $(root-config --libs) -lzstd -llz4 -pthread
+//
+// Usage:
+//   ./fast_sim output.root input1.hepmc [input2.hepmc ...] [--tables FILE]
+//              [--threads N] [--seed S] [--analysis JJP|JUP] [--nevents N] [--batch N]
+// ==============================================================================
+
+#include "flat_input.h"
+#include "gen_candidates.h"
+#include "detector_response.h"
+#include "kinematics_simd.h"
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+void printUsage(const char* progName) {
+    cerr << "\n=== Fast Detector Simulation ===" << endl;
+    cerr << "Usage: " << progName << " output.root input1.hepmc [input2.hepmc ...] [options]" << endl;
+    cerr << "\nArguments:" << endl;
+    cerr << "  output.root   : Output ROOT file (gen_ntuple layout)" << endl;
+    cerr << "  input1.hepmc  : Mixed HepMC2 file, or a shower output (HepMC3 ASCII or .hepb)" << endl;
+    cerr << "  inputN.hepmc  : Further shower outputs, combined event by event" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --tables FILE : Detector response tables (default: fastsim_tables.txt)" << endl;
+    cerr << "  --threads N   : Worker threads (default: all cores)" << endl;
+    cerr << "  --seed S      : Smearing seed (default: 12345)" << endl;
+    cerr << "  --analysis T  : JJP (default) or JUP; sets the tree directory" << endl;
+    cerr << "  --nevents N   : Maximum events to process (default: all)" << endl;
+    cerr << "  --batch N     : Events per thread and batch (default: 100)" << endl;
+}
+
+// True kinematics of the candidate daughters of a batch, as arrays
+struct DaughterKinematics {
+    vector<double> px, py, pz, pt, eta, phi;
+
+    void add(const double* p) {
+        px.push_back(p[0]); py.push_back(p[1]); pz.push_back(p[2]);
+    }
+
+    void compute() {
+        pt.resize(px.size()); eta.resize(px.size()); phi.resize(px.size());
+        batchKinematics(px.data(), py.data(), pz.data(), px.size(), pt.data(), eta.data(), phi.data());
+    }
+};
+
+// Reconstructed candidate from the smeared daughters; false if either is lost.
+// The daughters' kinematics are entries k and k + 1 of kin.
+bool smearCandidate(const DetectorResponse& response, const GenCandidate& gen,
+                    const DaughterKinematics& kin, size_t k, FastRng& rng, GenCandidate& reco) {
+    if (!gen.decay) return false;
+    const CandidateKind& kind = kCandidateKinds[gen.kind];
+    reco = gen;
+    if (!response.smear(DetectorResponse::objectFor(kind.daughter1), gen.d1,
+                        kin.pt[k], kin.eta[k], kin.phi[k], rng, reco.d1)) return false;
+    if (!response.smear(DetectorResponse::objectFor(kind.daughter2), gen.d2,
+                        kin.pt[k + 1], kin.eta[k + 1], kin.phi[k + 1], rng, reco.d2)) return false;
+    for (int c = 0; c < 4; ++c) reco.p[c] = reco.d1[c] + reco.d2[c];
+    return true;
+}
+
+// One input: raw ASCII event blocks, or binary events read directly
+class FastSimInput {
+public:
+    bool open(const string& file) {
+        m_format = detectHepMCFormat(file);
+        if (m_format == HepMCFormat::kBinary) {
+            m_binary.reset(new ReaderBinary(file));
+            return !m_binary->failed();
+        }
+        return m_blocks.open(file);
+    }
+
+    HepMCFormat format() const { return m_format; }
+    const string& header() const { return m_blocks.header(); }
+
+    // Up to n events, as text (ASCII) or decoded (binary); returns the count
+    size_t read(size_t n, string& text, vector<BinaryEvent>& events) {
+        if (m_format != HepMCFormat::kBinary) return m_blocks.readBatch(n, text);
+        size_t count = 0;
+        while (count < n) {
+            events.emplace_back();
+            if (!m_binary->read_binary(events.back())) {
+                events.pop_back();
+                break;
+            }
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    HepMCFormat m_format = HepMCFormat::kHepMC3;
+    EventBlockReader m_blocks;
+    unique_ptr<ReaderBinary> m_binary;
+};
+
+// A batch of events for one worker, and its results
+struct FastSimBatch {
+    size_t firstEvent = 0;
+    vector<string> text;                         // per input (ASCII)
+    vector<vector<BinaryEvent>> events;          // per input
+    vector<vector<vector<int>>> sources;         // per input, per event
+
+    size_t nEvents = 0;
+    vector<double> weight;
+    vector<int> nSources;
+    vector<vector<GenCandidate>> reco;
+    vector<long> nGen;                           // per candidate kind
+
+    void reset(size_t nInputs) {
+        text.assign(nInputs, string());
+        events.assign(nInputs, vector<BinaryEvent>());
+        sources.assign(nInputs, vector<vector<int>>());
+        nEvents = 0;
+        weight.clear();
+        nSources.clear();
+        reco.clear();
+        nGen.assign(kCandidateKinds.size(), 0);
+    }
+};
+
+void processBatch(FastSimBatch& batch, const vector<FastSimInput>& inputs,
+                  const DetectorResponse& response, uint64_t seed) {
+    const size_t nInputs = inputs.size();
+    for (size_t s = 0; s < nInputs; ++s) {
+        if (inputs[s].format() == HepMCFormat::kBinary) {
+            batch.sources[s].clear();
+            for (const auto& evt : batch.events[s]) batch.sources[s].emplace_back(evt.nParticles(), s);
+        } else {
+            parseEventBlocks(inputs[s].format(), inputs[s].header(), batch.text[s],
+                             batch.events[s], batch.sources[s], s);
+            string().swap(batch.text[s]);
+        }
+    }
+
+    batch.nEvents = batch.events[0].size();
+    for (size_t s = 1; s < nInputs; ++s) batch.nEvents = min(batch.nEvents, batch.events[s].size());
+
+    // Find the candidates of every event, collecting the daughter momenta
+    CandidateFinder finder;
+    vector<GenCandidate> gen;
+    vector<size_t> genBegin(1, 0);
+    DaughterKinematics kin;
+    batch.weight.resize(batch.nEvents);
+    batch.nSources.resize(batch.nEvents);
+    batch.reco.resize(batch.nEvents);
+    for (size_t i = 0; i < batch.nEvents; ++i) {
+        double weight = 1.0;
+        int nSources = 0;
+        for (size_t s = 0; s < nInputs; ++s) {
+            const BinaryEvent& evt = batch.events[s][i];
+            if (!evt.weights.empty()) weight *= evt.weights[0];
+            nSources = max(nSources, finder.find(evt, batch.sources[s][i], gen));
+        }
+        genBegin.push_back(gen.size());
+        batch.weight[i] = weight;
+        batch.nSources[i] = nSources;
+    }
+    for (const auto& c : gen) {
+        kin.add(c.d1);
+        kin.add(c.d2);
+    }
+    kin.compute();
+
+    // Smear event by event (per-event random stream)
+    for (size_t i = 0; i < batch.nEvents; ++i) {
+        FastRng rng = eventRng(seed, batch.firstEvent + i);
+        GenCandidate reco;
+        for (size_t c = genBegin[i]; c < genBegin[i + 1]; ++c) {
+            batch.nGen[gen[c].kind]++;
+            if (smearCandidate(response, gen[c], kin, 2 * c, rng, reco)) batch.reco[i].push_back(reco);
+        }
+    }
+
+    // Parsed events are not needed any more
+    for (size_t s = 0; s < nInputs; ++s) {
+        vector<BinaryEvent>().swap(batch.events[s]);
+        vector<vector<int>>().swap(batch.sources[s]);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string outputFile = argv[1];
+    vector<string> inputFiles;
+    string tablesFile = "fastsim_tables.txt";
+    string analysis = "JJP";
+    int nThreads = max(1u, thread::hardware_concurrency());
+    uint64_t seed = 12345;
+    long nEvents = -1;
+    size_t batchSize = 100;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--tables" && i + 1 < argc) {
+            tablesFile = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            nThreads = max(1, atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--analysis" && i + 1 < argc) {
+            analysis = argv[++i];
+        } else if (arg == "--nevents" && i + 1 < argc) {
+            nEvents = atol(argv[++i]);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchSize = max(1, atoi(argv[++i]));
+        } else if (arg.rfind("--", 0) == 0) {
+            cerr << "Error: Unknown option: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            inputFiles.push_back(arg);
+        }
+    }
+
+    string directory = candidateTreeDirectory(analysis);
+    if (directory.empty()) {
+        cerr << "Error: Unknown analysis: " << analysis << endl;
+        return 1;
+    }
+
+    DetectorResponse response;
+    string error;
+    if (!response.load(tablesFile, error)) {
+        cerr << "Error: Invalid detector tables: " << error << endl;
+        return 1;
+    }
+
+    const size_t nInputs = inputFiles.size();
+    vector<FastSimInput> inputs(nInputs);
+    for (size_t i = 0; i < nInputs; ++i) {
+        if (!inputs[i].open(inputFiles[i])) {
+            cerr << "Error: Cannot open input file: " << inputFiles[i] << endl;
+            return 1;
+        }
+        if (nInputs > 1 && inputs[i].format() == HepMCFormat::kHepMC2) {
+            cerr << "Error: Merged HepMC2 files are read alone: " << inputFiles[i] << endl;
+            return 1;
+        }
+    }
+
+    cout << "\n=== Fast Detector Simulation ===" << endl;
+    cout << "Output:     " << outputFile << " (" << directory << "/X_data)" << endl;
+    for (size_t i = 0; i < nInputs; ++i) {
+        cout << "  Input " << i+1 << ": " << inputFiles[i] << endl;
+    }
+    cout << "Tables:     " << tablesFile << " (" << response.size() << " rows)" << endl;
+    cout << "Threads:    " << nThreads << " (batch " << batchSize << ")" << endl;
+    cout << "Seed:       " << seed << endl;
+    cout << "N events:   " << (nEvents > 0 ? to_string(nEvents) : "all") << endl;
+    cout << "================================\n" << endl;
+
+    TFile* file = TFile::Open(outputFile.c_str(), "RECREATE");
+    if (!file || file->IsZombie()) {
+        cerr << "Error: Cannot create output file: " << outputFile << endl;
+        return 1;
+    }
+    TDirectory* dir = file->mkdir(directory.c_str());
+    dir->cd();
+    TTree* tree = new TTree("X_data", "Fast-simulation candidates");
+    CandidateNtuple ntuple(tree);
+
+    auto startTime = chrono::steady_clock::now();
+    vector<FastSimBatch> batches(nThreads);
+    vector<long> nGen(kCandidateKinds.size(), 0);
+    long iEvent = 0;
+    bool done = false;
+    while (!done) {
+        // Read one batch per thread (raw text only)
+        int nBatches = 0;
+        long nextEvent = iEvent;
+        for (int t = 0; t < nThreads && !done; ++t) {
+            FastSimBatch& batch = batches[t];
+            batch.reset(nInputs);
+            batch.firstEvent = nextEvent;
+            size_t want = batchSize;
+            if (nEvents >= 0) want = min<long>(want, nEvents - nextEvent);
+            size_t got = want;
+            for (size_t s = 0; s < nInputs; ++s) {
+                got = min(got, inputs[s].read(want, batch.text[s], batch.events[s]));
+            }
+            if (got < want || want == 0) done = true;
+            if (got == 0) break;
+            nextEvent += got;
+            ++nBatches;
+        }
+
+        // Parse, find and smear in parallel
+        vector<thread> workers;
+        for (int t = 0; t < nBatches; ++t) {
+            workers.emplace_back(processBatch, ref(batches[t]), cref(inputs), cref(response), seed);
+        }
+        for (auto& w : workers) w.join();
+
+        // Fill in input order
+        for (int t = 0; t < nBatches; ++t) {
+            const FastSimBatch& batch = batches[t];
+            for (size_t i = 0; i < batch.nEvents; ++i) {
+                ntuple.fill(iEvent, batch.weight[i], batch.nSources[i], batch.reco[i]);
+                ++iEvent;
+                if (iEvent % 100000 == 0) cout << "Processed " << iEvent << " events..." << endl;
+            }
+            for (size_t k = 0; k < nGen.size(); ++k) nGen[k] += batch.nGen[k];
+        }
+    }
+
+    dir->cd();
+    tree->Write();
+    file->Close();
+    delete file;
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    cout << "\n================================" << endl;
+    cout << "Fast Simulation Summary:" << endl;
+    cout << "--------------------------------" << endl;
+    cout << "Events written: " << iEvent << endl;
+    for (size_t k = 0; k < kCandidateKinds.size(); ++k) {
+        cout << "  " << kCandidateKinds[k].prefix << " reconstructed: " << ntuple.total(k)
+             << " / " << nGen[k] << " generated" << endl;
+    }
+    cout << "Time:           " << seconds << " s ("
+         << (seconds > 0 ? iEvent / seconds : 0.0) << " events/s)" << endl;
+    cout << "Output file:    " << outputFile << endl;
+    cout << "================================" << endl;
+
+    return 0;
+}
@@ -0,0 +1,272 @@
+// ==============================================================================
+// flat_event.h - Index links, merging and selection on flat events
+// ==============================================================================
+// The programs share one internal event model, the structure-of-arrays record
+// of hepmc_binary.h (BinaryEvent): pid/status/four-momentum arrays and
+// production/end vertex indices per particle. Events are reused between reads
+// (clear() keeps capacity), so the per-particle cost is a few array appends
+// instead of one heap object per particle and vertex.
+//
+// Converters to and from the three external models:
+//   HepMC3 : hepmc3ToBinary / binaryToHepMC3   (hepmc3_binary.h)
+//   HepMC2 : hepmc2ToBinary / flatToHepMC2     (hepmc_convert.h)
+//   Pythia : pythiaToFlat / flatToPythia       (flat_pythia.h)
+//
+// This header adds what the vertex indices alone do not give directly:
+//   FlatLinks       : particles entering/leaving every vertex (CSR), hence
+//                     mothers and daughters of a particle by index
+//   mergeFlatEvents : multi-source merge by concatenation; the vertex links
+//                     of source s are shifted by the vertices before it and
+//                     FlatMergeLayout records where every source starts;
+//                     combineWeights gives the merged weight vector
+//   FlatEventView   : SelectionProgram adapter (selection_expr.h)
+//   flatKinematics  : pT/eta/phi arrays of all particles (kinematics_simd.h)
+//   countParticles / fillEventSummary on flat events
+//
+// Header-only, no external dependencies.
+// ==============================================================================
+
+#ifndef FLAT_EVENT_H
+#define FLAT_EVENT_H
+
+#include "hepmc_binary.h"
+#include "event_summary.h"
+#include "kinematics_simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+struct FlatIndexRange {
+    const int* first;
+    const int* last;
+
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+};
+
+// Incoming and outgoing particles of every vertex. build() reuses its
+// buffers, so one FlatLinks per reader or worker is enough.
+class FlatLinks {
+public:
+    void build(const BinaryEvent& evt) {
+        fill(evt.nVertices(), evt.prodVertex, m_outStart, m_outList);
+        fill(evt.nVertices(), evt.endVertex, m_inStart, m_inList);
+    }
+
+    FlatIndexRange outgoing(int v) const { return range(m_outStart, m_outList, v); }
+    FlatIndexRange incoming(int v) const { return range(m_inStart, m_inList, v); }
+
+    FlatIndexRange daughters(const BinaryEvent& evt, int i) const {
+        return evt.endVertex[i] < 0 ? FlatIndexRange{nullptr, nullptr} : outgoing(evt.endVertex[i]);
+    }
+
+    FlatIndexRange mothers(const BinaryEvent& evt, int i) const {
+        return evt.prodVertex[i] < 0 ? FlatIndexRange{nullptr, nullptr} : incoming(evt.prodVertex[i]);
+    }
+
+    // Shower recoil copies have the same id among their daughters
+    bool isLastCopy(const BinaryEvent& evt, int i) const {
+        for (int d : daughters(evt, i)) {
+            if (evt.pid[d] == evt.pid[i]) return false;
+        }
+        return true;
+    }
+
+private:
+    void fill(size_t nVertices, const std::vector<int32_t>& vertexOf,
+              std::vector<int>& start, std::vector<int>& list) {
+        start.assign(nVertices + 1, 0);
+        for (int32_t v : vertexOf) {
+            if (v >= 0) start[v + 1]++;
+        }
+        for (size_t v = 0; v < nVertices; ++v) start[v + 1] += start[v];
+        list.resize(start.back());
+        m_fill.assign(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < vertexOf.size(); ++i) {
+            if (vertexOf[i] >= 0) list[m_fill[vertexOf[i]]++] = i;
+        }
+    }
+
+    static FlatIndexRange range(const std::vector<int>& start, const std::vector<int>& list, int v) {
+        return {list.data() + start[v], list.data() + start[v + 1]};
+    }
+
+    std::vector<int> m_outStart, m_outList;
+    std::vector<int> m_inStart, m_inList;
+    std::vector<int> m_fill;
+};
+
+// ------------------------------------------------------------------------------
+// Merging
+// ------------------------------------------------------------------------------
+
+// Where each source starts in a merged event (particleBegin/vertexBegin have
+// one entry per source plus the totals)
+struct FlatMergeLayout {
+    std::vector<size_t> particleBegin, vertexBegin;
+    std::vector<const std::vector<double>*> weights;   // source weights of the last merge
+
+    size_t nSources() const { return particleBegin.empty() ? 0 : particleBegin.size() - 1; }
+
+    // Single-source layout of an unmerged event
+    void single(const BinaryEvent& evt) {
+        particleBegin.assign({0, evt.nParticles()});
+        vertexBegin.assign({0, evt.nVertices()});
+        weights.assign(1, &evt.weights);
+    }
+};
+
+template <class T>
+inline void appendArray(std::vector<T>& dst, const std::vector<T>& src) {
+    dst.insert(dst.end(), src.begin(), src.end());
+}
+
+// Appends the particles and vertices of src to dst; vertex links are shifted
+// by the vertices already in dst. Weights and event number are left alone.
+inline void appendFlatEvent(BinaryEvent& dst, const BinaryEvent& src) {
+    int32_t vertexOffset = dst.nVertices();
+    size_t first = dst.nParticles();
+
+    appendArray(dst.vStatus, src.vStatus);
+    appendArray(dst.vx, src.vx); appendArray(dst.vy, src.vy);
+    appendArray(dst.vz, src.vz); appendArray(dst.vt, src.vt);
+
+    appendArray(dst.pid, src.pid); appendArray(dst.status, src.status);
+    appendArray(dst.prodVertex, src.prodVertex); appendArray(dst.endVertex, src.endVertex);
+    appendArray(dst.px, src.px); appendArray(dst.py, src.py); appendArray(dst.pz, src.pz);
+    appendArray(dst.e, src.e); appendArray(dst.m, src.m);
+
+    if (vertexOffset == 0) return;
+    for (size_t i = first; i < dst.nParticles(); ++i) {
+        if (dst.prodVertex[i] >= 0) dst.prodVertex[i] += vertexOffset;
+        if (dst.endVertex[i] >= 0) dst.endVertex[i] += vertexOffset;
+    }
+}
+
+// Weight vector of a combined event. Source vectors of the same length (the
+// nominal weight and the same variations in every source) are multiplied
+// index by index; otherwise only the nominal weights are multiplied and false
+// is returned. Sources without weights count as 1.
+inline bool combineWeights(const std::vector<const std::vector<double>*>& sources,
+                           std::vector<double>& combined) {
+    size_t n = 0;
+    bool sameLength = true;
+    for (const std::vector<double>* w : sources) {
+        if (!w || w->empty()) continue;
+        if (n == 0) n = w->size();
+        else if (w->size() != n) sameLength = false;
+    }
+    combined.assign(sameLength ? std::max<size_t>(n, 1) : 1, 1.0);
+    for (const std::vector<double>* w : sources) {
+        if (!w || w->empty()) continue;
+        for (size_t k = 0; k < combined.size(); ++k) combined[k] *= (*w)[k];
+    }
+    return sameLength;
+}
+
+// Merges the source events into merged (reused); the weights follow
+// combineWeights, as in mergeEvents (hepmc_convert.h). Returns false if the
+// weight variations could not be combined (nominal weight only)
+inline bool mergeFlatEvents(const std::vector<const BinaryEvent*>& events, int64_t eventNumber,
+                            BinaryEvent& merged, FlatMergeLayout& layout) {
+    merged.clear();
+    merged.eventNumber = eventNumber;
+    layout.particleBegin.clear();
+    layout.vertexBegin.clear();
+    layout.weights.clear();
+
+    for (const BinaryEvent* evt : events) {
+        layout.particleBegin.push_back(merged.nParticles());
+        layout.vertexBegin.push_back(merged.nVertices());
+        layout.weights.push_back(evt ? &evt->weights : nullptr);
+        if (!evt) continue;
+        appendFlatEvent(merged, *evt);
+    }
+    layout.particleBegin.push_back(merged.nParticles());
+    layout.vertexBegin.push_back(merged.nVertices());
+    return combineWeights(layout.weights, merged.weights);
+}
+
+// ------------------------------------------------------------------------------
+// Selection and counting
+// ------------------------------------------------------------------------------
+
+inline double flatPt(const BinaryEvent& evt, int i) {
+    return scalarPt(evt.px[i], evt.py[i]);
+}
+
+inline double flatEta(const BinaryEvent& evt, int i) {
+    return scalarEta(evt.px[i], evt.py[i], evt.pz[i]);
+}
+
+// pT/eta/phi of all particles (kinematics_simd.h); arrays are resized
+inline void flatKinematics(const BinaryEvent& evt, std::vector<double>& pt, std::vector<double>& eta,
+                           std::vector<double>& phi) {
+    size_t n = evt.nParticles();
+    pt.resize(n);
+    eta.resize(n);
+    phi.resize(n);
+    batchKinematics(evt.px.data(), evt.py.data(), evt.pz.data(), n, pt.data(), eta.data(), phi.data());
+}
+
+// Flat event view for SelectionProgram (selection_expr.h); links must be
+// built for evt
+struct FlatEventView {
+    const BinaryEvent& evt;
+    const FlatLinks& links;
+
+    int size() const { return evt.nParticles(); }
+    int id(int i) const { return evt.pid[i]; }
+    bool isFinal(int i) const { return evt.status[i] == 1; }
+    bool isCandidate(int i) const { return (evt.status[i] == 1 || evt.endVertex[i] >= 0) && !isCopy(i); }
+    // Intermediate (recoil/shower) copy: its only daughter has the same id
+    bool isCopy(int i) const {
+        FlatIndexRange daughters = links.daughters(evt, i);
+        return daughters.size() == 1 && evt.pid[*daughters.begin()] == evt.pid[i];
+    }
+    double px(int i) const { return evt.px[i]; }
+    double py(int i) const { return evt.py[i]; }
+    double pz(int i) const { return evt.pz[i]; }
+
+    template <class F>
+    void forEachInPidRange(int minAbs, int maxAbs, F&& f) const {
+        forEachPidInRange(evt.pid.data(), evt.nParticles(), minAbs, maxAbs, f);
+    }
+
+    template <class F>
+    void forEachDaughter(int i, F&& f) const {
+        for (int d : links.daughters(evt, i)) {
+            if (f(evt.pid[d], evt.px[d], evt.py[d], evt.pz[d])) return;
+        }
+    }
+};
+
+// Count specific particles in a flat event
+inline void countParticles(const BinaryEvent& evt, int& nJpsi, int& nUpsilon, int& nPhi) {
+    nJpsi = 0;
+    nUpsilon = 0;
+    nPhi = 0;
+
+    for (int32_t id : evt.pid) {
+        int pid = std::abs(id);
+        if (pid == 443) nJpsi++;
+        else if (pid == 553 || pid == 100553 || pid == 200553) nUpsilon++;
+        else if (pid == 333) nPhi++;
+    }
+}
+
+// Per-event facts for the summary sidecar (event_summary.h, fillSummaryFromView);
+// links must be built for evt
+inline void fillEventSummary(const BinaryEvent& evt, const FlatLinks& links,
+                             double minMuonPt, double maxMuonEta, EventSummary& summary) {
+    summary.weight = evt.weights.empty() ? 1.0 : evt.weights[0];
+    summary.nRetries = 0;
+    summary.retryCorrection = 0;
+    fillSummaryFromView(FlatEventView{evt, links}, minMuonPt, maxMuonEta, summary);
+}
+
+#endif // FLAT_EVENT_H
@@ -0,0 +1,185 @@
+// ==============================================================================
+// flat_input.h - HepMC input of any supported format as flat BinaryEvents
+// ==============================================================================
+// Readers for programs that only need the flat particle arrays of
+// hepmc_binary.h (gen_ntuple, fast_sim):
+//
+//   FlatSource       : sequential reader for the mixed HepMC2 file, HepMC3
+//                      ASCII or .hepb; source[i] gives the input source of
+//                      particle i (mixer barcode offsets for merged files)
+//   EventBlockReader : splits an ASCII file into raw event text blocks so
+//                      that batches can be parsed on several threads
+//                      (parseEventBlocks)
+//
+// ASCII inputs may be block-compressed (.zst/.lz4, block_compress.h).
+// ==============================================================================
+
+#ifndef FLAT_INPUT_H
+#define FLAT_INPUT_H
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/ReaderAscii.h"
+
+#include "HepMC/GenEvent.h"
+#include "HepMC/IO_GenEvent.h"
+
+#include "block_compress.h"
+#include "hepmc_convert.h"
+#include "hepmc3_binary.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+enum class HepMCFormat { kBinary, kHepMC3, kHepMC2 };
+
+// .hepb by extension, otherwise HepMC2 and HepMC3 ASCII by the listing header
+inline HepMCFormat detectHepMCFormat(const std::string& file) {
+    if (isBinaryEventFile(file)) return HepMCFormat::kBinary;
+    EventInputStream in;
+    if (!in.open(file, 0)) return HepMCFormat::kHepMC3;
+    std::string line;
+    for (int n = 0; n < 5 && std::getline(in, line); ++n) {
+        if (line.find("IO_GenEvent") != std::string::npos) return HepMCFormat::kHepMC2;
+    }
+    return HepMCFormat::kHepMC3;
+}
+
+class FlatSource {
+public:
+    bool open(const std::string& file) {
+        m_format = detectHepMCFormat(file);
+        if (m_format == HepMCFormat::kBinary) {
+            m_binary.reset(new ReaderBinary(file));
+            return !m_binary->failed();
+        }
+        if (!m_stream.open(file)) return false;
+        if (m_format == HepMCFormat::kHepMC2) {
+            m_hepmc2.reset(new HepMC::IO_GenEvent(m_stream));
+        } else {
+            m_ascii.reset(new HepMC3::ReaderAscii(m_stream));
+            if (m_ascii->failed()) return false;
+        }
+        return true;
+    }
+
+    HepMCFormat format() const { return m_format; }
+
+    // Next event; source[i] is the source of particle i (defaultSource unless
+    // the file is a merged HepMC2 event file)
+    bool next(BinaryEvent& evt, std::vector<int>& source, int defaultSource) {
+        bool ok = false;
+        if (m_format == HepMCFormat::kBinary) {
+            ok = m_binary->read_binary(evt);
+        } else if (m_format == HepMCFormat::kHepMC3) {
+            ok = m_ascii->read_event(m_evt3) && !m_ascii->failed();
+            if (ok) hepmc3ToBinary(m_evt3, evt);
+        } else {
+            ok = m_hepmc2->fill_next_event(&m_evt2);
+            if (ok) hepmc2ToBinary(m_evt2, evt, source);
+            return ok;
+        }
+        if (ok) source.assign(evt.nParticles(), defaultSource);
+        return ok;
+    }
+
+private:
+    HepMCFormat m_format = HepMCFormat::kHepMC3;
+    EventInputStream m_stream;
+    std::unique_ptr<ReaderBinary> m_binary;
+    std::unique_ptr<HepMC3::ReaderAscii> m_ascii;
+    std::unique_ptr<HepMC::IO_GenEvent> m_hepmc2;
+    HepMC3::GenEvent m_evt3;
+    HepMC::GenEvent m_evt2;
+};
+
+// Raw event text of an ASCII file: the header (everything before the first
+// "E " line) and then batches of complete event blocks. Only line splitting
+// happens here; parsing is left to parseEventBlocks on the worker threads.
+class EventBlockReader {
+public:
+    bool open(const std::string& file) {
+        m_format = detectHepMCFormat(file);
+        if (m_format == HepMCFormat::kBinary) return false;
+        if (!m_stream.open(file)) return false;
+        m_header.clear();
+        m_pending.clear();
+        std::string line;
+        while (std::getline(m_stream, line)) {
+            if (isEventStart(line)) {
+                m_pending = line;
+                break;
+            }
+            m_header += line;
+            m_header += '\n';
+        }
+        return true;
+    }
+
+    HepMCFormat format() const { return m_format; }
+    const std::string& header() const { return m_header; }
+
+    // Appends up to n event blocks to text; returns the number appended
+    size_t readBatch(size_t n, std::string& text) {
+        size_t count = 0;
+        std::string line;
+        while (count < n && !m_pending.empty()) {
+            text += m_pending;
+            text += '\n';
+            m_pending.clear();
+            while (std::getline(m_stream, line)) {
+                if (isEventStart(line)) {
+                    m_pending = line;
+                    break;
+                }
+                if (line.compare(0, 7, "HepMC::") == 0) continue;   // end of listing
+                text += line;
+                text += '\n';
+            }
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    static bool isEventStart(const std::string& line) {
+        return line.size() > 1 && line[0] == 'E' && line[1] == ' ';
+    }
+
+    HepMCFormat m_format = HepMCFormat::kHepMC3;
+    EventInputStream m_stream;
+    std::string m_header;
+    std::string m_pending;   // "E " line of the next event
+};
+
+// Parses event blocks from EventBlockReader into flat events (appended);
+// thread-safe, each call uses its own reader
+inline size_t parseEventBlocks(HepMCFormat format, const std::string& header, const std::string& text,
+                               std::vector<BinaryEvent>& events, std::vector<std::vector<int>>& sources,
+                               int defaultSource) {
+    std::istringstream in(header + text);
+    size_t n = 0;
+    if (format == HepMCFormat::kHepMC2) {
+        HepMC::IO_GenEvent reader(in);
+        HepMC::GenEvent evt;
+        while (reader.fill_next_event(&evt)) {
+            events.emplace_back();
+            sources.emplace_back();
+            hepmc2ToBinary(evt, events.back(), sources.back());
+            ++n;
+        }
+    } else {
+        HepMC3::ReaderAscii reader(in);
+        HepMC3::GenEvent evt;
+        while (reader.read_event(evt) && !reader.failed()) {
+            events.emplace_back();
+            hepmc3ToBinary(evt, events.back());
+            sources.emplace_back(events.back().nParticles(), defaultSource);
+            ++n;
+        }
+    }
+    return n;
+}
+
+#endif // FLAT_INPUT_H
@@ -0,0 +1,132 @@
+// ==============================================================================
+// flat_output.h - HepMC3 ASCII written straight from flat events
+// ==============================================================================
+// FlatHepMC3Writer produces the HepMC3::WriterAscii (Asciiv3) text of a flat
+// event (flat_event.h) without building a GenEvent: particle ids are 1..N in
+// storage order, vertex ids -1..-M in order of creation. A vertex is written
+// explicitly (V line) only when it has several incoming particles or a
+// non-zero status/position; otherwise the particle line points at its single
+// parent particle, as WriterAscii does.
+//
+// The run header names the weights of the first event ("Default", then
+// "Weight1", ... for variations). Event attributes added with addAttribute()
+// are written as "A 0 name value" lines of the next event.
+//
+// Each event is formatted into one reused text buffer and handed to the
+// stream in a single write, so on an EventOutputStream (block_compress.h) the
+// file I/O and any compression happen on the stream's threads.
+// ==============================================================================
+
+#ifndef FLAT_OUTPUT_H
+#define FLAT_OUTPUT_H
+
+#include "flat_event.h"
+
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class FlatHepMC3Writer {
+public:
+    explicit FlatHepMC3Writer(std::ostream& out) : m_out(out) {}
+
+    ~FlatHepMC3Writer() { close(); }
+
+    // Attribute of the next event written (value without newlines)
+    void addAttribute(const std::string& name, const std::string& value) {
+        m_attributes += "A 0 " + name + " " + value + "\n";
+    }
+
+    // links must be built for evt
+    bool write(const BinaryEvent& evt, const FlatLinks& links) {
+        if (!m_headerWritten) writeHeader(evt.weights.size());
+        size_t nV = evt.nVertices();
+        m_written.assign(nV, 0);
+        m_text.clear();
+
+        append("E %lld %zu %zu\n", (long long)evt.eventNumber, nV, evt.nParticles());
+        m_text += "U GEV MM\nW";
+        for (double w : evt.weights) append(" %.16e", w);
+        m_text += '\n';
+        m_text += m_attributes;
+        m_attributes.clear();
+
+        for (size_t i = 0; i < evt.nParticles(); ++i) {
+            int pv = evt.prodVertex[i];
+            int parent = 0;
+            if (pv >= 0) {
+                FlatIndexRange in = links.incoming(pv);
+                if (in.size() > 1 || evt.vStatus[pv] != 0 || hasPosition(evt, pv)) {
+                    parent = -(pv + 1);
+                    if (!m_written[pv]) writeVertex(evt, in, pv);
+                } else if (in.size() == 1) {
+                    parent = *in.begin() + 1;
+                }
+            }
+            append("P %zu %d %d %.16e %.16e %.16e %.16e %.16e %d\n",
+                   i + 1, parent, evt.pid[i], evt.px[i], evt.py[i], evt.pz[i], evt.e[i], evt.m[i],
+                   evt.status[i]);
+        }
+
+        m_out.write(m_text.data(), m_text.size());
+        return !m_out.fail();
+    }
+
+    // Writes the end of the listing; the stream itself is left open
+    void close() {
+        if (m_closed) return;
+        if (!m_headerWritten) writeHeader(1);
+        m_out << "HepMC::Asciiv3-END_EVENT_LISTING\n\n";
+        m_closed = true;
+    }
+
+private:
+    void writeHeader(size_t nWeights) {
+        m_out << "HepMC::Version 3.02.05\n"
+              << "HepMC::Asciiv3-START_EVENT_LISTING\n"
+              << "W Default";
+        for (size_t k = 1; k < nWeights; ++k) m_out << " Weight" << k;
+        m_out << "\n";
+        m_headerWritten = true;
+    }
+
+    static bool hasPosition(const BinaryEvent& evt, int v) {
+        return evt.vx[v] != 0.0 || evt.vy[v] != 0.0 || evt.vz[v] != 0.0 || evt.vt[v] != 0.0;
+    }
+
+    void writeVertex(const BinaryEvent& evt, const FlatIndexRange& in, int v) {
+        m_written[v] = 1;
+        append("V %d %d [", -(v + 1), evt.vStatus[v]);
+        for (const int* p = in.begin(); p != in.end(); ++p) {
+            append(p == in.begin() ? "%d" : ",%d", *p + 1);
+        }
+        m_text += ']';
+        if (hasPosition(evt, v)) append(" @ %.16e %.16e %.16e %.16e", evt.vx[v], evt.vy[v], evt.vz[v], evt.vt[v]);
+        m_text += '\n';
+    }
+
+    // printf-style append to the event text
+    template <class... Args>
+    void append(const char* format, Args... args) {
+        char line[320];
+        int n = snprintf(line, sizeof(line), format, args...);
+        if (n < (int)sizeof(line)) {
+            m_text.append(line, n);
+        } else {
+            size_t size = m_text.size();
+            m_text.resize(size + n + 1);
+            snprintf(&m_text[size], n + 1, format, args...);
+            m_text.resize(size + n);
+        }
+    }
+
+    std::ostream& m_out;
+    std::string m_text;             // current event, reused
+    std::vector<char> m_written;    // explicit vertex already written
+    std::string m_attributes;       // "A" lines of the next event
+    bool m_headerWritten = false;
+    bool m_closed = false;
+};
+
+#endif // FLAT_OUTPUT_H
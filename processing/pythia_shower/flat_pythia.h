@@ -0,0 +1,96 @@
+// ==============================================================================
+// flat_pythia.h - Pythia8 event record <-> flat event (flat_event.h)
+// ==============================================================================
+// pythiaToFlat builds the same vertex structure as Pythia8ToHepMC3: a particle
+// is produced at the end vertex of its first mother that already has one,
+// otherwise at a new vertex (at its production point) that all its mothers
+// enter. Statuses are the HepMC codes (statusHepMC), entry 0 (the system) is
+// dropped, so Pythia entry i is flat particle i - 1.
+//
+// flatToPythia goes the other way for tools that want the Pythia helpers on
+// stored events: final particles get status 1, beams (HepMC status 4) -12
+// and everything else a negative status. Mother and daughter lists are
+// encoded with Pythia's index conventions, which are exact for the
+// contiguous daughter ranges Pythia itself produces.
+// ==============================================================================
+
+#ifndef FLAT_PYTHIA_H
+#define FLAT_PYTHIA_H
+
+#include "Pythia8/Pythia.h"
+
+#include "flat_event.h"
+
+#include <vector>
+
+// Flatten a Pythia event; eventNumber and weights are left to the caller
+inline void pythiaToFlat(const Pythia8::Event& event, BinaryEvent& flat) {
+    flat.clear();
+    for (int i = 1; i < event.size(); ++i) {
+        const Pythia8::Particle& p = event[i];
+        flat.addParticle(p.id(), p.statusHepMC(), -1, p.px(), p.py(), p.pz(), p.e(), p.m());
+    }
+
+    for (int i = 1; i < event.size(); ++i) {
+        const Pythia8::Particle& p = event[i];
+        std::vector<int> mothers = p.motherList();
+        int prod = -1;
+        for (int mother : mothers) {
+            if (mother > 0 && flat.endVertex[mother - 1] >= 0) {
+                prod = flat.endVertex[mother - 1];
+                break;
+            }
+        }
+        bool hasPosition = p.xProd() != 0.0 || p.yProd() != 0.0 || p.zProd() != 0.0 || p.tProd() != 0.0;
+        if (prod < 0 && (!mothers.empty() || hasPosition)) {
+            prod = flat.addVertex(0, p.xProd(), p.yProd(), p.zProd(), p.tProd());
+        }
+        flat.prodVertex[i - 1] = prod;
+        for (int mother : mothers) {
+            if (mother > 0 && flat.endVertex[mother - 1] < 0) flat.endVertex[mother - 1] = prod;
+        }
+    }
+}
+
+// Pythia (index1, index2) pair for a list of flat indices
+inline void pythiaIndexPair(const FlatIndexRange& list, bool daughters, int& index1, int& index2) {
+    index1 = index2 = 0;
+    if (list.empty()) return;
+    int first = *list.begin() + 1;
+    int last = *(list.end() - 1) + 1;
+    if (list.size() == 1) {
+        index1 = first;
+        index2 = daughters ? first : 0;
+    } else if (list.size() == 2 && daughters && last != first + 1) {
+        index1 = last;       // two separate daughters: daughter2 < daughter1
+        index2 = first;
+    } else {
+        index1 = first;
+        index2 = last;
+    }
+}
+
+// Rebuild a Pythia event from a flat one; links must be built for flat
+inline void flatToPythia(const BinaryEvent& flat, const FlatLinks& links, Pythia8::Event& event) {
+    event.reset();
+
+    double sum[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < flat.nParticles(); ++i) {
+        if (flat.status[i] != 1) continue;
+        sum[0] += flat.px[i]; sum[1] += flat.py[i]; sum[2] += flat.pz[i]; sum[3] += flat.e[i];
+    }
+    event.append(90, -11, 0, 0, 0, 0, 0, 0, sum[0], sum[1], sum[2], sum[3]);
+
+    for (size_t i = 0; i < flat.nParticles(); ++i) {
+        int mother1, mother2, daughter1, daughter2;
+        pythiaIndexPair(links.mothers(flat, i), false, mother1, mother2);
+        pythiaIndexPair(links.daughters(flat, i), true, daughter1, daughter2);
+        int status = flat.status[i] == 1 ? 1 : (flat.status[i] == 4 ? -12 : -std::abs(flat.status[i]));
+        int j = event.append(flat.pid[i], status, mother1, mother2, daughter1, daughter2, 0, 0,
+                             flat.px[i], flat.py[i], flat.pz[i], flat.e[i], flat.m[i]);
+        int v = flat.prodVertex[i];
+        if (v >= 0) event[j].vProd(flat.vx[v], flat.vy[v], flat.vz[v], flat.vt[v]);
+    }
+}
+
+#endif // FLAT_PYTHIA_H
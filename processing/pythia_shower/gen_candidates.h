@@ -0,0 +1,186 @@
+// ==============================================================================
+// gen_candidates.h - Onium and phi candidates of a flat event, and their tree
+// ==============================================================================
+// Shared by gen_ntuple (generator level) and fast_sim (smeared), so both write
+// the same ntuple layout:
+//
+//   <prefix>Px/Py/Pz/Mass, <prefix>PdgId, <prefix>Src (source index),
+//   <prefix>Decay (both listed daughters found), daughter Px/Py/Pz
+//
+// one vector entry per candidate, with the "MC" prefixes of the analyzers'
+// MC-truth block. The tree is <module>/X_data, with the module label of
+// ntuple_jjp_cfg.py (mkcands) or ntuple_jup_cfg.py (onia2MuMuPAT).
+// ==============================================================================
+
+#ifndef GEN_CANDIDATES_H
+#define GEN_CANDIDATES_H
+
+#include "flat_event.h"
+
+#include "TTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// A mother species and the two daughters it is matched to (charge-conjugated
+// for negative mothers)
+struct CandidateKind {
+    const char* prefix;
+    std::vector<int> pids;
+    int daughter1, daughter2;
+    const char* prefix1;
+    const char* prefix2;
+};
+
+const std::vector<CandidateKind> kCandidateKinds = {
+    {"MCJPsi", {443}, -13, 13, "MCmup", "MCmum"},
+    {"MCUps", {553, 100553, 200553}, -13, 13, "MCUpsMup", "MCUpsMum"},
+    {"MCPhi", {333}, 321, -321, "MCKp", "MCKm"},
+};
+
+// Tree directory for an analysis type; empty if unknown
+inline std::string candidateTreeDirectory(const std::string& analysis) {
+    if (analysis == "JJP") return "mkcands";
+    if (analysis == "JUP") return "onia2MuMuPAT";
+    return "";
+}
+
+struct GenCandidate {
+    int kind = 0;                 // index into kCandidateKinds
+    int pdgId = 0;
+    int src = 0;
+    bool decay = false;
+    double p[4] = {0, 0, 0, 0};   // px, py, pz, e
+    double d1[4] = {0, 0, 0, 0};  // daughters, zero if not found
+    double d2[4] = {0, 0, 0, 0};
+
+    double mass() const {
+        return std::sqrt(std::max(0.0, p[3] * p[3] - p[0] * p[0] - p[1] * p[1] - p[2] * p[2]));
+    }
+};
+
+// Finds candidates in flat events; keeps its link buffers between events
+class CandidateFinder {
+public:
+    // Appends the candidates of evt; returns the number of sources seen
+    int find(const BinaryEvent& evt, const std::vector<int>& source, std::vector<GenCandidate>& out) {
+        m_links.build(evt);
+        int nSources = 0;
+        for (size_t i = 0; i < evt.nParticles(); ++i) {
+            nSources = std::max(nSources, source[i] + 1);
+            int apid = std::abs(evt.pid[i]);
+            for (size_t k = 0; k < kCandidateKinds.size(); ++k) {
+                const CandidateKind& kind = kCandidateKinds[k];
+                if (std::find(kind.pids.begin(), kind.pids.end(), apid) == kind.pids.end()) continue;
+                if (m_links.isLastCopy(evt, i)) out.push_back(makeCandidate(evt, i, source[i], k));
+                break;
+            }
+        }
+        return nSources;
+    }
+
+private:
+    static void copyMomentum(const BinaryEvent& evt, int i, double* p) {
+        p[0] = evt.px[i]; p[1] = evt.py[i]; p[2] = evt.pz[i]; p[3] = evt.e[i];
+    }
+
+    GenCandidate makeCandidate(const BinaryEvent& evt, int i, int source, int k) const {
+        const CandidateKind& kind = kCandidateKinds[k];
+        GenCandidate c;
+        c.kind = k;
+        c.pdgId = evt.pid[i];
+        c.src = source;
+        copyMomentum(evt, i, c.p);
+
+        int sign = evt.pid[i] < 0 ? -1 : 1;
+        int d1 = -1, d2 = -1;
+        for (int j : m_links.daughters(evt, i)) {
+            if (d1 < 0 && evt.pid[j] == sign * kind.daughter1) d1 = j;
+            else if (d2 < 0 && evt.pid[j] == sign * kind.daughter2) d2 = j;
+        }
+        c.decay = d1 >= 0 && d2 >= 0;
+        if (d1 >= 0) copyMomentum(evt, d1, c.d1);
+        if (d2 >= 0) copyMomentum(evt, d2, c.d2);
+        return c;
+    }
+
+    FlatLinks m_links;
+};
+
+struct CandidateBranches {
+    std::vector<float> px, py, pz, mass;
+    std::vector<int> pdgId, src, decay;
+    std::vector<float> px1, py1, pz1, px2, py2, pz2;
+
+    void book(TTree* tree, const CandidateKind& kind) {
+        std::string p = kind.prefix, d1 = kind.prefix1, d2 = kind.prefix2;
+        tree->Branch((p + "Px").c_str(), &px);
+        tree->Branch((p + "Py").c_str(), &py);
+        tree->Branch((p + "Pz").c_str(), &pz);
+        tree->Branch((p + "Mass").c_str(), &mass);
+        tree->Branch((p + "PdgId").c_str(), &pdgId);
+        tree->Branch((p + "Src").c_str(), &src);
+        tree->Branch((p + "Decay").c_str(), &decay);
+        tree->Branch((d1 + "Px").c_str(), &px1);
+        tree->Branch((d1 + "Py").c_str(), &py1);
+        tree->Branch((d1 + "Pz").c_str(), &pz1);
+        tree->Branch((d2 + "Px").c_str(), &px2);
+        tree->Branch((d2 + "Py").c_str(), &py2);
+        tree->Branch((d2 + "Pz").c_str(), &pz2);
+    }
+
+    void clear() {
+        px.clear(); py.clear(); pz.clear(); mass.clear();
+        pdgId.clear(); src.clear(); decay.clear();
+        px1.clear(); py1.clear(); pz1.clear(); px2.clear(); py2.clear(); pz2.clear();
+    }
+
+    void push(const GenCandidate& c) {
+        px.push_back(c.p[0]); py.push_back(c.p[1]); pz.push_back(c.p[2]);
+        mass.push_back(c.mass());
+        pdgId.push_back(c.pdgId);
+        src.push_back(c.src);
+        decay.push_back(c.decay);
+        px1.push_back(c.d1[0]); py1.push_back(c.d1[1]); pz1.push_back(c.d1[2]);
+        px2.push_back(c.d2[0]); py2.push_back(c.d2[1]); pz2.push_back(c.d2[2]);
+    }
+};
+
+// Event branches plus one CandidateBranches per kind
+class CandidateNtuple {
+public:
+    explicit CandidateNtuple(TTree* tree)
+        : m_tree(tree), m_branches(kCandidateKinds.size()), m_totals(kCandidateKinds.size(), 0) {
+        tree->Branch("Evt", &m_event, "Evt/I");
+        tree->Branch("MCWeight", &m_weight, "MCWeight/D");
+        tree->Branch("MCnSources", &m_nSources, "MCnSources/I");
+        for (size_t k = 0; k < kCandidateKinds.size(); ++k) m_branches[k].book(tree, kCandidateKinds[k]);
+    }
+
+    void fill(int eventNumber, double weight, int nSources, const std::vector<GenCandidate>& candidates) {
+        m_event = eventNumber;
+        m_weight = weight;
+        m_nSources = nSources;
+        for (auto& b : m_branches) b.clear();
+        for (const auto& c : candidates) {
+            m_branches[c.kind].push(c);
+            m_totals[c.kind]++;
+        }
+        m_tree->Fill();
+    }
+
+    long total(size_t kind) const { return m_totals[kind]; }
+
+private:
+    TTree* m_tree;
+    int m_event = 0;
+    double m_weight = 1.0;
+    int m_nSources = 0;
+    std::vector<CandidateBranches> m_branches;
+    std::vector<long> m_totals;
+};
+
+#endif // GEN_CANDIDATES_H
@@ -0,0 +1,163 @@
+// ==============================================================================
+// gen_ntuple.cc - Generator-level ntuple straight from HepMC
+// ==============================================================================
+// Quick physics check of a campaign without GEN-SIM ... MiniAOD: reads the
+// mixed event file (HepMC2, as written by event_mixer_multisource) or the
+// shower outputs (HepMC3 ASCII or .hepb) and writes a ROOT tree with the
+// generator-level onium, muon, phi and kaon kinematics of every event.
+//
+// - Tree layout and branch names: gen_candidates.h (also used by fast_sim)
+// - Every candidate carries its source index (*Src): from the barcode offsets
+//   of the mixer for merged files, the input position for shower outputs.
+//   Several shower outputs are combined event by event, like the mixer's
+//   sequential pairing.
+// - Events are flattened into the BinaryEvent record (flat_input.h); .hepb
+//   input is read without building a HepMC3 event at all
+//
+// Compilation (in CMSSW environment):
+//   g++ -std=c++17 -O2 gen_ntuple.cc -o gen_ntuple \
+//       -I$HEPMC3/include -I$HEPMC2/include $(root-config --cflags) \
+//       -L$HEPMC3/lib64 -L$HEPMC2/lib \
+//       -Wl,-rpath,$HEPMC3/lib64 -Wl,-rpath,$HEPMC2/lib \
+//       -lHepMC3 -lHepMC $(root-config --libs) -lzstd -llz4 -pthread
+//
+// Usage:
+//   ./gen_ntuple output.root input1.hepmc [input2.hepmc ...] [--analysis JJP|JUP] [--nevents N]
+// ==============================================================================
+
+#include "flat_input.h"
+#include "gen_candidates.h"
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void printUsage(const char* progName) {
+    cerr << "\n=== Generator-level Ntuple ===" << endl;
+    cerr << "Usage: " << progName << " output.root input1.hepmc [input2.hepmc ...] [options]" << endl;
+    cerr << "\nArguments:" << endl;
+    cerr << "  output.root   : Output ROOT file" << endl;
+    cerr << "  input1.hepmc  : Mixed HepMC2 file, or a shower output (HepMC3 ASCII or .hepb)" << endl;
+    cerr << "  inputN.hepmc  : Further shower outputs, combined event by event" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --analysis T  : JJP (default) or JUP; sets the tree directory" << endl;
+    cerr << "  --nevents N   : Maximum events to process (default: all)" << endl;
+    cerr << "\nExamples:" << endl;
+    cerr << "  " << progName << " gen_jjp.root mixed.hepmc" << endl;
+    cerr << "  " << progName << " gen_jup.root shower_0.hepmc shower_1.hepmc --analysis JUP" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string outputFile = argv[1];
+    vector<string> inputFiles;
+    string analysis = "JJP";
+    int nEvents = -1;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--analysis" && i + 1 < argc) {
+            analysis = argv[++i];
+        } else if (arg == "--nevents" && i + 1 < argc) {
+            nEvents = atoi(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            cerr << "Error: Unknown option: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            inputFiles.push_back(arg);
+        }
+    }
+
+    string directory = candidateTreeDirectory(analysis);
+    if (directory.empty()) {
+        cerr << "Error: Unknown analysis: " << analysis << endl;
+        return 1;
+    }
+
+    const int nInputs = inputFiles.size();
+    vector<FlatSource> sources(nInputs);
+    for (int i = 0; i < nInputs; ++i) {
+        if (!sources[i].open(inputFiles[i])) {
+            cerr << "Error: Cannot open input file: " << inputFiles[i] << endl;
+            return 1;
+        }
+        if (nInputs > 1 && sources[i].format() == HepMCFormat::kHepMC2) {
+            cerr << "Error: Merged HepMC2 files are read alone: " << inputFiles[i] << endl;
+            return 1;
+        }
+    }
+
+    cout << "\n=== Generator-level Ntuple ===" << endl;
+    cout << "Output:     " << outputFile << " (" << directory << "/X_data)" << endl;
+    for (int i = 0; i < nInputs; ++i) {
+        cout << "  Input " << i+1 << ": " << inputFiles[i] << endl;
+    }
+    cout << "N events:   " << (nEvents > 0 ? to_string(nEvents) : "all") << endl;
+    cout << "==============================\n" << endl;
+
+    TFile* file = TFile::Open(outputFile.c_str(), "RECREATE");
+    if (!file || file->IsZombie()) {
+        cerr << "Error: Cannot create output file: " << outputFile << endl;
+        return 1;
+    }
+    TDirectory* dir = file->mkdir(directory.c_str());
+    dir->cd();
+    TTree* tree = new TTree("X_data", "Generator-level candidates");
+    CandidateNtuple ntuple(tree);
+    CandidateFinder finder;
+
+    auto startTime = chrono::steady_clock::now();
+    BinaryEvent evt;
+    vector<int> source;
+    vector<GenCandidate> candidates;
+    int iEvent = 0;
+    bool done = false;
+    while (!done && (nEvents < 0 || iEvent < nEvents)) {
+        candidates.clear();
+        double weight = 1.0;
+        int nSources = 0;
+        for (int s = 0; s < nInputs; ++s) {
+            if (!sources[s].next(evt, source, s)) {
+                done = true;
+                break;
+            }
+            if (!evt.weights.empty()) weight *= evt.weights[0];
+            nSources = max(nSources, finder.find(evt, source, candidates));
+        }
+        if (done) break;
+        ntuple.fill(iEvent, weight, nSources, candidates);
+        ++iEvent;
+        if (iEvent % 10000 == 0) cout << "Processed " << iEvent << " events..." << endl;
+    }
+
+    dir->cd();
+    tree->Write();
+    file->Close();
+    delete file;
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    cout << "\n==============================" << endl;
+    cout << "Ntuple Summary:" << endl;
+    cout << "------------------------------" << endl;
+    cout << "Events written: " << iEvent << endl;
+    for (size_t k = 0; k < kCandidateKinds.size(); ++k) {
+        cout << "  " << kCandidateKinds[k].prefix << " candidates: " << ntuple.total(k) << endl;
+    }
+    cout << "Time:           " << seconds << " s ("
+         << (seconds > 0 ? iEvent / seconds : 0.0) << " events/s)" << endl;
+    cout << "Output file:    " << outputFile << endl;
+    cout << "==============================" << endl;
+
+    return 0;
+}
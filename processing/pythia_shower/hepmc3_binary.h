@@ -0,0 +1,124 @@
+// ==============================================================================
+// hepmc3_binary.h - HepMC3 reader for the binary event format
+// ==============================================================================
+// Lets programs that consume HepMC3::Reader (event_mixer_multisource) read
+// .hepb files written in the hepmc_binary.h format, and flattens HepMC3 events
+// into the same record for programs that only need the flat arrays (gen_ntuple).
+// ==============================================================================
+
+#ifndef HEPMC3_BINARY_H
+#define HEPMC3_BINARY_H
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/GenVertex.h"
+#include "HepMC3/Reader.h"
+
+#include "hepmc_binary.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Build a HepMC3 event from a binary record; particle order is preserved
+inline void binaryToHepMC3(const BinaryEvent& bin, HepMC3::GenEvent& evt) {
+    evt.clear();
+    evt.set_units(HepMC3::Units::GEV, HepMC3::Units::MM);
+    evt.set_event_number(bin.eventNumber);
+    evt.weights() = bin.weights;
+
+    std::vector<HepMC3::GenParticlePtr> particles(bin.nParticles());
+    for (size_t i = 0; i < bin.nParticles(); ++i) {
+        particles[i] = std::make_shared<HepMC3::GenParticle>(
+            HepMC3::FourVector(bin.px[i], bin.py[i], bin.pz[i], bin.e[i]),
+            bin.pid[i], bin.status[i]);
+        particles[i]->set_generated_mass(bin.m[i]);
+        evt.add_particle(particles[i]);
+    }
+
+    std::vector<HepMC3::GenVertexPtr> vertices(bin.nVertices());
+    for (size_t v = 0; v < bin.nVertices(); ++v) {
+        vertices[v] = std::make_shared<HepMC3::GenVertex>(
+            HepMC3::FourVector(bin.vx[v], bin.vy[v], bin.vz[v], bin.vt[v]));
+        vertices[v]->set_status(bin.vStatus[v]);
+    }
+
+    for (size_t i = 0; i < bin.nParticles(); ++i) {
+        if (bin.prodVertex[i] >= 0) vertices[bin.prodVertex[i]]->add_particle_out(particles[i]);
+        if (bin.endVertex[i] >= 0) vertices[bin.endVertex[i]]->add_particle_in(particles[i]);
+    }
+
+    for (auto& v : vertices) evt.add_vertex(v);
+}
+
+// Flatten a HepMC3 event into a binary record (particle i has id i+1,
+// vertex v has id -(v+1))
+inline void hepmc3ToBinary(const HepMC3::GenEvent& evt, BinaryEvent& bin) {
+    bin.clear();
+    bin.eventNumber = evt.event_number();
+    bin.weights = evt.weights();
+    for (const auto& v : evt.vertices()) {
+        const HepMC3::FourVector& pos = v->position();
+        bin.addVertex(v->status(), pos.x(), pos.y(), pos.z(), pos.t());
+    }
+    for (const auto& p : evt.particles()) {
+        const HepMC3::FourVector& mom = p->momentum();
+        int prod = p->production_vertex() ? -p->production_vertex()->id() - 1 : -1;
+        int i = bin.addParticle(p->pid(), p->status(), prod,
+                                mom.px(), mom.py(), mom.pz(), mom.e(), p->generated_mass());
+        if (p->end_vertex()) bin.endVertex[i] = -p->end_vertex()->id() - 1;
+    }
+}
+
+// HepMC3::Reader over a .hepb file
+class ReaderBinary : public HepMC3::Reader {
+public:
+    ReaderBinary(const std::string& filename) {
+        m_file = fopen(filename.c_str(), "rb");
+        m_failed = !m_file || !readBinaryFileHeader(m_file);
+    }
+
+    ~ReaderBinary() { close(); }
+
+    bool read_event(HepMC3::GenEvent& evt) override {
+        if (m_failed) return false;
+        if (!readBinaryEvent(m_file, m_event)) {
+            m_failed = true;
+            return false;
+        }
+        binaryToHepMC3(m_event, evt);
+        return true;
+    }
+
+    // Reads the raw record without building the HepMC3 graph
+    bool read_binary(BinaryEvent& evt) {
+        if (m_failed) return false;
+        if (!readBinaryEvent(m_file, evt)) m_failed = true;
+        return !m_failed;
+    }
+
+    // Byte offset of the next event frame, for seek()
+    uint64_t tell() { return m_file ? (uint64_t)ftello(m_file) : 0; }
+
+    // Positions the reader at an offset returned by tell(); clears a previous EOF
+    bool seek(uint64_t offset) {
+        if (!m_file) return false;
+        m_failed = fseeko(m_file, (off_t)offset, SEEK_SET) != 0;
+        return !m_failed;
+    }
+
+    bool failed() override { return m_failed; }
+
+    void close() override {
+        if (m_file) fclose(m_file);
+        m_file = nullptr;
+    }
+
+private:
+    FILE* m_file = nullptr;
+    bool m_failed = true;
+    BinaryEvent m_event;
+};
+
+#endif // HEPMC3_BINARY_H
@@ -0,0 +1,212 @@
+// ==============================================================================
+// hepmc_binary.h - Compact binary event format for intermediate HepMC files
+// ==============================================================================
+// A length-prefixed, structure-of-arrays event record used for large
+// intermediate files (synthetic banks, mixer inputs/outputs). It carries the
+// same information as a HepMC3 GenEvent (particles, vertices, links, weights)
+// but is read and written with a handful of bulk copies and no text parsing.
+//
+// File layout (little endian):
+//   file header : char magic[4] = "HMCB", uint32 version, uint32 flags, uint32 reserved
+//   event frame : uint32 frameMagic ("EVNT"), uint32 payloadBytes, int64 eventNumber,
+//                 payload[payloadBytes]
+//   payload     : uint32 nParticles, nVertices, nWeights, reserved
+//                 double weights[nWeights]
+//                 int32  vStatus[nV]; double vx[nV], vy[nV], vz[nV], vt[nV]
+//                 int32  pid[nP], status[nP], prodVertex[nP], endVertex[nP]
+//                 double px[nP], py[nP], pz[nP], e[nP], m[nP]
+//
+// Vertex links are indices into the vertex arrays (-1 = none). Particles are
+// stored in an order where every particle follows the particles entering its
+// production vertex. The frame header carries the event number so tools can
+// order or skip events without decoding the payload.
+//
+// Header-only, no external dependencies.
+// ==============================================================================
+
+#ifndef HEPMC_BINARY_H
+#define HEPMC_BINARY_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+const char kBinaryFileMagic[4] = {'H', 'M', 'C', 'B'};
+const uint32_t kBinaryFormatVersion = 1;
+const uint32_t kBinaryFrameMagic = 0x544E5645; // "EVNT"
+
+struct BinaryEvent {
+    int64_t eventNumber = 0;
+    std::vector<double> weights;
+
+    // Vertices
+    std::vector<int32_t> vStatus;
+    std::vector<double> vx, vy, vz, vt;
+
+    // Particles
+    std::vector<int32_t> pid, status, prodVertex, endVertex;
+    std::vector<double> px, py, pz, e, m;
+
+    size_t nParticles() const { return pid.size(); }
+    size_t nVertices() const { return vStatus.size(); }
+
+    // Keeps capacity so a reused event does not reallocate
+    void clear() {
+        eventNumber = 0;
+        weights.clear();
+        vStatus.clear(); vx.clear(); vy.clear(); vz.clear(); vt.clear();
+        pid.clear(); status.clear(); prodVertex.clear(); endVertex.clear();
+        px.clear(); py.clear(); pz.clear(); e.clear(); m.clear();
+    }
+
+    int addVertex(int32_t st = 0, double x = 0.0, double y = 0.0, double z = 0.0, double t = 0.0) {
+        vStatus.push_back(st);
+        vx.push_back(x); vy.push_back(y); vz.push_back(z); vt.push_back(t);
+        return (int)vStatus.size() - 1;
+    }
+
+    int addParticle(int32_t id, int32_t st, int32_t prod,
+                    double ppx, double ppy, double ppz, double pe, double pm) {
+        pid.push_back(id); status.push_back(st);
+        prodVertex.push_back(prod); endVertex.push_back(-1);
+        px.push_back(ppx); py.push_back(ppy); pz.push_back(ppz); e.push_back(pe); m.push_back(pm);
+        return (int)pid.size() - 1;
+    }
+
+    size_t payloadBytes() const;
+};
+
+// Payload size of a frame with these counts (64-bit, so file counts cannot overflow it)
+inline uint64_t binaryPayloadBytes(uint64_t nParticles, uint64_t nVertices, uint64_t nWeights) {
+    return 4 * sizeof(uint32_t)
+         + nWeights * sizeof(double)
+         + nVertices * (sizeof(int32_t) + 4 * sizeof(double))
+         + nParticles * (4 * sizeof(int32_t) + 5 * sizeof(double));
+}
+
+inline size_t BinaryEvent::payloadBytes() const {
+    return binaryPayloadBytes(nParticles(), nVertices(), weights.size());
+}
+
+// ------------------------------------------------------------------------------
+// Writing
+// ------------------------------------------------------------------------------
+
+// The writers take a FILE* or a std::ostream (e.g. EventOutputStream)
+inline bool writeBytes(FILE* f, const void* data, size_t n) {
+    return n == 0 || fwrite(data, 1, n, f) == n;
+}
+
+inline bool writeBytes(std::ostream& out, const void* data, size_t n) {
+    out.write((const char*)data, n);
+    return !out.fail();
+}
+
+template <class Out>
+inline bool writeBinaryFileHeader(Out& f) {
+    uint32_t header[3] = {kBinaryFormatVersion, 0, 0};
+    return writeBytes(f, kBinaryFileMagic, 4) && writeBytes(f, header, sizeof(header));
+}
+
+template <class Out, class T>
+inline bool writeBlock(Out& f, const std::vector<T>& v) {
+    return writeBytes(f, v.data(), v.size() * sizeof(T));
+}
+
+template <class Out>
+inline bool writeBinaryEvent(Out& f, const BinaryEvent& evt) {
+    // The frame length is 32 bits: a larger event cannot be written
+    if (evt.payloadBytes() > UINT32_MAX) return false;
+    uint32_t frame[2] = {kBinaryFrameMagic, (uint32_t)evt.payloadBytes()};
+    uint32_t counts[4] = {(uint32_t)evt.nParticles(), (uint32_t)evt.nVertices(),
+                          (uint32_t)evt.weights.size(), 0};
+    bool ok = writeBytes(f, frame, sizeof(frame))
+           && writeBytes(f, &evt.eventNumber, sizeof(int64_t))
+           && writeBytes(f, counts, sizeof(counts))
+           && writeBlock(f, evt.weights)
+           && writeBlock(f, evt.vStatus)
+           && writeBlock(f, evt.vx) && writeBlock(f, evt.vy)
+           && writeBlock(f, evt.vz) && writeBlock(f, evt.vt)
+           && writeBlock(f, evt.pid) && writeBlock(f, evt.status)
+           && writeBlock(f, evt.prodVertex) && writeBlock(f, evt.endVertex)
+           && writeBlock(f, evt.px) && writeBlock(f, evt.py) && writeBlock(f, evt.pz)
+           && writeBlock(f, evt.e) && writeBlock(f, evt.m);
+    return ok;
+}
+
+// ------------------------------------------------------------------------------
+// Reading
+// ------------------------------------------------------------------------------
+
+inline bool readBinaryFileHeader(FILE* f) {
+    char magic[4];
+    uint32_t header[3];
+    if (fread(magic, 1, 4, f) != 4 || fread(header, sizeof(header), 1, f) != 1) return false;
+    return memcmp(magic, kBinaryFileMagic, 4) == 0 && header[0] == kBinaryFormatVersion;
+}
+
+// Reads the next frame header; payloadBytes/eventNumber describe the frame
+inline bool readBinaryFrameHeader(FILE* f, uint32_t& payloadBytes, int64_t& eventNumber) {
+    uint32_t frame[2];
+    if (fread(frame, sizeof(frame), 1, f) != 1) return false;
+    if (frame[0] != kBinaryFrameMagic) return false;
+    payloadBytes = frame[1];
+    return fread(&eventNumber, sizeof(int64_t), 1, f) == 1;
+}
+
+template <class T>
+inline bool readBlock(FILE* f, std::vector<T>& v, size_t n) {
+    v.resize(n);
+    return n == 0 || fread(v.data(), sizeof(T), n, f) == n;
+}
+
+// Vertex links in [-1, nVertices): the converters (hepmc3_binary.h,
+// hepmc_convert.h, FlatLinks) index the vertex arrays with them unchecked
+inline bool binaryLinksValid(const BinaryEvent& evt) {
+    int64_t nV = (int64_t)evt.nVertices();
+    for (size_t i = 0; i < evt.nParticles(); ++i) {
+        if (evt.prodVertex[i] < -1 || evt.prodVertex[i] >= nV) return false;
+        if (evt.endVertex[i] < -1 || evt.endVertex[i] >= nV) return false;
+    }
+    return true;
+}
+
+inline bool readBinaryEvent(FILE* f, BinaryEvent& evt) {
+    uint32_t payloadBytes;
+    if (!readBinaryFrameHeader(f, payloadBytes, evt.eventNumber)) return false;
+
+    uint32_t counts[4];
+    if (fread(counts, sizeof(counts), 1, f) != 1) return false;
+    size_t nP = counts[0], nV = counts[1], nW = counts[2];
+    // Counts that do not add up to the frame size mean a corrupt frame: check
+    // before sizing any array from them
+    if (binaryPayloadBytes(nP, nV, nW) != payloadBytes) return false;
+
+    bool ok = readBlock(f, evt.weights, nW)
+           && readBlock(f, evt.vStatus, nV)
+           && readBlock(f, evt.vx, nV) && readBlock(f, evt.vy, nV)
+           && readBlock(f, evt.vz, nV) && readBlock(f, evt.vt, nV)
+           && readBlock(f, evt.pid, nP) && readBlock(f, evt.status, nP)
+           && readBlock(f, evt.prodVertex, nP) && readBlock(f, evt.endVertex, nP)
+           && readBlock(f, evt.px, nP) && readBlock(f, evt.py, nP) && readBlock(f, evt.pz, nP)
+           && readBlock(f, evt.e, nP) && readBlock(f, evt.m, nP);
+    return ok && binaryLinksValid(evt);
+}
+
+// Skips the next event without decoding it
+inline bool skipBinaryEvent(FILE* f) {
+    uint32_t payloadBytes;
+    int64_t eventNumber;
+    if (!readBinaryFrameHeader(f, payloadBytes, eventNumber)) return false;
+    return fseeko(f, payloadBytes, SEEK_CUR) == 0;
+}
+
+// File name convention for the binary format
+inline bool isBinaryEventFile(const std::string& path) {
+    return path.size() > 5 && path.compare(path.size() - 5, 5, ".hepb") == 0;
+}
+
+#endif // HEPMC_BINARY_H
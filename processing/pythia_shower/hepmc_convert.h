@@ -0,0 +1,294 @@
+// ==============================================================================
+// hepmc_convert.h - HepMC2 conversion and multi-source merging
+// ==============================================================================
+// Conversion kernels used by event_mixer_multisource. Kept in a header so the
+// benchmark suite exercises exactly the production code path. Also summarizes
+// HepMC3 events for inputs without a summary sidecar (event_summary.h).
+//
+// The mixer merges flat events (flat_event.h) and converts the result once
+// with flatToHepMC2; convertToHepMC2/mergeEvents are the graph-to-graph
+// versions it replaced, kept as the reference in bench_kernels.
+// ==============================================================================
+
+#ifndef HEPMC_CONVERT_H
+#define HEPMC_CONVERT_H
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/GenVertex.h"
+
+#include "HepMC/GenEvent.h"
+#include "HepMC/GenParticle.h"
+#include "HepMC/GenVertex.h"
+
+#include "event_summary.h"
+#include "flat_event.h"
+#include "kinematics_simd.h"
+#include "selection_expr.h"
+
+#include <cstdlib>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Barcode offset per source in merged events: source s gets barcodes
+// s * kSourceBarcodeStep + id, so the source of a particle can be recovered
+const int kSourceBarcodeStep = 100000;
+
+inline int sourceOfBarcode(int barcode) {
+    return (std::abs(barcode) - 1) / kSourceBarcodeStep;
+}
+
+// Convert HepMC3 event to HepMC2 event
+inline HepMC::GenEvent* convertToHepMC2(const HepMC3::GenEvent& evt3, int eventNumber, int barcodeOffset = 0) {
+    HepMC::GenEvent* evt2 = new HepMC::GenEvent();
+    evt2->set_event_number(eventNumber);
+    evt2->set_signal_process_id(0);
+    
+    // Set weights (nominal first, then any variations)
+    if (evt3.weights().empty()) evt2->weights().push_back(1.0);
+    for (double w : evt3.weights()) evt2->weights().push_back(w);
+    
+    // Particle mapping
+    std::map<int, HepMC::GenParticle*> particleMap;
+    
+    // Create all particles
+    for (const auto& p3 : evt3.particles()) {
+        HepMC::FourVector mom(p3->momentum().px(), 
+                              p3->momentum().py(),
+                              p3->momentum().pz(),
+                              p3->momentum().e());
+        HepMC::GenParticle* p2 = new HepMC::GenParticle(mom, p3->pid(), p3->status());
+        p2->suggest_barcode(p3->id() + barcodeOffset);
+        particleMap[p3->id()] = p2;
+    }
+    
+    // Create vertices and connect particles
+    for (const auto& v3 : evt3.vertices()) {
+        HepMC::FourVector pos(v3->position().x(),
+                              v3->position().y(),
+                              v3->position().z(),
+                              v3->position().t());
+        HepMC::GenVertex* v2 = new HepMC::GenVertex(pos);
+        v2->suggest_barcode(v3->id() - barcodeOffset);
+        
+        for (const auto& p3_in : v3->particles_in()) {
+            if (particleMap.count(p3_in->id())) {
+                v2->add_particle_in(particleMap[p3_in->id()]);
+            }
+        }
+        
+        for (const auto& p3_out : v3->particles_out()) {
+            if (particleMap.count(p3_out->id())) {
+                v2->add_particle_out(particleMap[p3_out->id()]);
+            }
+        }
+        
+        evt2->add_vertex(v2);
+    }
+    
+    return evt2;
+}
+
+// Merge multiple HepMC3 events into one HepMC2 event
+inline HepMC::GenEvent* mergeEvents(const std::vector<HepMC3::GenEvent*>& events, int eventNumber) {
+    HepMC::GenEvent* merged = new HepMC::GenEvent();
+    merged->set_event_number(eventNumber);
+    merged->set_signal_process_id(0);
+    
+    // Combine weights (nominal and variations, see combineWeights)
+    std::vector<const std::vector<double>*> sourceWeights;
+    for (const auto& evt : events) sourceWeights.push_back(evt ? &evt->weights() : nullptr);
+    std::vector<double> combined;
+    combineWeights(sourceWeights, combined);
+    for (double w : combined) merged->weights().push_back(w);
+    
+    for (size_t srcIdx = 0; srcIdx < events.size(); ++srcIdx) {
+        if (!events[srcIdx]) continue;
+        
+        const HepMC3::GenEvent& evt = *events[srcIdx];
+        int offset = srcIdx * kSourceBarcodeStep;
+        
+        // Particle mapping for this source
+        std::map<int, HepMC::GenParticle*> particleMap;
+        
+        // Create particles
+        for (const auto& p3 : evt.particles()) {
+            HepMC::FourVector mom(p3->momentum().px(), 
+                                  p3->momentum().py(),
+                                  p3->momentum().pz(),
+                                  p3->momentum().e());
+            HepMC::GenParticle* p2 = new HepMC::GenParticle(mom, p3->pid(), p3->status());
+            p2->suggest_barcode(p3->id() + offset);
+            particleMap[p3->id()] = p2;
+        }
+        
+        // Create vertices
+        for (const auto& v3 : evt.vertices()) {
+            HepMC::FourVector pos(v3->position().x(),
+                                  v3->position().y(),
+                                  v3->position().z(),
+                                  v3->position().t());
+            HepMC::GenVertex* v2 = new HepMC::GenVertex(pos);
+            v2->suggest_barcode(v3->id() - offset);
+            
+            for (const auto& p3_in : v3->particles_in()) {
+                if (particleMap.count(p3_in->id())) {
+                    v2->add_particle_in(particleMap[p3_in->id()]);
+                }
+            }
+            
+            for (const auto& p3_out : v3->particles_out()) {
+                if (particleMap.count(p3_out->id())) {
+                    v2->add_particle_out(particleMap[p3_out->id()]);
+                }
+            }
+            
+            merged->add_vertex(v2);
+        }
+    }
+    
+    return merged;
+}
+
+// Convert a flat event (merged or not) to HepMC2. Barcodes follow
+// convertToHepMC2/mergeEvents on HepMC3 input: particle i of source s gets
+// s * kSourceBarcodeStep + i + 1, vertex v gets -(s * kSourceBarcodeStep + v + 1),
+// with i and v counted within the source (layout from mergeFlatEvents; null
+// for a single source).
+inline HepMC::GenEvent* flatToHepMC2(const BinaryEvent& evt, int eventNumber,
+                                     const FlatMergeLayout* layout = nullptr) {
+    HepMC::GenEvent* evt2 = new HepMC::GenEvent();
+    evt2->set_event_number(eventNumber);
+    evt2->set_signal_process_id(0);
+    if (evt.weights.empty()) evt2->weights().push_back(1.0);
+    for (double w : evt.weights) evt2->weights().push_back(w);
+
+    size_t nSources = layout ? layout->nSources() : 1;
+    std::vector<HepMC::GenParticle*> particles(evt.nParticles());
+    std::vector<HepMC::GenVertex*> vertices(evt.nVertices());
+    for (size_t s = 0; s < nSources; ++s) {
+        size_t pBegin = layout ? layout->particleBegin[s] : 0;
+        size_t pEnd = layout ? layout->particleBegin[s + 1] : evt.nParticles();
+        size_t vBegin = layout ? layout->vertexBegin[s] : 0;
+        size_t vEnd = layout ? layout->vertexBegin[s + 1] : evt.nVertices();
+        int offset = s * kSourceBarcodeStep;
+
+        for (size_t i = pBegin; i < pEnd; ++i) {
+            HepMC::FourVector mom(evt.px[i], evt.py[i], evt.pz[i], evt.e[i]);
+            particles[i] = new HepMC::GenParticle(mom, evt.pid[i], evt.status[i]);
+            particles[i]->suggest_barcode(i - pBegin + 1 + offset);
+        }
+        for (size_t v = vBegin; v < vEnd; ++v) {
+            HepMC::FourVector pos(evt.vx[v], evt.vy[v], evt.vz[v], evt.vt[v]);
+            vertices[v] = new HepMC::GenVertex(pos);
+            vertices[v]->suggest_barcode(-(int)(v - vBegin + 1) - offset);
+        }
+    }
+
+    // Links in particle order; particles without a vertex are not part of
+    // the HepMC2 event (as in convertToHepMC2)
+    for (size_t i = 0; i < evt.nParticles(); ++i) {
+        bool linked = false;
+        if (evt.endVertex[i] >= 0) {
+            vertices[evt.endVertex[i]]->add_particle_in(particles[i]);
+            linked = true;
+        }
+        if (evt.prodVertex[i] >= 0) {
+            vertices[evt.prodVertex[i]]->add_particle_out(particles[i]);
+            linked = true;
+        }
+        if (!linked) delete particles[i];
+    }
+    for (HepMC::GenVertex* v : vertices) evt2->add_vertex(v);
+
+    return evt2;
+}
+
+// Particle and vertex order of the HepMC2 event is kept; source[i] is recovered
+// from the barcode offsets of mergeEvents/flatToHepMC2
+inline void hepmc2ToBinary(const HepMC::GenEvent& evt, BinaryEvent& bin, std::vector<int>& source) {
+    bin.clear();
+    source.clear();
+    bin.eventNumber = evt.event_number();
+    for (size_t w = 0; w < evt.weights().size(); ++w) bin.weights.push_back(evt.weights()[w]);
+
+    std::unordered_map<const HepMC::GenVertex*, int> vertexIndex;
+    for (auto v = evt.vertices_begin(); v != evt.vertices_end(); ++v) {
+        const HepMC::FourVector& pos = (*v)->position();
+        vertexIndex[*v] = bin.addVertex(0, pos.x(), pos.y(), pos.z(), pos.t());
+    }
+    for (auto it = evt.particles_begin(); it != evt.particles_end(); ++it) {
+        const HepMC::GenParticle* p = *it;
+        const HepMC::FourVector& mom = p->momentum();
+        int prod = p->production_vertex() ? vertexIndex[p->production_vertex()] : -1;
+        int i = bin.addParticle(p->pdg_id(), p->status(), prod,
+                                mom.px(), mom.py(), mom.pz(), mom.e(), p->generated_mass());
+        if (p->end_vertex()) bin.endVertex[i] = vertexIndex[p->end_vertex()];
+        source.push_back(sourceOfBarcode(p->barcode()));
+    }
+}
+
+// Count specific particles in event
+inline void countParticles(const HepMC::GenEvent* evt, int& nJpsi, int& nUpsilon, int& nPhi) {
+    nJpsi = 0;
+    nUpsilon = 0;
+    nPhi = 0;
+    
+    for (auto p = evt->particles_begin(); p != evt->particles_end(); ++p) {
+        int pid = std::abs((*p)->pdg_id());
+        if (pid == 443) nJpsi++;
+        else if (pid == 553 || pid == 100553 || pid == 200553) nUpsilon++;
+        else if (pid == 333) nPhi++;
+    }
+}
+
+// HepMC3 event view for SelectionProgram (selection_expr.h)
+struct HepMC3EventView {
+    const std::vector<HepMC3::ConstGenParticlePtr>& particles;
+
+    explicit HepMC3EventView(const HepMC3::GenEvent& evt) : particles(evt.particles()) {}
+
+    int size() const { return particles.size(); }
+    int id(int i) const { return particles[i]->pid(); }
+    bool isFinal(int i) const { return particles[i]->status() == 1; }
+    bool isCandidate(int i) const { return (particles[i]->status() == 1 || particles[i]->end_vertex()) && !isCopy(i); }
+    // Intermediate (recoil/shower) copy: its only daughter has the same id
+    bool isCopy(int i) const {
+        auto vtx = particles[i]->end_vertex();
+        return vtx && vtx->particles_out().size() == 1 && vtx->particles_out()[0]->pid() == particles[i]->pid();
+    }
+    double px(int i) const { return particles[i]->momentum().px(); }
+    double py(int i) const { return particles[i]->momentum().py(); }
+    double pz(int i) const { return particles[i]->momentum().pz(); }
+
+    template <class F>
+    void forEachInPidRange(int minAbs, int maxAbs, F&& f) const {
+        for (int i = 0; i < size(); ++i) {
+            int a = std::abs(particles[i]->pid());
+            if (a >= minAbs && a <= maxAbs) f(i);
+        }
+    }
+
+    template <class F>
+    void forEachDaughter(int i, F&& f) const {
+        auto vtx = particles[i]->end_vertex();
+        if (!vtx) return;
+        for (const auto& d : vtx->particles_out()) {
+            const HepMC3::FourVector& p = d->momentum();
+            if (f(d->pid(), p.px(), p.py(), p.pz())) return;
+        }
+    }
+};
+
+// Per-event facts for the summary sidecar (event_summary.h, fillSummaryFromView).
+// Used by the mixer's first pass over inputs that have no sidecar.
+inline void fillEventSummary(const HepMC3::GenEvent& evt, double minMuonPt, double maxMuonEta,
+                             EventSummary& summary) {
+    summary.weight = evt.weights().size() > 0 ? evt.weights()[0] : 1.0;
+    summary.nRetries = 0;
+    summary.retryCorrection = 0;
+    fillSummaryFromView(HepMC3EventView(evt), minMuonPt, maxMuonEta, summary);
+}
+
+#endif // HEPMC_CONVERT_H
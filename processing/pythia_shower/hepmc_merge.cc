@@ -0,0 +1,605 @@
+// ==============================================================================
+// hepmc_merge.cc - Streaming k-way merge of sharded HepMC outputs
+// ==============================================================================
+// Forked (--workers), range-split (LHE ledger, event slices) or otherwise
+// sharded shower and mixer runs leave one event file per shard. hepmc_merge
+// combines N shards into one ordered stream for GEN-SIM:
+//
+// - Formats: HepMC3 ASCII, HepMC2 ASCII (IO_GenEvent) or binary .hepb, all
+//   shards in the same one; ASCII may be block-compressed (.zst/.lz4) on
+//   either side. The output has the format of the shards.
+// - Events are copied as raw text blocks / binary frames: only the E line (or
+//   frame header) and the cross-section line are touched, no event is parsed
+//   into an object graph. Memory holds one event per shard, whatever the
+//   number of events.
+// - Order: a k-way merge (min-heap over the shard heads) by event number, by
+//   provenance (the source event numbers of the .mixprov side table for mixer
+//   shards, the LHE event index of the .evsum sidecar for shower shards) or
+//   in input order. Shards must be ordered by the key themselves, as every
+//   shower and mixer output is; a shard that is not gets a warning.
+// - Output events are renumbered consecutively (--first-number, default 0)
+//   unless --keep-numbers.
+// - Header: that of the first shard, plus the tool lines (T) of the others;
+//   shards with different weight names (W in the HepMC3 run info) are refused.
+// - Cross section: the last estimate of every shard (GenCrossSection
+//   attribute, HepMC2 C line), read from its last event, is combined into the
+//   mean weighted by the accepted events, sigma = sum n_k sigma_k / sum n_k,
+//   and written into every output event. Binary shards carry none.
+// - Sidecars: the output gets an .evsum when every shard has one and a
+//   .mixprov when every shard has one with the same inputs, with offsets and
+//   indices rewritten for the merged file.
+//
+// Needs zstd/lz4 (block_compress.h), no HepMC:
+//   g++ -std=c++17 -O2 hepmc_merge.cc -o hepmc_merge -lzstd -llz4 -pthread
+//
+// Usage:
+//   ./hepmc_merge merged.hepmc shower_1.w0.hepmc shower_1.w1.hepmc ...
+//   ./hepmc_merge mixed.hepmc mix_0.hepmc mix_1.hepmc --order provenance
+// ==============================================================================
+
+#include "block_compress.h"
+#include "event_summary.h"
+#include "hepmc_binary.h"
+#include "mix_provenance.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum class ShardFormat { kHepMC3, kHepMC2, kBinary };
+enum class MergeOrder { kNumber, kProvenance, kInput };
+
+// Window searched for the last cross-section line when a shard has no sidecar
+const uint64_t kTailBytes = 4 << 20;
+
+void printUsage(const char* progName) {
+    cerr << "\n=== HepMC Shard Merge ===" << endl;
+    cerr << "Usage: " << progName << " output shard1 [shard2 ...] [options]" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --order KEY        : number (event number, default), provenance (.mixprov source" << endl;
+    cerr << "                       events or .evsum LHE index), input (shards in the order given)" << endl;
+    cerr << "  --first-number N   : Number of the first output event (default: 0)" << endl;
+    cerr << "  --keep-numbers     : Keep the event numbers of the shards" << endl;
+    cerr << "  --no-sidecars      : Do not merge the .evsum / .mixprov sidecars" << endl;
+    cerr << "  --threads N        : Compression threads of the output (default: "
+         << kDefaultCompressionThreads << ")" << endl;
+    cerr << "\nAll shards must share one format (HepMC3, HepMC2 or .hepb); the output has" << endl;
+    cerr << "that format, ASCII block-compressed if its name ends in .zst/.lz4." << endl;
+}
+
+inline bool startsWith(const string& s, const char* prefix) {
+    return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// Cross-section values of a GenCrossSection attribute / HepMC2 C line:
+// sigma_0 err_0 [nAccepted nAttempted [sigma_i err_i ...]] (HepMC3), sigma err (HepMC2)
+struct CrossSection {
+    vector<double> values;
+    bool found() const { return values.size() >= 2; }
+};
+
+// Offset of the values in a cross-section line, npos if the line is none
+size_t crossSectionValues(const string& line, ShardFormat format) {
+    if (format == ShardFormat::kHepMC2) return startsWith(line, "C ") ? 2 : string::npos;
+    if (!startsWith(line, "A ")) return string::npos;
+    size_t pos = line.find(" GenCrossSection ");
+    return pos == string::npos ? string::npos : pos + 17;
+}
+
+CrossSection parseCrossSection(const string& line, size_t valuesPos) {
+    CrossSection xs;
+    const char* p = line.c_str() + valuesPos;
+    char* end;
+    for (double v = strtod(p, &end); end != p; v = strtod(p, &end)) {
+        xs.values.push_back(v);
+        p = end;
+    }
+    return xs;
+}
+
+// ------------------------------------------------------------------------------
+// One input shard
+// ------------------------------------------------------------------------------
+
+class Shard {
+public:
+    string file;
+    ShardFormat format = ShardFormat::kHepMC3;
+    string header;               // ASCII lines before the first event
+    bool hasEvents = false;
+
+    // Current event: text block (ASCII) or frame payload (binary)
+    string text;
+    vector<char> payload;
+    int64_t number = 0;
+    size_t lineEnd = 0;          // end of the E line in text
+    size_t xsBegin = string::npos, xsEnd = 0;   // values of the cross-section line in text
+    vector<int64_t> key;
+    uint64_t index = 0;          // events read so far (the current one is index - 1)
+
+    SummaryFile summary;
+    ProvenanceFile provenance;
+    MixProvenance record;        // .mixprov record of the current event
+    bool hasSummary = false, hasProvenance = false;
+    bool unordered = false;
+    bool failed = false;         // stopped on a corrupt event or missing provenance
+
+    bool open(const string& path, ShardFormat fmt, MergeOrder order, bool sidecars) {
+        file = path;
+        format = fmt;
+        m_order = order;
+        hasSummary = (sidecars || order == MergeOrder::kProvenance) && summary.open(summaryPathFor(file));
+        hasProvenance = (sidecars || order == MergeOrder::kProvenance) && provenance.open(provenancePathFor(file));
+        if (!m_in.open(file, 1)) return false;
+
+        if (format == ShardFormat::kBinary) {
+            char fileHeader[4 + 3 * sizeof(uint32_t)];
+            return m_in.read(fileHeader, sizeof(fileHeader)) && memcmp(fileHeader, kBinaryFileMagic, 4) == 0;
+        }
+        // Preamble up to the first E line, which stays pending
+        while (getline(m_in, m_line)) {
+            if (startsWith(m_line, "E ")) {
+                m_pending = true;
+                hasEvents = true;
+                break;
+            }
+            if (isEndOfListing(m_line)) break;
+            header += m_line;
+            header += '\n';
+        }
+        return true;
+    }
+
+    // Loads the next event; false at the end of the shard
+    bool next() {
+        if (format == ShardFormat::kBinary) {
+            uint32_t frame[2];
+            if (!m_in.read((char*)frame, sizeof(frame)) || !m_in.read((char*)&number, sizeof(number))) return false;
+            if (frame[0] != kBinaryFrameMagic) {
+                cerr << "Error: Corrupt frame in " << file << " after event " << index << endl;
+                return fail();
+            }
+            payload.resize(frame[1]);
+            if (frame[1] > 0 && !m_in.read(payload.data(), frame[1])) {
+                cerr << "Error: Truncated frame in " << file << " after event " << index << endl;
+                return fail();
+            }
+        } else {
+            if (!m_pending) return false;
+            text.clear();
+            text += m_line;
+            text += '\n';
+            lineEnd = m_line.size();
+            number = atoll(m_line.c_str() + 2);
+            xsBegin = string::npos;
+            m_pending = false;
+            while (getline(m_in, m_line)) {
+                if (startsWith(m_line, "E ")) {
+                    m_pending = true;
+                    break;
+                }
+                if (isEndOfListing(m_line)) break;
+                size_t values = crossSectionValues(m_line, format);
+                if (values != string::npos) {
+                    xsBegin = text.size() + values;
+                    xsEnd = text.size() + m_line.size();
+                }
+                text += m_line;
+                text += '\n';
+            }
+        }
+        ++index;
+        return updateKey();
+    }
+
+private:
+    bool fail() {
+        failed = true;
+        return false;
+    }
+
+    bool isEndOfListing(const string& line) const {
+        return startsWith(line, "HepMC::Asciiv3-END_EVENT_LISTING") || startsWith(line, "HepMC::IO_GenEvent-END_EVENT_LISTING");
+    }
+
+    // Merge key of the current event; in input order the key is empty and the
+    // shard index alone decides
+    bool updateKey() {
+        if (hasProvenance && !provenance.next(record)) {
+            cerr << "Warning: " << provenancePathFor(file) << " has fewer records than events" << endl;
+            hasProvenance = false;
+            if (m_order == MergeOrder::kProvenance) return fail();
+        }
+        vector<int64_t> previous;
+        previous.swap(key);
+        if (m_order == MergeOrder::kNumber) {
+            key.push_back(number);
+        } else if (m_order == MergeOrder::kProvenance) {
+            if (hasProvenance) {
+                for (const ProvenanceSource& s : record.sources) key.push_back(s.eventNumber);
+            } else if (hasSummary && index <= summary.size()) {
+                key.push_back(summary[index - 1].lheIndex);
+            } else {
+                cerr << "Error: No provenance (.mixprov or .evsum) for event " << index - 1 << " of " << file << endl;
+                return fail();
+            }
+        }
+        if (!previous.empty() && key < previous && !unordered) {
+            unordered = true;
+            cerr << "Warning: " << file << " is not ordered by the merge key (event " << index - 1
+                 << "); the output is merged, not sorted" << endl;
+        }
+        return true;
+    }
+
+    MergeOrder m_order = MergeOrder::kNumber;
+    EventInputStream m_in;
+    string m_line;
+    bool m_pending = false;
+};
+
+// ------------------------------------------------------------------------------
+// Header and cross section
+// ------------------------------------------------------------------------------
+
+// Header of the first shard with events, with the tool lines (T) of all shards;
+// false if the weight names (W) differ
+bool mergeHeaders(const vector<unique_ptr<Shard>>& shards, string& header) {
+    const Shard* first = shards[0].get();
+    for (const auto& shard : shards) {
+        if (shard->hasEvents) {
+            first = shard.get();
+            break;
+        }
+    }
+    auto linesOf = [](const string& text, const char* prefix) {
+        vector<string> lines;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find('\n', pos);
+            if (end == string::npos) end = text.size();
+            string line = text.substr(pos, end - pos);
+            if (startsWith(line, prefix)) lines.push_back(line);
+            pos = end + 1;
+        }
+        return lines;
+    };
+
+    header = first->header;
+    vector<string> names = linesOf(first->header, "W ");
+    vector<string> tools = linesOf(first->header, "T ");
+    for (const auto& shard : shards) {
+        if (!shard->hasEvents || shard.get() == first) continue;
+        if (linesOf(shard->header, "W ") != names) {
+            cerr << "Error: Weight names of " << shard->file << " differ from " << first->file << endl;
+            return false;
+        }
+        for (const string& tool : linesOf(shard->header, "T ")) {
+            if (find(tools.begin(), tools.end(), tool) != tools.end()) continue;
+            tools.push_back(tool);
+            header += tool + "\n";
+        }
+    }
+    return true;
+}
+
+// Last cross-section estimate of an ASCII shard, read from its last event
+// (sidecar offset) or the last kTailBytes of the file
+CrossSection lastCrossSection(const Shard& shard) {
+    CrossSection xs;
+    EventInputStream in;
+    if (!in.open(shard.file, 0)) return xs;
+    uint64_t start = 0;
+    if (shard.hasSummary && shard.summary.size() > 0) {
+        start = shard.summary[shard.summary.size() - 1].hepmcOffset;
+    } else {
+        in.seekg(0, ios::end);
+        uint64_t size = (uint64_t)in.tellg();
+        start = size > kTailBytes ? size - kTailBytes : 0;
+    }
+    in.seekg((streamoff)start);
+    string line;
+    while (getline(in, line)) {
+        size_t values = crossSectionValues(line, shard.format);
+        if (values != string::npos) xs = parseCrossSection(line, values);
+    }
+    return xs;
+}
+
+// Combined estimate: values weighted by the accepted events of each shard
+// (nAccepted of the GenCrossSection, else the sidecar's event count, else 1);
+// errors added in quadrature with the same weights, counts summed (-1 if any
+// shard's count is unknown)
+bool combineCrossSections(const vector<unique_ptr<Shard>>& shards, CrossSection& combined) {
+    vector<CrossSection> parts;
+    vector<double> weights;
+    for (const auto& shard : shards) {
+        if (!shard->hasEvents) continue;
+        CrossSection xs = lastCrossSection(*shard);
+        if (!xs.found()) {
+            if (!parts.empty()) cerr << "Warning: no cross section in " << shard->file << ", not combined" << endl;
+            return false;
+        }
+        double n = 1.0;
+        if (shard->format == ShardFormat::kHepMC3 && xs.values.size() >= 4 && xs.values[2] > 0) n = xs.values[2];
+        else if (shard->hasSummary && shard->summary.size() > 0) n = shard->summary.size();
+        parts.push_back(xs);
+        weights.push_back(n);
+    }
+    if (parts.empty()) return false;
+
+    size_t nValues = parts[0].values.size();
+    for (const auto& xs : parts) nValues = min(nValues, xs.values.size());
+    double total = 0.0;
+    for (double n : weights) total += n;
+    combined.values.assign(nValues, 0.0);
+    for (size_t v = 0; v < nValues; ++v) {
+        // HepMC3: sigma_0 err_0 nAccepted nAttempted sigma_1 err_1 ...; HepMC2: sigma err
+        bool hepmc3 = shards[0]->format == ShardFormat::kHepMC3;
+        bool count = hepmc3 && (v == 2 || v == 3);
+        bool error = hepmc3 && v > 3 ? (v % 2 == 1) : v == 1;
+        double sum = 0.0;
+        for (size_t k = 0; k < parts.size(); ++k) {
+            double x = parts[k].values[v];
+            if (count) sum = (sum < 0 || x < 0) ? -1.0 : sum + x;
+            else if (error) sum += (weights[k] * x) * (weights[k] * x);
+            else sum += weights[k] * x;
+        }
+        combined.values[v] = count ? sum : (error ? sqrt(sum) / total : sum / total);
+    }
+    return true;
+}
+
+string formatCrossSection(const CrossSection& xs, ShardFormat format) {
+    string text;
+    char buffer[32];
+    for (size_t v = 0; v < xs.values.size(); ++v) {
+        if (format == ShardFormat::kHepMC3 && (v == 2 || v == 3)) snprintf(buffer, sizeof(buffer), "%lld", (long long)llround(xs.values[v]));
+        else snprintf(buffer, sizeof(buffer), "%.8e", xs.values[v]);
+        if (v > 0) text += ' ';
+        text += buffer;
+    }
+    return text;
+}
+
+// ------------------------------------------------------------------------------
+// Main
+// ------------------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+    string outputFile;
+    vector<string> inputs;
+    MergeOrder order = MergeOrder::kNumber;
+    int64_t firstNumber = 0;
+    bool keepNumbers = false;
+    bool sidecars = true;
+    int nThreads = kDefaultCompressionThreads;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--order" && i + 1 < argc) {
+            string key = argv[++i];
+            if (key == "number") order = MergeOrder::kNumber;
+            else if (key == "provenance") order = MergeOrder::kProvenance;
+            else if (key == "input") order = MergeOrder::kInput;
+            else {
+                cerr << "Error: Unknown order: " << key << endl;
+                return 1;
+            }
+        } else if (arg == "--first-number" && i + 1 < argc) {
+            firstNumber = atoll(argv[++i]);
+        } else if (arg == "--keep-numbers") {
+            keepNumbers = true;
+        } else if (arg == "--no-sidecars") {
+            sidecars = false;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            nThreads = max(0, atoi(argv[++i]));
+        } else if (arg == "-h" || arg == "--help" || arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 1;
+        } else if (outputFile.empty()) {
+            outputFile = arg;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (outputFile.empty() || inputs.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Format of the shards: .hepb by name, ASCII by the listing header
+    ShardFormat format = isBinaryEventFile(inputs[0]) ? ShardFormat::kBinary : ShardFormat::kHepMC3;
+    vector<unique_ptr<Shard>> shards;
+    for (const auto& input : inputs) {
+        ShardFormat fmt = ShardFormat::kBinary;
+        if (!isBinaryEventFile(input)) {
+            EventInputStream probe;
+            string line;
+            fmt = ShardFormat::kHepMC3;
+            if (probe.open(input, 0)) {
+                for (int n = 0; n < 5 && getline(probe, line); ++n) {
+                    if (line.find("IO_GenEvent") != string::npos) fmt = ShardFormat::kHepMC2;
+                }
+            }
+        }
+        if (shards.empty()) format = fmt;
+        if (fmt != format) {
+            cerr << "Error: " << input << " has a different format than " << inputs[0] << endl;
+            return 1;
+        }
+        unique_ptr<Shard> shard(new Shard());
+        if (!shard->open(input, fmt, order, sidecars)) {
+            cerr << "Error: Cannot open shard: " << input << endl;
+            return 1;
+        }
+        shards.push_back(move(shard));
+    }
+    if ((format == ShardFormat::kBinary) != isBinaryEventFile(outputFile)) {
+        cerr << "Error: Output " << outputFile << " must have the format of the shards ("
+             << (format == ShardFormat::kBinary ? ".hepb" : "ASCII") << ")" << endl;
+        return 1;
+    }
+
+    string header;
+    CrossSection xs;
+    bool haveXs = false;
+    if (format != ShardFormat::kBinary) {
+        if (!mergeHeaders(shards, header)) return 1;
+        haveXs = combineCrossSections(shards, xs);
+    }
+    string xsText = haveXs ? formatCrossSection(xs, format) : "";
+
+    // Sidecars of the output: only when every shard has one
+    bool writeSummary = sidecars, writeProvenance = sidecars;
+    for (const auto& shard : shards) {
+        writeSummary = writeSummary && shard->hasSummary;
+        writeProvenance = writeProvenance && shard->hasProvenance
+                       && shard->provenance.nSources() == shards[0]->provenance.nSources();
+        for (size_t s = 0; writeProvenance && s < shard->provenance.nSources(); ++s) {
+            writeProvenance = shard->provenance.sourceName(s) == shards[0]->provenance.sourceName(s);
+        }
+    }
+    if (sidecars && shards[0]->hasProvenance && !writeProvenance) {
+        cerr << "Warning: the shards' .mixprov tables have different inputs; no merged side table" << endl;
+    }
+
+    EventOutputStream out;
+    if (!out.open(outputFile, nThreads)) {
+        cerr << "Error: Cannot open output file: " << outputFile << endl;
+        return 1;
+    }
+    SummaryWriter summaryOut;
+    if (writeSummary && !summaryOut.open(summaryPathFor(outputFile), shards[0]->summary.mode())) {
+        cerr << "Error: Cannot open " << summaryPathFor(outputFile) << endl;
+        return 1;
+    }
+    ProvenanceWriter provenanceOut;
+    if (writeProvenance) {
+        vector<string> names;
+        for (size_t s = 0; s < shards[0]->provenance.nSources(); ++s) names.push_back(shards[0]->provenance.sourceName(s));
+        if (!provenanceOut.open(provenancePathFor(outputFile), names)) {
+            cerr << "Error: Cannot open " << provenancePathFor(outputFile) << endl;
+            return 1;
+        }
+    }
+
+    auto t0 = chrono::steady_clock::now();
+    uint64_t outPos = 0;
+    if (format == ShardFormat::kBinary) {
+        writeBinaryFileHeader(out);
+        outPos = 4 + 3 * sizeof(uint32_t);
+    } else {
+        out << header;
+        outPos = header.size();
+    }
+
+    // Min-heap of shard heads by (key, shard index)
+    auto later = [&](size_t a, size_t b) {
+        if (shards[a]->key != shards[b]->key) return shards[b]->key < shards[a]->key;
+        return b < a;
+    };
+    priority_queue<size_t, vector<size_t>, decltype(later)> heads(later);
+    for (size_t k = 0; k < shards.size(); ++k) {
+        if (shards[k]->next()) heads.push(k);
+    }
+
+    uint64_t nOut = 0;
+    vector<uint64_t> perShard(shards.size(), 0);
+    string numberText;
+    while (!heads.empty()) {
+        size_t k = heads.top();
+        heads.pop();
+        Shard& shard = *shards[k];
+        int64_t number = keepNumbers ? shard.number : firstNumber + (int64_t)nOut;
+        uint64_t eventPos = outPos;
+
+        if (format == ShardFormat::kBinary) {
+            uint32_t frame[2] = {kBinaryFrameMagic, (uint32_t)shard.payload.size()};
+            out.write((const char*)frame, sizeof(frame));
+            out.write((const char*)&number, sizeof(number));
+            out.write(shard.payload.data(), shard.payload.size());
+            outPos += sizeof(frame) + sizeof(number) + shard.payload.size();
+        } else {
+            // "E <number> ..." with the new number, the cross-section values replaced
+            size_t numberEnd = shard.text.find(' ', 2);
+            if (numberEnd == string::npos || numberEnd > shard.lineEnd) numberEnd = shard.lineEnd;
+            numberText = "E " + to_string(number);
+            out << numberText;
+            outPos += numberText.size();
+            const string& t = shard.text;
+            if (haveXs && shard.xsBegin != string::npos) {
+                out.write(t.data() + numberEnd, shard.xsBegin - numberEnd);
+                out << xsText;
+                out.write(t.data() + shard.xsEnd, t.size() - shard.xsEnd);
+                outPos += (shard.xsBegin - numberEnd) + xsText.size() + (t.size() - shard.xsEnd);
+            } else {
+                out.write(t.data() + numberEnd, t.size() - numberEnd);
+                outPos += t.size() - numberEnd;
+            }
+        }
+
+        if (writeSummary) {
+            if (shard.index > shard.summary.size()) {
+                cerr << "Error: " << summaryPathFor(shard.file) << " has fewer records than events" << endl;
+                return 1;
+            }
+            EventSummary record = shard.summary[shard.index - 1];
+            record.hepmcOffset = eventPos;
+            record.eventIndex = (uint32_t)nOut;
+            summaryOut.write(record);
+        }
+        if (writeProvenance) {
+            if (!shard.hasProvenance) {
+                cerr << "Error: " << provenancePathFor(shard.file) << " has fewer records than events" << endl;
+                return 1;
+            }
+            shard.record.eventNumber = number;
+            provenanceOut.write(shard.record);
+        }
+        ++nOut;
+        ++perShard[k];
+
+        if (shard.next()) heads.push(k);
+    }
+
+    for (const auto& shard : shards) {
+        if (shard->failed) {
+            cerr << "Error: Merge stopped early on " << shard->file << endl;
+            return 1;
+        }
+    }
+
+    if (format == ShardFormat::kHepMC3) out << "HepMC::Asciiv3-END_EVENT_LISTING\n\n";
+    else if (format == ShardFormat::kHepMC2) out << "HepMC::IO_GenEvent-END_EVENT_LISTING\n";
+    bool ok = out.close();
+    summaryOut.close();
+    provenanceOut.close();
+    if (!ok) {
+        cerr << "Error: Cannot write output file: " << outputFile << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    cout << "\n=== HepMC Shard Merge ===" << endl;
+    for (size_t k = 0; k < shards.size(); ++k) {
+        cout << "  " << shards[k]->file << ": " << perShard[k] << " events"
+             << (shards[k]->unordered ? " (not ordered by the key)" : "") << endl;
+    }
+    cout << "Events merged:  " << nOut << " -> " << outputFile << endl;
+    if (haveXs) cout << "Cross section:  " << xsText << " (combined over " << shards.size() << " shards)" << endl;
+    if (writeSummary) cout << "Summary:        " << summaryPathFor(outputFile) << endl;
+    if (writeProvenance) cout << "Provenance:     " << provenancePathFor(outputFile) << endl;
+    cout << "Time:           " << seconds << " s, " << out.rawBytes() / 1e6 / max(seconds, 1e-9) << " MB/s" << endl;
+    return 0;
+}
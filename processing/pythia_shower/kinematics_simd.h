@@ -0,0 +1,179 @@
+// ==============================================================================
+// kinematics_simd.h - Batch pT/eta/phi and acceptance cuts on momentum arrays
+// ==============================================================================
+// Kernels over structure-of-arrays four-momenta (flat_event.h):
+//
+//   batchKinematics : pT, eta and phi for whole px/py/pz arrays
+//   batchAcceptance : pT > min && |eta| < max mask for whole arrays
+//   forEachPidInRange : indices whose |pid| is in a range (selection prefilter)
+//
+// plus AcceptanceCut, the same cut for single particles. Cuts are evaluated
+// on momentum components without sqrt/log:
+//
+//   pT > a    <=>  px^2 + py^2 > a^2                         (a >= 0)
+//   |eta| < b <=>  pz^2 < sinh(b)^2 (px^2 + py^2)            (b > 0)
+//
+// so particles with pT = 0 count as |eta| = infinity.
+//
+// The vector paths (kinematics_simd_isa.h) are compiled for AVX-512 and AVX2
+// with #pragma GCC target and chosen at run time with __builtin_cpu_supports,
+// so a portable build (the Makefile default) uses them on any worker that has
+// them; other CPUs get the path of the compiler flags (scalar libm unless
+// SIMD_FLAGS says otherwise).
+// log and atan use the Cephes rational approximations; eta and phi agree
+// with libm to a few 1e-16 (bench_kernels checks this on every run).
+//
+// Header-only, no external dependencies.
+// ==============================================================================
+
+#ifndef KINEMATICS_SIMD_H
+#define KINEMATICS_SIMD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// Run-time choice of the AVX2/AVX-512 paths (GCC on x86-64); elsewhere only
+// the instruction set of the compiler flags is used
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define KINEMATICS_DISPATCH
+#endif
+
+#if defined(KINEMATICS_DISPATCH) || defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// GCC 12 reports the _mm512_undefined_* placeholders of its own intrinsics as
+// maybe-uninitialized once they are inlined here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// ------------------------------------------------------------------------------
+// Scalar reference
+// ------------------------------------------------------------------------------
+
+inline double scalarPt(double px, double py) {
+    return std::sqrt(px * px + py * py);
+}
+
+// Pseudorapidity; along the beam +-1e10 (0 for a null momentum)
+inline double scalarEta(double px, double py, double pz) {
+    double pt = scalarPt(px, py);
+    if (pt > 0.0) return std::asinh(pz / pt);
+    return pz == 0.0 ? 0.0 : std::copysign(1e10, pz);
+}
+
+struct AcceptanceCut {
+    double minPt2;   // px^2 + py^2 must exceed this
+    double sinh2;    // pz^2 must stay below sinh2 * pT^2
+
+    AcceptanceCut(double minPt, double maxAbsEta) {
+        double s = std::sinh(maxAbsEta);
+        minPt2 = minPt < 0.0 ? -1.0 : minPt * minPt;
+        sinh2 = maxAbsEta > 0.0 ? s * s : -1.0;
+    }
+
+    bool pass(double px, double py, double pz) const {
+        double pt2 = px * px + py * py;
+        return pt2 > minPt2 && pz * pz < sinh2 * pt2;
+    }
+};
+
+// ------------------------------------------------------------------------------
+// Vector paths, one namespace per instruction set (kinematics_simd_isa.h)
+// ------------------------------------------------------------------------------
+
+// Built for the instruction set of the compiler flags (scalar by default)
+namespace kinematics_build {
+#include "kinematics_simd_isa.h"
+}
+
+#if defined(KINEMATICS_DISPATCH)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+namespace kinematics_avx2 {
+#include "kinematics_simd_isa.h"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+namespace kinematics_avx512 {
+#include "kinematics_simd_isa.h"
+}
+#pragma GCC pop_options
+#endif
+
+enum KinematicsPath { kKinematicsBuild = 0, kKinematicsAvx2, kKinematicsAvx512 };
+
+// Vector path for this CPU, decided once
+inline int kinematicsPath() {
+    static const int path = [] {
+#if defined(KINEMATICS_DISPATCH)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return (int)kKinematicsAvx512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return (int)kKinematicsAvx2;
+#endif
+        return (int)kKinematicsBuild;
+    }();
+    return path;
+}
+
+// Instruction set of the vector paths on this CPU
+inline const char* kinematicsIsa() {
+    switch (kinematicsPath()) {
+    case kKinematicsAvx512: return "avx512";
+    case kKinematicsAvx2: return "avx2";
+    default: return kinematics_build::kIsa;
+    }
+}
+
+// ------------------------------------------------------------------------------
+// Batch kernels
+// ------------------------------------------------------------------------------
+
+// pt/eta/phi may be null to skip that output
+inline void batchKinematics(const double* px, const double* py, const double* pz, size_t n,
+                            double* pt, double* eta, double* phi) {
+#if defined(KINEMATICS_DISPATCH)
+    switch (kinematicsPath()) {
+    case kKinematicsAvx512: return kinematics_avx512::batchKinematics(px, py, pz, n, pt, eta, phi);
+    case kKinematicsAvx2: return kinematics_avx2::batchKinematics(px, py, pz, n, pt, eta, phi);
+    }
+#endif
+    kinematics_build::batchKinematics(px, py, pz, n, pt, eta, phi);
+}
+
+// pass[i] = 1 if particle i passes the cut, else 0
+inline void batchAcceptance(const double* px, const double* py, const double* pz, size_t n,
+                            const AcceptanceCut& cut, uint8_t* pass) {
+#if defined(KINEMATICS_DISPATCH)
+    switch (kinematicsPath()) {
+    case kKinematicsAvx512: return kinematics_avx512::batchAcceptance(px, py, pz, n, cut, pass);
+    case kKinematicsAvx2: return kinematics_avx2::batchAcceptance(px, py, pz, n, cut, pass);
+    }
+#endif
+    kinematics_build::batchAcceptance(px, py, pz, n, cut, pass);
+}
+
+// Calls f(i) for every i with minAbs <= |pid[i]| <= maxAbs, in order. The
+// scan is vectorized; only the (rare) matches reach the callback.
+template <class F>
+inline void forEachPidInRange(const int32_t* pid, size_t n, int minAbs, int maxAbs, F&& f) {
+#if defined(KINEMATICS_DISPATCH)
+    switch (kinematicsPath()) {
+    case kKinematicsAvx512: return kinematics_avx512::forEachPidInRange(pid, n, minAbs, maxAbs, f);
+    case kKinematicsAvx2: return kinematics_avx2::forEachPidInRange(pid, n, minAbs, maxAbs, f);
+    }
+#endif
+    kinematics_build::forEachPidInRange(pid, n, minAbs, maxAbs, f);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // KINEMATICS_SIMD_H
@@ -0,0 +1,268 @@
+// ==============================================================================
+// kinematics_simd_isa.h - Vector paths of kinematics_simd.h for one instruction set
+// ==============================================================================
+// Included by kinematics_simd.h only, once per instruction set, inside its own
+// namespace and #pragma GCC target region; the __AVX512F__ / __AVX2__ macros
+// of that region select the vector code. No include guard and no #include on
+// purpose.
+// ==============================================================================
+
+// Instruction set of this copy
+#if defined(__AVX512F__)
+const char* const kIsa = "avx512";
+#elif defined(__AVX2__)
+const char* const kIsa = "avx2";
+#else
+const char* const kIsa = "scalar";
+#endif
+
+// ------------------------------------------------------------------------------
+// Vector operations
+// ------------------------------------------------------------------------------
+
+#if defined(__AVX512F__)
+struct SimdOps {
+    typedef __m512d V;
+    typedef __mmask8 M;
+    static const int kWidth = 8;
+
+    static V load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, V v) { _mm512_storeu_pd(p, v); }
+    static V set1(double x) { return _mm512_set1_pd(x); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm512_div_pd(a, b); }
+    static V sqrt(V a) { return _mm512_sqrt_pd(a); }
+    static V madd(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+    static V abs(V a) { return _mm512_abs_pd(a); }
+    static V copysign(V mag, V sgn) {
+        __m512i sign = _mm512_set1_epi64(INT64_MIN);
+        return _mm512_castsi512_pd(_mm512_or_si512(
+            _mm512_andnot_si512(sign, _mm512_castpd_si512(mag)),
+            _mm512_and_si512(sign, _mm512_castpd_si512(sgn))));
+    }
+    static M lt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static M eq(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static M both(M a, M b) { return a & b; }
+    static V select(M m, V a, V b) { return _mm512_mask_blend_pd(m, b, a); }
+    static unsigned bits(M m) { return m; }
+
+    // x = m * 2^e with m in [0.5, 1), for positive normal x
+    static V frexp(V x, V& e) {
+        __m512i b = _mm512_castpd_si512(x);
+        __m512i expo = _mm512_srli_epi64(b, 52);
+        __m512i two52 = _mm512_castpd_si512(_mm512_set1_pd(4503599627370496.0));
+        e = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(expo, two52)),
+                          _mm512_set1_pd(4503599627370496.0 + 1022.0));
+        __m512i mant = _mm512_or_si512(_mm512_and_si512(b, _mm512_set1_epi64(0x000FFFFFFFFFFFFFLL)),
+                                       _mm512_set1_epi64(0x3FE0000000000000LL));
+        return _mm512_castsi512_pd(mant);
+    }
+};
+#elif defined(__AVX2__)
+struct SimdOps {
+    typedef __m256d V;
+    typedef __m256d M;      // all-ones lanes
+    static const int kWidth = 4;
+
+    static V load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+    static V set1(double x) { return _mm256_set1_pd(x); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+#if defined(__FMA__)
+    static V madd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+    static V madd(V a, V b, V c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+    static V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static V copysign(V mag, V sgn) {
+        V sign = _mm256_set1_pd(-0.0);
+        return _mm256_or_pd(_mm256_andnot_pd(sign, mag), _mm256_and_pd(sign, sgn));
+    }
+    static M lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static M eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static M both(M a, M b) { return _mm256_and_pd(a, b); }
+    static V select(M m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+    static unsigned bits(M m) { return _mm256_movemask_pd(m); }
+
+    // x = m * 2^e with m in [0.5, 1), for positive normal x
+    static V frexp(V x, V& e) {
+        __m256i b = _mm256_castpd_si256(x);
+        __m256i expo = _mm256_srli_epi64(b, 52);
+        __m256i two52 = _mm256_castpd_si256(_mm256_set1_pd(4503599627370496.0));
+        e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(expo, two52)),
+                          _mm256_set1_pd(4503599627370496.0 + 1022.0));
+        __m256i mant = _mm256_or_si256(_mm256_and_si256(b, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                       _mm256_set1_epi64x(0x3FE0000000000000LL));
+        return _mm256_castsi256_pd(mant);
+    }
+};
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+// log for x >= 1 and atan2, after Cephes log.c / atan.c
+struct SimdMath {
+    typedef SimdOps O;
+    typedef O::V V;
+    typedef O::M M;
+
+    template <int N>
+    static V poly(V x, const double (&c)[N]) {
+        V r = O::set1(c[0]);
+        for (int k = 1; k < N; ++k) r = O::madd(r, x, O::set1(c[k]));
+        return r;
+    }
+
+    // Leading coefficient 1 implied
+    template <int N>
+    static V poly1(V x, const double (&c)[N]) {
+        V r = O::add(x, O::set1(c[0]));
+        for (int k = 1; k < N; ++k) r = O::madd(r, x, O::set1(c[k]));
+        return r;
+    }
+
+    static V log(V x) {
+        static const double P[] = {1.01875663804580931796E-4, 4.97494994976747001425E-1,
+                                   4.70579119878881725854E0, 1.44989225341610930846E1,
+                                   1.79368678507819816313E1, 7.70838733755885391666E0};
+        static const double Q[] = {1.12873587189167450590E1, 4.52279145837532221105E1,
+                                   8.29875266912776603211E1, 7.11544750618563894466E1,
+                                   2.31251620126765340583E1};
+        const V one = O::set1(1.0);
+        V e;
+        V m = O::frexp(x, e);
+        M small = O::lt(m, O::set1(0.70710678118654752440));
+        e = O::select(small, O::sub(e, one), e);
+        V t = O::sub(O::select(small, O::add(m, m), m), one);
+        V z = O::mul(t, t);
+        V y = O::mul(O::mul(t, z), O::div(poly(t, P), poly1(t, Q)));
+        y = O::madd(e, O::set1(-2.121944400546905827679e-4), y);
+        y = O::madd(z, O::set1(-0.5), y);
+        return O::madd(e, O::set1(0.693359375), O::add(t, y));
+    }
+
+    // atan for x >= 0
+    static V atan(V x) {
+        static const double P[] = {-8.750608600031904122785E-1, -1.615753718733365076637E1,
+                                   -7.500855792314704667340E1, -1.228866684490136173410E2,
+                                   -6.485021904942025371773E1};
+        static const double Q[] = {2.485846490142306297962E1, 1.650270098316988542046E2,
+                                   4.328810604912902668951E2, 4.853903996359136964868E2,
+                                   1.945506571482613964425E2};
+        const double moreBits = 6.123233995736765886130E-17;
+        const V one = O::set1(1.0);
+        M big = O::gt(x, O::set1(2.41421356237309504880));
+        M mid = O::gt(x, O::set1(0.66));
+        V y = O::select(big, O::set1(M_PI_2), O::select(mid, O::set1(M_PI_4), O::set1(0.0)));
+        V extra = O::select(big, O::set1(moreBits), O::select(mid, O::set1(0.5 * moreBits), O::set1(0.0)));
+        V r = O::select(big, O::div(O::set1(-1.0), x),
+                        O::select(mid, O::div(O::sub(x, one), O::add(x, one)), x));
+        V z = O::mul(r, r);
+        z = O::mul(z, O::div(poly(z, P), poly1(z, Q)));
+        z = O::madd(r, z, r);
+        return O::add(y, O::add(z, extra));
+    }
+
+    static V atan2(V y, V x) {
+        V ax = O::abs(x), ay = O::abs(y);
+        V a = atan(O::div(ay, ax));
+        a = O::select(O::both(O::eq(ax, O::set1(0.0)), O::eq(ay, O::set1(0.0))), O::set1(0.0), a);
+        a = O::select(O::lt(x, O::set1(0.0)), O::sub(O::set1(M_PI), a), a);
+        return O::copysign(a, y);
+    }
+};
+#endif
+
+// ------------------------------------------------------------------------------
+// Batch kernels
+// ------------------------------------------------------------------------------
+
+// pt/eta/phi may be null to skip that output
+inline void batchKinematics(const double* px, const double* py, const double* pz, size_t n,
+                            double* pt, double* eta, double* phi) {
+    size_t i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    typedef SimdOps O;
+    const size_t w = O::kWidth;
+    for (; i + w <= n; i += w) {
+        O::V x = O::load(px + i), y = O::load(py + i);
+        O::V t = O::sqrt(O::madd(x, x, O::mul(y, y)));
+        if (pt) O::store(pt + i, t);
+        if (eta) {
+            O::V z = O::load(pz + i);
+            O::V r = O::div(O::abs(z), t);
+            O::V s = O::add(r, O::sqrt(O::madd(r, r, O::set1(1.0))));
+            s = O::select(O::gt(r, O::set1(1e8)), O::add(r, r), s);   // r^2 would overflow
+            O::V v = O::copysign(SimdMath::log(s), z);
+            O::V zero = O::set1(0.0);
+            O::V beam = O::select(O::eq(z, zero), zero, O::copysign(O::set1(1e10), z));
+            O::store(eta + i, O::select(O::gt(t, zero), v, beam));
+        }
+        if (phi) O::store(phi + i, SimdMath::atan2(y, x));
+    }
+#endif
+    for (; i < n; ++i) {
+        if (pt) pt[i] = scalarPt(px[i], py[i]);
+        if (eta) eta[i] = scalarEta(px[i], py[i], pz[i]);
+        if (phi) phi[i] = std::atan2(py[i], px[i]);
+    }
+}
+
+// pass[i] = 1 if particle i passes the cut, else 0
+inline void batchAcceptance(const double* px, const double* py, const double* pz, size_t n,
+                            const AcceptanceCut& cut, uint8_t* pass) {
+    size_t i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    typedef SimdOps O;
+    const size_t w = O::kWidth;
+    const O::V minPt2 = O::set1(cut.minPt2), sinh2 = O::set1(cut.sinh2);
+    for (; i + w <= n; i += w) {
+        O::V x = O::load(px + i), y = O::load(py + i), z = O::load(pz + i);
+        O::V pt2 = O::madd(x, x, O::mul(y, y));
+        unsigned m = O::bits(O::both(O::gt(pt2, minPt2), O::lt(O::mul(z, z), O::mul(sinh2, pt2))));
+        for (size_t k = 0; k < w; ++k) pass[i + k] = (m >> k) & 1;
+    }
+#endif
+    for (; i < n; ++i) pass[i] = cut.pass(px[i], py[i], pz[i]);
+}
+
+// Calls f(i) for every i with minAbs <= |pid[i]| <= maxAbs, in order. The
+// scan is vectorized; only the (rare) matches reach the callback.
+template <class F>
+inline void forEachPidInRange(const int32_t* pid, size_t n, int minAbs, int maxAbs, F&& f) {
+    size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512i lo = _mm512_set1_epi32(minAbs), hi = _mm512_set1_epi32(maxAbs);
+    for (; i + 16 <= n; i += 16) {
+        __m512i a = _mm512_abs_epi32(_mm512_loadu_si512(pid + i));
+        unsigned m = _mm512_cmpge_epi32_mask(a, lo) & _mm512_cmple_epi32_mask(a, hi);
+        while (m) {
+            f((int)(i + __builtin_ctz(m)));
+            m &= m - 1;
+        }
+    }
+#elif defined(__AVX2__)
+    const __m256i lo = _mm256_set1_epi32(minAbs - 1), hi = _mm256_set1_epi32(maxAbs + 1);
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_abs_epi32(_mm256_loadu_si256((const __m256i*)(pid + i)));
+        __m256i in = _mm256_and_si256(_mm256_cmpgt_epi32(a, lo), _mm256_cmpgt_epi32(hi, a));
+        unsigned m = _mm256_movemask_ps(_mm256_castsi256_ps(in));
+        while (m) {
+            f((int)(i + __builtin_ctz(m)));
+            m &= m - 1;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        int a = std::abs(pid[i]);
+        if (a >= minAbs && a <= maxAbs) f((int)i);
+    }
+}
+
@@ -0,0 +1,533 @@
+// ==============================================================================
+// lhe_ledger.cc - Ledger of LHE event ranges handed out to shower jobs
+// ==============================================================================
+// run_chain.sh resolves pool:index inputs to files[index % n_files], so once a
+// pool has fewer files than jobs the same LHE events are showered again,
+// duplicating the work and correlating the samples. The ledger hands every
+// job a lease on an event range that no other job of the same ledger gets;
+// the shower programs process it with --skip and the event count.
+//
+// One ledger directory per (pool, shower mode). Each LHE file is cut into
+// chunks of a fixed number of events (set by the first claim, stored in
+// LEDGER/chunk). A claim leases exactly the events it asks for: whole free
+// chunks, plus the front of the last one, whose unused events are handed on as
+// a rest. All ledger files are created exclusively with their content (owner)
+// already in place, which is atomic on local and POSIX network filesystems, so
+// concurrent jobs never get overlapping events and no lock is needed:
+//
+//   LEDGER/<lhe file name>.<chunk>.lease         chunk taken
+//   LEDGER/<lhe file name>.<start>-<end>.rest    unused events [start, end)
+//   LEDGER/<lhe file name>.<start>-<end>.taken   rest taken
+//
+// If another job wins one of the pieces, the ones taken so far are removed
+// again and the search goes on. The claim is recorded in
+// LEDGER/owner_<owner>.claim before its first piece is taken, so a retried job
+// gets its original range back, and the pieces of a job that died while
+// claiming are finished or given back by its retry or its release. The events
+// per file are counted once (<event> tags) and cached in
+// LEDGER/<lhe file name>.events.
+//
+// No external dependencies:
+//   g++ -std=c++17 -O2 lhe_ledger.cc -o lhe_ledger
+//
+// Usage:
+//   ./lhe_ledger claim LEDGER --owner ID [--events N] [--chunk N] file.lhe [...]
+//   ./lhe_ledger status LEDGER [file.lhe ...]
+//   ./lhe_ledger release LEDGER --owner ID
+// ==============================================================================
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+void printUsage(const char* progName) {
+    cerr << "\n=== LHE Event Ledger ===" << endl;
+    cerr << "Usage: " << progName << " claim LEDGER --owner ID [--events N] [--chunk N] file.lhe [...]" << endl;
+    cerr << "       " << progName << " status LEDGER [file.lhe ...]" << endl;
+    cerr << "       " << progName << " release LEDGER --owner ID" << endl;
+    cerr << "\nCommands:" << endl;
+    cerr << "  claim    : Lease an unused event range of one of the files (in the order given)" << endl;
+    cerr << "             and print 'file skip count'; a repeated claim of the same owner" << endl;
+    cerr << "             prints its original range" << endl;
+    cerr << "  status   : Leased and free events per file" << endl;
+    cerr << "  release  : Return the range of an owner (e.g. a job that will not be retried," << endl;
+    cerr << "             or one that died while claiming)" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --owner ID  : Job identity, e.g. campaign/job/source" << endl;
+    cerr << "  --events N  : Events to lease, -1 = a whole unused file (default: -1)" << endl;
+    cerr << "  --chunk N   : Chunk size of a new ledger (default: 1000); a claim leases exactly" << endl;
+    cerr << "                N events, whole chunks plus part of the last one" << endl;
+    cerr << "\nA claim takes a shorter range (with a warning) when no full one is left." << endl;
+    cerr << "Exit codes: 0 = ok, 4 = no unused events left (claim), 1 = error" << endl;
+}
+
+// Events in an LHE file: number of <event> / <event ...> tags
+long countLheEvents(const string& file) {
+    FILE* f = fopen(file.c_str(), "rb");
+    if (!f) return -1;
+    static const char tag[] = "<event";
+    const size_t tagLen = sizeof(tag) - 1;
+    vector<char> buffer(1 << 20);
+    size_t carry = 0;
+    long n = 0;
+    size_t got;
+    while ((got = fread(buffer.data() + carry, 1, buffer.size() - carry, f)) > 0) {
+        size_t end = carry + got;
+        size_t i = 0;
+        for (; i + tagLen < end; ++i) {
+            if (buffer[i] == '<' && memcmp(&buffer[i], tag, tagLen) == 0) {
+                char next = buffer[i + tagLen];
+                if (next == '>' || next == ' ' || next == '\t' || next == '\n') ++n;
+            }
+        }
+        // Keep the tail that may hold a tag split across reads
+        carry = end - i;
+        memmove(buffer.data(), buffer.data() + i, carry);
+    }
+    fclose(f);
+    return n;
+}
+
+// Writes text to path through a temporary file and rename (readers never see a partial file)
+bool writeAtomic(const string& path, const string& text) {
+    string tmp = path + ".tmp." + to_string(getpid());
+    {
+        ofstream out(tmp);
+        if (!(out << text)) return false;
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+string readText(const string& path) {
+    ifstream in(path);
+    string text;
+    getline(in, text);
+    return text;
+}
+
+// Unused events [start, end) of a file: a chunk without a lease, or a rest
+struct FreePiece {
+    bool rest;
+    long chunk;
+    long start, end;
+};
+
+// Piece of a claim, of which the events [start, used) are showered
+struct ClaimPiece {
+    bool rest = false;
+    long chunk = 0;
+    long start = 0, end = 0, used = 0;
+};
+
+class Ledger {
+public:
+    explicit Ledger(const string& dir) : m_dir(dir) {}
+
+    static const long kDefaultChunk = 1000;
+
+    // Chunk size of the ledger; the first claim sets it (chunk, or kDefaultChunk
+    // if 0), status and release only read it
+    bool open(long chunk, bool create) {
+        error_code ec;
+        fs::create_directories(m_dir, ec);
+        string path = m_dir + "/chunk";
+        if (create) createExclusive(path, to_string(chunk > 0 ? chunk : kDefaultChunk));
+        m_chunk = atol(readText(path).c_str());
+        if (m_chunk <= 0) {
+            cerr << "Error: Ledger " << m_dir << " has no chunk size" << endl;
+            return false;
+        }
+        if (chunk > 0 && chunk != m_chunk) {
+            cerr << "Warning: ledger " << m_dir << " uses chunks of " << m_chunk << " events, not " << chunk << endl;
+        }
+        return true;
+    }
+
+    long chunk() const { return m_chunk; }
+
+    // Events of the file, counted once and cached in the ledger
+    long fileEvents(const string& file) {
+        string cache = m_dir + "/" + fs::path(file).filename().string() + ".events";
+        long n = atol(readText(cache).c_str());
+        if (n > 0) return n;
+        n = countLheEvents(file);
+        if (n > 0) writeAtomic(cache, to_string(n) + "\n");
+        return n;
+    }
+
+    // Unused events of the file in event order: chunks without a lease and
+    // rests without a taken marker
+    vector<FreePiece> freePieces(const string& file, long nEvents) const {
+        string prefix = fs::path(file).filename().string() + ".";
+        set<long> leased;
+        set<pair<long, long>> rests, taken;
+        error_code ec;
+        for (const auto& entry : fs::directory_iterator(m_dir, ec)) {
+            string name = entry.path().filename().string();
+            if (name.compare(0, prefix.size(), prefix) != 0) continue;
+            const char* tail = name.c_str() + prefix.size();
+            long a, b;
+            int end = -1;
+            if (sscanf(tail, "%ld.lease%n", &a, &end) == 1 && tail[end] == '\0') {
+                leased.insert(a);
+            } else if (end = -1, sscanf(tail, "%ld-%ld.rest%n", &a, &b, &end) == 2 && end > 0 && tail[end] == '\0') {
+                rests.insert({a, b});
+            } else if (end = -1, sscanf(tail, "%ld-%ld.taken%n", &a, &b, &end) == 2 && end > 0 && tail[end] == '\0') {
+                taken.insert({a, b});
+            }
+        }
+
+        vector<FreePiece> pieces;
+        for (long k = 0; k * m_chunk < nEvents; ++k) {
+            if (!leased.count(k)) pieces.push_back({false, k, k * m_chunk, min((k + 1) * m_chunk, nEvents)});
+        }
+        for (const auto& r : rests) {
+            if (!taken.count(r)) pieces.push_back({true, r.first / m_chunk, r.first, r.second});
+        }
+        sort(pieces.begin(), pieces.end(), [](const FreePiece& x, const FreePiece& y) { return x.start < y.start; });
+        return pieces;
+    }
+
+    string leasePath(const string& file, long chunk) const {
+        return m_dir + "/" + fs::path(file).filename().string() + "." + to_string(chunk) + ".lease";
+    }
+
+    string restPath(const string& file, long start, long end, const char* kind = "rest") const {
+        return m_dir + "/" + fs::path(file).filename().string() + "." + to_string(start) + "-"
+             + to_string(end) + "." + kind;
+    }
+
+    // File that makes the piece ours: the chunk lease or the rest's taken marker
+    string holderPath(const string& file, const ClaimPiece& piece) const {
+        return piece.rest ? restPath(file, piece.start, piece.end, "taken") : leasePath(file, piece.chunk);
+    }
+
+    string claimPath(string owner) const {
+        replace(owner.begin(), owner.end(), '/', '_');
+        return m_dir + "/owner_" + owner + ".claim";
+    }
+
+    const string& dir() const { return m_dir; }
+
+    // Creates path with its content in one step (written aside, then linked
+    // into place): fails if it exists, and nobody ever sees it empty
+    static bool createExclusive(const string& path, const string& text, bool* existed = nullptr) {
+        string tmp = path + ".tmp." + to_string(getpid());
+        if (!writeAtomic(tmp, text + "\n")) return false;
+        bool ok = link(tmp.c_str(), path.c_str()) == 0;
+        if (existed) *existed = !ok && errno == EEXIST;
+        unlink(tmp.c_str());
+        return ok;
+    }
+
+private:
+    string m_dir;
+    long m_chunk = 0;
+};
+
+// Events of an owner: [skip, skip + count) of one file, made of pieces. The
+// record is written as pending before the first piece is taken and marked done
+// once all are, so a job that dies while claiming leaves nothing unaccounted:
+// its retry (or release) finds the pending record and finishes or undoes it.
+//
+//   done|pending <file> <skip> <count>
+//   chunk <k> <start> <end> <used>        whole free chunk, events [start, used)
+//   rest <start> <end> <used>             rest start-end, events [start, used)
+//
+// Only the last piece may be used partly; its unused events [used, end) are
+// published as the rest used-end.
+struct Claim {
+    bool done = false;
+    string file;
+    long skip = 0;
+    long count = -1;          // -1: to the end of the file
+    vector<ClaimPiece> pieces;
+
+    string text() const {
+        string text = string(done ? "done " : "pending ") + file + " " + to_string(skip) + " " + to_string(count) + "\n";
+        for (const auto& p : pieces) {
+            if (p.rest) text += "rest " + to_string(p.start) + " " + to_string(p.end) + " " + to_string(p.used) + "\n";
+            else text += "chunk " + to_string(p.chunk) + " " + to_string(p.start) + " " + to_string(p.end) + " "
+                       + to_string(p.used) + "\n";
+        }
+        return text;
+    }
+
+    bool parse(const string& path) {
+        ifstream in(path);
+        string line;
+        char state[16], name[4096];
+        if (!getline(in, line) || sscanf(line.c_str(), "%15s %4095s %ld %ld", state, name, &skip, &count) != 4) return false;
+        done = string(state) == "done";
+        file = name;
+        pieces.clear();
+        while (getline(in, line)) {
+            ClaimPiece p;
+            if (sscanf(line.c_str(), "chunk %ld %ld %ld %ld", &p.chunk, &p.start, &p.end, &p.used) == 4) {
+                p.rest = false;
+            } else if (sscanf(line.c_str(), "rest %ld %ld %ld", &p.start, &p.end, &p.used) == 3) {
+                p.rest = true;
+            } else {
+                return false;
+            }
+            pieces.push_back(p);
+        }
+        return true;
+    }
+};
+
+bool holds(const Ledger& ledger, const Claim& c, const ClaimPiece& piece, const string& owner) {
+    return readText(ledger.holderPath(c.file, piece)) == owner;
+}
+
+// Gives back the pieces of c that are ours (a claim that lost a piece, or died)
+void rollback(const Ledger& ledger, const Claim& c, const string& owner) {
+    for (const auto& piece : c.pieces) {
+        if (holds(ledger, c, piece, owner)) unlink(ledger.holderPath(c.file, piece).c_str());
+    }
+}
+
+// Publishes the unused end of the last piece; already published is fine
+void publishTail(const Ledger& ledger, const Claim& c, const string& owner) {
+    if (c.pieces.empty() || c.pieces.back().used >= c.pieces.back().end) return;
+    const ClaimPiece& last = c.pieces.back();
+    Ledger::createExclusive(ledger.restPath(c.file, last.used, last.end), owner);
+}
+
+// Takes every piece of c, or none; false if another job holds one of them
+bool acquire(const Ledger& ledger, const Claim& c, const string& owner) {
+    for (const auto& piece : c.pieces) {
+        if (!Ledger::createExclusive(ledger.holderPath(c.file, piece), owner)) {
+            rollback(ledger, c, owner);
+            return false;
+        }
+    }
+    publishTail(ledger, c, owner);
+    return true;
+}
+
+// A pending record of this owner (a claim that died half-way): finished when
+// all its pieces are ours, otherwise undone; true if finished
+bool settlePending(const Ledger& ledger, Claim& c, const string& owner) {
+    bool all = !c.pieces.empty();
+    for (const auto& piece : c.pieces) all = all && holds(ledger, c, piece, owner);
+    if (!all) {
+        rollback(ledger, c, owner);
+        unlink(ledger.claimPath(owner).c_str());
+        return false;
+    }
+    publishTail(ledger, c, owner);
+    c.done = true;
+    return writeAtomic(ledger.claimPath(owner), c.text());
+}
+
+// Claim of the first count events of a run of contiguous free pieces
+Claim claimOf(const string& file, const vector<FreePiece>& run, long count) {
+    Claim c;
+    c.file = file;
+    c.skip = run.front().start;
+    c.count = count;
+    long end = c.skip + count;
+    for (const auto& free : run) {
+        if (free.start >= end) break;
+        c.pieces.push_back({free.rest, free.chunk, free.start, free.end, min(free.end, end)});
+    }
+    return c;
+}
+
+int claim(Ledger& ledger, const string& owner, long events, const vector<string>& files) {
+    // Retried job: same range again
+    Claim previous;
+    string recordPath = ledger.claimPath(owner);
+    if (previous.parse(recordPath) && (previous.done || settlePending(ledger, previous, owner))) {
+        cout << previous.file << " " << previous.skip << " " << previous.count << endl;
+        return 0;
+    }
+
+    // First exactly the requested range (a whole free file for -1) at the start
+    // of a free run; then the first free run of any length (file tails, gaps),
+    // so that no event stays unshowered
+    for (int pass = 0; pass < 2; ++pass) {
+        bool partial = pass == 1;
+        for (const auto& file : files) {
+            long nEvents = ledger.fileEvents(file);
+            if (nEvents <= 0) {
+                if (!partial) cerr << "Warning: no events in " << file << ", skipped" << endl;
+                continue;
+            }
+            vector<FreePiece> pieces = ledger.freePieces(file, nEvents);
+            for (size_t first = 0; first < pieces.size();) {
+                size_t last = first + 1;
+                while (last < pieces.size() && pieces[last].start == pieces[last - 1].end) ++last;
+                vector<FreePiece> run(pieces.begin() + first, pieces.begin() + last);
+                first = last;
+
+                long length = run.back().end - run.front().start;
+                bool whole = run.front().start == 0 && length == nEvents;
+                bool fits = events < 0 ? whole : length >= events;
+                if (!fits && !partial) continue;
+
+                Claim c = claimOf(file, run, fits && events >= 0 ? events : length);
+                if (!writeAtomic(recordPath, c.text())) {
+                    cerr << "Error: Cannot write the claim record of " << owner << endl;
+                    return 1;
+                }
+                if (!acquire(ledger, c, owner)) continue;   // lost a piece to another job
+
+                if (events < 0 && c.skip + c.count == nEvents) c.count = -1;   // to the end of the file
+                c.done = true;
+                if (!writeAtomic(recordPath, c.text())) {
+                    cerr << "Error: Cannot write the claim record of " << owner << endl;
+                    return 1;
+                }
+                if (!fits) cerr << "Warning: only " << length << " unused events left in one range" << endl;
+                cout << c.file << " " << c.skip << " " << c.count << endl;
+                return 0;
+            }
+        }
+    }
+
+    unlink(recordPath.c_str());
+    cerr << "Error: No unused events left in " << files.size() << " LHE files" << endl;
+    return 4;
+}
+
+int status(Ledger& ledger, const string& dir, vector<string> files) {
+    // Without files: every file the ledger has counted
+    bool listed = !files.empty();
+    vector<string> claims;
+    error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        string name = entry.path().filename().string();
+        if (!listed && name.size() > 7 && name.compare(name.size() - 7, 7, ".events") == 0) {
+            files.push_back(name.substr(0, name.size() - 7));
+        }
+        if (name.compare(0, 6, "owner_") == 0 && name.size() > 6 && name.compare(name.size() - 6, 6, ".claim") == 0) {
+            claims.push_back(entry.path().string());
+        }
+    }
+    sort(files.begin(), files.end());
+
+    long totalEvents = 0, totalLeased = 0;
+    cout << "Ledger: " << dir << " (chunks of " << ledger.chunk() << " events)" << endl;
+    for (const auto& file : files) {
+        long nEvents = ledger.fileEvents(file);   // cached: also for files given by name
+        long freeEvents = 0;
+        if (nEvents > 0) {
+            for (const auto& piece : ledger.freePieces(file, nEvents)) freeEvents += piece.end - piece.start;
+        }
+        totalEvents += max(0L, nEvents);
+        totalLeased += max(0L, nEvents) - freeEvents;
+        printf("  %-50s %8ld events %8ld leased %8ld free\n", fs::path(file).filename().string().c_str(),
+               nEvents, max(0L, nEvents) - freeEvents, freeEvents);
+    }
+    printf("Total: %ld events, %ld leased, %ld free\n", totalEvents, totalLeased, totalEvents - totalLeased);
+
+    long nPending = 0;
+    for (const auto& path : claims) {
+        Claim c;
+        if (c.parse(path) && !c.done) ++nPending;
+    }
+    if (nPending > 0) {
+        printf("Pending claims: %ld (jobs that died while claiming; their retry or release settles them)\n", nPending);
+    }
+    return 0;
+}
+
+int release(Ledger& ledger, const string& owner) {
+    Claim c;
+    string path = ledger.claimPath(owner);
+    if (!c.parse(path)) {
+        cerr << "Error: No claim of " << owner << endl;
+        return 1;
+    }
+    if (!c.done && !settlePending(ledger, c, owner)) {
+        cout << "Undid the unfinished claim of " << owner << endl;
+        return 0;
+    }
+    // Fully used pieces are freed; the used part of a split one becomes a rest
+    for (const auto& piece : c.pieces) {
+        if (piece.used == piece.end) {
+            if (holds(ledger, c, piece, owner)) unlink(ledger.holderPath(c.file, piece).c_str());
+        } else {
+            Ledger::createExclusive(ledger.restPath(c.file, piece.start, piece.used), owner);
+        }
+    }
+    unlink(path.c_str());
+    cout << "Released " << c.file << " events " << c.skip << " .. "
+         << (c.count < 0 ? string("end") : to_string(c.skip + c.count)) << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    string command = argv[1];
+    string dir = argv[2];
+    string owner;
+    long events = -1;
+    long chunk = 0;
+    vector<string> files;
+
+    for (int i = 3; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--owner" && i + 1 < argc) {
+            owner = argv[++i];
+        } else if (arg == "--events" && i + 1 < argc) {
+            events = atol(argv[++i]);
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            chunk = atol(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    Ledger ledger(dir);
+    if (command == "claim") {
+        if (owner.empty() || files.empty() || events == 0) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (!ledger.open(chunk, true)) return 1;
+        return claim(ledger, owner, events, files);
+    }
+    if (command == "status") {
+        if (!fs::is_directory(dir) || !ledger.open(0, false)) {
+            cerr << "Error: No ledger at " << dir << endl;
+            return 1;
+        }
+        return status(ledger, dir, files);
+    }
+    if (command == "release") {
+        if (owner.empty() || !ledger.open(0, false)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return release(ledger, owner);
+    }
+    printUsage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,237 @@
+// ==============================================================================
+// mix_provenance.h - Weight and provenance side table of the event mixer
+// ==============================================================================
+// event_mixer_multisource writes one record per output event to a side table
+// (default: <output>.mixprov): which event of which input was combined into
+// it, where that event sits in the input, and the full weight vector of every
+// source event. Reweighting, sums of weights and checks for reused or
+// duplicated combinations (across jobs too, inputs are identified by name)
+// then run on this small file instead of the multi-GB event files.
+//
+// File layout (little endian):
+//   header  : 64 bytes, ProvenanceFileHeader
+//   names   : namesBytes bytes, the nSources input file names, '\0'-terminated
+//   records : one per output event, in output order, recordBytes each:
+//             uint32 recordBytes, uint32 reserved, int64 eventNumber (output)
+//             nSources x ProvenanceSource
+//             double weights[sum of the sources' nWeights], source by source
+//
+// nRecords is patched when the writer closes; a table from a job that died
+// has nRecords = 0 and is read up to the last complete record.
+//
+// Header-only, no external dependencies.
+// ==============================================================================
+
+#ifndef MIX_PROVENANCE_H
+#define MIX_PROVENANCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char kProvenanceMagic[4] = {'M', 'I', 'X', 'P'};
+const uint32_t kProvenanceVersion = 1;
+
+struct ProvenanceFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t nSources;
+    uint32_t namesBytes;
+    uint64_t nRecords;
+    char reserved[40];
+};
+
+// One source event of an output event
+struct ProvenanceSource {
+    int64_t eventNumber;     // event number in the input file
+    uint64_t offset;         // byte (ASCII) or frame (.hepb) offset in the input
+    uint32_t eventIndex;     // position of the event in the input file
+    uint32_t nWeights;       // length of its weight vector
+};
+
+static_assert(sizeof(ProvenanceFileHeader) == 64, "ProvenanceFileHeader must be 64 bytes");
+static_assert(sizeof(ProvenanceSource) == 24, "ProvenanceSource must be 24 bytes");
+
+// One output event, reused between records
+struct MixProvenance {
+    int64_t eventNumber = 0;
+    std::vector<ProvenanceSource> sources;
+    std::vector<double> weights;        // all source weights, source by source
+
+    // Weights of source s (weightBegin(s) .. weightBegin(s) + nWeights)
+    size_t weightBegin(size_t s) const {
+        size_t begin = 0;
+        for (size_t i = 0; i < s; ++i) begin += sources[i].nWeights;
+        return begin;
+    }
+};
+
+// Default side table name for a mixer output
+inline std::string provenancePathFor(const std::string& outputFile) {
+    return outputFile + ".mixprov";
+}
+
+// ------------------------------------------------------------------------------
+// Writing
+// ------------------------------------------------------------------------------
+
+class ProvenanceWriter {
+public:
+    ~ProvenanceWriter() { close(); }
+
+    bool open(const std::string& file, const std::vector<std::string>& inputFiles) {
+        m_file = fopen(file.c_str(), "wb");
+        if (!m_file) return false;
+        std::string names;
+        for (const auto& name : inputFiles) names.append(name.c_str(), name.size() + 1);
+        ProvenanceFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kProvenanceMagic, 4);
+        header.version = kProvenanceVersion;
+        header.nSources = inputFiles.size();
+        header.namesBytes = names.size();
+        m_nSources = inputFiles.size();
+        m_nRecords = 0;
+        return fwrite(&header, sizeof(header), 1, m_file) == 1 &&
+               fwrite(names.data(), 1, names.size(), m_file) == names.size();
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    bool write(const MixProvenance& record) {
+        if (!m_file || record.sources.size() != m_nSources) return false;
+        uint32_t head[2] = {(uint32_t)(sizeof(head) + sizeof(int64_t)
+                                       + record.sources.size() * sizeof(ProvenanceSource)
+                                       + record.weights.size() * sizeof(double)), 0};
+        ++m_nRecords;
+        return fwrite(head, sizeof(head), 1, m_file) == 1 &&
+               fwrite(&record.eventNumber, sizeof(int64_t), 1, m_file) == 1 &&
+               fwrite(record.sources.data(), sizeof(ProvenanceSource), record.sources.size(), m_file)
+                   == record.sources.size() &&
+               fwrite(record.weights.data(), sizeof(double), record.weights.size(), m_file)
+                   == record.weights.size();
+    }
+
+    uint64_t nRecords() const { return m_nRecords; }
+
+    // Patches the record count into the header
+    void close() {
+        if (!m_file) return;
+        if (fseek(m_file, offsetof(ProvenanceFileHeader, nRecords), SEEK_SET) == 0) {
+            fwrite(&m_nRecords, sizeof(m_nRecords), 1, m_file);
+        }
+        fclose(m_file);
+        m_file = nullptr;
+    }
+
+private:
+    FILE* m_file = nullptr;
+    size_t m_nSources = 0;
+    uint64_t m_nRecords = 0;
+};
+
+// ------------------------------------------------------------------------------
+// Reading (read-only mmap, sequential over the records)
+// ------------------------------------------------------------------------------
+
+class ProvenanceFile {
+public:
+    ProvenanceFile() {}
+    ProvenanceFile(const ProvenanceFile&) = delete;
+    ProvenanceFile& operator=(const ProvenanceFile&) = delete;
+    ~ProvenanceFile() { close(); }
+
+    bool open(const std::string& file) {
+        close();
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ProvenanceFileHeader)) {
+            ::close(fd);
+            return false;
+        }
+        m_length = st.st_size;
+        m_data = (const char*)mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (m_data == MAP_FAILED) {
+            m_data = nullptr;
+            return false;
+        }
+
+        const ProvenanceFileHeader* h = header();
+        if (memcmp(h->magic, kProvenanceMagic, 4) != 0 || h->version != kProvenanceVersion ||
+            sizeof(ProvenanceFileHeader) + h->namesBytes > m_length) {
+            close();
+            return false;
+        }
+        const char* name = m_data + sizeof(ProvenanceFileHeader);
+        const char* namesEnd = name + h->namesBytes;
+        while (name < namesEnd && m_names.size() < h->nSources) {
+            size_t n = strnlen(name, namesEnd - name);
+            m_names.emplace_back(name, n);
+            name += n + 1;
+        }
+        m_names.resize(h->nSources);
+        madvise((void*)m_data, m_length, MADV_SEQUENTIAL);
+        rewind();
+        return true;
+    }
+
+    void close() {
+        if (m_data) munmap((void*)m_data, m_length);
+        m_data = nullptr;
+        m_length = 0;
+        m_names.clear();
+    }
+
+    bool isOpen() const { return m_data != nullptr; }
+    const ProvenanceFileHeader* header() const { return (const ProvenanceFileHeader*)m_data; }
+    size_t nSources() const { return header()->nSources; }
+    const std::string& sourceName(size_t s) const { return m_names[s]; }
+
+    // Records as counted by the writer (0 for a table from a job that died)
+    uint64_t nRecords() const { return header()->nRecords; }
+
+    void rewind() { m_pos = sizeof(ProvenanceFileHeader) + header()->namesBytes; }
+
+    // Decodes the next record into record; false at the end (or a torn record)
+    bool next(MixProvenance& record) {
+        const size_t fixed = 2 * sizeof(uint32_t) + sizeof(int64_t);
+        if (m_pos + fixed > m_length) return false;
+        uint32_t recordBytes;
+        memcpy(&recordBytes, m_data + m_pos, sizeof(recordBytes));
+        size_t nSrc = nSources();
+        if (recordBytes < fixed + nSrc * sizeof(ProvenanceSource) || m_pos + recordBytes > m_length) return false;
+
+        const char* p = m_data + m_pos + 2 * sizeof(uint32_t);
+        memcpy(&record.eventNumber, p, sizeof(int64_t));
+        p += sizeof(int64_t);
+        record.sources.resize(nSrc);
+        memcpy(record.sources.data(), p, nSrc * sizeof(ProvenanceSource));
+        p += nSrc * sizeof(ProvenanceSource);
+
+        size_t nWeights = 0;
+        for (const ProvenanceSource& s : record.sources) nWeights += s.nWeights;
+        if (fixed + nSrc * sizeof(ProvenanceSource) + nWeights * sizeof(double) != recordBytes) return false;
+        record.weights.resize(nWeights);
+        memcpy(record.weights.data(), p, nWeights * sizeof(double));
+        m_pos += recordBytes;
+        return true;
+    }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_length = 0;
+    size_t m_pos = 0;
+    std::vector<std::string> m_names;
+};
+
+#endif // MIX_PROVENANCE_H
@@ -0,0 +1,143 @@
+#!/bin/bash
+# ==============================================================================
+# pgo_train.sh - Training workloads for the profile-guided build (make pgo)
+# ==============================================================================
+# Runs the instrumented shower_normal, shower_phi and event_mixer_multisource
+# on the bundled synthetic workloads so that their profiles (-fprofile-generate)
+# cover the production hot paths: hadronization retries with the built-in cuts
+# and with --select, the early veto, HepMC3/.hepb/.zst outputs and summary
+# sidecars, then sequential and requirement-driven mixing of the shower
+# outputs and of synth_hepmc banks with --select and the HepMC3/binary copies.
+# Runs fully offline. The programs run single-process: forked workers leave
+# with _exit() and would not write their profile counters.
+#
+# Usage:
+#   ./pgo_train.sh [--events N] [--bank-events N] [--particles N] [--seed N]
+#                  [--workdir DIR] [--keep]
+# ==============================================================================
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+
+EVENTS=200
+BANK_EVENTS=100
+PARTICLES=3000
+SEED=4242
+WORKDIR=""
+KEEP="false"
+
+usage() {
+    cat << EOF
+Usage: $0 [options]
+
+Options:
+  --events N          LHE events per shower training run (default: 200)
+  --bank-events N     Events per synthetic HepMC bank for the mixer (default: 100)
+  --particles N       Final-state hadrons per bank event (default: 3000)
+  --seed N            Random seed of the synthetic samples (default: 4242)
+  --workdir DIR       Directory for the training files (default: temporary)
+  --keep              Keep the generated files
+  -h, --help          Show this help
+EOF
+    exit 1
+}
+
+while [[ $# -gt 0 ]]; do
+    case $1 in
+        --events) EVENTS="$2"; shift 2 ;;
+        --bank-events) BANK_EVENTS="$2"; shift 2 ;;
+        --particles) PARTICLES="$2"; shift 2 ;;
+        --seed) SEED="$2"; shift 2 ;;
+        --workdir) WORKDIR="$2"; shift 2 ;;
+        --keep) KEEP="true"; shift ;;
+        -h|--help) usage ;;
+        *) echo "[ERROR] Unknown option: $1"; usage ;;
+    esac
+done
+
+for prog in synth_lhe synth_hepmc shower_normal shower_phi event_mixer_multisource; do
+    if [[ ! -x "${SCRIPT_DIR}/${prog}" ]]; then
+        echo "[ERROR] ${prog} not built; run 'make ${prog}' first"
+        exit 1
+    fi
+done
+
+if [[ -z "${WORKDIR}" ]]; then
+    WORKDIR=$(mktemp -d --suffix=_pgo_train)
+fi
+mkdir -p "${WORKDIR}"
+
+cleanup() {
+    if [[ "${KEEP}" != "true" ]]; then
+        rm -f "${WORKDIR}"/train_*
+        rmdir "${WORKDIR}" 2>/dev/null || true
+    fi
+}
+trap cleanup EXIT
+
+# Runs one training step, keeping its output in a log shown on failure
+train() {
+    local name="$1"
+    shift
+    local log_file="${WORKDIR}/train_${name}.log"
+    local t0=$(date +%s.%N)
+    if ! "$@" > "${log_file}" 2>&1; then
+        tail -n 20 "${log_file}"
+        echo "[ERROR] Training step failed: ${name}"
+        exit 1
+    fi
+    local t1=$(date +%s.%N)
+    awk -v n="${name}" -v t0="${t0}" -v t1="${t1}" 'BEGIN { printf "  %-28s %8.1f s\n", n, t1 - t0 }'
+}
+
+echo ""
+echo "=============================================="
+echo "PGO Training"
+echo "=============================================="
+echo "LHE events/run:   ${EVENTS}"
+echo "Bank events:      ${BANK_EVENTS} x ${PARTICLES} particles"
+echo "Work dir:         ${WORKDIR}"
+echo "=============================================="
+
+# Synthetic LHE samples of the production pools
+for process in jpsi_g 2jpsi_g jpsi_upsilon_g; do
+    "${SCRIPT_DIR}/synth_lhe" "${WORKDIR}/train_${process}.lhe" --process "${process}" \
+        --events "${EVENTS}" --seed "${SEED}" > /dev/null
+done
+
+# Showers with the run_chain.sh arguments, covering all output formats
+train shower_normal_jpsi "${SCRIPT_DIR}/shower_normal" "${WORKDIR}/train_jpsi_g.lhe" \
+    "${WORKDIR}/train_normal.hepmc.zst" -1 2.5 2.4 1000
+train shower_normal_2jpsi "${SCRIPT_DIR}/shower_normal" "${WORKDIR}/train_2jpsi_g.lhe" \
+    "${WORKDIR}/train_normal_2jpsi.hepb" -1 2.5 2.4 1000
+train shower_phi_jpsi "${SCRIPT_DIR}/shower_phi" "${WORKDIR}/train_jpsi_g.lhe" \
+    "${WORKDIR}/train_phi.hepmc.zst" -1 0.0 2.5 2.4 1000
+train shower_phi_select "${SCRIPT_DIR}/shower_phi" "${WORKDIR}/train_jpsi_upsilon_g.lhe" \
+    "${WORKDIR}/train_phi_select.hepmc" -1 0.0 2.5 2.4 1000 \
+    --select "phi(333) ->K+K- AND onium(443|553)->mu+mu- pT>2.5 |eta|<2.4"
+
+# Mixer on the shower outputs (as in production) ...
+train mix_sequential "${SCRIPT_DIR}/event_mixer_multisource" "${WORKDIR}/train_mixed_seq.hepmc" \
+    "${WORKDIR}/train_normal.hepmc.zst" "${WORKDIR}/train_phi.hepmc.zst"
+train mix_jjp "${SCRIPT_DIR}/event_mixer_multisource" "${WORKDIR}/train_mixed_jjp.hepmc" \
+    "${WORKDIR}/train_normal.hepmc.zst" "${WORKDIR}/train_phi.hepmc.zst" --analysis JJP \
+    --hepmc3 "${WORKDIR}/train_mixed_jjp_v3.hepmc.zst" --binary "${WORKDIR}/train_mixed_jjp.hepb"
+
+# ... and on large synthetic banks (ASCII and binary), three sources
+for i in 1 2 3; do
+    phi_fraction=0.0
+    [[ ${i} -eq 1 ]] && phi_fraction=1.0
+    "${SCRIPT_DIR}/synth_hepmc" "${WORKDIR}/train_bank${i}.hepmc" "${WORKDIR}/train_bank${i}.hepb" \
+        --events "${BANK_EVENTS}" --particles "${PARTICLES}" --onia 443,553 \
+        --phi-fraction "${phi_fraction}" --seed $((SEED + i)) > /dev/null
+done
+train mix_banks_ascii "${SCRIPT_DIR}/event_mixer_multisource" "${WORKDIR}/train_mixed_banks.hepmc.zst" \
+    "${WORKDIR}"/train_bank{1,2,3}.hepmc --select "2*onium(443|553)->mu+mu- pT>2.5 |eta|<2.4"
+train mix_banks_binary "${SCRIPT_DIR}/event_mixer_multisource" "${WORKDIR}/train_mixed_banks_bin.hepmc" \
+    "${WORKDIR}"/train_bank{1,2,3}.hepb --require jpsi=1,phi=1 --hepmc3 "${WORKDIR}/train_mixed_banks_v3.hepmc"
+
+echo "=============================================="
+if [[ "${KEEP}" == "true" ]]; then
+    echo "Files kept in: ${WORKDIR}"
+fi
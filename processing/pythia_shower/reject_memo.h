@@ -0,0 +1,137 @@
+// ==============================================================================
+// reject_memo.h - Shared memo of LHE events that exhausted the retry budget
+// ==============================================================================
+// A few LHE events in each pool fail every hadronization retry and dominate
+// the shower runtime; pool files are reused across jobs, so the same events
+// come back again and again. The shower programs record the content hash of
+// such events in an append-only memo file, one line per failure, and later
+// runs skip an event (or give it a reduced retry budget, --memo-retries) once
+// it failed the full budget --memo-failures times. A single unlucky failure
+// therefore does not drop an event for good.
+//
+// File format: one text line per failed event,
+//   <settings key> <event hash> <retry budget>\n   (keys as 16 hex digits)
+// - settings key: hash of everything that decides acceptance (program, cuts,
+//   --select expression, kMemoSchema); entries of other settings are ignored
+// - event hash: hard-process content (ids, statuses, momenta) of the LHE event,
+//   independent of the file name or position in the file
+// - retry budget: an entry only applies to runs with the same or smaller budget
+//
+// Lines are appended with one O_APPEND write each, so concurrent jobs on the
+// same (local or POSIX) file do not interleave; a torn last line is skipped.
+// ==============================================================================
+
+#ifndef REJECT_MEMO_H
+#define REJECT_MEMO_H
+
+#include "Pythia8/Pythia.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Bump when a code change alters which events pass (tune, decays, selection code)
+const int kMemoSchema = 1;
+
+// Default full-budget failures before the memo applies to an event (--memo-failures)
+const int kMemoFailures = 3;
+
+inline uint64_t fnv1a(const void* data, size_t len, uint64_t h = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Key of the acceptance settings, from a description such as
+// "shower_normal minMuonPt=2.5 maxMuonEta=2.4"
+inline uint64_t memoSettingsKey(const std::string& description) {
+    std::string text = "schema=" + std::to_string(kMemoSchema) + " " + description;
+    return fnv1a(text.data(), text.size());
+}
+
+// Content hash of the LHE event: incoming and outgoing hard-process entries,
+// momenta rounded to keV so the hash does not depend on the last printed digit
+inline uint64_t hardProcessHash(const Pythia8::Event& process) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 1; i < process.size(); ++i) {
+        const Pythia8::Particle& p = process[i];
+        int status = std::abs(p.status());
+        if (status < 21 || status > 23) continue;
+        int64_t fields[5] = {p.id(), p.status(),
+                             (int64_t)std::llround(p.px() * 1e6),
+                             (int64_t)std::llround(p.py() * 1e6),
+                             (int64_t)std::llround(p.pz() * 1e6)};
+        h = fnv1a(fields, sizeof(fields), h);
+    }
+    return h;
+}
+
+class RejectMemo {
+public:
+    ~RejectMemo() { close(); }
+
+    // Loads the entries for settingsKey and opens the file for appending
+    bool open(const std::string& file, uint64_t settingsKey) {
+        close();
+        m_key = settingsKey;
+        m_entries.clear();
+
+        std::ifstream in(file);
+        std::string line;
+        while (std::getline(in, line)) {
+            unsigned long long key = 0, hash = 0;
+            int budget = 0;
+            if (sscanf(line.c_str(), "%16llx %16llx %d", &key, &hash, &budget) != 3) continue;
+            if (key != m_key) continue;
+            m_entries[hash].push_back(budget);
+        }
+
+        m_fd = ::open(file.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        return m_fd >= 0;
+    }
+
+    bool isOpen() const { return m_fd >= 0; }
+    size_t size() const { return m_entries.size(); }
+
+    // Times the event failed a budget of at least retryBudget (all runs so far)
+    int failures(uint64_t eventHash, int retryBudget) const {
+        auto it = m_entries.find(eventHash);
+        if (it == m_entries.end()) return 0;
+        int n = 0;
+        for (int budget : it->second) n += budget >= retryBudget;
+        return n;
+    }
+
+    bool record(uint64_t eventHash, int retryBudget) {
+        if (m_fd < 0) return false;
+        char line[64];
+        int len = snprintf(line, sizeof(line), "%016llx %016llx %d\n",
+                           (unsigned long long)m_key, (unsigned long long)eventHash, retryBudget);
+        m_entries[eventHash].push_back(retryBudget);
+        return ::write(m_fd, line, len) == len;
+    }
+
+    void close() {
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+    }
+
+private:
+    int m_fd = -1;
+    uint64_t m_key = 0;
+    std::unordered_map<uint64_t, std::vector<int>> m_entries;   // failed budgets per event
+};
+
+#endif // REJECT_MEMO_H
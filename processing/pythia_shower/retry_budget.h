@@ -0,0 +1,231 @@
+// ==============================================================================
+// retry_budget.h - Adaptive hadronization retry budget (--adaptive-retry)
+// ==============================================================================
+// The shower programs hadronize each LHE event up to maxRetry times until it
+// passes the cuts. Most accepted events need a few tries while a tail of
+// events never passes and burns the whole budget, so a fixed maxRetry is
+// rarely the cheapest way to accepted events. With --adaptive-retry the budget
+// b is chosen online to maximize accepted events per CPU-second:
+//
+//   R(b) = F(b) / (c0 + c * E[min(K, b)])
+//
+// K is the number of tries an event needs and F(b) = P(K <= b), estimated with
+// Kaplan-Meier from events stopped at different budgets; c is the measured
+// cost of one try and c0 the cost per event outside the retry loop (parton
+// level, vetoed and memo-skipped events). maxRetry stays the upper limit: the
+// first kWarmupEvents events and a fraction of the later ones (--retry-explore)
+// keep it, so that the tail of F stays measured, and b is recomputed every
+// kUpdateEvents events. Where fewer than kMinAtRisk events reach a try count
+// the tail is extrapolated with the hazard of the measured tail (geometric).
+//
+// A budget below maxRetry loses the events that would have passed later,
+// preferentially hard-to-accept ones. The tally keeps the expected accepted
+// events and tries of a full-budget run, from which the yield gain is
+// reported. With --retry-bias-correction each accepted event also records
+// F(maxRetry) / F(b) in the summary sidecar (EventSummary::retryCorrection),
+// the weight that restores the full-budget acceptance.
+//
+// Header-only, no external dependencies.
+// ==============================================================================
+
+#ifndef RETRY_BUDGET_H
+#define RETRY_BUDGET_H
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Additive counts of a run under the controller; workers send theirs to the parent
+struct RetryBudgetTally {
+    long events = 0;            // events hadronized with a controller budget
+    long exploreEvents = 0;     // of those, run at maxRetry (warm-up and exploration)
+    long stoppedEvents = 0;     // failed at a budget below maxRetry
+    long accepted = 0;
+    long tries = 0;
+    long budgetSum = 0;         // sum of the budgets given to the events
+    int updates = 0;            // budget recomputations
+    int minBudget = INT_MAX;    // range of the chosen budgets
+    int maxBudget = 0;
+    double retrySeconds = 0.0;
+    double overheadSeconds = 0.0;
+    double fullAccepted = 0.0;  // expected accepted events with maxRetry for every event
+    double fullExtraTries = 0.0;// expected additional tries of the stopped events with maxRetry
+
+    void add(const RetryBudgetTally& o) {
+        events += o.events;
+        exploreEvents += o.exploreEvents;
+        stoppedEvents += o.stoppedEvents;
+        accepted += o.accepted;
+        tries += o.tries;
+        budgetSum += o.budgetSum;
+        updates += o.updates;
+        minBudget = std::min(minBudget, o.minBudget);
+        maxBudget = std::max(maxBudget, o.maxBudget);
+        retrySeconds += o.retrySeconds;
+        overheadSeconds += o.overheadSeconds;
+        fullAccepted += o.fullAccepted;
+        fullExtraTries += o.fullExtraTries;
+    }
+
+    double meanBudget() const { return events > 0 ? (double)budgetSum / events : 0.0; }
+
+    // Accepted events per second relative to the same run at maxRetry
+    double yieldGain() const {
+        if (accepted == 0 || fullAccepted <= 0.0 || tries == 0) return 1.0;
+        double seconds = overheadSeconds + retrySeconds;
+        double fullSeconds = seconds + retrySeconds / tries * fullExtraTries;
+        return (accepted / seconds) / (fullAccepted / fullSeconds);
+    }
+};
+
+class RetryBudget {
+public:
+    static const int kWarmupEvents = 100;   // events at maxRetry before the first estimate
+    static const int kUpdateEvents = 50;    // events between recomputations
+    static const int kMinAtRisk = 10;       // fewer events at risk: extrapolated tail
+
+    void configure(int maxRetry, double exploreFraction) {
+        m_cap = std::max(1, maxRetry);
+        m_budget = m_cap;
+        m_explorePeriod = exploreFraction > 0.0 ? std::max(1L, std::lround(1.0 / exploreFraction)) : 0;
+        m_success.assign(m_cap + 1, 0);
+        m_censored.assign(m_cap + 1, 0);
+        m_survival.assign(m_cap + 1, 1.0);
+        m_triesBefore.resize(m_cap + 1);
+        for (int k = 0; k <= m_cap; ++k) m_triesBefore[k] = k;
+        m_enabled = true;
+    }
+
+    bool enabled() const { return m_enabled; }
+    int budget() const { return m_budget; }
+    int maxRetry() const { return m_cap; }
+    const RetryBudgetTally& tally() const { return m_tally; }
+
+    // Budget for the next event that reaches hadronization
+    int next() {
+        ++m_nEvents;
+        bool explore = m_nEvents <= kWarmupEvents || (m_explorePeriod > 0 && m_nEvents % m_explorePeriod == 0);
+        if (explore) m_tally.exploreEvents++;
+        return explore ? m_cap : m_budget;
+    }
+
+    // Cost of an event that never reached the retry loop (vetoed, skipped)
+    void addOverhead(double seconds) { m_tally.overheadSeconds += seconds; }
+
+    // Outcome of an event hadronized with the given budget; nTries is the try
+    // that passed, or the budget if none did. Returns true when this event
+    // triggered a recomputation that moved the budget by more than 10%.
+    bool observe(int budget, int nTries, bool accepted, double overheadSeconds, double retrySeconds) {
+        budget = std::min(std::max(budget, 1), m_cap);
+        nTries = std::min(std::max(nTries, 1), budget);
+        (accepted ? m_success : m_censored)[nTries]++;
+        ++m_nObserved;
+
+        RetryBudgetTally& t = m_tally;
+        t.events++;
+        t.tries += nTries;
+        t.budgetSum += budget;
+        t.retrySeconds += retrySeconds;
+        t.overheadSeconds += overheadSeconds;
+        if (accepted) {
+            t.accepted++;
+            t.fullAccepted += 1.0;
+        } else if (budget < m_cap) {
+            // A full budget would still pass with P(b < K <= cap | K > b)
+            double sb = m_survival[budget];
+            t.stoppedEvents++;
+            if (sb > 0.0) {
+                t.fullAccepted += (sb - m_survival[m_cap]) / sb;
+                t.fullExtraTries += (m_triesBefore[m_cap] - m_triesBefore[budget]) / sb;
+            }
+        }
+
+        if (m_nObserved < kWarmupEvents || m_nObserved % kUpdateEvents != 0) return false;
+        int previous = m_budget;
+        update();
+        return std::abs(m_budget - previous) * 10 > previous;
+    }
+
+    // F(maxRetry) / F(b): weight restoring the full-budget acceptance of an
+    // event accepted with budget b (1 at maxRetry)
+    double correction(int budget) const {
+        budget = std::min(std::max(budget, 1), m_cap);
+        double accept = 1.0 - m_survival[budget];
+        return accept > 0.0 ? (1.0 - m_survival[m_cap]) / accept : 1.0;
+    }
+
+    // Modeled yield of the current budget relative to maxRetry
+    double modelGain() const { return m_rateCap > 0.0 ? rate(m_budget) / m_rateCap : 1.0; }
+
+private:
+    // Kaplan-Meier survival S(k) = P(K > k), expected tries and the best budget
+    void update() {
+        std::vector<long> atRisk(m_cap + 1, 0);
+        long risk = m_nObserved;
+        int measured = 0;
+        for (int k = 1; k <= m_cap && risk >= kMinAtRisk; ++k) {
+            atRisk[k] = risk;
+            m_survival[k] = m_survival[k - 1] * (1.0 - (double)m_success[k] / risk);
+            risk -= m_success[k] + m_censored[k];
+            measured = k;
+        }
+        if (measured < m_cap) {
+            // Constant hazard of the second half of the measured range
+            double passed = 0.0, exposed = 0.0;
+            for (int k = measured / 2 + 1; k <= measured; ++k) {
+                passed += m_success[k];
+                exposed += atRisk[k];
+            }
+            double hazard = exposed > 0.0 ? passed / exposed : 0.0;
+            for (int k = measured + 1; k <= m_cap; ++k) m_survival[k] = m_survival[k - 1] * (1.0 - hazard);
+        }
+
+        // E[min(K, b)] = sum_{k < b} S(k)
+        m_triesBefore.assign(m_cap + 1, 0.0);
+        for (int k = 1; k <= m_cap; ++k) m_triesBefore[k] = m_triesBefore[k - 1] + m_survival[k - 1];
+
+        const RetryBudgetTally& t = m_tally;
+        m_costPerTry = t.tries > 0 ? t.retrySeconds / t.tries : 0.0;
+        m_costPerEvent = t.events > 0 ? t.overheadSeconds / t.events : 0.0;
+        m_tally.updates++;
+        if (m_costPerTry <= 0.0) return;
+
+        int best = m_cap;
+        double bestRate = rate(m_cap);
+        for (int b = 1; b < m_cap; ++b) {
+            double r = rate(b);
+            if (r > bestRate) {
+                bestRate = r;
+                best = b;
+            }
+        }
+        m_rateCap = rate(m_cap);
+        m_budget = best;
+        m_tally.minBudget = std::min(m_tally.minBudget, best);
+        m_tally.maxBudget = std::max(m_tally.maxBudget, best);
+    }
+
+    double rate(int b) const {
+        double cost = m_costPerEvent + m_costPerTry * m_triesBefore[b];
+        return cost > 0.0 ? (1.0 - m_survival[b]) / cost : 0.0;
+    }
+
+    bool m_enabled = false;
+    int m_cap = 1;
+    int m_budget = 1;
+    long m_explorePeriod = 0;
+    long m_nEvents = 0;
+    long m_nObserved = 0;
+    std::vector<uint32_t> m_success;    // events passing at try k
+    std::vector<uint32_t> m_censored;   // events stopped after k tries
+    std::vector<double> m_survival;     // S(k), 1 until the first estimate
+    std::vector<double> m_triesBefore;  // sum_{j < k} S(j), k until the first estimate
+    double m_costPerTry = 0.0;
+    double m_costPerEvent = 0.0;
+    double m_rateCap = 0.0;
+    RetryBudgetTally m_tally;
+};
+
+#endif // RETRY_BUDGET_H
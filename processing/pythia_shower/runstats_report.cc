@@ -0,0 +1,335 @@
+// ==============================================================================
+// runstats_report.cc - Fleet-wide report from run statistics records (.runstats)
+// ==============================================================================
+// Merges the per-run records written by shower_normal, shower_phi and
+// event_mixer_multisource (run_stats.h) into per-campaign reports: event
+// counts and efficiencies, hadronization tries and time per event (mean and
+// percentiles of the merged histograms), job wall times, CPU throughput and
+// the fleet's throughput over the campaign's time span.
+//
+// Arguments are record files or directories searched recursively for
+// *.runstats. Records found under a directory are grouped by the first path
+// component below it, i.e. by campaign for the EOS output tree
+// (output/<campaign>/<job>/*.runstats); records given as files form one
+// group. Within a group every program gets its own block. Files are read on
+// several threads, so thousands of records take seconds even on EOS.
+//
+// No external dependencies:
+//   g++ -std=c++17 -O2 -pthread runstats_report.cc -o runstats_report
+//
+// Usage:
+//   ./runstats_report DIR|FILE.runstats [...] [--json FILE|-] [--threads N]
+// ==============================================================================
+
+#include "run_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+void printUsage(const char* progName) {
+    cerr << "\n=== Run Statistics Report ===" << endl;
+    cerr << "Usage: " << progName << " DIR|FILE.runstats [...] [--json FILE|-] [--threads N]" << endl;
+    cerr << "\nArguments:" << endl;
+    cerr << "  DIR            : Searched recursively for *.runstats, grouped by the first" << endl;
+    cerr << "                   directory below DIR (the campaign in the EOS output tree)" << endl;
+    cerr << "  FILE.runstats  : Single records, reported as one group" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --json FILE    : Also write the report as JSON ('-' for stdout only)" << endl;
+    cerr << "  --threads N    : Reader threads (default: 16)" << endl;
+}
+
+// Merged records of one (group, program)
+struct RunAggregate {
+    long nRuns = 0;
+    long nWorkers = 0;
+    uint64_t counters[kRunCounterSlots] = {};
+    double initSeconds = 0.0, loopSeconds = 0.0, wallSeconds = 0.0, cpuSeconds = 0.0;
+    double maxRssMB = 0.0;
+    int64_t firstStart = 0, lastEnd = 0;     // fleet time span
+    StatsHistogram tries = {};
+    StatsHistogram eventMicros = {};
+    StatsHistogram jobWallSeconds = {};
+
+    void add(const RunStats& r) {
+        int64_t end = r.startTime + (int64_t)r.wallSeconds;
+        if (nRuns == 0 || r.startTime < firstStart) firstStart = r.startTime;
+        if (nRuns == 0 || end > lastEnd) lastEnd = end;
+        nRuns++;
+        nWorkers += r.nWorkers;
+        for (int i = 0; i < kRunCounterSlots; ++i) counters[i] += r.counters[i];
+        initSeconds += r.initSeconds;
+        loopSeconds += r.loopSeconds;
+        wallSeconds += r.wallSeconds;
+        cpuSeconds += r.cpuSeconds;
+        maxRssMB = max(maxRssMB, r.maxRssMB);
+        tries.add(r.tries);
+        eventMicros.add(r.eventMicros);
+        jobWallSeconds.fill((uint64_t)r.wallSeconds);
+    }
+
+    void add(const RunAggregate& o) {
+        if (o.nRuns == 0) return;
+        if (nRuns == 0 || o.firstStart < firstStart) firstStart = o.firstStart;
+        if (nRuns == 0 || o.lastEnd > lastEnd) lastEnd = o.lastEnd;
+        nRuns += o.nRuns;
+        nWorkers += o.nWorkers;
+        for (int i = 0; i < kRunCounterSlots; ++i) counters[i] += o.counters[i];
+        initSeconds += o.initSeconds;
+        loopSeconds += o.loopSeconds;
+        wallSeconds += o.wallSeconds;
+        cpuSeconds += o.cpuSeconds;
+        maxRssMB = max(maxRssMB, o.maxRssMB);
+        tries.add(o.tries);
+        eventMicros.add(o.eventMicros);
+        jobWallSeconds.add(o.jobWallSeconds);
+    }
+};
+
+typedef map<pair<string, string>, RunAggregate> Report;   // (group, program)
+
+struct RecordFile {
+    string path;
+    string group;
+};
+
+void findRecords(const string& arg, vector<RecordFile>& files) {
+    error_code ec;
+    if (!fs::is_directory(arg, ec)) {
+        files.push_back({arg, "(files)"});
+        return;
+    }
+    fs::path root(arg);
+    for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+         it != end; it.increment(ec)) {
+        if (ec) break;
+        const fs::path& p = it->path();
+        if (p.extension() != ".runstats" || !it->is_regular_file(ec)) continue;
+        fs::path relative = p.lexically_relative(root);
+        string group = distance(relative.begin(), relative.end()) > 1 ? relative.begin()->string()
+                                                                       : root.filename().string();
+        files.push_back({p.string(), group});
+    }
+}
+
+// Formats a duration in seconds with a readable unit
+string formatSeconds(double s) {
+    char buffer[32];
+    if (s < 1e-3) snprintf(buffer, sizeof(buffer), "%.0f us", s * 1e6);
+    else if (s < 1.0) snprintf(buffer, sizeof(buffer), "%.1f ms", s * 1e3);
+    else if (s < 120.0) snprintf(buffer, sizeof(buffer), "%.2f s", s);
+    else if (s < 7200.0) snprintf(buffer, sizeof(buffer), "%.1f min", s / 60.0);
+    else snprintf(buffer, sizeof(buffer), "%.2f h", s / 3600.0);
+    return buffer;
+}
+
+void printAggregate(const string& program, const RunAggregate& a) {
+    const uint64_t* c = a.counters;
+    double nLhe = max<uint64_t>(1, c[kRunLheEvents]);
+    double cpuHours = max(1e-9, a.cpuSeconds / 3600.0);
+    double span = max<int64_t>(1, a.lastEnd - a.firstStart);
+    bool isMixer = program == "event_mixer";
+    char line[256];
+
+    snprintf(line, sizeof(line), "  %-16s runs %ld", program.c_str(), a.nRuns);
+    cout << line;
+    if (a.nWorkers > a.nRuns) cout << " (" << a.nWorkers << " shower workers)";
+    cout << endl;
+    snprintf(line, sizeof(line), "    %-18s %llu -> accepted %llu (%.3f%%), failed %llu",
+             isMixer ? "combinations" : "LHE events", (unsigned long long)c[kRunLheEvents],
+             (unsigned long long)c[kRunAccepted], 100.0 * c[kRunAccepted] / nLhe,
+             (unsigned long long)c[kRunFailed]);
+    cout << line << endl;
+    if (!isMixer) {
+        snprintf(line, sizeof(line), "    %-18s mean %.1f  p50 %.0f  p90 %.0f  p99 %.0f", "tries / LHE event",
+                 (double)c[kRunTries] / nLhe, a.tries.quantile(0.5), a.tries.quantile(0.9), a.tries.quantile(0.99));
+        cout << line << endl;
+        if (c[kRunVetoHard] + c[kRunVetoEvolution] > 0) {
+            // Records of the earlier three-stage veto
+            snprintf(line, sizeof(line), "    %-18s hard %llu  after ISR/FSR %llu  parton level %llu", "early veto",
+                     (unsigned long long)c[kRunVetoHard], (unsigned long long)c[kRunVetoEvolution],
+                     (unsigned long long)c[kRunVetoParton]);
+            cout << line << endl;
+        } else if (c[kRunVetoParton] > 0) {
+            snprintf(line, sizeof(line), "    %-18s %llu (parton level)", "early veto", (unsigned long long)c[kRunVetoParton]);
+            cout << line << endl;
+        }
+        if (c[kRunBudgetEvents] > 0) {
+            // Yield per try of the adaptive budget relative to maxRetry throughout
+            double fullAccepted = c[kRunFullBudgetAccepted] / 1000.0;
+            double gain = c[kRunAccepted] > 0 && fullAccepted > 0 && c[kRunTries] > 0
+                ? ((double)c[kRunAccepted] / c[kRunTries]) / (fullAccepted / max<uint64_t>(1, c[kRunFullBudgetTries]))
+                : 1.0;
+            snprintf(line, sizeof(line), "    %-18s mean %.1f, stopped %llu; at maxRetry %.1f accepted (x%.3f), yield/try x%.2f",
+                     "retry budget", (double)c[kRunBudgetSum] / c[kRunBudgetEvents],
+                     (unsigned long long)c[kRunBudgetStops], fullAccepted,
+                     fullAccepted / max<uint64_t>(1, c[kRunAccepted]), gain);
+            cout << line << endl;
+        }
+        if (c[kRunMemoHits] + c[kRunMemoRecorded] > 0) {
+            snprintf(line, sizeof(line), "    %-18s hits %llu  new %llu", "reject memo",
+                     (unsigned long long)c[kRunMemoHits], (unsigned long long)c[kRunMemoRecorded]);
+            cout << line << endl;
+        }
+    } else if (c[kRunInputEvents] > 0 || c[kRunNominalWeights] > 0) {
+        snprintf(line, sizeof(line), "    %-18s %llu summarized, %llu unused; nominal weight only %llu", "inputs",
+                 (unsigned long long)c[kRunInputEvents], (unsigned long long)c[kRunUnusedInputs],
+                 (unsigned long long)c[kRunNominalWeights]);
+        cout << line << endl;
+    }
+    cout << "    " << (isMixer ? "time / combination" : "time / LHE event  ")
+         << " mean " << formatSeconds(a.eventMicros.mean() * 1e-6)
+         << "  p50 " << formatSeconds(a.eventMicros.quantile(0.5) * 1e-6)
+         << "  p90 " << formatSeconds(a.eventMicros.quantile(0.9) * 1e-6)
+         << "  p99 " << formatSeconds(a.eventMicros.quantile(0.99) * 1e-6) << endl;
+    cout << "    job wall time      mean " << formatSeconds(a.wallSeconds / max(1L, a.nRuns))
+         << "  p50 " << formatSeconds(a.jobWallSeconds.quantile(0.5))
+         << "  p90 " << formatSeconds(a.jobWallSeconds.quantile(0.9))
+         << "  max " << formatSeconds(a.jobWallSeconds.quantile(1.0))
+         << "  (init " << formatSeconds(a.initSeconds / max(1L, a.nRuns)) << ")" << endl;
+    snprintf(line, sizeof(line), "    %-18s %.1f accepted / CPU h, %.1f %s / CPU h, CPU/wall %.2f, peak RSS %.0f MB",
+             "throughput", c[kRunAccepted] / cpuHours, c[kRunLheEvents] / cpuHours,
+             isMixer ? "combinations" : "LHE events", a.cpuSeconds / max(1e-9, a.wallSeconds), a.maxRssMB);
+    cout << line << endl;
+    snprintf(line, sizeof(line), "    %-18s %.1f accepted / h over %s", "fleet",
+             c[kRunAccepted] * 3600.0 / span, formatSeconds(span).c_str());
+    cout << line << endl;
+}
+
+void writeQuantiles(ostream& out, const char* name, const StatsHistogram& h, double scale) {
+    out << "\"" << name << "\": {\"entries\": " << h.entries() << ", \"mean\": " << h.mean() * scale
+        << ", \"p50\": " << h.quantile(0.5) * scale << ", \"p90\": " << h.quantile(0.9) * scale
+        << ", \"p99\": " << h.quantile(0.99) * scale << ", \"max\": " << h.quantile(1.0) * scale << "}";
+}
+
+void writeJson(ostream& out, const Report& report, size_t nRecords, size_t nUnreadable) {
+    out << "{\n  \"records\": " << nRecords << ",\n  \"unreadable\": " << nUnreadable << ",\n  \"groups\": [";
+    bool first = true;
+    for (const auto& entry : report) {
+        const RunAggregate& a = entry.second;
+        double cpuHours = max(1e-9, a.cpuSeconds / 3600.0);
+        out << (first ? "\n" : ",\n") << "    {\"group\": \"" << entry.first.first
+            << "\", \"program\": \"" << entry.first.second << "\", \"runs\": " << a.nRuns
+            << ", \"workers\": " << a.nWorkers << ",\n     \"counters\": {";
+        for (int i = 0; i < kNumRunCounters; ++i) {
+            out << (i ? ", " : "") << "\"" << kRunCounterNames[i] << "\": " << a.counters[i];
+        }
+        out << "},\n     \"efficiency\": " << (double)a.counters[kRunAccepted] / max<uint64_t>(1, a.counters[kRunLheEvents])
+            << ", \"init_sec\": " << a.initSeconds << ", \"loop_sec\": " << a.loopSeconds
+            << ", \"wall_sec\": " << a.wallSeconds << ", \"cpu_sec\": " << a.cpuSeconds
+            << ", \"max_rss_mb\": " << a.maxRssMB
+            << ",\n     \"accepted_per_cpu_hour\": " << a.counters[kRunAccepted] / cpuHours
+            << ", \"fleet_span_sec\": " << (a.lastEnd - a.firstStart) << ",\n     ";
+        writeQuantiles(out, "tries", a.tries, 1.0);
+        out << ",\n     ";
+        writeQuantiles(out, "event_sec", a.eventMicros, 1e-6);
+        out << ",\n     ";
+        writeQuantiles(out, "job_wall_sec", a.jobWallSeconds, 1.0);
+        out << "}";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> paths;
+    string jsonFile;
+    int nThreads = 16;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            jsonFile = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            nThreads = max(1, atoi(argv[++i]));
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    auto tStart = chrono::steady_clock::now();
+    vector<RecordFile> files;
+    for (const auto& path : paths) findRecords(path, files);
+
+    // Each thread merges its share of the files into its own report
+    nThreads = (int)min<size_t>(nThreads, max<size_t>(1, files.size()));
+    vector<Report> partial(nThreads);
+    vector<vector<string>> unreadable(nThreads);
+    atomic<size_t> next(0);
+    vector<thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            RunStats record;
+            for (size_t i = next++; i < files.size(); i = next++) {
+                if (!readRunStats(files[i].path, record)) {
+                    unreadable[t].push_back(files[i].path);
+                    continue;
+                }
+                partial[t][{files[i].group, record.program}].add(record);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    Report report;
+    vector<string> bad;
+    for (int t = 0; t < nThreads; ++t) {
+        for (const auto& entry : partial[t]) report[entry.first].add(entry.second);
+        bad.insert(bad.end(), unreadable[t].begin(), unreadable[t].end());
+    }
+    size_t nRecords = files.size() - bad.size();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - tStart).count();
+
+    if (jsonFile != "-") {
+        cout << "\n=== Run Statistics Report ===" << endl;
+        cout << "Records: " << nRecords << " (" << bad.size() << " unreadable), read in "
+             << formatSeconds(seconds) << " on " << nThreads << " threads" << endl;
+        sort(bad.begin(), bad.end());
+        for (size_t i = 0; i < bad.size() && i < 10; ++i) cout << "  unreadable: " << bad[i] << endl;
+        if (bad.size() > 10) cout << "  ... " << bad.size() - 10 << " more" << endl;
+
+        string group;
+        for (const auto& entry : report) {
+            if (entry.first.first != group) {
+                group = entry.first.first;
+                cout << "\n" << group << endl;
+            }
+            printAggregate(entry.first.second, entry.second);
+        }
+    }
+
+    if (jsonFile == "-") {
+        writeJson(cout, report, nRecords, bad.size());
+    } else if (!jsonFile.empty()) {
+        ofstream out(jsonFile);
+        writeJson(out, report, nRecords, bad.size());
+        if (!out.good()) {
+            cerr << "Error: Cannot write JSON report: " << jsonFile << endl;
+            return 1;
+        }
+        cout << "\nJSON report written to: " << jsonFile << endl;
+    }
+
+    return nRecords > 0 ? 0 : 1;
+}
@@ -0,0 +1,370 @@
+// ==============================================================================
+// selection_expr.h - Declarative event selection compiled to a predicate table
+// ==============================================================================
+// Lets the shower programs and the mixer take their cuts from the command line
+// (--select) instead of hand-written functions. An expression is parsed once at
+// startup into a flat table of terms and cuts; matching is a single pass over
+// the particles with no allocation.
+//
+// Grammar:
+//   expr    := clause ( OR clause )*
+//   clause  := term ( AND term )*
+//   term    := [N*] name ( pid ( | pid )* ) cut* [ -> daughter+ cut* ]
+//   cut     := pT>x  pT<x  |eta|<x  |eta|>x  eta>x  eta<x  (also >=, <=)
+//
+// - pids match either charge (|id|); a term counts matching particles that have
+//   decayed or are final, and needs at least N of them (default 1)
+// - cuts before "->" apply to the particle itself, cuts after the daughter list
+//   apply to every listed daughter
+// - daughters: mu+ mu- e+ e- K+ K- pi+ pi- p pbar gamma pi0; each must be found
+//   among the particle's daughters (charge-conjugated for negative mothers)
+// - counts are per expression evaluation, so the mixer can sum them over the
+//   events of all its sources
+//
+// Examples:
+//   onium(443|553|100553|200553)->mu+mu- pT>2.5 |eta|<2.4
+//   phi(333) pT>3 ->K+K- AND onium(443|553|100553|200553)->mu+mu- pT>2.5 |eta|<2.4
+//   2*jpsi(443)->mu+mu- pT>2.5 |eta|<2.4 AND phi(333)
+//
+// Cuts are compared in momentum space (pT^2, pz^2/pT^2; see SelectionCut), so
+// matching needs no sqrt or log. Particles with pT = 0 have |eta| = infinity.
+//
+// Event views (adapters) supply size(), id(i), isCandidate(i) (decayed or
+// final, and not an intermediate copy: a particle whose only daughter has its
+// id, so a hadron with recoil copies counts once for N*name terms), px/py/pz(i),
+// forEachInPidRange(min, max, f) calling f(i) for every particle with
+// min <= |id| <= max in order, and forEachDaughter(i, f) with
+// f(id, px, py, pz) -> true to stop; see PythiaEventView (shower_selection.h),
+// HepMC3EventView (hepmc_convert.h) and FlatEventView (flat_event.h, whose
+// pid range scan is vectorized). The views also supply isFinal(i) and
+// isCopy(i) for fillSummaryFromView (event_summary.h).
+//
+// Header-only, no external dependencies.
+// ==============================================================================
+
+#ifndef SELECTION_EXPR_H
+#define SELECTION_EXPR_H
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct SelectionCut {
+    enum Var { kPt, kEta, kAbsEta };
+    Var var;
+    bool greater;            // x > value (else x < value)
+    bool inclusive;          // >= / <=
+    double value;
+
+    // Set by prepare(): value in momentum space, or a constant result
+    double threshold = 0.0;
+    int constant = -1;
+
+    // pT, |eta| and eta are monotonic in pT^2, pz^2/pT^2 and pz|pz|/pT^2
+    void prepare() {
+        constant = -1;
+        if (var != kEta && value < 0.0) {
+            constant = greater ? 1 : 0;   // pT and |eta| are never negative
+            return;
+        }
+        double s = std::sinh(value);
+        threshold = (var == kPt) ? value * value : (var == kEta ? s * std::fabs(s) : s * s);
+    }
+
+    bool pass(double px, double py, double pz) const {
+        if (constant >= 0) return constant;
+        double pt2 = px * px + py * py;
+        double x = pt2, cut = threshold;
+        if (var != kPt) {
+            x = (var == kEta) ? pz * std::fabs(pz) : pz * pz;
+            cut = threshold * pt2;
+        }
+        if (greater) return inclusive ? x >= cut : x > cut;
+        return inclusive ? x <= cut : x < cut;
+    }
+};
+
+struct SelectionTerm {
+    std::string name;
+    int minCount = 1;
+    int firstCut = 0, nCuts = 0;                  // particle cuts (into the cut table)
+    int firstDaughter = 0, nDaughters = 0;        // daughter ids (into the daughter table)
+    int firstDaughterCut = 0, nDaughterCuts = 0;  // daughter cuts (into the cut table)
+};
+
+// Per-evaluation counters; reuse one across events to avoid allocation
+struct SelectionState {
+    std::vector<int> counts;
+};
+
+class SelectionProgram {
+public:
+    bool empty() const { return m_terms.empty(); }
+    const std::string& source() const { return m_source; }
+
+    // Parses the expression; on failure returns false with a message in error
+    bool compile(const std::string& expr, std::string& error) {
+        *this = SelectionProgram();
+        m_source = expr;
+        m_text = expr.c_str();
+        m_pos = 0;
+        m_clauses.emplace_back();
+        while (true) {
+            if (!parseTerm(error)) return false;
+            skipSpace();
+            if (acceptWord("AND")) continue;
+            if (acceptWord("OR")) {
+                m_clauses.emplace_back();
+                continue;
+            }
+            if (m_text[m_pos] != '\0') {
+                error = "unexpected '" + std::string(m_text + m_pos) + "'";
+                return false;
+            }
+            break;
+        }
+        m_text = nullptr;
+        return true;
+    }
+
+    void reset(SelectionState& state) const {
+        state.counts.assign(m_terms.size(), 0);
+    }
+
+    // One pass over the event; adds matches to the state
+    template <class View>
+    void accumulate(const View& view, SelectionState& state) const {
+        const int nKeys = m_keys.size();
+        view.forEachInPidRange(m_minPid, m_maxPid, [&](int i) {
+            int apid = std::abs(view.id(i));
+            for (int k = 0; k < nKeys; ++k) {
+                if (m_keys[k].pid != apid) continue;
+                int t = m_keys[k].term;
+                if (matches(view, i, m_terms[t])) state.counts[t]++;
+            }
+        });
+    }
+
+    bool satisfied(const SelectionState& state) const {
+        for (const auto& clause : m_clauses) {
+            bool ok = true;
+            for (int t : clause) {
+                if (state.counts[t] < m_terms[t].minCount) {
+                    ok = false;
+                    break;
+                }
+            }
+            if (ok) return true;
+        }
+        return false;
+    }
+
+    // Convenience for a single event
+    template <class View>
+    bool match(const View& view, SelectionState& state) const {
+        reset(state);
+        accumulate(view, state);
+        return satisfied(state);
+    }
+
+private:
+    struct PidKey { int pid; int term; };
+
+    template <class View>
+    bool matches(const View& view, int i, const SelectionTerm& term) const {
+        if (!view.isCandidate(i)) return false;
+        if (term.nCuts > 0) {
+            double px = view.px(i), py = view.py(i), pz = view.pz(i);
+            for (int c = term.firstCut; c < term.firstCut + term.nCuts; ++c) {
+                if (!m_cuts[c].pass(px, py, pz)) return false;
+            }
+        }
+        if (term.nDaughters == 0) return true;
+
+        // Each listed daughter must be found once among the daughters
+        int sign = view.id(i) < 0 ? -1 : 1;
+        unsigned found = 0;
+        const unsigned all = (1u << term.nDaughters) - 1;
+        view.forEachDaughter(i, [&](int id, double px, double py, double pz) {
+            for (int d = 0; d < term.nDaughters; ++d) {
+                if (found & (1u << d)) continue;
+                const DaughterId& want = m_daughters[term.firstDaughter + d];
+                int wantId = want.selfConjugate ? want.id : sign * want.id;
+                if (id != wantId) continue;
+                bool pass = true;
+                for (int c = term.firstDaughterCut; c < term.firstDaughterCut + term.nDaughterCuts; ++c) {
+                    if (!m_cuts[c].pass(px, py, pz)) {
+                        pass = false;
+                        break;
+                    }
+                }
+                if (pass) {
+                    found |= 1u << d;
+                    break;
+                }
+            }
+            return found == all;
+        });
+        return found == all;
+    }
+
+    // --- parsing ---
+
+    struct DaughterId { int id; bool selfConjugate; };
+
+    void skipSpace() {
+        while (m_text[m_pos] && std::isspace((unsigned char)m_text[m_pos])) ++m_pos;
+    }
+
+    bool accept(const char* s) {
+        skipSpace();
+        size_t len = strlen(s);
+        if (strncmp(m_text + m_pos, s, len) != 0) return false;
+        m_pos += len;
+        return true;
+    }
+
+    bool acceptWord(const char* s) {
+        skipSpace();
+        size_t len = strlen(s);
+        if (strncmp(m_text + m_pos, s, len) != 0) return false;
+        if (std::isalnum((unsigned char)m_text[m_pos + len])) return false;
+        m_pos += len;
+        return true;
+    }
+
+    bool parseNumber(double& value) {
+        skipSpace();
+        char* end = nullptr;
+        value = strtod(m_text + m_pos, &end);
+        if (end == m_text + m_pos) return false;
+        m_pos = end - m_text;
+        return true;
+    }
+
+    bool parseCut(SelectionCut& cut) {
+        size_t start = m_pos;
+        if (accept("|eta|")) cut.var = SelectionCut::kAbsEta;
+        else if (accept("pT")) cut.var = SelectionCut::kPt;
+        else if (accept("eta")) cut.var = SelectionCut::kEta;
+        else return false;
+
+        if (accept(">=")) { cut.greater = true; cut.inclusive = true; }
+        else if (accept("<=")) { cut.greater = false; cut.inclusive = true; }
+        else if (accept(">")) { cut.greater = true; cut.inclusive = false; }
+        else if (accept("<")) { cut.greater = false; cut.inclusive = false; }
+        else { m_pos = start; return false; }
+
+        if (!parseNumber(cut.value)) { m_pos = start; return false; }
+        cut.prepare();
+        return true;
+    }
+
+    void parseCuts(int& first, int& count) {
+        first = m_cuts.size();
+        SelectionCut cut;
+        while (parseCut(cut)) m_cuts.push_back(cut);
+        count = m_cuts.size() - first;
+    }
+
+    bool parseDaughter(DaughterId& d) {
+        // Longest names first so "pi0" is not read as "pi" + "0"
+        static const struct { const char* name; int id; bool selfConjugate; } table[] = {
+            {"gamma", 22, true}, {"pbar", -2212, false}, {"pi0", 111, true},
+            {"mu+", -13, false}, {"mu-", 13, false}, {"pi+", 211, false}, {"pi-", -211, false},
+            {"e+", -11, false}, {"e-", 11, false}, {"K+", 321, false}, {"K-", -321, false},
+            {"p", 2212, false},
+        };
+        skipSpace();
+        for (const auto& entry : table) {
+            size_t len = strlen(entry.name);
+            if (strncmp(m_text + m_pos, entry.name, len) != 0) continue;
+            // "p" must not swallow the start of "pT"
+            if (std::isalnum((unsigned char)entry.name[len - 1]) &&
+                std::isalnum((unsigned char)m_text[m_pos + len])) continue;
+            m_pos += len;
+            d.id = entry.id;
+            d.selfConjugate = entry.selfConjugate;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseTerm(std::string& error) {
+        SelectionTerm term;
+        skipSpace();
+
+        // Optional count "N*"
+        size_t start = m_pos;
+        double count = 0.0;
+        if (std::isdigit((unsigned char)m_text[m_pos]) && parseNumber(count) && accept("*")) {
+            term.minCount = (int)count;
+        } else {
+            m_pos = start;
+        }
+
+        skipSpace();
+        while (std::isalnum((unsigned char)m_text[m_pos]) || m_text[m_pos] == '_') {
+            term.name += m_text[m_pos++];
+        }
+        if (term.name.empty()) {
+            error = "expected a particle name at '" + std::string(m_text + m_pos) + "'";
+            return false;
+        }
+
+        if (!accept("(")) {
+            error = "expected '(' after " + term.name;
+            return false;
+        }
+        int termIndex = m_terms.size();
+        do {
+            double pid = 0.0;
+            if (!parseNumber(pid)) {
+                error = "expected a PDG id in " + term.name + "(...)";
+                return false;
+            }
+            int apid = std::abs((int)pid);
+            m_keys.push_back({apid, termIndex});
+            if (m_keys.size() == 1 || apid < m_minPid) m_minPid = apid;
+            if (m_keys.size() == 1 || apid > m_maxPid) m_maxPid = apid;
+        } while (accept("|"));
+        if (!accept(")")) {
+            error = "expected ')' in " + term.name + "(...)";
+            return false;
+        }
+
+        parseCuts(term.firstCut, term.nCuts);
+
+        if (accept("->")) {
+            term.firstDaughter = m_daughters.size();
+            DaughterId d;
+            while (parseDaughter(d)) m_daughters.push_back(d);
+            term.nDaughters = m_daughters.size() - term.firstDaughter;
+            if (term.nDaughters == 0 || term.nDaughters > 8) {
+                error = "expected 1-8 daughters after '->' in " + term.name;
+                return false;
+            }
+            parseCuts(term.firstDaughterCut, term.nDaughterCuts);
+        }
+
+        m_terms.push_back(term);
+        m_clauses.back().push_back(termIndex);
+        return true;
+    }
+
+    std::string m_source;
+    std::vector<SelectionTerm> m_terms;
+    std::vector<SelectionCut> m_cuts;
+    std::vector<DaughterId> m_daughters;
+    std::vector<PidKey> m_keys;
+    std::vector<std::vector<int>> m_clauses;  // OR of ANDs over term indices
+    int m_minPid = 0, m_maxPid = -1;
+
+    const char* m_text = nullptr;
+    size_t m_pos = 0;
+};
+
+#endif // SELECTION_EXPR_H
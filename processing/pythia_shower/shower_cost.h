@@ -0,0 +1,73 @@
+// ==============================================================================
+// shower_cost.h - Cost profile written by the shower programs (--calibrate)
+// ==============================================================================
+// A cost profile records how expensive one LHE event is for a given LHE pool
+// and shower mode: wall time per LHE event, accepted fraction and hadronization
+// retries. dag_generator.py (--cost-profile) uses it to size processing jobs
+// for a target wall time instead of consuming whole LHE files per job.
+//
+// The profile is a small flat JSON object:
+//   {"mode": "phi", "lhe_file": "...", "lhe_events": 200, "accepted_events": 37,
+//    "accept_fraction": 0.185, "avg_retries": 412.3, "init_sec": 4.1,
+//    "sec_per_lhe_event": 0.82, "sec_per_retry": 0.0020, "cuts": {...}}
+// plus "retry_budget" and "retry_yield_gain" for --adaptive-retry runs.
+// ==============================================================================
+
+#ifndef SHOWER_COST_H
+#define SHOWER_COST_H
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct CostProfile {
+    std::string mode;
+    std::string lheFile;
+    int lheEvents = 0;
+    int acceptedEvents = 0;
+    long totalRetries = 0;
+    double initSeconds = 0.0;
+    double loopSeconds = 0.0;
+    std::vector<std::pair<std::string, double>> cuts;
+    std::string selection;   // --select expression, if any
+    double retryBudget = 0.0;    // mean --adaptive-retry budget (0: fixed maxRetry)
+    double retryYieldGain = 1.0; // its accepted events per second relative to maxRetry
+};
+
+inline double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+inline bool writeCostProfile(const std::string& file, const CostProfile& p) {
+    std::ofstream out(file);
+    if (!out.is_open()) return false;
+
+    int n = std::max(1, p.lheEvents);
+    out << "{\n"
+        << "  \"mode\": \"" << p.mode << "\",\n"
+        << "  \"lhe_file\": \"" << p.lheFile << "\",\n"
+        << "  \"lhe_events\": " << p.lheEvents << ",\n"
+        << "  \"accepted_events\": " << p.acceptedEvents << ",\n"
+        << "  \"accept_fraction\": " << double(p.acceptedEvents) / n << ",\n"
+        << "  \"avg_retries\": " << double(p.totalRetries) / n << ",\n"
+        << "  \"init_sec\": " << p.initSeconds << ",\n"
+        << "  \"sec_per_lhe_event\": " << p.loopSeconds / n << ",\n"
+        << "  \"sec_per_retry\": " << p.loopSeconds / std::max(1L, p.totalRetries) << ",\n"
+        << "  \"cuts\": {";
+    for (size_t i = 0; i < p.cuts.size(); ++i) {
+        out << (i ? ", " : "") << "\"" << p.cuts[i].first << "\": " << p.cuts[i].second;
+    }
+    out << "}";
+    if (!p.selection.empty()) out << ",\n  \"selection\": \"" << p.selection << "\"";
+    if (p.retryBudget > 0.0) {
+        out << ",\n  \"retry_budget\": " << p.retryBudget
+            << ",\n  \"retry_yield_gain\": " << p.retryYieldGain;
+    }
+    out << "\n}\n";
+    return out.good();
+}
+
+#endif // SHOWER_COST_H
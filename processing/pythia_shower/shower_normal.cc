@@ -3,124 +3,224 @@
 // ==============================================================================
 // Performs parton shower + hadronization without phi meson enrichment.
 // Includes kinematic filtering for J/psi -> mu+ mu- decay products.
+// With --workers N, N forked workers share one Pythia initialization
+// (shower_workers.h). A run statistics record (--stats, run_stats.h) feeds the
+// fleet-wide report.
 //
 // Compilation (in CMSSW environment):
 //   g++ -std=c++17 -O2 shower_normal.cc -o shower_normal \
 //       $(pythia8-config --cxxflags --libs) \
-//       -I$HEPMC3/include -L$HEPMC3/lib64 -lHepMC3
+//       -I$HEPMC3/include -L$HEPMC3/lib64 -lHepMC3 -lzstd -llz4 -pthread
 //
 // Usage:
 //   ./shower_normal input.lhe output.hepmc [nEvents] [minMuonPt] [maxMuonEta] [maxRetry]
+//                [--skip N] [--calibrate K] [--cost-profile FILE] [--summary FILE|none]
+//                [--select EXPR] [--no-early-veto] [--reject-memo FILE] [--memo-retries N] [--memo-failures N]
+//                [--compress-threads N] [--workers N] [--stats FILE|none]
+//                [--adaptive-retry] [--retry-explore F] [--retry-bias-correction]
 // ==============================================================================
 
 #include "Pythia8/Pythia.h"
 #include "Pythia8Plugins/HepMC3.h"
 
+#include "shower_selection.h"
+#include "shower_cost.h"
+#include "shower_output.h"
+#include "shower_veto.h"
+#include "reject_memo.h"
+#include "shower_workers.h"
+#include "run_stats.h"
+#include "retry_budget.h"
+
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 using namespace Pythia8;
 using namespace std;
 
-// Check if J/psi decay muons satisfy kinematic requirements
-bool hasValidJpsiMuons(Event& event, double minPt = 2.5, double maxEta = 2.4) {
-    for (int i = 0; i < event.size(); ++i) {
-        if (abs(event[i].id()) != 443) continue; // Only J/psi
-        
-        int status = event[i].status();
-        if (status >= 0 && !event[i].isFinal()) continue;
-        
-        int d1 = event[i].daughter1();
-        int d2 = event[i].daughter2();
-        
-        if (d1 <= 0 || d2 <= 0) continue;
-        
-        bool foundMuPlus = false, foundMuMinus = false;
-        bool muPlusValid = false, muMinusValid = false;
-        
-        for (int j = d1; j <= d2; ++j) {
-            int pid = event[j].id();
-            if (pid == 13) { // mu-
-                foundMuMinus = true;
-                if (event[j].pT() > minPt && abs(event[j].eta()) < maxEta) {
-                    muMinusValid = true;
-                }
-            } else if (pid == -13) { // mu+
-                foundMuPlus = true;
-                if (event[j].pT() > minPt && abs(event[j].eta()) < maxEta) {
-                    muPlusValid = true;
-                }
-            }
-        }
-        
-        if (foundMuPlus && foundMuMinus && muPlusValid && muMinusValid) {
-            return true;
-        }
-    }
-    return false;
+void printUsage(const char* progName) {
+    cerr << "\n=== Pythia8 Standard Shower Processing ===" << endl;
+    cerr << "Usage: " << progName << " input.lhe output.hepmc [nEvents] [minMuonPt] [maxMuonEta] [maxRetry]" << endl;
+    cerr << "\nArguments:" << endl;
+    cerr << "  input.lhe   : Input LHE file" << endl;
+    cerr << "  output.hepmc: Output HepMC file (.hepb binary, .zst/.lz4 block-compressed)" << endl;
+    cerr << "  nEvents     : Number of LHE events to read (default: -1, all)" << endl;
+    cerr << "  minMuonPt   : Minimum muon pT in GeV (default: 2.5)" << endl;
+    cerr << "  maxMuonEta  : Maximum muon |eta| (default: 2.4)" << endl;
+    cerr << "  maxRetry    : Maximum hadronization retries (default: 100)" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --skip N           : Skip the first N LHE events" << endl;
+    cerr << "  --calibrate K      : Process K events and write a cost profile" << endl;
+    cerr << "  --cost-profile FILE: Cost profile output (default: cost_profile_normal.json)" << endl;
+    cerr << "  --summary FILE     : Per-event summary sidecar, 'none' to disable (default: output.hepmc.evsum)" << endl;
+    cerr << "  --select EXPR      : Selection expression replacing the built-in cuts (see selection_expr.h)," << endl;
+    cerr << "                       e.g. \"onium(443|553)->mu+mu- pT>2.5 |eta|<2.4\"" << endl;
+    cerr << "  --no-early-veto    : Do not abort events whose onia cannot pass the muon cuts" << endl;
+    cerr << "  --reject-memo FILE : Shared memo of LHE events that exhausted the retry budget" << endl;
+    cerr << "  --memo-retries N   : Retries for events found in the memo (default: 0, skip)" << endl;
+    cerr << "  --memo-failures N  : Full-budget failures (over all runs) before an event counts as" << endl;
+    cerr << "                       found in the memo (default: " << kMemoFailures << ")" << endl;
+    cerr << "  --compress-threads N: Compression threads for .zst/.lz4 outputs (default: 2)" << endl;
+    cerr << "  --workers N        : Fork N workers after initialization that share its tables" << endl;
+    cerr << "  --stats FILE       : Run statistics record, 'none' to disable (default: output.hepmc.runstats)" << endl;
+    cerr << "  --adaptive-retry   : Learn the retry budget (up to maxRetry) maximizing accepted events/CPU-s" << endl;
+    cerr << "  --retry-explore F  : Fraction of events kept at maxRetry with --adaptive-retry (default: 0.05)" << endl;
+    cerr << "  --retry-bias-correction: Record the full-budget acceptance weight in the summary sidecar" << endl;
 }
 
-// Check if Upsilon decay muons satisfy kinematic requirements
-bool hasValidUpsilonMuons(Event& event, double minPt = 2.5, double maxEta = 2.4) {
-    for (int i = 0; i < event.size(); ++i) {
-        int pid = abs(event[i].id());
-        // Upsilon(1S)=553, Upsilon(2S)=100553, Upsilon(3S)=200553
-        if (pid != 553 && pid != 100553 && pid != 200553) continue;
-        
-        int status = event[i].status();
-        if (status >= 0 && !event[i].isFinal()) continue;
-        
-        int d1 = event[i].daughter1();
-        int d2 = event[i].daughter2();
-        
-        if (d1 <= 0 || d2 <= 0) continue;
-        
-        bool foundMuPlus = false, foundMuMinus = false;
-        bool muPlusValid = false, muMinusValid = false;
-        
-        for (int j = d1; j <= d2; ++j) {
-            int pdgid = event[j].id();
-            if (pdgid == 13) { // mu-
-                foundMuMinus = true;
-                if (event[j].pT() > minPt && abs(event[j].eta()) < maxEta) {
-                    muMinusValid = true;
-                }
-            } else if (pdgid == -13) { // mu+
-                foundMuPlus = true;
-                if (event[j].pT() > minPt && abs(event[j].eta()) < maxEta) {
-                    muPlusValid = true;
-                }
-            }
-        }
-        
-        if (foundMuPlus && foundMuMinus && muPlusValid && muMinusValid) {
-            return true;
-        }
+// Event counts of a run; with --workers every worker sends its own to the parent
+struct NormalStats {
+    int iEvent = 0;
+    int totalRetries = 0;
+    int successEvents = 0;
+    int failedEvents = 0;
+    int nMemoHits = 0, nMemoRecorded = 0;
+    long nVetoed = 0;                   // early veto at parton level
+    StatsHistogram tries = {};          // hadronization tries per LHE event
+    StatsHistogram eventMicros = {};    // wall time per LHE event
+    RetryBudgetTally budget;            // --adaptive-retry (retry_budget.h)
+
+    // One LHE event done after nTries hadronizations (0: vetoed or skipped)
+    void countEvent(int nTries, chrono::steady_clock::time_point t0) {
+        ++iEvent;
+        tries.fill(nTries);
+        eventMicros.fill(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - t0).count());
     }
-    return false;
-}
+
+    void add(const NormalStats& o) {
+        iEvent += o.iEvent;
+        totalRetries += o.totalRetries;
+        successEvents += o.successEvents;
+        failedEvents += o.failedEvents;
+        nMemoHits += o.nMemoHits;
+        nMemoRecorded += o.nMemoRecorded;
+        nVetoed += o.nVetoed;
+        tries.add(o.tries);
+        eventMicros.add(o.eventMicros);
+        budget.add(o.budget);
+    }
+};
 
 int main(int argc, char* argv[]) {
+    auto tStart = chrono::steady_clock::now();
+    
+    // Positional arguments first; "--" options may appear anywhere
+    // (negative numbers such as nEvents = -1 stay positional)
+    vector<string> args;
+    int nSkip = 0;
+    int calibrateEvents = 0;
+    string costProfileFile;
+    string summaryFile;
+    string selectExpr;
+    bool useEarlyVeto = true;
+    string memoFile;
+    int memoRetries = 0;
+    int memoFailures = kMemoFailures;
+    int compressThreads = kDefaultCompressionThreads;
+    int nWorkers = 1;
+    string statsFile;
+    bool adaptiveRetry = false;
+    double retryExplore = 0.05;
+    bool retryBiasCorrection = false;
     
-    if (argc < 3) {
-        cerr << "\n=== Pythia8 Standard Shower Processing ===" << endl;
-        cerr << "Usage: " << argv[0] << " input.lhe output.hepmc [nEvents] [minMuonPt] [maxMuonEta] [maxRetry]" << endl;
-        cerr << "\nArguments:" << endl;
-        cerr << "  input.lhe   : Input LHE file" << endl;
-        cerr << "  output.hepmc: Output HepMC file" << endl;
-        cerr << "  nEvents     : Number of events to process (default: -1, all)" << endl;
-        cerr << "  minMuonPt   : Minimum muon pT in GeV (default: 2.5)" << endl;
-        cerr << "  maxMuonEta  : Maximum muon |eta| (default: 2.4)" << endl;
-        cerr << "  maxRetry    : Maximum hadronization retries (default: 100)" << endl;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--skip" && i + 1 < argc) {
+            nSkip = atoi(argv[++i]);
+        } else if (arg == "--calibrate" && i + 1 < argc) {
+            calibrateEvents = atoi(argv[++i]);
+        } else if (arg == "--cost-profile" && i + 1 < argc) {
+            costProfileFile = argv[++i];
+        } else if (arg == "--summary" && i + 1 < argc) {
+            summaryFile = argv[++i];
+        } else if (arg == "--select" && i + 1 < argc) {
+            selectExpr = argv[++i];
+        } else if (arg == "--no-early-veto") {
+            useEarlyVeto = false;
+        } else if (arg == "--reject-memo" && i + 1 < argc) {
+            memoFile = argv[++i];
+        } else if (arg == "--memo-retries" && i + 1 < argc) {
+            memoRetries = atoi(argv[++i]);
+        } else if (arg == "--memo-failures" && i + 1 < argc) {
+            memoFailures = max(1, atoi(argv[++i]));
+        } else if (arg == "--compress-threads" && i + 1 < argc) {
+            compressThreads = atoi(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            nWorkers = max(1, atoi(argv[++i]));
+        } else if (arg == "--stats" && i + 1 < argc) {
+            statsFile = argv[++i];
+        } else if (arg == "--adaptive-retry") {
+            adaptiveRetry = true;
+        } else if (arg == "--retry-explore" && i + 1 < argc) {
+            retryExplore = atof(argv[++i]);
+        } else if (arg == "--retry-bias-correction") {
+            retryBiasCorrection = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            cerr << "Error: Unknown option: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    
+    if (args.size() < 2) {
+        printUsage(argv[0]);
         return 1;
     }
     
-    string inputFile = argv[1];
-    string outputFile = argv[2];
-    int nEvents = (argc > 3) ? atoi(argv[3]) : -1;
-    double minMuonPt = (argc > 4) ? atof(argv[4]) : 2.5;
-    double maxMuonEta = (argc > 5) ? atof(argv[5]) : 2.4;
-    int maxRetry = (argc > 6) ? atoi(argv[6]) : 1000;
+    string inputFile = args[0];
+    string outputFile = args[1];
+    int nEvents = (args.size() > 2) ? atoi(args[2].c_str()) : -1;
+    double minMuonPt = (args.size() > 3) ? atof(args[3].c_str()) : 2.5;
+    double maxMuonEta = (args.size() > 4) ? atof(args[4].c_str()) : 2.4;
+    int maxRetry = (args.size() > 5) ? atoi(args[5].c_str()) : 1000;
+    
+    // Online retry budget below maxRetry (retry_budget.h)
+    RetryBudget adaptive;
+    if (adaptiveRetry) {
+        if (retryExplore < 0.0 || retryExplore > 1.0) {
+            cerr << "Error: --retry-explore must be between 0 and 1" << endl;
+            return 1;
+        }
+        adaptive.configure(maxRetry, retryExplore);
+    }
+    retryBiasCorrection = retryBiasCorrection && adaptiveRetry;
+    
+    // Selection expression, compiled once
+    SelectionProgram selection;
+    SelectionState selectionState;
+    if (!selectExpr.empty()) {
+        string error;
+        if (!selection.compile(selectExpr, error)) {
+            cerr << "Error: Invalid --select expression: " << error << endl;
+            return 1;
+        }
+        selection.reset(selectionState);
+        useEarlyVeto = false; // the veto only knows the built-in muon cuts
+    }
+    
+    // Per-event summary sidecar next to the HepMC output unless disabled
+    if (summaryFile.empty()) summaryFile = summaryPathFor(outputFile);
+    else if (summaryFile == "none") summaryFile.clear();
+    
+    // Run statistics record likewise
+    if (statsFile.empty()) statsFile = runStatsPathFor(outputFile);
+    else if (statsFile == "none") statsFile.clear();
+    
+    // Calibration: a short run whose timing goes into the cost profile
+    if (calibrateEvents > 0) {
+        if (nWorkers > 1) {
+            cerr << "Error: --calibrate measures a single process, drop --workers" << endl;
+            return 1;
+        }
+        nEvents = calibrateEvents;
+        if (costProfileFile.empty()) costProfileFile = "cost_profile_normal.json";
+    }
     
     cout << "\n=== Pythia8 Standard Shower Processing ===" << endl;
     cout << "Input LHE:    " << inputFile << endl;
@@ -129,6 +229,18 @@ int main(int argc, char* argv[]) {
     cout << "Min muon pT:  " << minMuonPt << " GeV" << endl;
     cout << "Max muon eta: " << maxMuonEta << endl;
     cout << "Max retries:  " << maxRetry << endl;
+    if (adaptive.enabled()) {
+        cout << "Retry budget: adaptive (explore " << 100.0 * retryExplore << "%"
+             << (retryBiasCorrection ? ", bias correction recorded" : "") << ")" << endl;
+    }
+    if (nSkip > 0) cout << "Skip events:  " << nSkip << endl;
+    if (!costProfileFile.empty()) cout << "Cost profile: " << costProfileFile << endl;
+    if (!summaryFile.empty()) cout << "Summary:      " << summaryFile << endl;
+    if (!selection.empty()) cout << "Selection:    " << selection.source() << endl;
+    cout << "Early veto:   " << (useEarlyVeto ? "on" : "off") << endl;
+    if (!memoFile.empty()) cout << "Reject memo:  " << memoFile << " (memo retries: " << memoRetries
+                                 << " after " << memoFailures << " failures)" << endl;
+    if (nWorkers > 1) cout << "Workers:      " << nWorkers << " (forked after initialization)" << endl;
     cout << "==========================================\n" << endl;
     
     // Initialize Pythia
@@ -137,6 +249,7 @@ int main(int argc, char* argv[]) {
     // Basic settings
     pythia.readString("Beams:frameType = 4"); // Read from LHEF
     pythia.readString("Beams:LHEF = " + inputFile);
+    if (nSkip > 0) pythia.readString("Beams:nSkipLHEFatInit = " + to_string(nSkip));
     pythia.readString("Beams:eCM = 13600."); // 13.6 TeV Run3
     
     // Shower settings
@@ -176,30 +289,107 @@ int main(int argc, char* argv[]) {
     pythia.readString("553:onMode = off");
     pythia.readString("553:onIfMatch = 13 -13");
     
+    // Early veto of events whose onia cannot give two accepted muons
+    // (shower_veto.h), at the end of the parton level
+    shared_ptr<EarlyVetoHook> earlyVeto;
+    if (useEarlyVeto) {
+        earlyVeto = make_shared<EarlyVetoHook>(minMuonPt, maxMuonEta);
+        pythia.setUserHooksPtr(earlyVeto);
+        pythia.readString("Check:abortIfVeto = on"); // next() returns false on a veto
+    }
+    
     // Initialize
+    auto tInit = chrono::steady_clock::now();
     if (!pythia.init()) {
         cerr << "Pythia initialization failed!" << endl;
         return 1;
     }
     
-    // HepMC3 output
-    Pythia8::Pythia8ToHepMC toHepMC(outputFile);
+    // Memo of hopeless LHE events, keyed by the acceptance settings
+    RejectMemo memo;
+    if (!memoFile.empty()) {
+        string settings = "shower_normal minMuonPt=" + to_string(minMuonPt) + " maxMuonEta=" + to_string(maxMuonEta) + " select=" + selection.source();
+        if (!memo.open(memoFile, memoSettingsKey(settings))) {
+            cerr << "Error: Cannot open reject memo: " << memoFile << endl;
+            return 1;
+        }
+        cout << "Reject memo entries for these settings: " << memo.size() << endl;
+    }
     
-    // Statistics
-    int iEvent = 0;
+    // Statistics (summed over the workers)
+    NormalStats stats;
     int iAbort = 0;
+    int nLheRead = 0;
     int maxAbort = 10;
-    int totalRetries = 0;
-    int successEvents = 0;
-    int failedEvents = 0;
     
-    cout << "Starting event processing..." << endl;
+    double initSeconds = secondsSince(tInit);
+    
+    // Forked workers share everything initialized so far (shower_workers.h);
+    // each showers its slice of the LHE file into its own output
+    ShowerWorkers<NormalStats> workers;
+    long lheFirst = nSkip;
+    string workerOutput = outputFile;
+    string workerSummary = summaryFile;
+    string logPrefix;
+    if (nWorkers > 1) {
+        long available = countLheEvents(inputFile);
+        if (available >= 0) available = max(0L, available - nSkip);
+        long nTotal = nEvents > 0 ? nEvents : available;
+        if (available >= 0) nTotal = min(nTotal, available);
+        if (nTotal <= 0) {
+            cerr << "Error: --workers needs nEvents (or a plain LHE file) to slice " << inputFile << endl;
+            return 1;
+        }
+        nWorkers = (int)min<long>(nWorkers, nTotal);
+        if (!workers.launch(nWorkers)) {
+            cerr << "Error: Cannot start " << nWorkers << " shower workers" << endl;
+            return 1;
+        }
+        if (workers.isWorker()) {
+            long first, count;
+            workerSlice(nTotal, nWorkers, workers.index(), first, count);
+            lheFirst += first;
+            nEvents = count;
+            workerOutput = workerOutputPath(outputFile, workers.index());
+            if (!summaryFile.empty()) workerSummary = summaryPathFor(workerOutput);
+            logPrefix = "[worker " + to_string(workers.index()) + "] ";
+            if (!prepareWorker(pythia, inputFile, lheFirst, workers.index())) {
+                cerr << logPrefix << "Error: Cannot position the LHE reader at event " << lheFirst << endl;
+                workers.finish(stats, false);
+            }
+        }
+    }
+    
+    // HepMC3 output (+ summary sidecar); the parent of workers only merges
+    ShowerOutput output;
+    if (!workers.isParent() && !output.open(workerOutput, workerSummary, "normal", compressThreads)) {
+        cerr << "Error: Cannot open output file: " << workerOutput
+             << (workerSummary.empty() ? "" : " / " + workerSummary) << endl;
+        if (workers.isWorker()) workers.finish(stats, false);
+        return 1;
+    }
+    
+    auto tLoop = chrono::steady_clock::now();
+    
+    if (!workers.isParent()) cout << logPrefix << "Starting event processing..." << endl;
     
-    while (true) {
-        if (nEvents > 0 && iEvent >= nEvents) break;
+    while (!workers.isParent()) {
+        // nEvents counts LHE events read, aborted ones included: a --skip/count
+        // range (LHE ledger lease, worker slice) must not run into the next one
+        if (nEvents > 0 && nLheRead >= nEvents) break;
+        auto tEvent = chrono::steady_clock::now();
         
         // Run parton level (without hadronization)
+        ++nLheRead;
+        if (earlyVeto) earlyVeto->clearVeto();
         if (!pythia.next()) {
+            if (earlyVeto && earlyVeto->vetoed()) {
+                // Doomed event: no hadronization retries
+                if (adaptive.enabled()) adaptive.addOverhead(secondsSince(tEvent));
+                stats.failedEvents++;
+                stats.countEvent(0, tEvent);
+                continue;
+            }
             if (pythia.info.atEndOfFile()) {
                 cout << "Reached end of LHE file." << endl;
                 break;
@@ -209,6 +399,30 @@ int main(int argc, char* argv[]) {
             break;
         }
         
+        // Events that already exhausted this retry budget memoFailures times get memoRetries
+        int retryBudget = maxRetry;
+        uint64_t eventHash = 0;
+        bool memoHit = false;
+        if (memo.isOpen()) {
+            eventHash = hardProcessHash(pythia.process);
+            if (memo.failures(eventHash, maxRetry) >= memoFailures) {
+                retryBudget = min(memoRetries, maxRetry);
+                memoHit = true;
+                stats.nMemoHits++;
+            }
+        }
+        if (retryBudget == 0) {
+            if (adaptive.enabled()) adaptive.addOverhead(secondsSince(tEvent));
+            stats.failedEvents++;
+            stats.countEvent(0, tEvent);
+            continue;
+        }
+        
+        // Learned budget for the others (maxRetry while exploring)
+        bool adaptiveEvent = adaptive.enabled() && !memoHit;
+        if (adaptiveEvent) retryBudget = adaptive.next();
+        auto tRetry = chrono::steady_clock::now();
+        
         // Save parton level state
         Event savedEvent = pythia.event;
         PartonSystems savedPartonSystems = pythia.partonSystems;
@@ -217,7 +431,7 @@ int main(int argc, char* argv[]) {
         bool foundValid = false;
         int nRetry = 0;
         
-        for (nRetry = 0; nRetry < maxRetry; ++nRetry) {
+        for (nRetry = 0; nRetry < retryBudget; ++nRetry) {
             pythia.event = savedEvent;
             pythia.partonSystems = savedPartonSystems;
             
@@ -225,9 +439,11 @@ int main(int argc, char* argv[]) {
                 continue;
             }
             
-            // Check muon kinematics
-            bool validMuons = hasValidJpsiMuons(pythia.event, minMuonPt, maxMuonEta) ||
-                              hasValidUpsilonMuons(pythia.event, minMuonPt, maxMuonEta);
+            // Check muon kinematics (or the --select expression)
+            bool validMuons = selection.empty()
+                ? (hasValidJpsiMuons(pythia.event, minMuonPt, maxMuonEta) ||
+                   hasValidUpsilonMuons(pythia.event, minMuonPt, maxMuonEta))
+                : selection.match(PythiaEventView{pythia.event}, selectionState);
             
             if (validMuons) {
                 foundValid = true;
@@ -235,35 +451,153 @@ int main(int argc, char* argv[]) {
             }
         }
         
-        totalRetries += nRetry + 1;
+        stats.totalRetries += nRetry + 1;
+        
+        // Acceptance weight of this budget, taken before the event updates the estimate
+        uint16_t retryCorrection = 0;
+        if (retryBiasCorrection && adaptiveEvent && foundValid) {
+            retryCorrection = (uint16_t)min(65535L, lround(1000.0 * adaptive.correction(retryBudget)));
+        }
+        if (adaptiveEvent) {
+            double overhead = chrono::duration<double>(tRetry - tEvent).count();
+            if (adaptive.observe(retryBudget, foundValid ? nRetry + 1 : nRetry, foundValid, overhead, secondsSince(tRetry))) {
+                cout << logPrefix << "Retry budget: " << adaptive.budget() << " of " << maxRetry
+                     << " after " << stats.iEvent + 1 << " events (modeled yield x" << adaptive.modelGain() << ")" << endl;
+            }
+        } else if (adaptive.enabled()) {
+            adaptive.addOverhead(secondsSince(tEvent));
+        }
+        
+        if (!foundValid && memo.isOpen() && retryBudget == maxRetry) {
+            memo.record(eventHash, maxRetry);
+            stats.nMemoRecorded++;
+        }
         
         if (foundValid) {
-            successEvents++;
-            toHepMC.writeNextEvent(pythia);
+            stats.successEvents++;
+            // Write to HepMC + summary
+            EventSummary summary;
+            fillEventSummary(pythia.event, minMuonPt, maxMuonEta, summary);
+            summary.lheIndex = lheFirst + nLheRead - 1;
+            summary.weight = pythia.info.weight();
+            summary.nRetries = nRetry + 1;
+            summary.retryCorrection = retryCorrection;
+            output.write(pythia, summary);
         } else {
-            failedEvents++;
+            stats.failedEvents++;
         }
         
-        ++iEvent;
-        if (iEvent % 100 == 0) {
-            double efficiency = 100.0 * successEvents / iEvent;
-            cout << "Processed " << iEvent << " events, "
+        stats.countEvent(nRetry + 1, tEvent);
+        if (stats.iEvent % 100 == 0) {
+            double efficiency = 100.0 * stats.successEvents / stats.iEvent;
+            cout << logPrefix << "Processed " << stats.iEvent << " events, "
                  << "efficiency: " << efficiency << "%" << endl;
         }
     }
     
-    pythia.stat();
+    double loopSeconds = secondsSince(tLoop);
+    output.close();
+    stats.budget = adaptive.tally();
+    if (earlyVeto) {
+        stats.nVetoed = earlyVeto->nVetoed();
+    }
+    
+    if (workers.isWorker()) workers.finish(stats, true);
+    if (workers.isParent()) {
+        if (!workers.collect(stats)) return 1;
+        string error;
+        if (!mergeWorkerOutputs(outputFile, summaryFile, nWorkers, "normal", compressThreads, error)) {
+            cerr << "Error: Cannot merge worker outputs: " << error << endl;
+            return 1;
+        }
+    } else {
+        pythia.stat();
+    }
     
     cout << "\n======================================================" << endl;
     cout << "Processing Summary:" << endl;
     cout << "------------------------------------------------------" << endl;
-    cout << "Total LHE events processed: " << iEvent << endl;
-    cout << "Events written:             " << successEvents 
-         << " (" << 100.0*successEvents/max(1,iEvent) << "%)" << endl;
-    cout << "Events skipped:             " << failedEvents << endl;
-    cout << "Average retries per event:  " << (double)totalRetries/max(1,iEvent) << endl;
+    cout << "Total LHE events processed: " << stats.iEvent << endl;
+    cout << "Events written:             " << stats.successEvents 
+         << " (" << 100.0*stats.successEvents/max(1,stats.iEvent) << "%)" << endl;
+    cout << "Events skipped:             " << stats.failedEvents << endl;
+    if (earlyVeto) {
+        cout << "  Early veto, parton level: " << stats.nVetoed << endl;
+    }
+    if (memo.isOpen()) {
+        cout << "  Reject memo hits:         " << stats.nMemoHits << endl;
+        cout << "  Reject memo new entries:  " << stats.nMemoRecorded << endl;
+    }
+    cout << "Average retries per event:  " << (double)stats.totalRetries/max(1,stats.iEvent) << endl;
+    if (adaptive.enabled()) {
+        const RetryBudgetTally& b = stats.budget;
+        cout << "Adaptive retry budget:      mean " << b.meanBudget() << " of " << maxRetry;
+        if (b.updates > 0) cout << " (chosen " << b.minBudget << "-" << b.maxBudget << ", " << b.updates << " updates)";
+        cout << endl;
+        cout << "  Exploring / stopped:      " << b.exploreEvents << " / " << b.stoppedEvents << " events" << endl;
+        cout << "  Accepted at maxRetry:     " << b.fullAccepted << " expected (bias correction x"
+             << b.fullAccepted / max(1L, b.accepted) << ")" << endl;
+        cout << "  Yield gain:               x" << b.yieldGain() << " accepted events per CPU-second" << endl;
+    }
     cout << "Output file: " << outputFile << endl;
+    if (workers.isParent()) {
+        cout << "------------------------------------------------------" << endl;
+        workers.printMemory(cout);
+    }
     cout << "======================================================" << endl;
     
+    // Run statistics record for the fleet-wide report (run_stats.h)
+    if (!statsFile.empty()) {
+        RunStats run;
+        initRunStats(run, "shower_normal", inputFile, outputFile);
+        run.nWorkers = nWorkers;
+        run.initSeconds = initSeconds;
+        run.loopSeconds = loopSeconds;
+        run.counters[kRunLheEvents] = stats.iEvent;
+        run.counters[kRunAccepted] = stats.successEvents;
+        run.counters[kRunFailed] = stats.failedEvents;
+        run.counters[kRunTries] = stats.totalRetries;
+        run.counters[kRunVetoParton] = stats.nVetoed;
+        run.counters[kRunMemoHits] = stats.nMemoHits;
+        run.counters[kRunMemoRecorded] = stats.nMemoRecorded;
+        run.counters[kRunBudgetEvents] = stats.budget.events;
+        run.counters[kRunBudgetStops] = stats.budget.stoppedEvents;
+        run.counters[kRunBudgetSum] = stats.budget.budgetSum;
+        if (adaptive.enabled()) {
+            run.counters[kRunFullBudgetAccepted] = llround(1000.0 * (stats.budget.fullAccepted + stats.successEvents - stats.budget.accepted));
+            run.counters[kRunFullBudgetTries] = stats.totalRetries + llround(stats.budget.fullExtraTries);
+        }
+        run.tries = stats.tries;
+        run.eventMicros = stats.eventMicros;
+        finishRunStats(run, tStart);
+        if (!writeRunStats(statsFile, run)) {
+            cerr << "Error: Cannot write run statistics: " << statsFile << endl;
+            return 1;
+        }
+    }
+    
+    if (!costProfileFile.empty()) {
+        CostProfile profile;
+        profile.mode = "normal";
+        profile.lheFile = inputFile;
+        profile.lheEvents = stats.iEvent;
+        profile.acceptedEvents = stats.successEvents;
+        profile.totalRetries = stats.totalRetries;
+        profile.initSeconds = initSeconds;
+        profile.loopSeconds = loopSeconds;
+        profile.cuts = {{"min_muon_pt", minMuonPt}, {"max_muon_eta", maxMuonEta},
+                        {"max_retry", double(maxRetry)}, {"early_veto", useEarlyVeto ? 1.0 : 0.0}};
+        profile.selection = selection.source();
+        if (adaptive.enabled()) {
+            profile.retryBudget = stats.budget.meanBudget();
+            profile.retryYieldGain = stats.budget.yieldGain();
+        }
+        if (!writeCostProfile(costProfileFile, profile)) {
+            cerr << "Error: Cannot write cost profile: " << costProfileFile << endl;
+            return 1;
+        }
+        cout << "Cost profile written to: " << costProfileFile << endl;
+    }
+    
     return 0;
 }
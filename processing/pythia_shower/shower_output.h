@@ -0,0 +1,105 @@
+// ==============================================================================
+// shower_output.h - HepMC3 output of the shower programs with summary sidecar
+// ==============================================================================
+// Writes events through HepMC3::WriterAscii on our own stream (instead of the
+// Pythia8ToHepMC convenience wrapper) so the byte offset of every event block
+// is known, and appends one EventSummary record per written event to the
+// sidecar (event_summary.h). The HepMC text is identical to the wrapper's.
+//
+// An output file ending in .hepb is written in the binary format instead
+// (hepmc_binary.h), straight from the flat event model (flat_pythia.h) without
+// building a HepMC3 graph; the sidecar then holds frame offsets.
+//
+// A name ending in .zst or .lz4 (e.g. shower_0.hepmc.zst) writes the ASCII
+// output block-compressed on a pool of threads (block_compress.h); sidecar
+// offsets stay uncompressed byte offsets.
+// ==============================================================================
+
+#ifndef SHOWER_OUTPUT_H
+#define SHOWER_OUTPUT_H
+
+#include "Pythia8/Pythia.h"
+#include "Pythia8Plugins/HepMC3.h"
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/WriterAscii.h"
+
+#include "block_compress.h"
+#include "event_summary.h"
+#include "flat_pythia.h"
+#include "hepmc_binary.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+class ShowerOutput {
+public:
+    ~ShowerOutput() { close(); }
+
+    // summaryFile may be empty to disable the sidecar; compressThreads is the
+    // compression pool size for .zst/.lz4 outputs
+    bool open(const std::string& hepmcFile, const std::string& summaryFile, const std::string& mode,
+              int compressThreads = kDefaultCompressionThreads) {
+        if (isBinaryEventFile(hepmcFile)) {
+            m_binary = fopen(hepmcFile.c_str(), "wb");
+            if (!m_binary || !writeBinaryFileHeader(m_binary)) return false;
+        } else {
+            if (!m_stream.open(hepmcFile, compressThreads)) return false;
+            m_writer.reset(new HepMC3::WriterAscii(m_stream));
+        }
+        if (!summaryFile.empty() && !m_summary.open(summaryFile, mode)) return false;
+        return true;
+    }
+
+    // Converts and writes the current Pythia event; summary gets the offset and index
+    bool write(Pythia8::Pythia& pythia, EventSummary& summary) {
+        if (m_binary) return writeBinary(pythia, summary);
+
+        HepMC3::GenEvent event;
+        if (!m_converter.fill_next_event(pythia, &event)) return false;
+
+        summary.hepmcOffset = (uint64_t)m_stream.tellp();
+        summary.eventIndex = m_nWritten++;
+        m_writer->write_event(event);
+
+        if (m_summary.isOpen()) m_summary.write(summary);
+        return !m_writer->failed();
+    }
+
+    void close() {
+        if (m_binary) fclose(m_binary);
+        m_binary = nullptr;
+        if (m_writer) m_writer->close();
+        m_writer.reset();
+        m_stream.close();
+        m_summary.close();
+    }
+
+    uint32_t nWritten() const { return m_nWritten; }
+
+private:
+    bool writeBinary(Pythia8::Pythia& pythia, EventSummary& summary) {
+        pythiaToFlat(pythia.event, m_flat);
+        m_flat.eventNumber = m_nWritten;
+        m_flat.weights.assign(1, pythia.info.weight());
+
+        summary.hepmcOffset = (uint64_t)ftello(m_binary);
+        summary.eventIndex = m_nWritten++;
+        bool ok = writeBinaryEvent(m_binary, m_flat);
+
+        if (m_summary.isOpen()) m_summary.write(summary);
+        return ok;
+    }
+
+    EventOutputStream m_stream;
+    std::unique_ptr<HepMC3::WriterAscii> m_writer;
+    HepMC3::Pythia8ToHepMC3 m_converter;
+    SummaryWriter m_summary;
+    uint32_t m_nWritten = 0;
+    FILE* m_binary = nullptr;
+    BinaryEvent m_flat;        // reused between events
+};
+
+#endif // SHOWER_OUTPUT_H
@@ -0,0 +1,184 @@
+// ==============================================================================
+// shower_selection.h - Event selection kernels shared by the shower programs
+// ==============================================================================
+// Kinematic checks run on the Pythia8 event record after every hadronization
+// attempt. Shared by shower_normal, shower_phi and the benchmark suite so that
+// the benchmarked code is exactly the code used in production.
+// ==============================================================================
+
+#ifndef SHOWER_SELECTION_H
+#define SHOWER_SELECTION_H
+
+#include "Pythia8/Pythia.h"
+
+#include "event_summary.h"
+#include "kinematics_simd.h"
+#include "selection_expr.h"
+
+#include <cstdlib>
+#include <cmath>
+
+// Check for phi meson satisfying pT requirement
+// Note: phi meson typically decays immediately, so status is negative (-83, -84)
+inline bool hasPhiMeson(Pythia8::Event& event, double minPt = 0.0) {
+    for (int i = 0; i < event.size(); ++i) {
+        int pid = std::abs(event[i].id());
+        if (pid == 333) { // phi meson
+            int status = event[i].status();
+            // phi usually has decayed (status < 0) or is final state
+            if ((status < 0) || event[i].isFinal()) {
+                if (event[i].pT() > minPt) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Check if J/psi decay muons satisfy kinematic requirements
+inline bool hasValidJpsiMuons(Pythia8::Event& event, double minPt = 2.5, double maxEta = 2.4) {
+    for (int i = 0; i < event.size(); ++i) {
+        if (std::abs(event[i].id()) != 443) continue; // Only J/psi
+
+        int status = event[i].status();
+        if (status >= 0 && !event[i].isFinal()) continue;
+
+        int d1 = event[i].daughter1();
+        int d2 = event[i].daughter2();
+
+        if (d1 <= 0 || d2 <= 0) continue;
+
+        const AcceptanceCut acceptance(minPt, maxEta);
+        bool foundMuPlus = false, foundMuMinus = false;
+        bool muPlusValid = false, muMinusValid = false;
+
+        for (int j = d1; j <= d2; ++j) {
+            int pdgid = event[j].id();
+            if (pdgid == 13) { // mu-
+                foundMuMinus = true;
+                if (acceptance.pass(event[j].px(), event[j].py(), event[j].pz())) {
+                    muMinusValid = true;
+                }
+            } else if (pdgid == -13) { // mu+
+                foundMuPlus = true;
+                if (acceptance.pass(event[j].px(), event[j].py(), event[j].pz())) {
+                    muPlusValid = true;
+                }
+            }
+        }
+
+        if (foundMuPlus && foundMuMinus && muPlusValid && muMinusValid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check if Upsilon decay muons satisfy kinematic requirements
+inline bool hasValidUpsilonMuons(Pythia8::Event& event, double minPt = 2.5, double maxEta = 2.4) {
+    for (int i = 0; i < event.size(); ++i) {
+        int pid = std::abs(event[i].id());
+        // Upsilon(1S)=553, Upsilon(2S)=100553, Upsilon(3S)=200553
+        if (pid != 553 && pid != 100553 && pid != 200553) continue;
+
+        int status = event[i].status();
+        if (status >= 0 && !event[i].isFinal()) continue;
+
+        int d1 = event[i].daughter1();
+        int d2 = event[i].daughter2();
+
+        if (d1 <= 0 || d2 <= 0) continue;
+
+        const AcceptanceCut acceptance(minPt, maxEta);
+        bool foundMuPlus = false, foundMuMinus = false;
+        bool muPlusValid = false, muMinusValid = false;
+
+        for (int j = d1; j <= d2; ++j) {
+            int pdgid = event[j].id();
+            if (pdgid == 13) { // mu-
+                foundMuMinus = true;
+                if (acceptance.pass(event[j].px(), event[j].py(), event[j].pz())) {
+                    muMinusValid = true;
+                }
+            } else if (pdgid == -13) { // mu+
+                foundMuPlus = true;
+                if (acceptance.pass(event[j].px(), event[j].py(), event[j].pz())) {
+                    muPlusValid = true;
+                }
+            }
+        }
+
+        if (foundMuPlus && foundMuMinus && muPlusValid && muMinusValid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Count particles for statistics
+inline void countParticles(Pythia8::Event& event, int& nJpsi, int& nUpsilon, int& nPhi, int& nMuon) {
+    nJpsi = 0;
+    nUpsilon = 0;
+    nPhi = 0;
+    nMuon = 0;
+
+    for (int i = 0; i < event.size(); ++i) {
+        int pid = std::abs(event[i].id());
+        int status = event[i].status();
+
+        if ((status < 0) || event[i].isFinal()) {
+            if (pid == 443) nJpsi++;
+            else if (pid == 553 || pid == 100553 || pid == 200553) nUpsilon++;
+            else if (pid == 333) nPhi++;
+            else if (pid == 13) nMuon++;
+        }
+    }
+}
+
+// Pythia8 event view for SelectionProgram (selection_expr.h); "candidates" are
+// the particles the hand-written checks above look at (decayed or final),
+// last copies only, as in fillEventSummary
+struct PythiaEventView {
+    Pythia8::Event& event;
+
+    int size() const { return event.size(); }
+    int id(int i) const { return event[i].id(); }
+    bool isFinal(int i) const { return event[i].isFinal(); }
+    bool isCandidate(int i) const { return (event[i].status() < 0 || event[i].isFinal()) && !isCopy(i); }
+    // Intermediate (recoil/shower) copy: its only daughter has the same id
+    bool isCopy(int i) const {
+        int d1 = event[i].daughter1();
+        return d1 > 0 && d1 == event[i].daughter2() && event[d1].id() == event[i].id();
+    }
+    double px(int i) const { return event[i].px(); }
+    double py(int i) const { return event[i].py(); }
+    double pz(int i) const { return event[i].pz(); }
+
+    template <class F>
+    void forEachInPidRange(int minAbs, int maxAbs, F&& f) const {
+        for (int i = 0; i < event.size(); ++i) {
+            int a = event[i].idAbs();
+            if (a >= minAbs && a <= maxAbs) f(i);
+        }
+    }
+
+    template <class F>
+    void forEachDaughter(int i, F&& f) const {
+        int d1 = event[i].daughter1();
+        int d2 = event[i].daughter2();
+        if (d1 <= 0 || d2 <= 0) return;
+        for (int j = d1; j <= d2; ++j) {
+            if (f(event[j].id(), event[j].px(), event[j].py(), event[j].pz())) return;
+        }
+    }
+};
+
+// Per-event facts for the summary sidecar (event_summary.h, fillSummaryFromView).
+// Bookkeeping fields (offset, indices, weight, retries) are left to the caller.
+inline void fillEventSummary(Pythia8::Event& event, double minMuonPt, double maxMuonEta,
+                             EventSummary& summary) {
+    fillSummaryFromView(PythiaEventView{event}, minMuonPt, maxMuonEta, summary);
+}
+
+#endif // SHOWER_SELECTION_H
@@ -0,0 +1,91 @@
+// ==============================================================================
+// shower_veto.h - Early veto of events whose onia cannot pass the muon cuts
+// ==============================================================================
+// UserHooks for shower_normal/shower_phi. pythia.next() runs the full ISR/FSR/
+// MPI evolution and the programs then retry hadronization up to maxRetry
+// times; for an event whose onia can never give two muons in acceptance the
+// retries are wasted. The hook aborts such events at the end of the parton
+// level, where the onium kinematics are final (only the decay is left), so no
+// margin is needed and the veto is exact.
+//
+// Earlier stages (hard process, after ISR/FSR) are deliberately not vetoed:
+// the bound would need a margin for ISR recoil and primordial kT of the order
+// of 10 GeV, which leaves mT > 2 minMuonPt as the only test, and every J/psi or
+// Upsilon passes that at the usual cuts. They also cannot see b quarks or onia
+// that later shower branchings produce, so they would not be conservative.
+//
+// Both muons must come from one onium (as in hasValidJpsiMuons). Necessary
+// conditions for an onium (or any ancestor state) of transverse mass mT and
+// rapidity y, in its pz = 0 frame where the decay products share energy mT:
+//   - transverse budget: pT(mu1) + pT(mu2) <= mT, so mT > 2 minMuonPt
+//   - rapidity budget:   each muon has E < mT - minMuonPt, so its rapidity
+//                        relative to the onium is below acosh((mT - minPt)/minPt),
+//                        and |y| <= |eta| for a massive particle
+//
+// Only events with onia are considered (other sources, e.g. gg dijets, are
+// never vetoed), and events with b quarks (non-prompt J/psi) are never vetoed.
+// ==============================================================================
+
+#ifndef SHOWER_VETO_H
+#define SHOWER_VETO_H
+
+#include "Pythia8/Pythia.h"
+
+#include <cmath>
+#include <cstdlib>
+
+// Charmonium/bottomonium states, including colour-octet ids (99xxxxx)
+inline bool isOniumLike(int id) {
+    int code = std::abs(id) % 1000;
+    return (code >= 441 && code <= 449) || (code >= 551 && code <= 559);
+}
+
+// Necessary condition for the onium to give two accepted muons
+inline bool oniumCanPass(const Pythia8::Particle& p, double minMuonPt, double maxMuonEta) {
+    double mT = p.mT();
+    if (mT <= 2.0 * minMuonPt) return false;
+    if (minMuonPt <= 0.0) return true;
+    double maxRelY = std::acosh((mT - minMuonPt) / minMuonPt);
+    return std::abs(p.y()) - maxRelY < maxMuonEta;
+}
+
+class EarlyVetoHook : public Pythia8::UserHooks {
+public:
+    EarlyVetoHook(double minMuonPt, double maxMuonEta)
+        : m_minMuonPt(minMuonPt), m_maxMuonEta(maxMuonEta) {}
+
+    bool canVetoPartonLevel() override { return true; }
+    bool doVetoPartonLevel(const Pythia8::Event& event) override {
+        if (!doomed(event)) return false;
+        m_vetoed = true;
+        m_nVetoed++;
+        return true;
+    }
+
+    // Call before pythia.next(); afterwards tells a veto from a failure
+    void clearVeto() { m_vetoed = false; }
+    bool vetoed() const { return m_vetoed; }
+
+    long nVetoed() const { return m_nVetoed; }
+
+private:
+    // True only if the event has onia and none of them can pass
+    bool doomed(const Pythia8::Event& event) const {
+        bool hasOnium = false;
+        for (int i = 0; i < event.size(); ++i) {
+            const Pythia8::Particle& p = event[i];
+            if (!p.isFinal()) continue;
+            if (std::abs(p.id()) == 5) return false;
+            if (!isOniumLike(p.id())) continue;
+            hasOnium = true;
+            if (oniumCanPass(p, m_minMuonPt, m_maxMuonEta)) return false;
+        }
+        return hasOnium;
+    }
+
+    double m_minMuonPt, m_maxMuonEta;
+    bool m_vetoed = false;
+    long m_nVetoed = 0;
+};
+
+#endif // SHOWER_VETO_H
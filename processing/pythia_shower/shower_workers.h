@@ -0,0 +1,419 @@
+// ==============================================================================
+// shower_workers.h - Forked shower workers sharing one initialized Pythia
+// ==============================================================================
+// Pythia8::init() builds the particle data, PDF grids, MPI/cross-section
+// tables and shower setup; that state is read-only during event generation but
+// costs every independent shower process the same few hundred MB. With
+// --workers N the shower programs initialize once and then fork N workers:
+// the initialized tables stay shared copy-on-write between them and only the
+// pages a worker actually writes (event records, buffers) become private.
+//
+// - Each worker gets a contiguous slice of the LHE events, its own LHE reader
+//   (a forked reader would share the file offset of the parent's) and its own
+//   random number stream (worker 0 keeps the parent's, so a one-worker run is
+//   identical to a plain run).
+// - Worker k writes out.wK.hepmc (+ sidecar); the parent concatenates them into
+//   the requested output and sidecar, renumbering events and rewriting the
+//   offsets, so downstream steps see one file as before.
+// - Every worker reports its counters and its memory (/proc/self/smaps_rollup)
+//   through a pipe; the parent prints RSS, PSS and private memory per worker.
+//   The private memory is the cost of one more worker on the node.
+//
+// Linux only (fork, /proc).
+// ==============================================================================
+
+#ifndef SHOWER_WORKERS_H
+#define SHOWER_WORKERS_H
+
+#include "Pythia8/Pythia.h"
+
+#include "block_compress.h"
+#include "event_summary.h"
+#include "hepmc_binary.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Pythia's seed when Random:setSeed is off
+const int kDefaultPythiaSeed = 19780503;
+
+// ------------------------------------------------------------------------------
+// Memory accounting
+// ------------------------------------------------------------------------------
+
+struct MemoryUsage {
+    double rssMB = 0.0;      // resident pages, shared ones counted in full
+    double pssMB = 0.0;      // shared pages divided among the processes mapping them
+    double privateMB = 0.0;  // pages mapped by this process only
+};
+
+// Reads the memory of the calling process; smaps_rollup needs Linux >= 4.14,
+// older kernels only give VmRSS (then pss = private = rss)
+inline bool readMemoryUsage(MemoryUsage& usage) {
+    usage = MemoryUsage();
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string key;
+    double kB;
+    if (in.is_open()) {
+        while (in >> key) {
+            if (!(in >> kB)) {
+                in.clear();
+            } else if (key == "Rss:") {
+                usage.rssMB = kB / 1024.0;
+            } else if (key == "Pss:") {
+                usage.pssMB = kB / 1024.0;
+            } else if (key == "Private_Clean:" || key == "Private_Dirty:") {
+                usage.privateMB += kB / 1024.0;
+            }
+            in.ignore(1 << 20, '\n');
+        }
+        if (usage.rssMB > 0.0) return true;
+    }
+
+    std::ifstream status("/proc/self/status");
+    while (status >> key) {
+        if (key == "VmRSS:" && status >> kB) {
+            usage.rssMB = usage.pssMB = usage.privateMB = kB / 1024.0;
+            return true;
+        }
+        status.ignore(1 << 20, '\n');
+    }
+    return false;
+}
+
+// ------------------------------------------------------------------------------
+// Slicing and per-worker setup
+// ------------------------------------------------------------------------------
+
+// Number of <event> blocks in a plain-text LHE file, -1 if it cannot be read
+// (or is gzipped)
+inline long countLheEvents(const std::string& lheFile) {
+    if (lheFile.size() > 3 && lheFile.compare(lheFile.size() - 3, 3, ".gz") == 0) return -1;
+    std::ifstream in(lheFile);
+    if (!in.is_open()) return -1;
+    long n = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t i = line.find_first_not_of(" \t");
+        if (i != std::string::npos && line.compare(i, 6, "<event") == 0 &&
+            (line.size() == i + 6 || line[i + 6] == '>' || line[i + 6] == ' ')) ++n;
+    }
+    return n;
+}
+
+// First LHE event (relative to the run's own start) and count of worker k
+inline void workerSlice(long nEvents, int nWorkers, int worker, long& first, long& count) {
+    first = nEvents * worker / nWorkers;
+    count = nEvents * (worker + 1) / nWorkers - first;
+}
+
+// Output of worker k, keeping the extensions that select the format
+// (shower_1.hepmc.zst -> shower_1.w0.hepmc.zst); the parent merges these
+inline std::string workerOutputPath(const std::string& output, int worker) {
+    size_t base = output.find_last_of('/');
+    size_t dot = output.find('.', base == std::string::npos ? 0 : base + 1);
+    if (dot == std::string::npos) dot = output.size();
+    return output.substr(0, dot) + ".w" + std::to_string(worker) + output.substr(dot);
+}
+
+// Gives a forked worker its own LHE reader, positioned at LHE event lheEvent,
+// and (for worker > 0) its own random number stream. Beams:newLHEFsameInit
+// swaps the reader without redoing the rest of the initialization.
+inline bool prepareWorker(Pythia8::Pythia& pythia, const std::string& lheFile, long lheEvent, int worker) {
+    pythia.readString("Beams:newLHEFsameInit = on");
+    pythia.readString("Beams:nSkipLHEFatInit = 0");
+    pythia.readString("Beams:LHEF = " + lheFile);
+    if (!pythia.init()) return false;
+    if (lheEvent > 0 && !pythia.LHAeventSkip(lheEvent)) return false;
+    if (worker > 0) {
+        int seed = pythia.settings.flag("Random:setSeed") ? pythia.settings.mode("Random:seed") : -1;
+        if (seed < 1) seed = kDefaultPythiaSeed;
+        pythia.rndm.init(seed + worker);
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------
+// Worker processes
+// ------------------------------------------------------------------------------
+
+// Stats is the program's plain counter struct with add(const Stats&)
+template <class Stats>
+class ShowerWorkers {
+    static_assert(std::is_trivially_copyable<Stats>::value, "worker stats are sent through a pipe");
+
+public:
+    struct Report {
+        int ok = 0;
+        MemoryUsage memory;
+        Stats stats;
+    };
+
+    // Forks nWorkers processes. Returns in every worker (index() >= 0) and in
+    // the parent (isParent()); false if a fork failed
+    bool launch(int nWorkers) {
+        readMemoryUsage(m_parentMemory);
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(stdout);
+
+        m_reports.assign(nWorkers, Report());
+        for (int k = 0; k < nWorkers; ++k) {
+            int fds[2];
+            if (pipe(fds) != 0) return false;
+            pid_t pid = fork();
+            if (pid < 0) {
+                close(fds[0]);
+                close(fds[1]);
+                return false;
+            }
+            if (pid == 0) {
+                prctl(PR_SET_PDEATHSIG, SIGTERM);
+                close(fds[0]);
+                for (const Child& c : m_children) close(c.pipe);
+                m_children.clear();
+                m_pipe = fds[1];
+                m_index = k;
+                m_nWorkers = nWorkers;
+                return true;
+            }
+            close(fds[1]);
+            m_children.push_back(Child{pid, fds[0]});
+        }
+        m_nWorkers = nWorkers;
+        return true;
+    }
+
+    bool isParent() const { return m_nWorkers > 0 && m_index < 0; }
+    bool isWorker() const { return m_index >= 0; }
+    int index() const { return m_index; }
+    int size() const { return m_nWorkers; }
+
+    // Worker: sends counters and memory usage to the parent and exits
+    [[noreturn]] void finish(const Stats& stats, bool ok) {
+        Report report;
+        report.ok = ok;
+        readMemoryUsage(report.memory);
+        report.stats = stats;
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(stdout);
+        bool sent = write(m_pipe, &report, sizeof(report)) == (ssize_t)sizeof(report);
+        close(m_pipe);
+        _exit(ok && sent ? 0 : 1);
+    }
+
+    // Parent: waits for all workers and adds up their counters; false if one failed
+    bool collect(Stats& total) {
+        bool ok = true;
+        for (size_t k = 0; k < m_children.size(); ++k) {
+            Report& report = m_reports[k];
+            size_t got = 0;
+            while (got < sizeof(report)) {
+                ssize_t n = read(m_children[k].pipe, (char*)&report + got, sizeof(report) - got);
+                if (n <= 0) break;
+                got += n;
+            }
+            close(m_children[k].pipe);
+            int status = 0;
+            waitpid(m_children[k].pid, &status, 0);
+            if (got != sizeof(report) || !report.ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "Error: Shower worker " << k << " failed" << std::endl;
+                report = Report();
+                ok = false;
+                continue;
+            }
+            total.add(report.stats);
+        }
+        m_children.clear();
+        return ok;
+    }
+
+    const Report& report(int k) const { return m_reports[k]; }
+
+    // Parent: per-worker memory and the node total against independent processes
+    void printMemory(std::ostream& out) const {
+        double sumPrivate = 0.0, sumRss = 0.0;
+        char line[160];
+        out << "Memory (MB, at the end of each worker):" << std::endl;
+        snprintf(line, sizeof(line), "  parent after init: RSS %8.1f", m_parentMemory.rssMB);
+        out << line << std::endl;
+        for (size_t k = 0; k < m_reports.size(); ++k) {
+            const MemoryUsage& m = m_reports[k].memory;
+            snprintf(line, sizeof(line), "  worker %-3zu        RSS %8.1f  PSS %8.1f  private %8.1f",
+                     k, m.rssMB, m.pssMB, m.privateMB);
+            out << line << std::endl;
+            sumPrivate += m.privateMB;
+            sumRss += m.rssMB;
+        }
+        int n = std::max(1, (int)m_reports.size());
+        double shared = m_parentMemory.rssMB + sumPrivate;
+        snprintf(line, sizeof(line), "  per additional worker: %.1f (independent process: %.1f)",
+                 sumPrivate / n, sumRss / n);
+        out << line << std::endl;
+        snprintf(line, sizeof(line), "  node total: %.1f (%d independent processes: %.1f, %.1fx)",
+                 shared, n, sumRss, shared > 0.0 ? sumRss / shared : 0.0);
+        out << line << std::endl;
+    }
+
+private:
+    struct Child {
+        pid_t pid;
+        int pipe;
+    };
+
+    int m_nWorkers = 0;
+    int m_index = -1;
+    int m_pipe = -1;
+    std::vector<Child> m_children;
+    std::vector<Report> m_reports;
+    MemoryUsage m_parentMemory;
+};
+
+// ------------------------------------------------------------------------------
+// Merging the worker outputs
+// ------------------------------------------------------------------------------
+
+// Concatenates the nWorkers worker outputs (workerOutputPath) into output and,
+// unless summaryFile is empty, their sidecars into summaryFile. Events are
+// renumbered and sidecar offsets/indices rewritten as if one process had
+// written the file; the worker files are removed on success
+inline bool mergeWorkerOutputs(const std::string& output, const std::string& summaryFile, int nWorkers,
+                               const std::string& mode, int compressThreads, std::string& error) {
+    EventOutputStream out;
+    if (!out.open(output, compressThreads)) {
+        error = "cannot open " + output;
+        return false;
+    }
+    bool binary = isBinaryEventFile(output);
+    std::vector<uint64_t> offsets;  // output offset of every event
+    uint64_t outPos = 0;
+    int64_t eventBase = 0;
+
+    std::string header, line;
+    std::vector<char> payload;
+    bool headerDone = false;
+    for (int k = 0; k < nWorkers; ++k) {
+        std::string file = workerOutputPath(output, k);
+        EventInputStream in;
+        if (!in.open(file, compressThreads)) {
+            error = "cannot open " + file;
+            return false;
+        }
+        int64_t nEvents = 0;
+        if (binary) {
+            // File header once, then the event frames with shifted event numbers
+            char fileHeader[4 + 3 * sizeof(uint32_t)];
+            if (!in.read(fileHeader, sizeof(fileHeader))) {
+                error = "truncated " + file;
+                return false;
+            }
+            if (k == 0) {
+                out.write(fileHeader, sizeof(fileHeader));
+                outPos += sizeof(fileHeader);
+            }
+            uint32_t frame[2];
+            int64_t eventNumber;
+            while (in.read((char*)frame, sizeof(frame)) && in.read((char*)&eventNumber, sizeof(eventNumber))) {
+                payload.resize(frame[1]);
+                if (frame[0] != kBinaryFrameMagic || !in.read(payload.data(), payload.size())) {
+                    error = "corrupt frame in " + file;
+                    return false;
+                }
+                eventNumber += eventBase;
+                offsets.push_back(outPos);
+                out.write((const char*)frame, sizeof(frame));
+                out.write((const char*)&eventNumber, sizeof(eventNumber));
+                out.write(payload.data(), payload.size());
+                outPos += sizeof(frame) + sizeof(eventNumber) + payload.size();
+                ++nEvents;
+            }
+            eventBase += nEvents;
+            continue;
+        }
+
+        // HepMC3 ASCII: the header (with run info) of the first worker with
+        // events, the event blocks of all, and one end-of-listing line
+        std::string preamble;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 33, "HepMC::Asciiv3-END_EVENT_LISTING") == 0) break;
+            if (line.compare(0, 2, "E ") == 0) {
+                if (!headerDone) {
+                    out << preamble;
+                    outPos += preamble.size();
+                    headerDone = true;
+                }
+                // "E <number> <nVertices> <nParticles> ..."
+                size_t end = line.find(' ', 2);
+                if (end == std::string::npos) end = line.size();
+                long long number = atoll(line.c_str() + 2) + eventBase;
+                line = "E " + std::to_string(number) + line.substr(end);
+                offsets.push_back(outPos);
+                ++nEvents;
+            }
+            if (nEvents > 0) {
+                out << line << '\n';
+                outPos += line.size() + 1;
+            } else {
+                preamble += line + '\n';
+            }
+        }
+        if (k == 0) header = preamble;
+        eventBase += nEvents;
+    }
+    if (!binary) {
+        if (!headerDone) out << header;
+        out << "HepMC::Asciiv3-END_EVENT_LISTING\n\n";
+    }
+    if (!out.close()) {
+        error = "cannot write " + output;
+        return false;
+    }
+
+    if (!summaryFile.empty()) {
+        SummaryWriter writer;
+        if (!writer.open(summaryFile, mode)) {
+            error = "cannot open " + summaryFile;
+            return false;
+        }
+        // One record per written event, in event order
+        uint32_t index = 0;
+        for (int k = 0; k < nWorkers; ++k) {
+            std::string file = summaryPathFor(workerOutputPath(output, k));
+            SummaryFile sidecar;
+            if (!sidecar.open(file)) {
+                error = "cannot read " + file;
+                return false;
+            }
+            for (size_t i = 0; i < sidecar.size() && index < offsets.size(); ++i, ++index) {
+                EventSummary record = sidecar[i];
+                record.hepmcOffset = offsets[index];
+                record.eventIndex = index;
+                writer.write(record);
+            }
+        }
+        writer.close();
+    }
+
+    for (int k = 0; k < nWorkers; ++k) {
+        std::string file = workerOutputPath(output, k);
+        unlink(file.c_str());
+        if (!summaryFile.empty()) unlink(summaryPathFor(file).c_str());
+    }
+    return true;
+}
+
+#endif // SHOWER_WORKERS_H
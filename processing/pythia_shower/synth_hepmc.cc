@@ -0,0 +1,363 @@
+// ==============================================================================
+// synth_hepmc.cc - Synthetic HepMC3 event bank generator for mixer benchmarks
+// ==============================================================================
+// Writes structurally valid HepMC3 ASCII (.hepmc, via flat_output.h) and
+// binary (.hepb, see hepmc_binary.h) files with shower-like content, without
+// running Pythia:
+//
+//   beams (status 4) -> incoming gluons -> hard vertex
+//   hard vertex -> onia (status 2) + strings (pid 92)
+//   strings -> decay tree with a fixed fan-out per vertex -> final hadrons
+//   onia -> mu+ mu-, optional phi (status 2) -> K+ K-
+//
+// The number of final-state hadrons per event, the vertex fan-out (and thus
+// the depth of the decay tree) and the onium/phi content are configurable, so
+// banks with tens of thousands of particles per event and multi-GB files can
+// be produced without any Pythia time. Momenta are conserved at every decay
+// vertex; onium and phi decays are isotropic two-body decays.
+//
+// No external dependencies:
+//   g++ -std=c++17 -O2 synth_hepmc.cc -o synth_hepmc
+//
+// Usage:
+//   ./synth_hepmc output.hepmc [output.hepb] [--events N] [--particles N]
+//                 [--fanout F] [--onia 443,553] [--phi-fraction f] [--seed N]
+// ==============================================================================
+
+#include "hepmc_binary.h"
+#include "flat_output.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const double kEbeam = 6800.0;
+const double kMassProton = 0.938272;
+const double kMassMuon = 0.1056584;
+const double kMassKaon = 0.493677;
+const double kMassPion = 0.139570;
+const double kMassPhi = 1.019461;
+
+struct SynthConfig {
+    int nEvents = 1000;
+    int nParticles = 1000;
+    int fanout = 8;
+    vector<int> onia = {443};
+    double phiFraction = 1.0;
+    unsigned long seed = 12345;
+};
+
+double oniumMass(int pid) {
+    switch (pid) {
+        case 443: return 3.0969;
+        case 100443: return 3.6861;
+        case 553: return 9.4603;
+        case 100553: return 10.0233;
+        case 200553: return 10.3552;
+        default: return 3.0969;
+    }
+}
+
+// ------------------------------------------------------------------------------
+// Event generation
+// ------------------------------------------------------------------------------
+
+class Generator {
+public:
+    Generator(const SynthConfig& cfg) : cfg_(cfg), rng_(cfg.seed), flat_(0.0, 1.0) {}
+
+    void generate(BinaryEvent& evt, int64_t eventNumber) {
+        evt.clear();
+        evt.eventNumber = eventNumber;
+        evt.weights.push_back(1.0);
+
+        // Beams and incoming gluons (momenta fixed up once the hard vertex is known)
+        int beam1 = evt.addParticle(2212, 4, -1, 0.0, 0.0, kEbeam, hypot(kEbeam, kMassProton), kMassProton);
+        int beam2 = evt.addParticle(2212, 4, -1, 0.0, 0.0, -kEbeam, hypot(kEbeam, kMassProton), kMassProton);
+        int g1 = evt.addParticle(21, 21, decayVertex(evt, beam1), 0.0, 0.0, 0.0, 0.0, 0.0);
+        int g2 = evt.addParticle(21, 21, decayVertex(evt, beam2), 0.0, 0.0, 0.0, 0.0, 0.0);
+
+        int hard = evt.addVertex();
+        evt.endVertex[g1] = hard;
+        evt.endVertex[g2] = hard;
+
+        // Hard-process onia
+        vector<int> decaying;
+        for (int pid : cfg_.onia) {
+            double m = oniumMass(pid);
+            double pt = 6.0 + expo(6.0);
+            double y = 2.5 * (2.0 * flat_(rng_) - 1.0);
+            decaying.push_back(addKinematic(evt, pid, 2, hard, pt, y, m));
+        }
+
+        // Decay tree of the strings: level sizes from the leaves upwards
+        vector<int> levelSize = {max(cfg_.nParticles, 1)};
+        while (levelSize.back() > cfg_.fanout) {
+            levelSize.push_back((levelSize.back() + cfg_.fanout - 1) / cfg_.fanout);
+        }
+
+        // Emit top-down so every particle follows its production vertex inputs
+        vector<int> parents;
+        for (int j = 0; j < levelSize.back(); ++j) {
+            parents.push_back(evt.addParticle(92, 2, hard, 0.0, 0.0, 0.0, 0.0, 0.0));
+        }
+        for (int level = (int)levelSize.size() - 2; level >= 0; --level) {
+            bool leaves = (level == 0);
+            vector<int> children;
+            for (int j = 0; j < levelSize[level]; ++j) {
+                int parent = parents[j / cfg_.fanout];
+                int vtx = (j % cfg_.fanout == 0) ? decayVertex(evt, parent) : evt.endVertex[parent];
+                if (leaves) {
+                    children.push_back(addHadron(evt, vtx));
+                } else {
+                    children.push_back(evt.addParticle(113, 2, vtx, 0.0, 0.0, 0.0, 0.0, 0.0));
+                }
+            }
+            parents.swap(children);
+        }
+
+        // A single-level tree has the strings as leaves; give them kinematics
+        if (levelSize.size() == 1) {
+            for (int i : parents) setHadron(evt, i);
+        }
+
+        // Optional phi replacing one final hadron
+        if (flat_(rng_) < cfg_.phiFraction && !parents.empty()) {
+            int i = parents[rng_() % parents.size()];
+            double pt = 0.5 + expo(1.5);
+            double y = 4.0 * (2.0 * flat_(rng_) - 1.0);
+            setKinematic(evt, i, 333, 2, pt, y, kMassPhi);
+            decaying.push_back(i);
+        }
+
+        // Intermediate momenta = sum of their decay products
+        sumIntermediates(evt);
+
+        // Two-body decays of onia and phi
+        for (int i : decaying) {
+            bool phi = (evt.pid[i] == 333);
+            double md = phi ? kMassKaon : kMassMuon;
+            int pidPlus = phi ? 321 : -13;
+            twoBodyDecay(evt, i, pidPlus, -pidPlus, md);
+        }
+
+        // Incoming gluons carry the light-cone momenta of the hard final state
+        double eSum = 0.0, pzSum = 0.0;
+        for (size_t i = 0; i < evt.nParticles(); ++i) {
+            if (evt.prodVertex[i] == hard) {
+                eSum += evt.e[i];
+                pzSum += evt.pz[i];
+            }
+        }
+        setP(evt, g1, 0.0, 0.0, 0.5 * (eSum + pzSum), 0.5 * (eSum + pzSum), 0.0);
+        setP(evt, g2, 0.0, 0.0, -0.5 * (eSum - pzSum), 0.5 * (eSum - pzSum), 0.0);
+    }
+
+private:
+    double expo(double mean) { return -mean * log(1.0 - flat_(rng_)); }
+
+    // End vertex of a particle, created on first use
+    int decayVertex(BinaryEvent& evt, int i) {
+        if (evt.endVertex[i] < 0) evt.endVertex[i] = evt.addVertex();
+        return evt.endVertex[i];
+    }
+
+    void setP(BinaryEvent& evt, int i, double px, double py, double pz, double e, double m) {
+        evt.px[i] = px; evt.py[i] = py; evt.pz[i] = pz; evt.e[i] = e; evt.m[i] = m;
+    }
+
+    void setKinematic(BinaryEvent& evt, int i, int pid, int status, double pt, double y, double m) {
+        double phi = 2.0 * M_PI * flat_(rng_);
+        double mt = sqrt(m * m + pt * pt);
+        evt.pid[i] = pid;
+        evt.status[i] = status;
+        setP(evt, i, pt * cos(phi), pt * sin(phi), mt * sinh(y), mt * cosh(y), m);
+    }
+
+    int addKinematic(BinaryEvent& evt, int pid, int status, int vtx, double pt, double y, double m) {
+        int i = evt.addParticle(pid, status, vtx, 0.0, 0.0, 0.0, 0.0, 0.0);
+        setKinematic(evt, i, pid, status, pt, y, m);
+        return i;
+    }
+
+    // Soft final-state hadron: charged/neutral pions and photons
+    void setHadron(BinaryEvent& evt, int i) {
+        static const int kPids[5] = {211, -211, 111, 22, 22};
+        int pid = kPids[rng_() % 5];
+        double m = (pid == 22) ? 0.0 : kMassPion;
+        double pt = 0.05 + expo(0.5);
+        double eta = 5.0 * (2.0 * flat_(rng_) - 1.0);
+        double phi = 2.0 * M_PI * flat_(rng_);
+        double pz = pt * sinh(eta);
+        evt.pid[i] = pid;
+        evt.status[i] = 1;
+        setP(evt, i, pt * cos(phi), pt * sin(phi), pz, sqrt(m * m + pt * pt + pz * pz), m);
+    }
+
+    int addHadron(BinaryEvent& evt, int vtx) {
+        int i = evt.addParticle(0, 1, vtx, 0.0, 0.0, 0.0, 0.0, 0.0);
+        setHadron(evt, i);
+        return i;
+    }
+
+    // Children always follow their parents, so a reverse pass accumulates
+    // momenta bottom-up; onia and phi keep their own kinematics
+    void sumIntermediates(BinaryEvent& evt) {
+        size_t nV = evt.nVertices();
+        vector<double> spx(nV, 0.0), spy(nV, 0.0), spz(nV, 0.0), se(nV, 0.0);
+        for (size_t k = evt.nParticles(); k-- > 0;) {
+            int i = (int)k;
+            int ev = evt.endVertex[i];
+            if (ev >= 0 && (evt.pid[i] == 92 || evt.pid[i] == 113)) {
+                double m2 = se[ev] * se[ev] - spx[ev] * spx[ev] - spy[ev] * spy[ev] - spz[ev] * spz[ev];
+                setP(evt, i, spx[ev], spy[ev], spz[ev], se[ev], sqrt(max(m2, 0.0)));
+            }
+            int pv = evt.prodVertex[i];
+            if (pv >= 0) {
+                spx[pv] += evt.px[i]; spy[pv] += evt.py[i]; spz[pv] += evt.pz[i]; se[pv] += evt.e[i];
+            }
+        }
+    }
+
+    // Isotropic two-body decay in the rest frame, boosted to the lab
+    void twoBodyDecay(BinaryEvent& evt, int i, int pid1, int pid2, double md) {
+        double M = evt.m[i];
+        double pStar = sqrt(max(0.25 * M * M - md * md, 0.0));
+        double eStar = 0.5 * M;
+        double cosT = 2.0 * flat_(rng_) - 1.0;
+        double sinT = sqrt(max(0.0, 1.0 - cosT * cosT));
+        double phi = 2.0 * M_PI * flat_(rng_);
+        double d[3] = {pStar * sinT * cos(phi), pStar * sinT * sin(phi), pStar * cosT};
+
+        double bx = evt.px[i] / evt.e[i], by = evt.py[i] / evt.e[i], bz = evt.pz[i] / evt.e[i];
+        double b2 = bx * bx + by * by + bz * bz;
+        double gamma = 1.0 / sqrt(max(1.0 - b2, 1e-12));
+
+        int vtx = decayVertex(evt, i);
+        for (int sign : {1, -1}) {
+            double qx = sign * d[0], qy = sign * d[1], qz = sign * d[2];
+            double bq = bx * qx + by * qy + bz * qz;
+            double g2 = (b2 > 0.0) ? (gamma - 1.0) / b2 : 0.0;
+            double f = g2 * bq + gamma * eStar;
+            evt.addParticle(sign > 0 ? pid1 : pid2, 1, vtx,
+                            qx + f * bx, qy + f * by, qz + f * bz, gamma * (eStar + bq), md);
+        }
+    }
+
+    SynthConfig cfg_;
+    mt19937_64 rng_;
+    uniform_real_distribution<double> flat_;
+};
+
+// ------------------------------------------------------------------------------
+// Main
+// ------------------------------------------------------------------------------
+
+void printUsage(const char* progName) {
+    cerr << "\n=== Synthetic HepMC3 Event Bank Generator ===" << endl;
+    cerr << "Usage: " << progName << " output.hepmc|output.hepb [more outputs] [options]" << endl;
+    cerr << "\nOutputs ending in .hepb use the binary format, all others HepMC3 ASCII." << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --events N         : Number of events (default: 1000)" << endl;
+    cerr << "  --particles N      : Final-state hadrons per event (default: 1000)" << endl;
+    cerr << "  --fanout F         : Decay products per vertex, F >= 2 (default: 8)" << endl;
+    cerr << "  --onia LIST        : Comma-separated onium PDG ids, 'none' for dijet-like (default: 443)" << endl;
+    cerr << "  --phi-fraction f   : Fraction of events containing a phi -> K+ K- (default: 1.0)" << endl;
+    cerr << "  --seed N           : Random seed (default: 12345)" << endl;
+    cerr << "\nExample:" << endl;
+    cerr << "  " << progName << " bank.hepmc bank.hepb --events 1000 --particles 20000 --onia 443,553" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    SynthConfig cfg;
+    vector<string> outputs;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            outputs.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--events") cfg.nEvents = atoi(argv[++i]);
+        else if (arg == "--particles") cfg.nParticles = atoi(argv[++i]);
+        else if (arg == "--fanout") cfg.fanout = atoi(argv[++i]);
+        else if (arg == "--phi-fraction") cfg.phiFraction = atof(argv[++i]);
+        else if (arg == "--seed") cfg.seed = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--onia") {
+            cfg.onia.clear();
+            string list = argv[++i];
+            if (list != "none") {
+                stringstream ss(list);
+                string item;
+                while (getline(ss, item, ',')) cfg.onia.push_back(atoi(item.c_str()));
+            }
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (outputs.empty() || cfg.fanout < 2 || cfg.nParticles < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    vector<unique_ptr<ofstream>> streams;
+    vector<unique_ptr<FlatHepMC3Writer>> asciiWriters;
+    vector<ofstream*> binaryFiles;
+    for (const auto& out : outputs) {
+        streams.push_back(make_unique<ofstream>(out, ios::binary));
+        ofstream& f = *streams.back();
+        if (!f.is_open()) {
+            cerr << "Error: Cannot open output file: " << out << endl;
+            return 1;
+        }
+        if (isBinaryEventFile(out)) {
+            writeBinaryFileHeader(f);
+            binaryFiles.push_back(&f);
+        } else {
+            asciiWriters.push_back(make_unique<FlatHepMC3Writer>(f));
+        }
+    }
+
+    Generator gen(cfg);
+    BinaryEvent evt;
+    FlatLinks links;
+    size_t totalParticles = 0;
+
+    for (int iEvent = 0; iEvent < cfg.nEvents; ++iEvent) {
+        gen.generate(evt, iEvent);
+        totalParticles += evt.nParticles();
+        if (!asciiWriters.empty()) links.build(evt);
+        for (auto& w : asciiWriters) w->write(evt, links);
+        for (ofstream* f : binaryFiles) {
+            if (!writeBinaryEvent(*f, evt)) {
+                cerr << "Error: Write failed" << endl;
+                return 1;
+            }
+        }
+    }
+
+    asciiWriters.clear();
+    streams.clear();
+
+    cout << "Wrote " << cfg.nEvents << " events ("
+         << (cfg.nEvents > 0 ? totalParticles / cfg.nEvents : 0) << " particles/event) to";
+    for (const auto& out : outputs) cout << " " << out;
+    cout << endl;
+
+    return 0;
+}
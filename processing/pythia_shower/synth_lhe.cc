@@ -0,0 +1,302 @@
+// ==============================================================================
+// synth_lhe.cc - Synthetic HELAC-Onia-like LHE workload generator
+// ==============================================================================
+// Writes valid Les Houches Event files whose content mimics the HELAC-Onia
+// pools used in production, so that shower_normal/shower_phi can be
+// benchmarked offline with reproducible inputs:
+//   jpsi_g          g g > cc~(3S11) g
+//   upsilon_g       g g > bb~(3S11) g
+//   2jpsi_g         g g > cc~(3S11) cc~(3S11) g
+//   jpsi_upsilon_g  g g > cc~(3S11) bb~(3S11) g
+//   gg              g g > g g
+//
+// Kinematics are momentum-conserving 2 -> n configurations: onium and gluon
+// pT are drawn from a power-law spectrum dN/dpT ~ (1 + pT/pT0)^-n above the
+// HELAC-style pT cuts, rapidities are flat in |y| < ymax and the last gluon
+// balances the transverse momentum. Onia are colour singlets (status 1,
+// decayed by Pythia) and the gluons form a single colour chain.
+//
+// No external dependencies:
+//   g++ -std=c++17 -O2 synth_lhe.cc -o synth_lhe
+//
+// Usage:
+//   ./synth_lhe output.lhe [--process P] [--events N] [--extra-gluons K]
+//               [--pt0 GeV] [--pt-power n] [--min-pt-conia GeV]
+//               [--min-pt-bonia GeV] [--min-pt-q GeV] [--ymax Y] [--seed N]
+// ==============================================================================
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const double kEcm = 13600.0;
+const double kMassJpsi = 3.0969;
+const double kMassUpsilon = 9.4603;
+
+struct LheParticle {
+    int id;
+    int status;
+    int mother1, mother2;
+    int col, acol;
+    double px, py, pz, e, m;
+};
+
+struct SynthConfig {
+    string process = "jpsi_g";
+    int nEvents = 1000;
+    int extraGluons = 0;
+    double pt0 = 5.0;
+    double ptPower = 5.0;
+    double minPtConia = 6.0;
+    double minPtBonia = 2.0;
+    double minPtQ = 4.0;
+    double yMax = 2.5;
+    unsigned long seed = 12345;
+    double xsec = 1.0; // pb, unweighted events
+};
+
+// Onium content (PDG ids) of each supported process; gluon count excludes extras
+bool processContent(const string& process, vector<int>& onia, int& nGluons) {
+    onia.clear();
+    if (process == "jpsi_g") {
+        onia = {443};
+        nGluons = 1;
+    } else if (process == "upsilon_g") {
+        onia = {553};
+        nGluons = 1;
+    } else if (process == "2jpsi_g") {
+        onia = {443, 443};
+        nGluons = 1;
+    } else if (process == "jpsi_upsilon_g") {
+        onia = {443, 553};
+        nGluons = 1;
+    } else if (process == "gg") {
+        nGluons = 2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+string helacProcess(const string& process) {
+    if (process == "jpsi_g") return "g g > cc~(3S11) g";
+    if (process == "upsilon_g") return "g g > bb~(3S11) g";
+    if (process == "2jpsi_g") return "g g > cc~(3S11) cc~(3S11) g";
+    if (process == "jpsi_upsilon_g") return "g g > cc~(3S11) bb~(3S11) g";
+    return "g g > g g";
+}
+
+class Generator {
+public:
+    Generator(const SynthConfig& cfg) : cfg_(cfg), rng_(cfg.seed), flat_(0.0, 1.0) {}
+
+    // Power-law pT above ptMin via inverse CDF of (1 + pT/pt0)^-n
+    double samplePt(double ptMin) {
+        double u = flat_(rng_);
+        double a = 1.0 + ptMin / cfg_.pt0;
+        return cfg_.pt0 * (a * pow(1.0 - u, 1.0 / (1.0 - cfg_.ptPower)) - 1.0);
+    }
+
+    double sampleY() { return cfg_.yMax * (2.0 * flat_(rng_) - 1.0); }
+    double samplePhi() { return 2.0 * M_PI * flat_(rng_); }
+
+    LheParticle outgoing(int id, double pt, double phi, double y, double m) {
+        double mt = sqrt(m * m + pt * pt);
+        LheParticle p{id, 1, 1, 2, 0, 0,
+                      pt * cos(phi), pt * sin(phi), mt * sinh(y), mt * cosh(y), m};
+        return p;
+    }
+
+    // Generate one event; retries the phase-space point until the balancing
+    // gluon passes the pT cut and the incoming momentum fractions are < 1
+    bool generate(const vector<int>& onia, int nGluons, vector<LheParticle>& out, double& scale) {
+        for (int attempt = 0; attempt < 1000; ++attempt) {
+            out.clear();
+            double sumPx = 0.0, sumPy = 0.0;
+            scale = 0.0;
+
+            for (int pid : onia) {
+                bool charm = (pid == 443);
+                double m = charm ? kMassJpsi : kMassUpsilon;
+                double pt = samplePt(charm ? cfg_.minPtConia : cfg_.minPtBonia);
+                out.push_back(outgoing(pid, pt, samplePhi(), sampleY(), m));
+                sumPx += out.back().px;
+                sumPy += out.back().py;
+                scale = max(scale, sqrt(m * m + pt * pt));
+            }
+
+            for (int g = 0; g < nGluons - 1; ++g) {
+                double pt = samplePt(cfg_.minPtQ);
+                out.push_back(outgoing(21, pt, samplePhi(), sampleY(), 0.0));
+                sumPx += out.back().px;
+                sumPy += out.back().py;
+                scale = max(scale, pt);
+            }
+
+            // Last gluon balances the transverse momentum
+            double ptBal = hypot(sumPx, sumPy);
+            if (ptBal < cfg_.minPtQ) continue;
+            out.push_back(outgoing(21, ptBal, atan2(-sumPy, -sumPx), sampleY(), 0.0));
+
+            double e = 0.0, pz = 0.0;
+            for (const auto& p : out) {
+                e += p.e;
+                pz += p.pz;
+            }
+            double x1 = (e + pz) / kEcm;
+            double x2 = (e - pz) / kEcm;
+            if (x1 >= 1.0 || x2 >= 1.0) continue;
+
+            // Incoming gluons and a single colour chain through the outgoing gluons:
+            // g1(501,502) g2(503,501) -> g_0(503,504) ... g_last(.., 502)
+            LheParticle g1{21, -1, 0, 0, 501, 502, 0.0, 0.0, 0.5 * x1 * kEcm, 0.5 * x1 * kEcm, 0.0};
+            LheParticle g2{21, -1, 0, 0, 503, 501, 0.0, 0.0, -0.5 * x2 * kEcm, 0.5 * x2 * kEcm, 0.0};
+            int tag = 503;
+            int iGluon = 0;
+            for (auto& p : out) {
+                if (p.id != 21) continue;
+                p.col = tag;
+                p.acol = (++iGluon == nGluons) ? 502 : ++tag;
+            }
+            out.insert(out.begin(), {g1, g2});
+            return true;
+        }
+        return false;
+    }
+
+private:
+    SynthConfig cfg_;
+    mt19937_64 rng_;
+    uniform_real_distribution<double> flat_;
+};
+
+void writeHeader(FILE* f, const SynthConfig& cfg) {
+    fprintf(f, "<LesHouchesEvents version=\"3.0\">\n");
+    fprintf(f, "<header>\n");
+    fprintf(f, "<!-- synth_lhe: synthetic HELAC-Onia-like sample for benchmarking\n");
+    fprintf(f, "     process      = %s (%s)\n", cfg.process.c_str(), helacProcess(cfg.process).c_str());
+    fprintf(f, "     events       = %d\n", cfg.nEvents);
+    fprintf(f, "     extra gluons = %d\n", cfg.extraGluons);
+    fprintf(f, "     pT spectrum  = (1 + pT/%g)^-%g\n", cfg.pt0, cfg.ptPower);
+    fprintf(f, "     minptconia   = %g, minptbonia = %g, minptq = %g, |y| < %g\n",
+            cfg.minPtConia, cfg.minPtBonia, cfg.minPtQ, cfg.yMax);
+    fprintf(f, "     seed         = %lu\n", cfg.seed);
+    fprintf(f, "-->\n");
+    fprintf(f, "</header>\n");
+    fprintf(f, "<init>\n");
+    fprintf(f, " 2212 2212 %.8E %.8E 0 0 0 0 3 1\n", 0.5 * kEcm, 0.5 * kEcm);
+    fprintf(f, " %.8E %.8E %.8E 1\n", cfg.xsec, 0.0, cfg.xsec);
+    fprintf(f, "</init>\n");
+}
+
+void writeEvent(FILE* f, const vector<LheParticle>& particles, double weight, double scale) {
+    fprintf(f, "<event>\n");
+    fprintf(f, " %zu 1 %+.8E %.8E %.8E %.8E\n", particles.size(), weight, scale, 0.0072973525, 0.2);
+    for (const auto& p : particles) {
+        fprintf(f, " %8d %2d %4d %4d %4d %4d %+.10E %+.10E %+.10E %.10E %.10E 0.0000E+00 9.0000E+00\n",
+                p.id, p.status, p.mother1, p.mother2, p.col, p.acol,
+                p.px, p.py, p.pz, p.e, p.m);
+    }
+    fprintf(f, "</event>\n");
+}
+
+void printUsage(const char* progName) {
+    cerr << "\n=== Synthetic LHE Generator ===" << endl;
+    cerr << "Usage: " << progName << " output.lhe [options]" << endl;
+    cerr << "\nOptions:" << endl;
+    cerr << "  --process P        : jpsi_g | upsilon_g | 2jpsi_g | jpsi_upsilon_g | gg (default: jpsi_g)" << endl;
+    cerr << "  --events N         : Number of events (default: 1000)" << endl;
+    cerr << "  --extra-gluons K   : Additional final-state gluons (default: 0)" << endl;
+    cerr << "  --pt0 GeV          : pT spectrum scale (default: 5)" << endl;
+    cerr << "  --pt-power n       : pT spectrum power, n > 1 (default: 5)" << endl;
+    cerr << "  --min-pt-conia GeV : Minimum charmonium pT (default: 6)" << endl;
+    cerr << "  --min-pt-bonia GeV : Minimum bottomonium pT (default: 2)" << endl;
+    cerr << "  --min-pt-q GeV     : Minimum gluon pT (default: 4)" << endl;
+    cerr << "  --ymax Y           : Maximum |rapidity| (default: 2.5)" << endl;
+    cerr << "  --seed N           : Random seed (default: 12345)" << endl;
+    cerr << "\nExample:" << endl;
+    cerr << "  " << progName << " jpsi_g.lhe --process jpsi_g --events 5000 --seed 1" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argv[1][0] == '-') {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string outputFile = argv[1];
+    SynthConfig cfg;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--process") cfg.process = argv[++i];
+        else if (arg == "--events") cfg.nEvents = atoi(argv[++i]);
+        else if (arg == "--extra-gluons") cfg.extraGluons = atoi(argv[++i]);
+        else if (arg == "--pt0") cfg.pt0 = atof(argv[++i]);
+        else if (arg == "--pt-power") cfg.ptPower = atof(argv[++i]);
+        else if (arg == "--min-pt-conia") cfg.minPtConia = atof(argv[++i]);
+        else if (arg == "--min-pt-bonia") cfg.minPtBonia = atof(argv[++i]);
+        else if (arg == "--min-pt-q") cfg.minPtQ = atof(argv[++i]);
+        else if (arg == "--ymax") cfg.yMax = atof(argv[++i]);
+        else if (arg == "--seed") cfg.seed = strtoul(argv[++i], nullptr, 10);
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    vector<int> onia;
+    int nGluons = 0;
+    if (!processContent(cfg.process, onia, nGluons)) {
+        cerr << "Error: Unknown process: " << cfg.process << endl;
+        return 1;
+    }
+    if (cfg.ptPower <= 1.0 || cfg.pt0 <= 0.0 || cfg.extraGluons < 0) {
+        cerr << "Error: Invalid spectrum or multiplicity settings" << endl;
+        return 1;
+    }
+    nGluons += cfg.extraGluons;
+
+    FILE* f = fopen(outputFile.c_str(), "w");
+    if (!f) {
+        cerr << "Error: Cannot open output file: " << outputFile << endl;
+        return 1;
+    }
+
+    Generator gen(cfg);
+    vector<LheParticle> particles;
+    int nWritten = 0;
+    int nFailed = 0;
+
+    writeHeader(f, cfg);
+    while (nWritten < cfg.nEvents) {
+        double scale = 0.0;
+        if (!gen.generate(onia, nGluons, particles, scale)) {
+            if (++nFailed > 100) {
+                cerr << "Error: Could not generate phase-space points, check the cuts" << endl;
+                fclose(f);
+                return 1;
+            }
+            continue;
+        }
+        writeEvent(f, particles, cfg.xsec, scale);
+        ++nWritten;
+    }
+    fprintf(f, "</LesHouchesEvents>\n");
+    fclose(f);
+
+    cout << "Wrote " << nWritten << " events (" << helacProcess(cfg.process)
+         << ", " << particles.size() << " particles/event) to " << outputFile << endl;
+
+    return 0;
+}
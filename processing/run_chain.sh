@@ -19,6 +19,13 @@
 #   # JUP SPS: Single source with phi shower
 #   ./run_chain.sh --inputs pool_jpsi_upsilon_g:50 --modes phi \
 #                  --analysis JUP --campaign JUP_SPS --job-id 0
+#
+#   # Shared shower bank: build shard 3 of the pool_jpsi_g/phi bank, then mix
+#   # events 2000-2999 of it with the normal-mode bank (no shower in the job)
+#   ./run_chain.sh --inputs EOS:pool_jpsi_g:3:0 --modes phi --campaign BANK \
+#                  --job-id 3 --bank-dir /eos/.../banks/pool_jpsi_g_phi
+#   ./run_chain.sh --inputs BANK:pool_jpsi_g:2000:1000,BANK:pool_jpsi_g:2000:1000 \
+#                  --modes normal,phi --analysis JJP --campaign JJP_DPS1 --job-id 2
 # ==============================================================================
 
 set -e
@@ -51,6 +58,7 @@ CMSSW_14_BASE="${CMSSW_14_BASE:-/afs/cern.ch/user/x/xcheng/condor/CMSSW_14_0_18}
 EOS_BASE="/eos/user/x/xcheng/MC_Production"
 EOS_LHE_POOL="${EOS_BASE}/lhe_pools"
 EOS_OUTPUT="${EOS_BASE}/output"
+EOS_BANKS="${EOS_BASE}/banks"
 
 # Existing LHE pools
 declare -A EXISTING_POOLS=(
@@ -80,17 +88,21 @@ msg_warn() { echo -e "${YELLOW}[WARN]${NC} $1"; }
 msg_error() { echo -e "${RED}[ERROR]${NC} $1"; }
 msg_step() { echo -e "\n${YELLOW}========================================${NC}"; echo -e "${YELLOW}  $1${NC}"; echo -e "${YELLOW}========================================${NC}\n"; }
 
-get_lhe_file() {
+get_pool_dir() {
     local pool_name="$1"
-    local index="$2"
-    local pool_dir=""
     
     # Check for existing pool
     if [[ -n "${EXISTING_POOLS[$pool_name]}" ]]; then
-        pool_dir="${EXISTING_POOLS[$pool_name]}"
+        echo "${EXISTING_POOLS[$pool_name]}"
     else
-        pool_dir="${EOS_LHE_POOL}/${pool_name}"
+        echo "${EOS_LHE_POOL}/${pool_name}"
     fi
+}
+
+get_lhe_file() {
+    local pool_name="$1"
+    local index="$2"
+    local pool_dir=$(get_pool_dir "$pool_name")
     
     # Get files
     local files=($(ls "${pool_dir}"/*.lhe 2>/dev/null | sort))
@@ -101,11 +113,42 @@ get_lhe_file() {
         return 1
     fi
     
-    # Wrap around if index exceeds available files
+    # Wrap around if index exceeds available files (the events are showered
+    # again; --lhe-ledger hands out unused ranges instead)
     local file_idx=$((index % n_files))
+    if [[ $index -ge $n_files ]] && [[ -z "${LHE_LEDGER_DIR}" ]]; then
+        msg_warn "Pool ${pool_name} has only ${n_files} LHE files; index ${index} reuses ${files[$file_idx]##*/}" >&2
+    fi
     echo "${files[$file_idx]}"
 }
 
+# Lease an unused event range of the pool for this source (see lhe_ledger.cc);
+# prints "file skip count". The owner is stable across retries of the job, so
+# a retry gets the same range back.
+claim_lhe_range() {
+    local pool_name="$1"
+    local mode="$2"
+    local events="$3"
+    local owner="$4"
+    local pool_dir=$(get_pool_dir "$pool_name")
+    local files=($(ls "${pool_dir}"/*.lhe 2>/dev/null | sort))
+    
+    if [[ ${#files[@]} -eq 0 ]]; then
+        msg_error "No LHE files found in ${pool_dir}" >&2
+        return 1
+    fi
+    if [[ ! -x "${SHOWER_DIR}/lhe_ledger" ]]; then
+        make -C "${SHOWER_DIR}" lhe_ledger > /dev/null
+    fi
+    
+    local chunk_args=()
+    if [[ -n "${LEDGER_CHUNK}" ]]; then
+        chunk_args=(--chunk "${LEDGER_CHUNK}")
+    fi
+    "${SHOWER_DIR}/lhe_ledger" claim "${LHE_LEDGER_DIR}/${pool_name}_${mode}" --owner "${owner}" \
+        --events "${events}" "${chunk_args[@]}" "${files[@]}"
+}
+
 setup_cmssw12() {
     msg_info "Setting up CMSSW_12_4_14_patch3..."
     source /cvmfs/cms.cern.ch/cmsset_default.sh
@@ -329,6 +372,22 @@ BUILDEOF
 # Processing Steps
 # ==============================================================================
 
+# File suffix of the intermediate shower outputs: block-compressed HepMC
+# (.zst/.lz4, see block_compress.h) read directly by the mixer. mixed.hepmc
+# stays plain since cmsRun reads it.
+# Bank shards are always binary (.hepb), since bank_slice copies their frames.
+hepmc_suffix() {
+    if [[ -n "${BANK_DIR}" ]]; then
+        echo ".hepb"
+        return
+    fi
+    case "${COMPRESS}" in
+        zstd) echo ".zst" ;;
+        lz4)  echo ".lz4" ;;
+        *)    echo "" ;;
+    esac
+}
+
 # Step 1: Shower LHE files
 run_shower() {
     local lhe_files=("$@")
@@ -344,27 +403,86 @@ run_shower() {
     
     HEPMC_FILES=()
     
-    setup_cmssw12
+    # Sources drawn from shared shower banks need no Pythia
+    local n_bank=0
+    for ((i=0; i<n_files; i++)); do
+        [[ -d "${lhe_files[$i]}" ]] && n_bank=$((n_bank + 1))
+    done
+    
+    if [[ $n_bank -lt $n_files ]]; then
+        setup_cmssw12
+    fi
     cd "${SHOWER_DIR}"
     
     # Build shower programs if needed
-    if [[ ! -f "shower_normal" ]] || [[ ! -f "shower_phi" ]]; then
+    if [[ $n_bank -lt $n_files ]] && { [[ ! -f "shower_normal" ]] || [[ ! -f "shower_phi" ]]; }; then
         msg_info "Building shower programs..."
         make shower
     fi
+    if [[ $n_bank -gt 0 ]] && [[ ! -f "bank_slice" ]]; then
+        msg_info "Building bank_slice..."
+        make bank_slice
+    fi
     
     for ((i=0; i<n_files; i++)); do
         local lhe_file="${lhe_files[$i]}"
         local mode="${SHOWER_MODES[$i]}"
-        local hepmc_output="${WORKDIR}/shower_${i}.hepmc"
+        local hepmc_output="${WORKDIR}/shower_${i}.hepmc$(hepmc_suffix)"
         
         msg_info "Processing source $((i+1))/${n_files}: ${lhe_file}"
         msg_info "Shower mode: ${mode}"
         
+        # Shared shower bank (BANK: input): copy the job's event range out of
+        # the bank shards instead of showering (see bank_slice.cc)
+        if [[ -d "${lhe_file}" ]]; then
+            local bank_output="${WORKDIR}/shower_${i}.hepb"
+            local shards=($(ls "${lhe_file}"/shard_*.hepb 2>/dev/null | sort -V))
+            if [[ ${#shards[@]} -eq 0 ]]; then
+                msg_error "No shards in shower bank ${lhe_file}"
+                return 1
+            fi
+            local rc=0
+            ./bank_slice "${bank_output}" --first "${SOURCE_SKIPS[$i]}" --count "${SOURCE_COUNTS[$i]}" \
+                "${shards[@]}" || rc=$?
+            if [[ $rc -eq 3 ]]; then
+                msg_warn "Bank ${lhe_file} is shorter than the requested range; mixing the events available"
+            elif [[ $rc -ne 0 ]]; then
+                msg_error "bank_slice failed for ${lhe_file}"
+                return 1
+            fi
+            HEPMC_FILES+=("${bank_output}")
+            msg_ok "Bank events ready: ${bank_output}"
+            continue
+        fi
+        
+        # Event slice of the LHE file (set by sized DAG jobs, see dag_generator.py --cost-profile)
+        local n_events="${SOURCE_COUNTS[$i]:--1}"
+        local slice_args=()
+        if [[ "${SOURCE_SKIPS[$i]:-0}" -gt 0 ]]; then
+            slice_args=(--skip "${SOURCE_SKIPS[$i]}")
+            msg_info "LHE events: ${SOURCE_SKIPS[$i]} skipped, ${n_events} processed"
+        fi
+        
+        # Shared memo of LHE events that exhausted the retry budget (see reject_memo.h)
+        if [[ -n "${REJECT_MEMO_DIR}" ]]; then
+            mkdir -p "${REJECT_MEMO_DIR}"
+            slice_args+=(--reject-memo "${REJECT_MEMO_DIR}/reject_memo_${SOURCE_POOLS[$i]}.txt")
+        fi
+        
+        # Forked workers sharing one initialization (see shower_workers.h)
+        if [[ "${SHOWER_WORKERS}" -gt 1 ]]; then
+            slice_args+=(--workers "${SHOWER_WORKERS}")
+        fi
+        
+        # Learned retry budget below the maximum of 1000 (see retry_budget.h)
+        if [[ "${ADAPTIVE_RETRY}" == "true" ]]; then
+            slice_args+=(--adaptive-retry --retry-bias-correction)
+        fi
+        
         if [[ "$mode" == "phi" ]]; then
-            ./shower_phi "${lhe_file}" "${hepmc_output}" -1 0.0 2.5 2.4 1000
+            ./shower_phi "${lhe_file}" "${hepmc_output}" ${n_events} 0.0 2.5 2.4 1000 "${slice_args[@]}"
         else
-            ./shower_normal "${lhe_file}" "${hepmc_output}" -1 2.5 2.4 1000
+            ./shower_normal "${lhe_file}" "${hepmc_output}" ${n_events} 2.5 2.4 1000 "${slice_args[@]}"
         fi
         
         if [[ ! -f "${hepmc_output}" ]]; then
@@ -398,8 +516,14 @@ run_mix() {
         msg_info "Single source - converting to HepMC2 format..."
         ./event_mixer_multisource "${MIXED_HEPMC}" "${HEPMC_FILES[0]}"
     else
-        msg_info "Mixing ${n_sources} sources..."
-        ./event_mixer_multisource "${MIXED_HEPMC}" "${HEPMC_FILES[@]}"
+        # Smart pairing: only combine events that together satisfy the campaign
+        # requirement (uses the shower summary sidecars, see event_pairing.h)
+        local pairing_args=()
+        if [[ "${PAIRING}" == "smart" ]]; then
+            pairing_args=(--analysis "${ANALYSIS_TYPE}")
+        fi
+        msg_info "Mixing ${n_sources} sources (pairing: ${PAIRING})..."
+        ./event_mixer_multisource "${MIXED_HEPMC}" "${HEPMC_FILES[@]}" "${pairing_args[@]}"
     fi
     
     if [[ ! -f "${MIXED_HEPMC}" ]]; then
@@ -411,6 +535,33 @@ run_mix() {
     cd "${WORKDIR}"
 }
 
+# Bank build (--bank-dir): publish the shower output as shard_<job-id> of the
+# shared bank. The index (.evsum) goes first and the events last, renamed into
+# place, so that a listed shard_*.hepb is always complete.
+publish_bank_shard() {
+    msg_step "Publish Shower Bank Shard"
+    
+    local hepb="${HEPMC_FILES[0]:-${WORKDIR}/shower_0.hepb}"
+    local shard="${BANK_DIR}/shard_${JOB_ID}.hepb"
+    if [[ ! -f "${hepb}" ]] || [[ ! -f "${hepb}.evsum" ]]; then
+        msg_error "Bank shard input missing: ${hepb} (+ .evsum)"
+        return 1
+    fi
+    
+    mkdir -p "${BANK_DIR}"
+    cp "${hepb}.evsum" "${shard}.evsum"
+    if [[ -f "${hepb}.runstats" ]]; then
+        cp "${hepb}.runstats" "${BANK_DIR}/shard_${JOB_ID}.runstats"
+    fi
+    cp "${hepb}" "${shard}.tmp"
+    mv "${shard}.tmp" "${shard}"
+    msg_ok "Published bank shard ${shard}"
+    
+    if [[ "${CLEANUP}" == "true" ]]; then
+        rm -f "${WORKDIR}"/*.hepb "${WORKDIR}"/*.evsum
+    fi
+}
+
 # Step 3: GEN-SIM
 run_gensim() {
     msg_step "Step 3: GEN-SIM"
@@ -622,10 +773,18 @@ transfer_output() {
         msg_ok "Copied Ntuple to ${output_dir}/"
     fi
     
+    # Run statistics records of the shower and mixer runs, merged into the
+    # campaign report by the DAG's summary job (see run_stats.h)
+    local stats_files=("${WORKDIR}"/*.runstats)
+    if [[ -f "${stats_files[0]}" ]]; then
+        cp "${stats_files[@]}" "${output_dir}/"
+        msg_ok "Copied ${#stats_files[@]} run statistics records to ${output_dir}/"
+    fi
+    
     # Cleanup intermediate files
     if [[ "${CLEANUP}" == "true" ]]; then
         msg_info "Cleaning up intermediate files..."
-        rm -f "${WORKDIR}"/*.hepmc
+        rm -f "${WORKDIR}"/*.hepmc "${WORKDIR}"/*.hepmc.zst "${WORKDIR}"/*.hepmc.lz4 "${WORKDIR}"/*.hepb "${WORKDIR}"/*.evsum
         rm -f "${WORKDIR}"/output_GENSIM.root
         rm -f "${WORKDIR}"/output_RAW.root
         rm -f "${WORKDIR}"/output_RECO.root
@@ -643,8 +802,9 @@ Usage: $0 [options]
 
 Required options:
   --inputs INPUTS       Comma-separated list of pool:index pairs
+                        (BANK:pool:first:count = events of the pool's shared shower bank)
   --modes MODES         Comma-separated shower modes (normal|phi)
-  --analysis TYPE       Analysis type: JJP or JUP
+  --analysis TYPE       Analysis type: JJP or JUP (not needed with --bank-dir)
   --campaign NAME       Campaign name (e.g., JJP_DPS1)
   --job-id ID           Job identifier
 
@@ -653,6 +813,15 @@ Optional:
   --no-cleanup          Keep intermediate files
   --skip-to STEP        Skip to specified step (shower|mix|gensim|raw|reco|miniaod|ntuple)
   --stop-at STEP        Stop after specified step
+  --pairing MODE        Mixer pairing: smart (default, requirement-driven) or sequential
+  --reject-memo-dir DIR Share a memo of LHE events that fail every retry (one file per pool)
+  --compress CODEC      Shower HepMC outputs: zstd (default), lz4 or none
+  --shower-workers N    Fork N shower workers sharing one Pythia initialization (default: 1)
+  --adaptive-retry      Learn the hadronization retry budget per run (maximum 1000)
+  --bank-dir DIR        Shower the single input into shard_<job-id>.hepb of a shared bank, then stop
+  --lhe-ledger DIR      Lease unused LHE event ranges per pool and mode instead of
+                        fixed files (the input slice count is the lease size)
+  --ledger-chunk N      Lease granularity of a new ledger in events (default: 1000)
     --max-events N        Limit events for fast local test (default: -1 = all)
   -h, --help            Show this help
 
@@ -677,6 +846,14 @@ CLEANUP="true"
 SKIP_TO=""
 STOP_AT=""
 MAX_EVENTS=-1
+PAIRING="smart"
+REJECT_MEMO_DIR=""
+COMPRESS="zstd"
+SHOWER_WORKERS=1
+ADAPTIVE_RETRY="false"
+BANK_DIR=""
+LHE_LEDGER_DIR=""
+LEDGER_CHUNK=""
 
 while [[ $# -gt 0 ]]; do
     case $1 in
@@ -720,6 +897,38 @@ while [[ $# -gt 0 ]]; do
             MAX_EVENTS="$2"
             shift 2
             ;;
+        --pairing)
+            PAIRING="$2"
+            shift 2
+            ;;
+        --reject-memo-dir)
+            REJECT_MEMO_DIR="$2"
+            shift 2
+            ;;
+        --compress)
+            COMPRESS="$2"
+            shift 2
+            ;;
+        --shower-workers)
+            SHOWER_WORKERS="$2"
+            shift 2
+            ;;
+        --adaptive-retry)
+            ADAPTIVE_RETRY="true"
+            shift
+            ;;
+        --bank-dir)
+            BANK_DIR="$2"
+            shift 2
+            ;;
+        --lhe-ledger)
+            LHE_LEDGER_DIR="$2"
+            shift 2
+            ;;
+        --ledger-chunk)
+            LEDGER_CHUNK="$2"
+            shift 2
+            ;;
         -h|--help)
             usage
             ;;
@@ -731,25 +940,51 @@ while [[ $# -gt 0 ]]; do
 done
 
 # Validate required arguments
-if [[ -z "$INPUTS" ]] || [[ -z "$MODES" ]] || [[ -z "$ANALYSIS_TYPE" ]] || [[ -z "$CAMPAIGN_NAME" ]] || [[ -z "$JOB_ID" ]]; then
+if [[ -z "$INPUTS" ]] || [[ -z "$MODES" ]] || [[ -z "$CAMPAIGN_NAME" ]] || [[ -z "$JOB_ID" ]]; then
     msg_error "Missing required arguments"
     usage
 fi
 
+if [[ -z "$ANALYSIS_TYPE" ]] && [[ -z "$BANK_DIR" ]]; then
+    msg_error "Missing required argument: --analysis"
+    usage
+fi
+
+if [[ "${COMPRESS}" != "zstd" && "${COMPRESS}" != "lz4" && "${COMPRESS}" != "none" ]]; then
+    msg_error "Unknown compression: ${COMPRESS} (zstd, lz4 or none)"
+    usage
+fi
+
+if ! [[ "${SHOWER_WORKERS}" =~ ^[1-9][0-9]*$ ]]; then
+    msg_error "Invalid --shower-workers: ${SHOWER_WORKERS}"
+    usage
+fi
+
 # Parse inputs and modes
 IFS=',' read -ra INPUT_SPECS <<< "$INPUTS"
 IFS=',' read -ra SHOWER_MODES <<< "$MODES"
 
-# Resolve LHE files from pool:index specs (supports GEN:pool:idx, EOS:pool:idx:usage, or pool:idx)
+# Resolve LHE files from pool:index specs (supports GEN:pool:idx, EOS:pool:idx:usage, or pool:idx).
+# GEN and EOS specs may carry an event slice as two extra fields, skip:count
+# (GEN:pool:idx:skip:count, EOS:pool:idx:usage:skip:count); -1 = to end of file.
+# BANK:pool:first:count resolves to the pool's shower bank directory for the
+# source's mode, with the event range as the slice.
 LHE_FILES=()
+SOURCE_SKIPS=()
+SOURCE_COUNTS=()
+SOURCE_POOLS=()
 declare -a parts  # Declare array outside loop (no 'local' in main script)
 for spec in "${INPUT_SPECS[@]}"; do
+    skip=0
+    count=-1
     if [[ "$spec" == GEN:* ]]; then
         # Format: GEN:pool_name:lhe_job_idx - generated LHE from DAG
         # The LHE file should be at EOS_LHE_POOL/pool_name/sample_pool_name_<seed>.lhe
         IFS=':' read -ra parts <<< "$spec"
         pool_name="${parts[1]}"
         lhe_job_idx="${parts[2]}"
+        skip="${parts[3]:-0}"
+        count="${parts[4]:--1}"
         # For GEN: prefix, we look in the pool directory for any available file
         # Seed is typically 100 + job_idx for DAG jobs
         seed=$((100 + lhe_job_idx))
@@ -758,11 +993,24 @@ for spec in "${INPUT_SPECS[@]}"; do
             # Try to find any lhe file in the pool
             lhe_file=$(get_lhe_file "$pool_name" "$lhe_job_idx")
         fi
+    elif [[ "$spec" == BANK:* ]]; then
+        # Format: BANK:pool_name:first:count - shared shower bank (dag_generator.py --shared-banks)
+        IFS=':' read -ra parts <<< "$spec"
+        pool_name="${parts[1]}"
+        skip="${parts[2]:-0}"
+        count="${parts[3]:--1}"
+        lhe_file="${EOS_BANKS}/${pool_name}_${SHOWER_MODES[${#LHE_FILES[@]}]}"
+        if [[ ! -d "$lhe_file" ]]; then
+            msg_error "Shower bank not found for: $spec (tried: ${lhe_file})"
+            exit 1
+        fi
     elif [[ "$spec" == EOS:* ]]; then
         # Format: EOS:pool_name:job_id:usage_idx - existing LHE from EOS
         IFS=':' read -ra parts <<< "$spec"
         pool_name="${parts[1]}"
         job_id="${parts[2]}"
+        skip="${parts[4]:-0}"
+        count="${parts[5]:--1}"
         lhe_file=$(get_lhe_file "$pool_name" "$job_id")
     else
         # Legacy format: pool_name:index
@@ -771,13 +1019,37 @@ for spec in "${INPUT_SPECS[@]}"; do
         lhe_file=$(get_lhe_file "$pool_name" "$index")
     fi
     
-    if [[ -z "$lhe_file" ]] || [[ ! -f "$lhe_file" ]]; then
+    # Ledger: the spec only names the pool and the event count; file and skip
+    # come from an unused range of the pool in this source's mode
+    if [[ -n "${LHE_LEDGER_DIR}" ]] && [[ "$spec" != BANK:* ]]; then
+        lease_rc=0
+        lease=$(claim_lhe_range "$pool_name" "${SHOWER_MODES[${#LHE_FILES[@]}]}" "$count" \
+                "${CAMPAIGN_NAME}/${JOB_ID}/${#LHE_FILES[@]}") || lease_rc=$?
+        if [[ $lease_rc -eq 4 ]]; then
+            msg_error "Every event of pool ${pool_name} (${SHOWER_MODES[${#LHE_FILES[@]}]}) is already leased; generate more LHE files"
+            exit 1
+        elif [[ $lease_rc -ne 0 ]] || [[ -z "$lease" ]]; then
+            msg_error "LHE ledger claim failed for: $spec"
+            exit 1
+        fi
+        read -r lhe_file skip count <<< "$lease"
+    fi
+    
+    if [[ -z "$lhe_file" ]] || [[ ! -e "$lhe_file" ]]; then
         msg_error "Could not resolve LHE file for: $spec (tried: ${lhe_file:-<none>})"
         exit 1
     fi
     LHE_FILES+=("$lhe_file")
+    SOURCE_SKIPS+=("$skip")
+    SOURCE_COUNTS+=("$count")
+    SOURCE_POOLS+=("$pool_name")
 done
 
+if [[ -n "${BANK_DIR}" ]] && [[ ${#LHE_FILES[@]} -ne 1 || -d "${LHE_FILES[0]}" ]]; then
+    msg_error "--bank-dir showers exactly one LHE input into a bank shard"
+    exit 1
+fi
+
 # Print configuration
 echo ""
 echo "=============================================="
@@ -790,8 +1062,28 @@ echo "Work dir:     ${WORKDIR}"
 echo "N sources:    ${#LHE_FILES[@]}"
 for ((i=0; i<${#LHE_FILES[@]}; i++)); do
     echo "  Source $((i+1)): ${LHE_FILES[$i]} (mode: ${SHOWER_MODES[$i]})"
+    if [[ "${SOURCE_SKIPS[$i]}" -gt 0 ]] || [[ "${SOURCE_COUNTS[$i]}" -ge 0 ]]; then
+        echo "            events: skip ${SOURCE_SKIPS[$i]}, count ${SOURCE_COUNTS[$i]}"
+    fi
 done
 echo "Max events:   ${MAX_EVENTS}"
+echo "Pairing:      ${PAIRING}"
+echo "Compression:  ${COMPRESS}"
+if [[ "${SHOWER_WORKERS}" -gt 1 ]]; then
+    echo "Shower workers: ${SHOWER_WORKERS}"
+fi
+if [[ -n "${REJECT_MEMO_DIR}" ]]; then
+    echo "Reject memo:  ${REJECT_MEMO_DIR}"
+fi
+if [[ "${ADAPTIVE_RETRY}" == "true" ]]; then
+    echo "Retry budget: adaptive"
+fi
+if [[ -n "${BANK_DIR}" ]]; then
+    echo "Bank shard:   ${BANK_DIR}/shard_${JOB_ID}.hepb"
+fi
+if [[ -n "${LHE_LEDGER_DIR}" ]]; then
+    echo "LHE ledger:   ${LHE_LEDGER_DIR}"
+fi
 echo "=============================================="
 echo ""
 
@@ -829,6 +1121,10 @@ SELECTED_STEPS=()
 for ((i=start_idx; i<=end_idx; i++)); do
     SELECTED_STEPS+=("${STEPS[$i]}")
 done
+# A bank build only showers and publishes the shard
+if [[ -n "${BANK_DIR}" ]]; then
+    SELECTED_STEPS=("shower" "bank")
+fi
 msg_info "Planned steps: ${SELECTED_STEPS[*]}"
 
 # Validate VOMS proxy early to avoid pileup download failures
@@ -861,6 +1157,9 @@ for step in "${SELECTED_STEPS[@]}"; do
         transfer)
             transfer_output
             ;;
+        bank)
+            publish_bank_shard
+            ;;
     esac
 done
 
@@ -876,5 +1175,9 @@ fi
 msg_step "Production Complete!"
 echo "Campaign:  ${CAMPAIGN_NAME}"
 echo "Job ID:    ${JOB_ID}"
-echo "Output:    ${EOS_OUTPUT}/${CAMPAIGN_NAME}/${JOB_ID}/"
+if [[ -n "${BANK_DIR}" ]]; then
+    echo "Output:    ${BANK_DIR}/shard_${JOB_ID}.hepb"
+else
+    echo "Output:    ${EOS_OUTPUT}/${CAMPAIGN_NAME}/${JOB_ID}/"
+fi
 echo ""
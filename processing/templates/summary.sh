@@ -1,7 +1,32 @@
 #!/bin/bash
-# Simple summary script for DAG completion
+# Summary script for DAG completion: merges the run statistics records
+# (.runstats) that every job copied to EOS into per-campaign throughput and
+# efficiency reports (runstats_report, see pythia_shower/run_stats.h)
+SHOWER_DIR="/afs/cern.ch/user/x/xcheng/condor/MC_Production_DAG/Full_MC_Production/processing/pythia_shower"
+EOS_OUTPUT="/eos/user/x/xcheng/MC_Production/output"
+EOS_BANKS="/eos/user/x/xcheng/MC_Production/banks"
+
 echo "=========================================="
 echo "DAG completed successfully!"
-echo "Campaign outputs stored in /eos/user/x/xcheng/MC_Production/output/"
+echo "Campaign outputs stored in ${EOS_OUTPUT}/"
 echo "=========================================="
+
+# The report needs no CMSSW, only a compiler
+if [[ ! -x "${SHOWER_DIR}/runstats_report" ]]; then
+    make -C "${SHOWER_DIR}" runstats_report > /dev/null || true
+fi
+
+if [[ -x "${SHOWER_DIR}/runstats_report" ]]; then
+    "${SHOWER_DIR}/runstats_report" "${EOS_OUTPUT}" --json "${EOS_OUTPUT}/runstats_report.json" \
+        || echo "[WARN] No run statistics records found under ${EOS_OUTPUT}"
+    # Shower cost of the shared banks (dag_generator.py --shared-banks)
+    if [[ -d "${EOS_BANKS}" ]]; then
+        "${SHOWER_DIR}/runstats_report" "${EOS_BANKS}" --json "${EOS_BANKS}/runstats_report.json" \
+            || echo "[WARN] No run statistics records found under ${EOS_BANKS}"
+    fi
+else
+    echo "[WARN] runstats_report not available, skipping the campaign report"
+fi
+
+# The summary never fails the DAG
 exit 0